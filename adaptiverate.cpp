@@ -0,0 +1,114 @@
+#include "adaptiverate.h"
+
+#include <math.h>
+#include <string.h>
+
+float MotionEstimator::Update(const float* luma, int64_t time, uint32_t count)
+{
+    if (count > GRID_SIZE)
+        count = GRID_SIZE;
+    if (count == 0)
+        return 0.0f;
+
+    float change = 0.0f;
+    if (m_valid)
+    {
+        float sum = 0.0f;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            sum += fabsf(luma[i] - m_previous[i]);
+        }
+        change = sum / count;
+        m_interval = time > m_previousTime ? (time - m_previousTime) / 1e9 : 0.0;
+    }
+
+    m_previousTime = time;
+    memcpy(m_previous, luma, count * sizeof(float));
+    m_valid = true;
+    return change;
+}
+
+AdaptiveRateSettings DefaultAdaptiveRateSettings(uint32_t floorRate, uint32_t ceilingRate)
+{
+    AdaptiveRateSettings settings = {};
+    settings.floorRate = floorRate;
+    settings.ceilingRate = ceilingRate;
+    // mean luma change of the blurred image per second, 0.004 and 0.015 per frame at 60 fps
+    settings.lowMotion = 0.24f;
+    settings.highMotion = 0.9f;
+    // per sample, a cut is a single jump whatever the rate
+    settings.cutMotion = 0.08f;
+    settings.settleFrames = 15;
+    return settings;
+}
+
+AdaptiveFrameRate::AdaptiveFrameRate()
+{
+    Configure(DefaultAdaptiveRateSettings(30, 60));
+    ResetStats();
+}
+
+void AdaptiveFrameRate::Configure(const AdaptiveRateSettings& settings)
+{
+    m_settings = settings;
+    if (m_settings.ceilingRate == 0)
+        m_settings.ceilingRate = 1;
+    if (m_settings.floorRate == 0 || m_settings.floorRate > m_settings.ceilingRate)
+        m_settings.floorRate = m_settings.ceilingRate;
+    Reset();
+}
+
+void AdaptiveFrameRate::Reset()
+{
+    m_rate = m_settings.ceilingRate;
+    m_calmFrames = 0;
+}
+
+uint32_t AdaptiveFrameRate::Update(float motion, double interval)
+{
+    m_frames++;
+    m_seconds += 1.0 / m_rate;
+
+    if (interval <= 0.0)
+        interval = 1.0 / m_rate;
+    float speed = (float)(motion / interval);
+
+    if (motion >= m_settings.cutMotion)
+    {
+        m_rate = m_settings.ceilingRate;
+        m_calmFrames = 0;
+    }
+    else if (speed >= m_settings.highMotion)
+    {
+        m_rate = m_rate * 2 < m_settings.ceilingRate ? m_rate * 2 : m_settings.ceilingRate;
+        m_calmFrames = 0;
+    }
+    else if (speed < m_settings.lowMotion)
+    {
+        // step down by a quarter once the scene has been static for a while
+        if (++m_calmFrames >= m_settings.settleFrames)
+        {
+            uint32_t rate = m_rate * 3 / 4;
+            m_rate = rate > m_settings.floorRate ? rate : m_settings.floorRate;
+            m_calmFrames = 0;
+        }
+    }
+    else
+    {
+        // in between the thresholds, hold the current rate
+        m_calmFrames = 0;
+    }
+
+    return m_rate;
+}
+
+double AdaptiveFrameRate::GetAverageRate() const
+{
+    return m_seconds > 0.0 ? m_frames / m_seconds : 0.0;
+}
+
+void AdaptiveFrameRate::ResetStats()
+{
+    m_frames = 0;
+    m_seconds = 0.0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+// Effect frame rate that follows the motion of the blurred source.
+
+#include <stdint.h>
+
+// size of the luma grid sampled from the blurred image
+#define MOTION_GRID_WIDTH  32
+#define MOTION_GRID_HEIGHT 18
+
+// Mean absolute luma difference between consecutive grids.
+class MotionEstimator
+{
+public:
+    static constexpr uint32_t GRID_SIZE = MOTION_GRID_WIDTH * MOTION_GRID_HEIGHT;
+
+    MotionEstimator() { Reset(); }
+
+    // returns the change against the previous grid, 0 for the first one;
+    // time is when the grid was sampled, in nanoseconds
+    float Update(const float* luma, int64_t time, uint32_t count = GRID_SIZE);
+    // seconds between the last two grids, 0 before the second one
+    double GetInterval() const { return m_interval; }
+    void Reset() { m_valid = false; m_interval = 0.0; }
+
+private:
+    float m_previous[GRID_SIZE];
+    int64_t m_previousTime;
+    double m_interval;
+    bool m_valid;
+};
+
+struct AdaptiveRateSettings
+{
+    uint32_t floorRate;
+    uint32_t ceilingRate;
+    // luma change per second, below: counts as static, above: steps the rate up
+    float lowMotion;
+    float highMotion;
+    // luma change between two samples, a scene cut jumps straight to the ceiling
+    float cutMotion;
+    // consecutive static frames before each step down
+    uint32_t settleFrames;
+};
+
+AdaptiveRateSettings DefaultAdaptiveRateSettings(uint32_t floorRate, uint32_t ceilingRate);
+
+// Frame rate controller with hysteresis: fast to react to motion, slow to drop down.
+class AdaptiveFrameRate
+{
+public:
+    AdaptiveFrameRate();
+
+    void Configure(const AdaptiveRateSettings& settings);
+    // start over from the ceiling
+    void Reset();
+
+    // Feed the change since the previous sample and the seconds between the two, returns
+    // the rate for the next frame. The thresholds compare the change per second, so a
+    // lower rate and its larger steps do not read as more motion. Without an interval
+    // the current rate is assumed.
+    uint32_t Update(float motion, double interval);
+    uint32_t GetRate() const { return m_rate; }
+    // motion at or above the cut threshold
+    bool IsSceneCut(float motion) const { return motion >= m_settings.cutMotion; }
+
+    // frames and average rate since the last ResetStats
+    uint64_t GetFrames() const { return m_frames; }
+    double GetAverageRate() const;
+    void ResetStats();
+
+private:
+    AdaptiveRateSettings m_settings;
+    uint32_t m_rate;
+    uint32_t m_calmFrames;
+
+    uint64_t m_frames;
+    double m_seconds;
+};
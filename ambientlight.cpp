@@ -2,16 +2,22 @@
 //
 
 #include "ambientlight.h"
+#include "texturepool_d3d.h"
 #include "ui.h"
 
 #include <algorithm>
 
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "dcomp.lib")
-#pragma comment(lib, "Winmm.lib")
 
 #define IS_BOX_EMPTY(box) ((box).left >= (box).right || (box).top >= (box).bottom)
 
+#define SWAPCHAIN_BUFFER_COUNT 2
+// idle wakeup period when auto detection is off, only settings are polled
+#define IDLE_POLL_INTERVAL 1000
+// the preset textures are created once startup or a switch has settled
+#define PREWARM_DELAY_MS 2000
+
 D3D11_BOX GetMirroredBox(D3D11_BOX box, UINT width, UINT height)
 {
     D3D11_BOX mirrored = box;
@@ -30,29 +36,62 @@ D3D11_BOX GetMirroredBox(D3D11_BOX box, UINT width, UINT height)
     return mirrored;
 }
 
+static BarLayout ToBarLayout(const BlackBars& bars)
+{
+    BarLayout layout = {};
+    layout.count = (uint32_t)min(bars.size(), ARRAYSIZE(layout.sizes));
+    for (uint32_t i = 0; i < layout.count; i++)
+    {
+        layout.positions[i] = bars[i].position;
+        layout.sizes[i] = (bars[i].position == Left || bars[i].position == Right) ? bars[i].width : bars[i].height;
+    }
+    return layout;
+}
+
 
 
 AmbientLight::AmbientLight()
     : m_effectRendered(false),
+    m_clearCanvas(true),
     m_presented(false),
     m_gameWidth(0),
     m_gameHeight(0),
     m_windowWidth(0),
     m_windowHeight(0),
     m_effectZoom(0),
+    m_effectMipLevel(0),
+    m_renderPlan(),
+    m_configured(),
+    m_reconfigureAll(true),
+    m_prewarmStarted(false),
     m_frameRate(60),
     m_hwnd(nullptr),
-    m_lastPresentTime(0),
-    m_perfFreq(0),
+    m_framePacer(m_frameClock),
     m_showConfigWindow(false),
-    m_clearConfigWindow(false)
+    m_clearConfigWindow(false),
+    m_barRectCount(0),
+    m_barSurfaceCount(0),
+    m_capturedFrames(0),
+    m_lastCaptureTime(0),
+    m_sourceTime(0),
+    m_perf(),
+    m_sourceRefreshed(false),
+    m_lastFrameTime(0),
+    m_frameInterval(0.0),
+    m_missedFrames(0),
+    m_fullRefreshCount(SWAPCHAIN_BUFFER_COUNT),
+    m_pixelsProcessed(0),
+    m_frameIndex(0)
 {
-    m_dirtyRects[0] = { 0, 0, 0, 0 };
-    m_dirtyRects[1] = { 0, 0, 0, 0 };
+    m_barRects[0] = { 0, 0, 0, 0 };
+    m_barRects[1] = { 0, 0, 0, 0 };
 }
 
 AmbientLight::~AmbientLight()
 {
+    m_prewarmer.Stop();
+    FlushSettings();
+    TRACE_DUMP(GetDataFile(L"trace.json").c_str());
 }
 
 LRESULT AmbientLight::WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
@@ -92,58 +131,230 @@ RECT AmbientLight::GetPresentRect()
 void AmbientLight::UpdateSettings()
 {
     ValidateSettings();
+    UpdateBarRects();
+    UpdateMetricsServer();
+
+    // bars may have moved, every back buffer needs a full refresh
+    m_fullRefreshCount = SWAPCHAIN_BUFFER_COUNT;
 
     if (m_hwnd)
     {
+        TexturePoolStats poolBefore = GetTexturePool().GetPool().GetStats();
+        m_reconfigurePerfTimer.Start();
+
+        auto df = GetDesktopFormat();
+        ReconfigureInputs inputs = GetReconfigureInputs(df);
+        uint32_t stages = m_reconfigureAll ? ReconfigureAll : GetReconfigureStages(m_configured, inputs);
+        m_configured = inputs;
+        m_reconfigureAll = false;
+
         //m_blurPre.Initialize(m_device,
         //    m_deferred,
         //    m_gameWidth,
         //    m_gameHeight,
         //    m_settings.blurSamples);
 
-        UINT mipWidth = max(1u, m_gameWidth >> m_settings.mipmapLevels);
-        UINT mipHeight = max(1u, m_gameHeight >> m_settings.mipmapLevels);
-        m_blurDownscale.Initialize(m_device,
-            m_deferred,
-            mipWidth,
-            mipHeight,
-            m_settings.blurSamples);
+        if (stages & ReconfigureVignette)
+        {
+            float windowAspect = (float)m_windowWidth / (float)m_windowHeight;
+            m_vignette.Initialize(m_device,
+                m_deferred,
+                m_settings.vignetteIntensity,
+                m_settings.vignetteRadius,
+                m_settings.vignetteSmoothness,
+                windowAspect);
+        }
 
-        float windowAspect = (float)m_windowWidth / (float)m_windowHeight;
-        m_vignette.Initialize(m_device,
-            m_deferred,
-            m_settings.vignetteIntensity,
-            m_settings.vignetteRadius,
-            m_settings.vignetteSmoothness,
-            windowAspect);
+        GetResourceRegistry().SetBudget(inputs.memoryBudget);
+        GetTexturePool().SetCap((UINT64)m_settings.texturePoolSize * 1024 * 1024);
 
-        auto df = GetDesktopFormat();
-        CreateOffscreen(df.format);
+        if (stages & ReconfigureOffscreen)
+            CreateOffscreen(df.format);
+        if (stages & ReconfigureBarSurfaces)
+            UpdateBarSurfaces(df.format);
+
+        if (stages & ReconfigureBlur)
+        {
+            // sized by the downsampled texture, which the budget may have made smaller
+            m_blurDownscale.Initialize(m_device,
+                m_deferred,
+                max(1u, m_gameWidth >> m_effectMipLevel),
+                max(1u, m_gameHeight >> m_effectMipLevel),
+                m_settings.blurSamples);
+        }
+
+        RenderPlanInputs planInputs = {};
+        planInputs.windowWidth = m_windowWidth;
+        planInputs.windowHeight = m_windowHeight;
+        planInputs.gameWidth = m_gameWidth;
+        planInputs.gameHeight = m_gameHeight;
+        planInputs.bars = ToBarLayout(m_blackBars);
+        planInputs.mipLevel = m_effectMipLevel;
+        planInputs.zoom = m_effectZoom;
+        planInputs.stretchFactor = m_settings.stretchFactor;
+        planInputs.mirrored = m_settings.mirrored;
+        m_renderPlan = BuildRenderPlan(planInputs);
+
+        // the composite only writes the bar rectangles, clear the rest once
+        if (stages & (ReconfigureOffscreen | ReconfigureBarSurfaces))
+            m_clearCanvas = true;
 
         DXGI_COLOR_SPACE_TYPE colorSpace = df.colorSpace;
-        m_detection.Initialize(m_device,
-            m_immediate,
-            m_windowWidth,
-            m_windowHeight,
-            m_settings.autoDetectionBrightnessThreshold,
-            m_settings.autoDetectionBlackRatio,
-            m_settings.autoDetectionSymmetricBars,
-            m_settings.autoDetectionReservedArea ? m_settings.autoDetectionReservedWidth : 0,
-            m_settings.autoDetectionReservedArea ? m_settings.autoDetectionReservedHeight : 0,
-            colorSpace);
+        if (stages & ReconfigureDetection)
+        {
+            m_detection.Initialize(m_device,
+                m_immediate,
+                m_windowWidth,
+                m_windowHeight,
+                m_settings.autoDetectionBrightnessThreshold,
+                m_settings.autoDetectionBlackRatio,
+                m_settings.autoDetectionSymmetricBars,
+                m_settings.autoDetectionReservedArea ? m_settings.autoDetectionReservedWidth : 0,
+                m_settings.autoDetectionReservedArea ? m_settings.autoDetectionReservedHeight : 0,
+                colorSpace);
+        }
+
+        if (stages & ReconfigureDetectionInner)
+        {
+            m_detectInner.Initialize(m_device,
+                m_deferred,
+                m_gameWidth,
+                m_gameHeight,
+                m_settings.autoDetectionBrightnessThreshold,
+                m_settings.autoDetectionBlackRatio,
+                false,
+                0,
+                0,
+                colorSpace);
+        }
+
+        // a new ImGui context and font atlas only for a new UI scale, InitUI sets the window flags too
+        if (stages & ReconfigureUI)
+            InitUI(m_hwnd, m_device.Get(), m_deferred.Get(), m_settings);
+        else if (stages & ReconfigureWindow)
+            UpdateWindowFlags(m_hwnd, m_settings);
+
+        m_reconfigurePerfTimer.Stop();
+
+        // a switch to a size the pool holds only leases textures, compare the time with
+        // the pooled and created counts to see what warming saves
+        TexturePoolStats poolAfter = GetTexturePool().GetPool().GetStats();
+        char names[128];
+        char buffer[256];
+        FormatReconfigureStages(stages, names, sizeof(names));
+        sprintf_s(buffer, "=== Reconfigure %.3fms, %llu pooled, %llu created: %s\n", m_reconfigurePerfTimer.GetLast(),
+            poolAfter.hits - poolBefore.hits, poolAfter.misses - poolBefore.misses, names);
+        OutputDebugStringA(buffer);
+
+        if (!m_settings.prewarm)
+        {
+            m_prewarmer.Stop();
+            m_prewarmStarted = false;
+        }
+        else if ((stages & ReconfigureOffscreen) || !m_prewarmStarted)
+        {
+            StartPrewarm(df.format);
+            m_prewarmStarted = true;
+        }
+    }
+}
+
+void AmbientLight::ApplySettingsChanges(UINT changes)
+{
+    if (changes & SettingsChangeRender)
+    {
+        UpdateSettings();
+        return;
+    }
 
-        m_detectInner.Initialize(m_device,
-            m_deferred,
-            m_gameWidth,
-            m_gameHeight,
-            m_settings.autoDetectionBrightnessThreshold,
-            m_settings.autoDetectionBlackRatio,
-            false,
-            0,
-            0,
-            colorSpace);
+    // the metrics port or the pool size alone leave the pipeline as it is
+    if (changes & SettingsChangeMetrics)
+        UpdateMetricsServer();
+    if (changes & SettingsChangeTexturePool)
+        GetTexturePool().SetCap((UINT64)m_settings.texturePoolSize * 1024 * 1024);
+}
+
+void AmbientLight::StartPrewarm(DXGI_FORMAT format)
+{
+    PrewarmInputs inputs = {};
+    inputs.windowWidth = m_windowWidth;
+    inputs.windowHeight = m_windowHeight;
+    inputs.gameWidth = m_gameWidth;
+    inputs.gameHeight = m_gameHeight;
+    inputs.nativeFormat = format;
+    inputs.format = ToResourceFormat(format);
+    inputs.mipmapLevels = m_settings.mipmapLevels;
+    inputs.temporalInterpolation = m_settings.temporalInterpolation;
+    inputs.budget = GetResourceRegistry().GetBudget();
+    inputs.cap = GetTexturePool().GetPool().GetCap();
+
+    std::vector<PrewarmPreset> presets;
+    for (const ResolutionSettings& resolution : m_settings.resolutions.available)
+        presets.push_back({ resolution.width, resolution.height });
+    std::vector<TexturePoolKey> plan = PlanPrewarm(inputs, presets.data(), presets.size());
+
+    // sizes switched to before are in the pool already
+    const TexturePool& pool = GetTexturePool().GetPool();
+    plan.erase(std::remove_if(plan.begin(), plan.end(), [&](const TexturePoolKey& key)
+    {
+        return pool.FindIdle(key) != POOL_ENTRY_NONE;
+    }), plan.end());
+
+    m_prewarmer.Start(m_device.Get(), std::move(plan), PREWARM_DELAY_MS);
+}
 
-        InitUI(m_hwnd, m_device.Get(), m_deferred.Get(), m_settings);
+ReconfigureInputs AmbientLight::GetReconfigureInputs(const DesktopFormat& format)
+{
+    ReconfigureInputs inputs = {};
+    inputs.windowWidth = m_windowWidth;
+    inputs.windowHeight = m_windowHeight;
+    inputs.gameWidth = m_gameWidth;
+    inputs.gameHeight = m_gameHeight;
+    inputs.barRectCount = m_barRectCount;
+    for (UINT i = 0; i < m_barRectCount; i++)
+    {
+        inputs.barRects[i][0] = m_barRects[i].left;
+        inputs.barRects[i][1] = m_barRects[i].top;
+        inputs.barRects[i][2] = m_barRects[i].right;
+        inputs.barRects[i][3] = m_barRects[i].bottom;
+    }
+    inputs.format = format.format;
+    inputs.colorSpace = format.colorSpace;
+    inputs.mipmapLevels = m_settings.mipmapLevels;
+    inputs.memoryBudget = (UINT64)m_settings.memoryBudget * 1024 * 1024;
+    inputs.temporalInterpolation = m_settings.temporalInterpolation;
+    inputs.barSurfaces = m_settings.barSurfaces;
+    inputs.barSurfaceScale = m_settings.barSurfaceScale;
+    inputs.blurSamples = m_settings.blurSamples;
+    inputs.vignetteIntensity = m_settings.vignetteIntensity;
+    inputs.vignetteRadius = m_settings.vignetteRadius;
+    inputs.vignetteSmoothness = m_settings.vignetteSmoothness;
+    inputs.brightnessThreshold = m_settings.autoDetectionBrightnessThreshold;
+    inputs.blackRatio = m_settings.autoDetectionBlackRatio;
+    inputs.symmetricBars = m_settings.autoDetectionSymmetricBars;
+    inputs.reservedWidth = m_settings.autoDetectionReservedArea ? m_settings.autoDetectionReservedWidth : 0;
+    inputs.reservedHeight = m_settings.autoDetectionReservedArea ? m_settings.autoDetectionReservedHeight : 0;
+    inputs.uiScale = m_settings.uiScale;
+    inputs.showInTaskbar = m_settings.showInTaskbar;
+    return inputs;
+}
+
+void AmbientLight::UpdateMetricsServer()
+{
+    if (!m_settings.metricsEnabled)
+    {
+        m_metrics.Stop();
+        return;
+    }
+
+    if (m_metrics.IsRunning() && m_metrics.GetPort() == m_settings.metricsPort)
+        return;
+
+    if (!m_metrics.Start((uint16_t)m_settings.metricsPort, m_perfSnapshot))
+    {
+        char buffer[128];
+        sprintf_s(buffer, "=== Metrics endpoint could not listen on port %u\n", m_settings.metricsPort);
+        OutputDebugStringA(buffer);
     }
 }
 
@@ -151,10 +362,14 @@ void AmbientLight::ValidateSettings()
 {
     if (m_settings.loaded && m_settings.useAutoDetection)
     {
-        m_blackBars = m_detection.GetDetectedBars();
+        m_blackBars = m_trackedBars;
     }
     else
     {
+        // start over from the first pass when auto detection is turned back on
+        m_barTracker.Reset();
+        m_trackedBars.clear();
+
         // Validate game width and height
         UINT width = m_settings.gameWidth;
         UINT height = m_settings.gameHeight;
@@ -188,6 +403,11 @@ void AmbientLight::ValidateSettings()
             m_gameHeight = m_windowHeight - m_blackBars[0].height - m_blackBars[1].height;
     }
 
+    // Validate detection hysteresis
+    m_settings.autoDetectionConfirmations = std::clamp(m_settings.autoDetectionConfirmations, 1u, 20u);
+    m_settings.autoDetectionJitter = std::clamp(m_settings.autoDetectionJitter, 0u, 64u);
+    m_barTracker.Configure({ m_settings.autoDetectionConfirmations, m_settings.autoDetectionJitter });
+
     // Validate blur settings
     m_settings.blurPasses = std::clamp(m_settings.blurPasses, 0u, 128u);
     m_settings.mipmapLevels = std::clamp(m_settings.mipmapLevels, 0u, 12u);
@@ -198,15 +418,50 @@ void AmbientLight::ValidateSettings()
     m_settings.vignetteRadius = std::clamp(m_settings.vignetteRadius, 0.0f, 1.0f);
     m_settings.vignetteSmoothness = std::clamp(m_settings.vignetteSmoothness, 0.0f, 1.0f);
 
+    // Validate bar surface settings
+    m_settings.barSurfaceScale = std::clamp(m_settings.barSurfaceScale, 1u, 8u);
+
     // Validate frame rate
     m_settings.frameRate = std::clamp(m_settings.frameRate, 10u, 1000u);
     m_frameRate = m_settings.frameRate;
+    m_framePacer.SetFrameRate(m_frameRate);
+
+    m_settings.minFrameRate = std::clamp(m_settings.minFrameRate, 10u, m_settings.frameRate);
+    m_adaptiveRate.Configure(DefaultAdaptiveRateSettings(m_settings.minFrameRate, m_frameRate));
+
+    m_settings.captureRate = std::clamp(m_settings.captureRate, 10u, m_settings.frameRate);
+
+    // with nothing to draw, wake up for detection only
+    UINT idleInterval = m_settings.useAutoDetection ? (UINT)max(m_settings.autoDetectionTime, 1) : IDLE_POLL_INTERVAL;
+    m_scheduler.SetIdleInterval((INT64)idleInterval * 1000000);
 
     // Validate zoom
     m_settings.zoom = std::clamp(m_settings.zoom, 0u, 16u);
     m_effectZoom = m_settings.zoom * 4;
 }
 
+void AmbientLight::UpdateBarRects()
+{
+    memset(m_barRects, 0, sizeof(m_barRects));
+    m_barRectCount = 0;
+    for (auto& bar : m_blackBars)
+    {
+        if (m_barRectCount >= ARRAYSIZE(m_barRects))
+            break;
+
+        D3D11_RECT rect = bar.toRect();
+        if (IS_BOX_EMPTY(rect))
+            continue;
+        m_barRects[m_barRectCount++] = rect;
+    }
+
+    TRACE_INSTANT("bars",
+        { "count", m_barRectCount },
+        { "gameWidth", m_gameWidth },
+        { "gameHeight", m_gameHeight },
+        { "barSize", m_barRectCount > 0 ? max(RECT_WIDTH(m_barRects[0]), RECT_HEIGHT(m_barRects[0])) : 0 });
+}
+
 AmbientLight::DesktopFormat AmbientLight::GetDesktopFormat()
 {
     AmbientLight::DesktopFormat f = {
@@ -233,9 +488,6 @@ HRESULT AmbientLight::Initialize(HWND hwnd)
 
     m_resetUiPosition = true;
 
-    QueryPerformanceFrequency((LARGE_INTEGER*)&m_perfFreq);
-    timeBeginPeriod(1);
-
     // create device
     D3D_FEATURE_LEVEL featureLevels[] = { D3D_FEATURE_LEVEL_11_0 };
     D3D_FEATURE_LEVEL featureLevel;
@@ -253,8 +505,10 @@ HRESULT AmbientLight::Initialize(HWND hwnd)
     hr = m_device.As(&dxgiDevice);
     RETURN_IF_FAILED(hr);
 
-    ComPtr<IDXGIFactory2> dxgiFactory2;
-    hr = CreateDXGIFactory2(0, __uuidof(IDXGIFactory2), &dxgiFactory2);
+    ReleaseBarSurfaces();
+
+    hr = CreateDXGIFactory2(0, __uuidof(IDXGIFactory2), &m_dxgiFactory);
+    RETURN_IF_FAILED(hr);
 
     RECT windowRect = { 0 };
     GetWindowRect(hwnd, &windowRect);
@@ -262,6 +516,7 @@ HRESULT AmbientLight::Initialize(HWND hwnd)
     m_windowHeight = RECT_HEIGHT(windowRect);
 
     HMONITOR monitor = GetDisplayMonitor(m_settings.display);
+    m_desktopView = TextureView();
     hr = m_capture.Initialize(m_device, monitor, m_settings.hdrSupport);
 
     // create swap chain
@@ -272,14 +527,22 @@ HRESULT AmbientLight::Initialize(HWND hwnd)
     scd.Height = m_windowHeight;
     scd.Format = df.format;
     scd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-    scd.BufferCount = 2;
+    scd.BufferCount = SWAPCHAIN_BUFFER_COUNT;
     scd.SampleDesc.Count = 1;
     scd.SampleDesc.Quality = 0;
     scd.AlphaMode = DXGI_ALPHA_MODE_PREMULTIPLIED;
     scd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
     scd.Scaling = DXGI_SCALING_STRETCH;
 
-    hr = dxgiFactory2->CreateSwapChainForComposition(m_device.Get(), &scd, nullptr, &m_swapchain);
+    ResourceDesc swapchainDesc = { ResourceOwnerPresent, "swapchain", scd.Width, scd.Height,
+        ToResourceFormat(scd.Format), 1, scd.BufferCount, ResourceDowngradeNone };
+    hr = AllocateResource(swapchainDesc, [&](const ResourceDesc&, ResourceId id)
+    {
+        HRESULT result = m_dxgiFactory->CreateSwapChainForComposition(m_device.Get(), &scd, nullptr, &m_swapchain);
+        if (SUCCEEDED(result))
+            result = TrackResource(m_swapchain.Get(), id);
+        return result;
+    });
     char buffer[256];
     sprintf_s(buffer, "Swapchain created: %dx%d, format: %s\n", scd.Width, scd.Height,
         scd.Format == DXGI_FORMAT_B8G8R8A8_UNORM ? "BGRA8"
@@ -290,31 +553,52 @@ HRESULT AmbientLight::Initialize(HWND hwnd)
     OutputDebugStringA(buffer);
     RETURN_IF_FAILED(hr);
 
+    ComPtr<ID3D11Texture2D> backBuffer;
+    hr = m_swapchain->GetBuffer(0, __uuidof(ID3D11Texture2D), &backBuffer);
+    RETURN_IF_FAILED(hr);
+    m_backBuffer.Clear();
+    m_backBuffer.CreateViews(m_device.Get(), backBuffer.Get(), true, false, false);
+
     hr = DCompositionCreateDevice(dxgiDevice.Get(), __uuidof(IDCompositionDevice), &m_dcompDevice);
     RETURN_IF_FAILED(hr);
 
     hr = m_dcompDevice->CreateTargetForHwnd(m_hwnd, TRUE, &m_dcompTarget);
     RETURN_IF_FAILED(hr);
 
+    // root
+    //  +- bar surface visuals (optional)
+    //  +- full window visual, effects canvas and UI
+    hr = m_dcompDevice->CreateVisual(&m_dcompRoot);
+    RETURN_IF_FAILED(hr);
+
     hr = m_dcompDevice->CreateVisual(&m_dcompVisual);
     RETURN_IF_FAILED(hr);
 
     hr = m_dcompVisual->SetContent(m_swapchain.Get());
     RETURN_IF_FAILED(hr);
 
-    hr = m_dcompTarget->SetRoot(m_dcompVisual.Get());
+    hr = m_dcompRoot->AddVisual(m_dcompVisual.Get(), FALSE, nullptr);
+    RETURN_IF_FAILED(hr);
+
+    hr = m_dcompTarget->SetRoot(m_dcompRoot.Get());
     RETURN_IF_FAILED(hr);
 
     hr = m_dcompDevice->Commit();
     RETURN_IF_FAILED(hr);
 
-    m_copy.Initialize(m_device, m_deferred.Get());
+    m_composite.Initialize(m_device, m_deferred.Get());
+    m_motion.Initialize(m_device, m_deferred.Get());
 
     m_gameTexture.Clear();
     m_downsampledTexture.Clear();
-    m_processedBlurTexture.Clear();
     m_effectCanvasTexture.Clear();
 
+    // the window may have a new size, take the first detection pass as it is
+    m_barTracker.Reset();
+    m_trackedBars.clear();
+    m_sceneCut.Reset();
+
+    m_reconfigureAll = true;
     UpdateSettings();
 
     return 0;
@@ -324,59 +608,230 @@ HRESULT AmbientLight::CreateOffscreen(DXGI_FORMAT format)
 {
     HRESULT hr = S_OK;
     // Create with full mip chain (0) and enable mip generation support
-    m_gameTexture.RecreateTexture(m_device.Get(), format, m_gameWidth, m_gameHeight, 0, true);
+    m_gameTexture.RecreateTexture(m_device.Get(), format, m_gameWidth, m_gameHeight, 0, true,
+        ResourceOwnerEffect, "game");
 
-    // m_downsampledTexture now matches the selected mip level size
+    // m_downsampledTexture now matches the selected mip level size. Over the memory budget
+    // it takes a higher mip instead, as long as the game texture has one.
     UINT mipWidth = max(1u, m_gameWidth >> m_settings.mipmapLevels);
     UINT mipHeight = max(1u, m_gameHeight >> m_settings.mipmapLevels);
+    bool canDowngrade = m_settings.mipmapLevels + RESOURCE_MAX_MIP_SHIFT < GetMipChainLength(m_gameWidth, m_gameHeight);
     m_downsampledTexture.RecreateTexture(m_device.Get(), format,
         mipWidth,
-        mipHeight);
+        mipHeight,
+        1, false, ResourceOwnerEffect, "downsampled", canDowngrade ? ResourceDowngradeMip : ResourceDowngradeNone);
 
-    m_processedBlurTexture.RecreateTexture(m_device.Get(), format,
-        m_gameWidth,
-        m_gameHeight);
+    const ResourceRecord* downsampled = m_downsampledTexture.GetResource();
+    m_effectMipLevel = m_settings.mipmapLevels + (downsampled ? downsampled->grant.mipShift : 0);
+    mipWidth = max(1u, m_gameWidth >> m_effectMipLevel);
+    mipHeight = max(1u, m_gameHeight >> m_effectMipLevel);
 
-    m_effectCanvasTexture.RecreateTexture(m_device.Get(), format,
-        m_windowWidth,
-        m_windowHeight);
+    // history for temporal interpolation, the size of the blurred mip
+    if (m_settings.temporalInterpolation)
+    {
+        m_previousTexture.RecreateTexture(m_device.Get(), format,
+            mipWidth,
+            mipHeight,
+            1, false, ResourceOwnerEffect, "previous");
+    }
+    else
+    {
+        m_previousTexture.Clear();
+    }
+    m_capturedFrames = 0;
+
+    if (m_settings.barSurfaces)
+    {
+        // each bar surface has its own canvas
+        m_effectCanvasTexture.Clear();
+    }
+    else
+    {
+        m_effectCanvasTexture.RecreateTexture(m_device.Get(), format,
+            m_windowWidth,
+            m_windowHeight,
+            1, false, ResourceOwnerEffect, "canvas");
+    }
 
     return hr;
 }
 
+HRESULT AmbientLight::UpdateBarSurfaces(DXGI_FORMAT format)
+{
+    HRESULT hr = S_OK;
+
+    ReleaseBarSurfaces();
+
+    if (m_settings.barSurfaces && m_dxgiFactory && m_dcompRoot)
+    {
+        SurfaceRect rects[ARRAYSIZE(m_barRects)] = {};
+        for (UINT i = 0; i < m_barRectCount; i++)
+        {
+            rects[i] = { (uint32_t)m_barRects[i].left, (uint32_t)m_barRects[i].top,
+                (uint32_t)m_barRects[i].right, (uint32_t)m_barRects[i].bottom };
+        }
+
+        UINT bytesPerPixel = (format == DXGI_FORMAT_R16G16B16A16_FLOAT) ? 8 : 4;
+        SurfacePlan plan = PlanBarSurfaces(rects, m_barRectCount, m_settings.barSurfaceScale, bytesPerPixel, SWAPCHAIN_BUFFER_COUNT);
+        SurfacePlan windowPlan = PlanWindowSurface(m_windowWidth, m_windowHeight, bytesPerPixel, SWAPCHAIN_BUFFER_COUNT);
+
+        for (UINT i = 0; i < plan.count; i++)
+        {
+            const PlannedSurface& planned = plan.surfaces[i];
+            BarSurface& surface = m_barSurfaces[i];
+
+            DXGI_SWAP_CHAIN_DESC1 scd = {};
+            scd.Width = planned.width;
+            scd.Height = planned.height;
+            scd.Format = format;
+            scd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+            scd.BufferCount = SWAPCHAIN_BUFFER_COUNT;
+            scd.SampleDesc.Count = 1;
+            scd.SampleDesc.Quality = 0;
+            scd.AlphaMode = DXGI_ALPHA_MODE_PREMULTIPLIED;
+            scd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
+            scd.Scaling = DXGI_SCALING_STRETCH;
+
+            ResourceDesc swapchainDesc = { ResourceOwnerPresent, "bar swapchain", scd.Width, scd.Height,
+                ToResourceFormat(scd.Format), 1, scd.BufferCount, ResourceDowngradeNone };
+            hr = AllocateResource(swapchainDesc, [&](const ResourceDesc&, ResourceId id)
+            {
+                HRESULT result = m_dxgiFactory->CreateSwapChainForComposition(m_device.Get(), &scd, nullptr, &surface.swapchain);
+                if (SUCCEEDED(result))
+                    result = TrackResource(surface.swapchain.Get(), id);
+                return result;
+            });
+            if (SUCCEEDED(hr))
+                hr = surface.swapchain->GetBuffer(0, __uuidof(ID3D11Texture2D), &surface.buffer);
+            if (SUCCEEDED(hr))
+                hr = m_dcompDevice->CreateVisual(&surface.visual);
+            if (SUCCEEDED(hr))
+                hr = surface.visual->SetContent(surface.swapchain.Get());
+            if (SUCCEEDED(hr))
+                hr = surface.visual->SetBitmapInterpolationMode(DCOMPOSITION_BITMAP_INTERPOLATION_MODE_LINEAR);
+            if (SUCCEEDED(hr))
+            {
+                // scale the surface up to the bar and move it into place
+                D2D_MATRIX_3X2_F transform = {};
+                transform._11 = planned.scaleX;
+                transform._22 = planned.scaleY;
+                transform._31 = (float)planned.window.left;
+                transform._32 = (float)planned.window.top;
+                hr = surface.visual->SetTransform(transform);
+            }
+            if (SUCCEEDED(hr))
+            {
+                // below the full window visual, so the UI stays on top
+                hr = m_dcompRoot->AddVisual(surface.visual.Get(), TRUE, nullptr);
+            }
+            if (SUCCEEDED(hr))
+                hr = surface.canvas.RecreateTexture(m_device.Get(), format, planned.width, planned.height,
+                    1, false, ResourceOwnerEffect, "bar canvas");
+
+            if (FAILED(hr))
+            {
+                surface = {};
+                break;
+            }
+
+            surface.plan = planned;
+            m_barSurfaceCount++;
+        }
+
+        if (FAILED(hr))
+        {
+            // fall back to the full window canvas
+            ReleaseBarSurfaces();
+            m_effectCanvasTexture.RecreateTexture(m_device.Get(), format, m_windowWidth, m_windowHeight,
+                1, false, ResourceOwnerEffect, "canvas");
+        }
+        else
+        {
+            char buffer[256];
+            sprintf_s(buffer, "Bar surfaces: %u at 1/%u, %.2f MiB vs %.2f MiB full window, %llu vs %llu px per frame\n",
+                plan.count, m_settings.barSurfaceScale,
+                plan.bytes / (1024.0 * 1024.0), windowPlan.bytes / (1024.0 * 1024.0),
+                plan.pixelsPerFrame, windowPlan.pixelsPerFrame);
+            OutputDebugStringA(buffer);
+        }
+    }
+
+    UpdateWindowVisual();
+
+    return hr;
+}
+
+void AmbientLight::ReleaseBarSurfaces()
+{
+    for (UINT i = 0; i < m_barSurfaceCount; i++)
+    {
+        BarSurface& surface = m_barSurfaces[i];
+        if (m_dcompRoot && surface.visual)
+            m_dcompRoot->RemoveVisual(surface.visual.Get());
+        surface = {};
+    }
+    m_barSurfaceCount = 0;
+}
+
+void AmbientLight::UpdateWindowVisual()
+{
+    if (!m_dcompVisual || !m_dcompDevice)
+        return;
+
+    // With bar surfaces the full window swapchain only hosts the UI, keep it out of
+    // the composition while the UI is hidden.
+    bool showWindowSurface = m_barSurfaceCount == 0 || m_showConfigWindow;
+    m_dcompVisual->SetContent(showWindowSurface ? m_swapchain.Get() : nullptr);
+    m_dcompDevice->Commit();
+}
+
 void AmbientLight::Render()
 {
     if (nullptr == m_device)
         return;
 
-#ifdef _DEBUG
+    // per-stage stats are collected in every build and rotated once a second
     static ULONGLONG lastLogTime = 0;
     ULONGLONG currentTime = GetTickCount64();
     if (1000 < (currentTime - lastLogTime))
     {
-
-        OutputDebugStringA("=== Performance (ms):\n");
-        m_framePerfTimer.PrintToDebug();
-        m_capturePerfTimer.PrintToDebug();
-        m_renderPerfTimer.PrintToDebug();
-        m_detectPerfTimer.PrintToDebug();
-        m_sleepPerfTimer.PrintToDebug();
+        LogStats();
         lastLogTime = currentTime;
+    }
+    m_pixelsProcessed = 0;
 
-        UINT ref = m_device->AddRef();
-        ref = m_device->Release();
+    // textures of the other presets finished in the background go to the pool
+    m_prewarmer.Adopt(m_device.Get());
 
-        char buffer[64];
-        sprintf_s(buffer, "=== Device ref %u\n", ref);
-        OutputDebugStringA(buffer);
+    INT64 now = m_frameClock.Now();
+    m_scheduler.SetActive(!IsIdle(), now);
+    if (!m_scheduler.IsActive())
+    {
+        // nothing to draw, only poll detection and settings
+        if (m_scheduler.Tick(now))
+        {
+            // do not hold on to a duplicated frame while sleeping
+            m_capture.ReleaseFrame();
+            Detect(true);
+            m_capture.ReleaseFrame();
+
+            ApplySettingsChanges(ReadSettings(m_settings));
+        }
+        // the idle gap is not a frame interval, nor a missed frame
+        m_lastFrameTime = 0;
+        m_framePacer.Reset();
+        return;
     }
-#endif
+    m_scheduler.Tick(now);
+    m_sourceRefreshed = false;
 
+    TRACE_SET_FRAME(++m_frameIndex);
     ScopedPerfTimer frameTimer(m_framePerfTimer);
 
+    bool refreshSource = IsCaptureDue(now);
     {
         m_capture.ReleaseFrame();
-        if (ShouldRenderEffect())
+        if (ShouldRenderEffect() && refreshSource)
         {
             ScopedPerfTimer captureTimer(m_capturePerfTimer);
             m_capture.Capture();
@@ -387,7 +842,7 @@ void AmbientLight::Render()
         ScopedPerfTimer renderTimer(m_renderPerfTimer);
         if (ShouldRenderEffect())
         {
-            RenderEffects();
+            RenderEffects(refreshSource);
         }
         else
         {
@@ -405,9 +860,144 @@ void AmbientLight::Render()
         Detect();
     }
 
-    bool changed = ReadSettings(m_settings);
-    if (changed)
-        UpdateSettings();
+    ApplySettingsChanges(ReadSettings(m_settings));
+
+    PublishPerfSnapshot(now);
+}
+
+void AmbientLight::PublishPerfSnapshot(INT64 now)
+{
+    if (m_lastFrameTime != 0)
+    {
+        double interval = (double)(now - m_lastFrameTime);
+        m_frameInterval = m_frameInterval > 0.0 ? m_frameInterval * 0.9 + interval * 0.1 : interval;
+    }
+    m_lastFrameTime = now;
+
+    if (ShouldRenderEffect())
+    {
+        if (m_sourceRefreshed)
+            m_perf.capturesProcessed++;
+        else
+            m_perf.capturesSkipped++;
+    }
+
+    // the frame timer is still running, it shows the previous frame
+    m_perf.frame = m_frameIndex;
+    m_perf.stageMs[PerfStageFrame] = m_framePerfTimer.GetLast();
+    m_perf.stageMs[PerfStageCapture] = m_sourceRefreshed ? m_capturePerfTimer.GetLast() : 0.0;
+    m_perf.stageMs[PerfStageCopy] = m_sourceRefreshed ? m_copyPerfTimer.GetLast() : 0.0;
+    m_perf.stageMs[PerfStageMips] = m_sourceRefreshed ? m_mipsPerfTimer.GetLast() : 0.0;
+    m_perf.stageMs[PerfStageBlur] = m_sourceRefreshed ? m_blurPerfTimer.GetLast() : 0.0;
+    m_perf.stageMs[PerfStageComposite] = ShouldRenderEffect() ? m_compositePerfTimer.GetLast() : 0.0;
+    m_perf.stageMs[PerfStagePresent] = m_presentPerfTimer.GetLast();
+    m_perf.stageMs[PerfStageDetect] = m_detectPerfTimer.GetLast();
+    m_perf.targetFps = m_framePacer.GetFrameRate();
+    m_perf.achievedFps = m_frameInterval > 0.0 ? 1e9 / m_frameInterval : 0.0;
+    m_perf.framesMissed = m_missedFrames + m_framePacer.GetStats().missed;
+
+    const ResourceRegistry& resources = GetResourceRegistry();
+    m_perf.textureBytes = resources.GetTotalBytes();
+    for (int i = 0; i < ResourceOwnerCount; i++)
+        m_perf.resourceBytes[i] = resources.GetOwnerBytes((ResourceOwner)i);
+    m_perf.resourceBudget = resources.GetBudget();
+    m_perf.resourcesDowngraded = resources.GetDowngradedCount();
+
+    TexturePoolStats pool = GetTexturePool().GetPool().GetStats();
+    m_perf.poolHits = pool.hits;
+    m_perf.poolMisses = pool.misses;
+    m_perf.poolIdleBytes = pool.idleBytes;
+    m_perf.poolPrewarmed = m_prewarmer.GetAdopted();
+
+    m_perfSnapshot.Publish(m_perf);
+}
+
+void AmbientLight::LogStats()
+{
+    // the windows rotate in every build, only debug builds print them
+    PerfTimer* timers[] = { &m_framePerfTimer, &m_capturePerfTimer, &m_copyPerfTimer, &m_mipsPerfTimer,
+        &m_blurPerfTimer, &m_compositePerfTimer, &m_renderPerfTimer, &m_detectPerfTimer, &m_presentPerfTimer,
+        &m_sleepPerfTimer };
+    for (PerfTimer* timer : timers)
+        timer->Rotate();
+    m_latency.Rotate();
+
+    // the window just completed is what the metrics endpoint exports, a single frame
+    // is noise at any scrape interval
+    const PerfTimer* stageTimers[PerfStageCount] = { &m_framePerfTimer, &m_capturePerfTimer, &m_copyPerfTimer,
+        &m_mipsPerfTimer, &m_blurPerfTimer, &m_compositePerfTimer, &m_presentPerfTimer, &m_detectPerfTimer };
+    for (int i = 0; i < PerfStageCount; i++)
+    {
+        LatencyStats stats = stageTimers[i]->GetStats();
+        m_perf.stageP50Ms[i] = stats.p50 / 1e6;
+        m_perf.stageP95Ms[i] = stats.p95 / 1e6;
+        m_perf.stageP99Ms[i] = stats.p99 / 1e6;
+        m_perf.stageCount[i] += stats.count;
+        m_perf.stageSumMs[i] += stats.sum / 1e6;
+    }
+
+    FramePacerStats pacer = m_framePacer.GetStats();
+    INT64 now = m_frameClock.Now();
+
+#ifdef _DEBUG
+    OutputDebugStringA("=== Performance (ms):\n");
+    for (const PerfTimer* timer : timers)
+        timer->PrintToDebug();
+
+    char buffer[256];
+    sprintf_s(buffer, "=== Pacing %u fps: jitter %.3fms, max late %.3fms, missed %llu/%llu, wait CPU %.3fms per frame\n",
+        m_framePacer.GetFrameRate(), pacer.jitter / 1e6, pacer.maxError / 1e6,
+        pacer.missed, pacer.frames, pacer.waitCpuTime / 1e6);
+    OutputDebugStringA(buffer);
+
+    LoopSchedulerStats loop = m_scheduler.GetStats(now);
+    sprintf_s(buffer, "=== Loop %s: %.1f wakeups/s, %llu periodic\n",
+        m_scheduler.IsActive() ? "active" : "idle", loop.wakeupsPerSecond, loop.periodicWakeups);
+    OutputDebugStringA(buffer);
+
+    if (m_settings.adaptiveFrameRate && m_adaptiveRate.GetFrames() > 0)
+    {
+        // render timer covers the CPU side of a frame, GPU work scales the same way
+        double average = m_adaptiveRate.GetAverageRate();
+        double skipped = max(0.0, 1.0 - average / m_frameRate);
+        sprintf_s(buffer, "=== Adaptive rate %u fps, avg %.1f of %u, %.0f%% frames skipped, ~%.2fms CPU/s saved\n",
+            m_adaptiveRate.GetRate(), average, m_frameRate, skipped * 100.0,
+            (m_frameRate - average) * m_renderPerfTimer.GetAverage());
+        OutputDebugStringA(buffer);
+    }
+
+    // source age when each stage was submitted, the scanout itself is not observable here
+    if (m_latency.GetStats(LatencyCommit).count > 0)
+    {
+        OutputDebugStringA("=== Latency from game present (ms):\n");
+        for (int i = 0; i < LatencyStageCount; i++)
+        {
+            LatencyStats latency = m_latency.GetStats((LatencyStage)i);
+            if (latency.count == 0)
+                continue;
+            sprintf_s(buffer, "%s: n %llu, p50 %.3f, p95 %.3f, p99 %.3f, max %.3f\n",
+                LatencyStageName((LatencyStage)i), latency.count,
+                latency.p50 / 1e6, latency.p95 / 1e6, latency.p99 / 1e6, latency.max / 1e6);
+            OutputDebugStringA(buffer);
+        }
+    }
+
+    UINT ref = m_device->AddRef();
+    ref = m_device->Release();
+
+    sprintf_s(buffer, "=== Device ref %u\n", ref);
+    OutputDebugStringA(buffer);
+
+    UINT64 canvasPixels = (UINT64)m_windowWidth * m_windowHeight;
+    sprintf_s(buffer, "=== Pixels processed %llu per frame (%.1f%% of canvas)\n",
+        m_pixelsProcessed, canvasPixels ? 100.0 * m_pixelsProcessed / canvasPixels : 0.0);
+    OutputDebugStringA(buffer);
+#endif
+
+    m_missedFrames += pacer.missed;
+    m_framePacer.ResetStats();
+    m_scheduler.ResetStats(now);
+    m_adaptiveRate.ResetStats();
 }
 
 bool AmbientLight::ShouldRenderEffect()
@@ -415,82 +1005,139 @@ bool AmbientLight::ShouldRenderEffect()
     return m_gameWidth < m_windowWidth || m_gameHeight < m_windowHeight;
 }
 
-bool AmbientLight::RenderEffects()
+bool AmbientLight::IsCaptureDue(INT64 now)
 {
-    ComPtr<ID3D11Texture2D> desktopTexture = m_capture.GetDesktopTexture();
-    if (!desktopTexture)
-        return false;
+    // without interpolation every frame is captured
+    if (!m_settings.temporalInterpolation || m_capturedFrames < 2)
+        return true;
 
-    ComPtr<IDXGISurface> surface;
-    desktopTexture.As(&surface);
-    DXGI_SURFACE_DESC desc = {};
-    surface->GetDesc(&desc);
+    INT64 period = 1000000000LL / m_settings.captureRate;
+    return now - m_lastCaptureTime >= period;
+}
 
-    if (m_blackBars.size() != 2)
-        return false;
+bool AmbientLight::IsIdle()
+{
+    // idle once the cleared effect and UI have been presented
+    return !ShouldRenderEffect() && !m_effectRendered && m_presented &&
+        !m_showConfigWindow && !m_clearConfigWindow;
+}
 
-    D3D11_BOX game_box = {};
-    game_box.front = 0;
-    game_box.back = 1;
-    if (m_gameHeight == m_windowHeight)
+DWORD AmbientLight::GetWaitTimeout()
+{
+    if (nullptr == m_device)
+        return 0;
+
+    INT64 now = m_frameClock.Now();
+    m_scheduler.SetActive(!IsIdle(), now);
+
+    // round up, waking early would only lead to another wait
+    INT64 wait = m_scheduler.GetWaitTime(now);
+    return (DWORD)((wait + 999999) / 1000000);
+}
+
+void AmbientLight::ReloadSettings()
+{
+    if (nullptr == m_device)
+        return;
+    ApplySettingsChanges(ReadSettings(m_settings));
+}
+
+void AmbientLight::RefreshEffectSource(ID3D11Texture2D* desktopTexture, const D3D11_BOX& gameBox, bool interpolate)
+{
+    if (interpolate && m_capturedFrames > 0)
     {
-        // black bars on left/right
-        game_box.left = m_blackBars[0].width;
-        game_box.right = m_windowWidth - m_blackBars[1].width;
-        game_box.top = 0;
-        game_box.bottom = m_windowHeight;
+        // keep the last blurred frame to blend from
+        m_deferred->CopyResource(m_previousTexture.GetTexture(), m_downsampledTexture.GetTexture());
     }
-    else if (m_gameWidth == m_windowWidth)
+
+    // the stage timers measure recording on the deferred context, the GPU runs later
     {
-        // black bars on top/bottom
-        game_box.left = 0;
-        game_box.right = m_windowWidth;
-        game_box.top = m_blackBars[0].height;
-        game_box.bottom = m_windowHeight - m_blackBars[1].height;
+        ScopedPerfTimer copyTimer(m_copyPerfTimer);
+        m_deferred->CopySubresourceRegion(m_gameTexture.GetTexture(), 0, 0, 0, 0, desktopTexture, 0, &gameBox);
     }
-    else
+    m_latency.Stamp(LatencyCopy, m_frameClock.Now());
+
+    // m_blurPre.Render(m_deferred.Get(), m_gameTexture, m_settings.blurPasses);
+
     {
-        return false;
-    }
+        ScopedPerfTimer mipsTimer(m_mipsPerfTimer);
 
-    if (IS_BOX_EMPTY(game_box))
-        return false;
+        // Generate mipmaps for the captured game area
+        m_deferred->GenerateMips(m_gameTexture.GetSRV());
 
-    auto df = GetDesktopFormat();
+        // Extract the specific mip level to the secondary buffer for the final blur/stretch
+        m_deferred->CopySubresourceRegion(m_downsampledTexture.GetTexture(), 0, 0, 0, 0, m_gameTexture.GetTexture(), m_effectMipLevel, NULL);
+    }
 
-    DXGI_FORMAT dupFormat = df.format;
-    D3D11_TEXTURE2D_DESC gameDesc = {};
-    m_gameTexture.GetTexture()->GetDesc(&gameDesc);
-    //assert(gameDesc.Format == desc.Format);
+    {
+        ScopedPerfTimer blurTimer(m_blurPerfTimer);
+        m_blurDownscale.Render(m_deferred.Get(), m_downsampledTexture, m_settings.blurPasses);
+    }
+    m_latency.Stamp(LatencyBlur, m_frameClock.Now());
 
-    m_deferred->CopySubresourceRegion(m_gameTexture.GetTexture(), 0, 0, 0, 0, desktopTexture.Get(), 0, &game_box);
+    // the motion grid drives the adaptive rate, and its scene cuts fast-track detection
+    if (m_settings.adaptiveFrameRate || m_settings.useAutoDetection)
+    {
+        // grids come back a few frames late, the rate follows with the same delay
+        float grid[MotionEstimator::GRID_SIZE];
+        INT64 gridTime;
+        while (m_motion.ReadGrid(m_immediate.Get(), grid, gridTime))
+        {
+            float motion = m_motionEstimator.Update(grid, gridTime);
+            if (m_adaptiveRate.IsSceneCut(motion))
+                m_sceneCut.Mark(gridTime);
+            if (m_settings.adaptiveFrameRate)
+                m_adaptiveRate.Update(motion, m_motionEstimator.GetInterval());
+        }
+        m_motion.Render(m_deferred.Get(), m_downsampledTexture, m_frameClock.Now());
+    }
 
-    // m_blurPre.Render(m_deferred.Get(), m_gameTexture, m_settings.blurPasses);
+    m_capturedFrames = min(m_capturedFrames + 1, 2u);
+    m_lastCaptureTime = m_frameClock.Now();
+    m_sourceRefreshed = true;
+}
 
-    // Generate mipmaps for the captured game area
-    m_deferred->GenerateMips(m_gameTexture.GetSRV());
+bool AmbientLight::RenderEffects(bool refreshSource)
+{
+    // with temporal interpolation the last two captures stay usable in between
+    bool interpolate = m_settings.temporalInterpolation && m_previousTexture.GetTexture();
+
+    ComPtr<ID3D11Texture2D> desktopTexture = refreshSource ? m_capture.GetDesktopTexture() : nullptr;
+    if (!desktopTexture)
+    {
+        if (!interpolate || m_capturedFrames == 0)
+            return false;
+        refreshSource = false;
+    }
 
-    // Extract the specific mip level to the secondary buffer for the final blur/stretch
-    m_deferred->CopySubresourceRegion(m_downsampledTexture.GetTexture(), 0, 0, 0, 0, m_gameTexture.GetTexture(), m_settings.mipmapLevels, NULL);
+    // boxes and bars come from the plan UpdateSettings built for the current bars
+    const RenderPlan& plan = m_renderPlan;
+    if (!plan.valid)
+        return false;
 
-    m_blurDownscale.Render(m_deferred.Get(), m_downsampledTexture, m_settings.blurPasses);
+    D3D11_BOX game_box = { plan.gameBox.left, plan.gameBox.top, 0, plan.gameBox.right, plan.gameBox.bottom, 1 };
 
-    UINT mipWidth = max(1u, m_gameWidth >> m_settings.mipmapLevels);
-    UINT mipHeight = max(1u, m_gameHeight >> m_settings.mipmapLevels);
-    if (mipWidth > m_effectZoom * 2 && mipHeight > m_effectZoom * 2)
+    if (refreshSource)
     {
-        m_copy.Render(m_deferred.Get(), m_processedBlurTexture, 0, 0, m_gameWidth, m_gameHeight,
-            m_downsampledTexture, m_effectZoom, m_effectZoom, mipWidth - m_effectZoom * 2, mipHeight - m_effectZoom * 2);
+        // desktop duplication reports when the game presented the captured image,
+        // fall back to the capture time if the frame carried no update
+        INT64 presentTime = m_capture.GetLastPresentTime();
+        m_sourceTime = presentTime != 0 ? m_frameClock.FromSystemTicks(presentTime) : m_frameClock.Now();
     }
-    else
+    // interpolated frames still show the last capture, they age from the same source
+    m_latency.BeginFrame(m_sourceTime);
+
+    if (refreshSource)
     {
-        m_copy.Render(m_deferred.Get(), m_processedBlurTexture, m_downsampledTexture);
+        RefreshEffectSource(desktopTexture.Get(), game_box, interpolate);
     }
 
+    UVRect masks[Composite::MAX_MASK_RECTS] = {};
+    UINT maskCount = 0;
     if (m_settings.autoDetectionInner)
     {
         bool clearInner = false;
-        std::vector<BlackBar> innerBars = m_detectInner.GetDetectedBars();
+        BlackBars innerBars = m_detectInner.GetDetectedBars();
         if (innerBars.size() == 2)
         {
             // outer pillar box, inner letter box
@@ -515,58 +1162,58 @@ bool AmbientLight::RenderEffects()
 
         if (clearInner)
         {
-            // clear the inner box in the effect texture
-            ComPtr<ID3D11DeviceContext1> deferred1 = nullptr;
-            m_deferred.As(&deferred1);
-            if (deferred1)
+            // mask the inner box out of the blurred source, in source UV space
+            for (UINT i = 0; i < 2; i++)
             {
-                float color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
-                D3D11_RECT rects[2] = { innerBars[0].toRect(), innerBars[1].toRect() };
-                deferred1->ClearView(m_processedBlurTexture.GetRTV(), color, &rects[0], 2);
+                D3D11_RECT rect = innerBars[i].toRect();
+                masks[maskCount++] = GetSourceUV(plan,
+                    { (uint32_t)rect.left, (uint32_t)rect.top, (uint32_t)rect.right, (uint32_t)rect.bottom });
             }
         }
     }
 
 
-    ID3D11RenderTargetView* rtv = m_effectCanvasTexture.GetRTV();
-    float color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
-    m_deferred->ClearRenderTargetView(rtv, color);
-
-    D3D11_TEXTURE2D_DESC desc2 = {};
-    m_processedBlurTexture.GetTexture()->GetDesc(&desc2);
-
-
-    for (int i = 0; i < 2; i++)
+    if (m_clearCanvas && m_barSurfaceCount == 0)
     {
-        BlackBar srcBar = m_blackBars[i];
-        srcBar.parentWidth = m_gameWidth;
-        srcBar.parentHeight = m_gameHeight;
-
-
-        switch (srcBar.position)
-        {
-        case BlackBarPosition::Top:
-        case BlackBarPosition::Bottom:
-            srcBar.height = (UINT)((float)srcBar.height / m_settings.stretchFactor);
-            break;
-        case BlackBarPosition::Left:
-        case BlackBarPosition::Right:
-            srcBar.width = (UINT)((float)srcBar.width / m_settings.stretchFactor);
-            break;
-        }
-
-        D3D11_BOX src = srcBar.toBox();
-        D3D11_BOX dst = m_blackBars[i].toBox();
+        ID3D11RenderTargetView* rtv = m_effectCanvasTexture.GetRTV();
+        float color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        m_deferred->ClearRenderTargetView(rtv, color);
+        m_clearCanvas = false;
+        m_pixelsProcessed += (UINT64)m_windowWidth * m_windowHeight;
+    }
 
-        Copy::Flip flip = Copy::FlipNone;
-        if (m_settings.mirrored)
-        {
-            flip = (m_gameWidth == m_windowWidth) ? Copy::FlipVertical : Copy::FlipHorizontal;
-        }
+    // copy, mirror, stretch, vignette and light peek mask in one pass over the bars
+    ID3D11ShaderResourceView* vignette = m_settings.vignetteEnabled ? m_vignette.GetAttenuationSRV() : nullptr;
+    ID3D11ShaderResourceView* lumaMask = (m_settings.useAutoDetection && m_settings.autoDetectionLightMask) ? m_detection.GetLumaSRV() : nullptr;
 
-        m_copy.Render(m_deferred.Get(), m_effectCanvasTexture, dst.left, dst.top, RECT_WIDTH(dst), RECT_HEIGHT(dst),
-            m_processedBlurTexture, src.left, src.top, RECT_WIDTH(src), RECT_HEIGHT(src), flip);
+    // blend from the previous capture to the latest over one capture period
+    ID3D11ShaderResourceView* previous = nullptr;
+    float blend = 1.0f;
+    if (interpolate && m_capturedFrames >= 2)
+    {
+        double elapsed = (double)(m_frameClock.Now() - m_lastCaptureTime);
+        double period = 1e9 / m_settings.captureRate;
+        previous = m_previousTexture.GetSRV();
+        blend = (float)std::clamp(elapsed / period, 0.0, 1.0);
+    }
+    ScopedPerfTimer compositeTimer(m_compositePerfTimer);
+    // both bars into the window canvas, or each bar into its own surface
+    PlannedSurface surfaces[SurfacePlan::MAX_SURFACES];
+    for (UINT i = 0; i < m_barSurfaceCount; i++)
+        surfaces[i] = m_barSurfaces[i].plan;
+    CompositeDraw draws[COMPOSITE_MAX_SLOTS];
+    UINT drawCount = GetCompositeDraws(plan, surfaces, m_barSurfaceCount, draws);
+    for (UINT i = 0; i < drawCount; i++)
+    {
+        const CompositeDraw& draw = draws[i];
+        const TextureView& target = draw.surface == COMPOSITE_WINDOW ? m_effectCanvasTexture : m_barSurfaces[draw.surface].canvas;
+        m_composite.Render(m_deferred.Get(), target, m_downsampledTexture,
+            draw.bars, draw.barCount, masks, maskCount, m_windowWidth, m_windowHeight, vignette, lumaMask,
+            previous, blend, draw.slot);
+        for (UINT j = 0; j < draw.barCount; j++)
+            m_pixelsProcessed += (UINT64)draw.bars[j].targetWidth * draw.bars[j].targetHeight;
     }
+    m_latency.Stamp(LatencyComposite, m_frameClock.Now());
 
     m_effectRendered = true;
 
@@ -577,12 +1224,30 @@ void AmbientLight::ClearEffects()
 {
     if (m_effectRendered)
     {
-        ID3D11RenderTargetView* rtv = m_effectCanvasTexture.GetRTV();
         float color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
-        m_deferred->ClearRenderTargetView(rtv, color);
+        if (m_barSurfaceCount > 0)
+        {
+            for (UINT i = 0; i < m_barSurfaceCount; i++)
+            {
+                m_deferred->ClearRenderTargetView(m_barSurfaces[i].canvas.GetRTV(), color);
+                m_pixelsProcessed += (UINT64)m_barSurfaces[i].plan.width * m_barSurfaces[i].plan.height;
+            }
+        }
+        else
+        {
+            m_deferred->ClearRenderTargetView(m_effectCanvasTexture.GetRTV(), color);
+            m_pixelsProcessed += (UINT64)m_windowWidth * m_windowHeight;
+        }
+        m_clearCanvas = false;
 
         // force next present
         m_presented = false;
+
+        // start the next scene at the full frame rate, from a fresh capture
+        m_capturedFrames = 0;
+        m_motion.Reset();
+        m_motionEstimator.Reset();
+        m_adaptiveRate.Reset();
     }
     m_effectRendered = false;
 }
@@ -592,7 +1257,7 @@ void AmbientLight::RenderConfig()
     if (!m_showConfigWindow)
         return;
 
-    bool open = RenderUI(m_hwnd, m_settings, m_gameWidth, m_gameHeight, m_resetUiPosition);
+    bool open = RenderUI(m_hwnd, m_settings, m_gameWidth, m_gameHeight, m_resetUiPosition, &m_perfSnapshot);
     ShowConfigWindow(open);
 
     m_resetUiPosition = false;
@@ -600,30 +1265,53 @@ void AmbientLight::RenderConfig()
 
 void AmbientLight::RenderBackBuffer()
 {
-    ComPtr<ID3D11Texture2D> backBuffer;
-    m_swapchain->GetBuffer(0, __uuidof(ID3D11Texture2D), &backBuffer);
-
-    TextureView backview;
-    backview.CreateViews(m_device.Get(), backBuffer.Get(), true, false, false);
-
-    ID3D11RenderTargetView* rtv_back = backview.GetRTV();
-    float color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
-    m_deferred->ClearRenderTargetView(rtv_back, color);
-
-    if (m_effectRendered)
+    bool barSurfaces = m_barSurfaceCount > 0;
+    for (UINT i = 0; i < m_barSurfaceCount; i++)
     {
-        if (m_settings.vignetteEnabled)
-            m_vignette.Render(m_deferred.Get(), m_effectCanvasTexture);
-
-        if (m_settings.useAutoDetection && m_settings.autoDetectionLightMask)
-            m_detection.RenderLumaMask(m_deferred.Get(), m_effectCanvasTexture);
+        BarSurface& surface = m_barSurfaces[i];
+        if (surface.buffer)
+        {
+            m_deferred->CopyResource(surface.buffer.Get(), surface.canvas.GetTexture());
+            m_pixelsProcessed += (UINT64)surface.plan.width * surface.plan.height;
+        }
     }
 
-    m_deferred->CopyResource(backview.GetTexture(), m_effectCanvasTexture.GetTexture());
+    // with bar surfaces the full window swapchain only hosts the UI
+    if (!barSurfaces || m_showConfigWindow || m_clearConfigWindow)
+    {
+        const TextureView& backview = m_backBuffer;
+        ID3D11RenderTargetView* rtv_back = backview.GetRTV();
 
-    m_deferred->OMSetRenderTargets(1, &rtv_back, nullptr);
-    if (m_showConfigWindow)
-        ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+        // The UI can draw anywhere, and a back buffer that was last used for different bars may
+        // hold stale content. Otherwise only the bar rectangles differ from the previous frame.
+        if (barSurfaces)
+        {
+            float color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            m_deferred->ClearRenderTargetView(rtv_back, color);
+        }
+        else if (m_showConfigWindow || m_clearConfigWindow || m_fullRefreshCount > 0)
+        {
+            float color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            m_deferred->ClearRenderTargetView(rtv_back, color);
+            m_deferred->CopyResource(backview.GetTexture(), m_effectCanvasTexture.GetTexture());
+            m_pixelsProcessed += (UINT64)m_windowWidth * m_windowHeight;
+        }
+        else
+        {
+            for (UINT i = 0; i < m_barRectCount; i++)
+            {
+                const D3D11_RECT& rect = m_barRects[i];
+                D3D11_BOX box = { (UINT)rect.left, (UINT)rect.top, 0, (UINT)rect.right, (UINT)rect.bottom, 1 };
+                m_deferred->CopySubresourceRegion(backview.GetTexture(), 0, rect.left, rect.top, 0,
+                    m_effectCanvasTexture.GetTexture(), 0, &box);
+                m_pixelsProcessed += (UINT64)RECT_WIDTH(rect) * RECT_HEIGHT(rect);
+            }
+        }
+
+        m_deferred->OMSetRenderTargets(1, &rtv_back, nullptr);
+        if (m_showConfigWindow)
+            ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+    }
 
     ComPtr<ID3D11CommandList> cmdlist = nullptr;
     HRESULT hr;
@@ -637,33 +1325,38 @@ void AmbientLight::RenderBackBuffer()
 
 void AmbientLight::Present()
 {
+    LARGE_INTEGER presentStart;
+    QueryPerformanceCounter(&presentStart);
+    TRACE_BEGIN("present");
+
     if (m_showConfigWindow || m_clearConfigWindow)
     {
         m_clearConfigWindow = false;
+        for (UINT i = 0; i < m_barSurfaceCount; i++)
+        {
+            m_barSurfaces[i].swapchain->Present(0, 0);
+        }
         m_swapchain->Present(1, 0);
+        m_latency.Stamp(LatencyPresent, m_frameClock.Now());
         m_presented = true;
+        m_fullRefreshCount = SWAPCHAIN_BUFFER_COUNT;
     }
     else
     {
-        if (!m_presented)
+        if (!m_presented && m_barSurfaceCount > 0)
         {
-            memset(m_dirtyRects, 0, sizeof(m_dirtyRects));
-            int numRects = 0;
-            for (auto& bar : m_blackBars)
+            // only the first surface waits for vblank
+            for (UINT i = 0; i < m_barSurfaceCount; i++)
             {
-                D3D11_BOX box = bar.toBox();
-                if (IS_BOX_EMPTY(box))
-                    continue;
-                m_dirtyRects[numRects].left = box.left;
-                m_dirtyRects[numRects].top = box.top;
-                m_dirtyRects[numRects].right = box.right;
-                m_dirtyRects[numRects].bottom = box.bottom;
-                numRects++;
+                m_barSurfaces[i].swapchain->Present(i == 0 ? 1 : 0, 0);
             }
-
+            m_presented = true;
+        }
+        else if (!m_presented)
+        {
             DXGI_PRESENT_PARAMETERS param = {};
-            param.DirtyRectsCount = numRects;
-            param.pDirtyRects = m_dirtyRects;
+            param.DirtyRectsCount = m_barRectCount;
+            param.pDirtyRects = m_barRects;
             param.pScrollOffset = nullptr;
             param.pScrollRect = nullptr;
 
@@ -674,6 +1367,9 @@ void AmbientLight::Present()
                 hr = m_swapchain->Present(1, 0);
             }
             m_presented = true;
+
+            if (m_fullRefreshCount > 0)
+                m_fullRefreshCount--;
         }
         else if (!m_effectRendered)
         {
@@ -686,42 +1382,32 @@ void AmbientLight::Present()
 
         if (m_presented)
         {
+            m_latency.Stamp(LatencyPresent, m_frameClock.Now());
             m_dcompDevice->Commit();
+            m_latency.Stamp(LatencyCommit, m_frameClock.Now());
         }
     }
 
-    INT64 now = 0;
-    double elapsedMs = 0.0;
-    double frameTime = 1000.0 / m_frameRate;
+    // effect frames that were skipped by the present toggle never reach the screen
+    m_latency.EndFrame(m_presented);
 
-    QueryPerformanceCounter((LARGE_INTEGER*)&now);
-    if (m_lastPresentTime != 0)
-    {
-        ScopedPerfTimer sleepTimer(m_sleepPerfTimer);
-        elapsedMs = (double)((now - m_lastPresentTime) * 1000) / m_perfFreq;
+    m_presentPerfTimer.Record(presentStart);
+    TRACE_END("present");
 
-        while (elapsedMs < frameTime)
-        {
-            double remaining = frameTime - elapsedMs;
-            if (remaining > 1.5)
-            {
-                Sleep(1);
-            }
-            else
-            {
-                Sleep(0);
-            }
+    // the UI always runs at the full frame rate
+    UINT frameRate = m_frameRate;
+    if (m_settings.adaptiveFrameRate && m_effectRendered && !m_showConfigWindow)
+        frameRate = m_adaptiveRate.GetRate();
+    m_framePacer.SetFrameRate(frameRate);
+    TRACE_COUNTER("frameRate", frameRate);
 
-            QueryPerformanceCounter((LARGE_INTEGER*)&now);
-            elapsedMs = (double)((now - m_lastPresentTime) * 1000) / m_perfFreq;
-        }
+    {
+        ScopedPerfTimer sleepTimer(m_sleepPerfTimer);
+        m_framePacer.Wait();
     }
-
-    QueryPerformanceCounter((LARGE_INTEGER*)&now);
-    m_lastPresentTime = now;
 }
 
-void AmbientLight::Detect()
+void AmbientLight::Detect(bool force)
 {
     if (m_settings.useAutoDetection)
     {
@@ -735,35 +1421,42 @@ void AmbientLight::Detect()
             // we will then apply a black bar matching the inner cutscene to crop the rendered blur effect
             m_detectInner.Detect(m_immediate.Get(), m_gameTexture);
         }
-        if (m_detectionTimer.HasElapsed(m_settings.autoDetectionTime))
+        bool detect = m_detectionTimer.HasElapsed(m_settings.autoDetectionTime);
+        if (force && !detect)
+        {
+            m_detectionTimer.Restart();
+            detect = true;
+        }
+        if (detect)
         {
             m_capture.Capture();
             ComPtr<ID3D11Texture2D> desktopTexture = m_capture.GetDesktopTexture();
             if (!desktopTexture)
                 return;
 
-            TextureView desktopTextureView;
-            desktopTextureView.CreateViews(m_device.Get(), desktopTexture.Get(), false, true, false);
-            m_detection.Detect(m_immediate.Get(), desktopTextureView);
+            if (m_desktopView.GetTexture() != desktopTexture.Get())
+                m_desktopView.CreateViews(m_device.Get(), desktopTexture.Get(), false, true, false);
+            m_detection.Detect(m_immediate.Get(), m_desktopView);
 
-            std::vector<BlackBar> detected = m_detection.GetDetectedBars();
+            BlackBars detected = m_detection.GetDetectedBars();
 
-            bool updateSettings = false;
-            if (detected.size() == m_blackBars.size())
-            {
-                for (int i = 0; i < detected.size(); i++)
-                {
-                    if (detected[i] != m_blackBars[i])
-                    {
-                        updateSettings = true;
-                        break;
-                    }
-                }
-            }
-            else
-            {
-                updateSettings = true;
-            }
+            // a single pass is not trusted, the tracker commits a new size once it is confirmed
+            bool updateSettings = m_barTracker.Observe(ToBarLayout(detected), m_sceneCut.Take(m_frameClock.Now()));
+            if (updateSettings)
+                m_trackedBars = detected;
+
+            m_perf.detections++;
+            if (!detected.empty())
+                m_perf.detectionHits++;
+            if (updateSettings)
+                m_perf.detectionChanges++;
+            m_perf.detectionsAvoided = m_barTracker.GetAvoided();
+
+            TRACE_INSTANT("detection",
+                { "changed", updateSettings ? 1 : 0 },
+                { "bars", (int64_t)detected.size() },
+                { "barWidth", detected.size() > 0 ? detected[0].width : 0 },
+                { "barHeight", detected.size() > 0 ? detected[0].height : 0 });
 
             if (updateSettings)
             {
@@ -783,5 +1476,7 @@ void AmbientLight::ShowConfigWindow(bool show)
 
         dwExStyle = show ? dwExStyle & ~WS_EX_TRANSPARENT : dwExStyle | WS_EX_TRANSPARENT;
         SetWindowLong(m_hwnd, GWL_EXSTYLE, dwExStyle);
+
+        UpdateWindowVisual();
     }
 }
@@ -3,11 +3,24 @@
 #include "common.h"
 #include "capture.h"
 #include "dcomp.h"
-#include "shaders/copy.h"
+#include "adaptiverate.h"
+#include "bartracker.h"
+#include "framepacer.h"
+#include "latency.h"
+#include "metrics.h"
+#include "perfstats.h"
+#include "prewarm.h"
+#include "prewarm_d3d.h"
+#include "reconfigure.h"
+#include "renderplan.h"
+#include "scheduler.h"
+#include "surfaceplan.h"
+#include "shaders/composite.h"
 #include "shaders/blur.h"
 #include "shaders/fullscreenquad.h"
 #include "shaders/vignette.h"
 #include "shaders/detect.h"
+#include "shaders/motion.h"
 
 class AmbientLight
 {
@@ -19,6 +32,17 @@ public:
 
     void Render();
 
+    // how long the message loop may block before calling Render, in milliseconds
+    DWORD GetWaitTimeout();
+    // applies a config file edit the message loop was woken for
+    void ReloadSettings();
+
+    // capture-to-photon latency per pipeline stage, over the last logging window
+    LatencyStats GetLatencyStats(LatencyStage stage) const { return m_latency.GetStats(stage); }
+
+    // published once per frame, safe to read from any thread
+    const PerfSnapshotBuffer& GetPerfSnapshot() const { return m_perfSnapshot; }
+
     LRESULT WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam);
 
     RECT GetPresentRect();
@@ -29,12 +53,38 @@ private:
         DXGI_COLOR_SPACE_TYPE colorSpace;
     };
 
+    // a bar presented through its own, possibly downscaled, swapchain and visual
+    struct BarSurface
+    {
+        ComPtr<IDXGISwapChain1> swapchain;
+        // buffer 0, the flip model swapchain keeps it the current back buffer
+        ComPtr<ID3D11Texture2D> buffer;
+        ComPtr<IDCompositionVisual> visual;
+        TextureView canvas;
+        PlannedSurface plan;
+    };
+
 
     AppSettings m_settings;
     void UpdateSettings();
+    // SettingsChange flags from ReadSettings, UpdateSettings only for the render ones
+    void ApplySettingsChanges(UINT changes);
     void ValidateSettings();
+    void UpdateBarRects();
 
     DesktopFormat GetDesktopFormat();
+    ReconfigureInputs GetReconfigureInputs(const DesktopFormat& format);
+
+    // what the pipeline was last built from, UpdateSettings only rebuilds what changed
+    ReconfigureInputs m_configured;
+    // rebuild everything on the next UpdateSettings, after the device was created
+    bool m_reconfigureAll;
+
+    // creates the textures of the other resolution presets, see prewarm.h
+    TexturePrewarmer m_prewarmer;
+    // m_prewarmer was started for the current geometry
+    bool m_prewarmStarted;
+    void StartPrewarm(DXGI_FORMAT format);
 
     HWND m_hwnd;
     bool m_resetUiPosition;
@@ -43,14 +93,24 @@ private:
     ComPtr<ID3D11DeviceContext> m_immediate;
     ComPtr<ID3D11DeviceContext> m_deferred;
     ComPtr<IDXGISwapChain1> m_swapchain;
+    // view of the current back buffer of m_swapchain, made once per swapchain
+    TextureView m_backBuffer;
+    // view of the captured desktop for the detection pass, made again only when
+    // the duplication hands out another texture
+    TextureView m_desktopView;
     ComPtr<IDCompositionDevice> m_dcompDevice;
     ComPtr<IDCompositionTarget> m_dcompTarget;
     ComPtr<IDCompositionVisual> m_dcompVisual;
+    ComPtr<IDCompositionVisual> m_dcompRoot;
+    ComPtr<IDXGIFactory2> m_dxgiFactory;
+
+    BarSurface m_barSurfaces[SurfacePlan::MAX_SURFACES];
+    UINT m_barSurfaceCount;
 
     DesktopCapture m_capture;
     Blur m_blurDownscale;
     Blur m_blurPre;
-    Copy m_copy;
+    Composite m_composite;
     Vignette m_vignette;
     Detection m_detection;
     ElapsedTimer m_detectionTimer;
@@ -58,6 +118,7 @@ private:
     ElapsedTimer m_detectionInnerTimer;
 
     bool m_effectRendered;
+    bool m_clearCanvas;
     bool m_presented;
 
     UINT m_gameWidth;
@@ -67,37 +128,97 @@ private:
     UINT m_windowHeight;
     
     UINT m_effectZoom;
-
-    std::vector<BlackBar> m_blackBars;
-
-    RECT m_dirtyRects[2];
+    // mip of the game texture the effect is made from, above the setting when the
+    // memory budget asked for a smaller downsampled texture
+    UINT m_effectMipLevel;
+
+    BlackBars m_blackBars;
+    // boxes and composite bars of the effect pass, rebuilt by UpdateSettings
+    RenderPlan m_renderPlan;
+
+    // bar rectangles in window coordinates, the only area the effects ever write
+    D3D11_RECT m_barRects[2];
+    UINT m_barRectCount;
+    // number of presents that still need the whole back buffer refreshed
+    UINT m_fullRefreshCount;
+    // pixels written by the effect passes during the current frame
+    UINT64 m_pixelsProcessed;
+    // frames rendered since start, annotates the trace
+    UINT64 m_frameIndex;
 
     UINT m_frameRate;
-    INT64 m_lastPresentTime;
-    INT64 m_perfFreq;
+    SystemFrameClock m_frameClock;
+    FramePacer m_framePacer;
+    LoopScheduler m_scheduler;
+
+    Motion m_motion;
+    MotionEstimator m_motionEstimator;
+    // a scene cut was measured since the last detection pass
+    SceneCutLatch m_sceneCut;
+    // committed bars of the auto detection, see bartracker.h
+    BarTracker m_barTracker;
+    BlackBars m_trackedBars;
+    AdaptiveFrameRate m_adaptiveRate;
+
+    // age of the captured image at each stage, up to the composition commit
+    LatencyTracker m_latency;
+    // when the image behind the current effect source was presented by the game
+    INT64 m_sourceTime;
+
+    // counters and stage times of the current frame, published at the end of it
+    PerfSnapshot m_perf;
+    PerfSnapshotBuffer m_perfSnapshot;
+    // the effect source was refreshed from a new capture this frame
+    bool m_sourceRefreshed;
+    INT64 m_lastFrameTime;
+    // smoothed time between active frames, in nanoseconds
+    double m_frameInterval;
+    // missed frames of the pacing windows already logged
+    uint64_t m_missedFrames;
+    // serves m_perfSnapshot when enabled in the settings
+    MetricsServer m_metrics;
 
     PerfTimer m_framePerfTimer = { "frame" };
     PerfTimer m_renderPerfTimer = { "render" };
     PerfTimer m_detectPerfTimer = { "detect" };
     PerfTimer m_sleepPerfTimer = { "sleep" };
     PerfTimer m_capturePerfTimer = { "capture" };
+    PerfTimer m_copyPerfTimer = { "copy" };
+    PerfTimer m_mipsPerfTimer = { "mips" };
+    PerfTimer m_blurPerfTimer = { "blur" };
+    PerfTimer m_compositePerfTimer = { "composite" };
+    PerfTimer m_presentPerfTimer = { "present" };
+    PerfTimer m_reconfigurePerfTimer = { "reconfigure" };
 
     TextureView m_gameTexture;
     TextureView m_downsampledTexture;
-    TextureView m_processedBlurTexture;
+    // previous blurred frame for temporal interpolation
+    TextureView m_previousTexture;
+    // blurred frames captured since the last reset, up to 2
+    UINT m_capturedFrames;
+    INT64 m_lastCaptureTime;
     TextureView m_effectCanvasTexture;
 
     HRESULT CreateOffscreen(DXGI_FORMAT format);
+    HRESULT UpdateBarSurfaces(DXGI_FORMAT format);
+    void ReleaseBarSurfaces();
+    void UpdateWindowVisual();
 
     bool ShouldRenderEffect();
-    bool RenderEffects();
+    bool IsIdle();
+    bool RenderEffects(bool refreshSource);
+    void RefreshEffectSource(ID3D11Texture2D* desktopTexture, const D3D11_BOX& gameBox, bool interpolate);
+    bool IsCaptureDue(INT64 now);
+    void LogStats();
+    void UpdateMetricsServer();
+    void PublishPerfSnapshot(INT64 now);
     void RenderConfig();
     void RenderBackBuffer();
     void ClearEffects();
 
     void Present();
 
-    void Detect();
+    void Detect(bool force = false);
 
     void ShowConfigWindow(bool show);
     bool m_showConfigWindow;
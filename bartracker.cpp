@@ -0,0 +1,126 @@
+#include "bartracker.h"
+
+bool operator==(const BarLayout& a, const BarLayout& b)
+{
+    if (a.count != b.count)
+        return false;
+    for (uint32_t i = 0; i < a.count && i < 2; i++)
+    {
+        if (a.positions[i] != b.positions[i] || a.sizes[i] != b.sizes[i])
+            return false;
+    }
+    return true;
+}
+
+BarTrackerSettings DefaultBarTrackerSettings()
+{
+    BarTrackerSettings settings = {};
+    settings.confirmations = 3;
+    settings.jitter = 4;
+    return settings;
+}
+
+BarTracker::BarTracker()
+{
+    Configure(DefaultBarTrackerSettings());
+    Reset();
+    ResetStats();
+}
+
+void BarTracker::Configure(const BarTrackerSettings& settings)
+{
+    m_settings = settings;
+    if (m_settings.confirmations == 0)
+        m_settings.confirmations = 1;
+}
+
+void BarTracker::Reset()
+{
+    m_hasCommitted = false;
+    m_committed = {};
+    m_candidate = {};
+    m_candidateCount = 0;
+}
+
+void BarTracker::ResetStats()
+{
+    m_hasLast = false;
+    m_last = {};
+    m_observations = 0;
+    m_changes = 0;
+    m_commits = 0;
+    m_fastTracked = 0;
+}
+
+bool BarTracker::IsSimilar(const BarLayout& a, const BarLayout& b) const
+{
+    if (a.count != b.count)
+        return false;
+    for (uint32_t i = 0; i < a.count && i < 2; i++)
+    {
+        if (a.positions[i] != b.positions[i])
+            return false;
+        uint32_t difference = a.sizes[i] > b.sizes[i] ? a.sizes[i] - b.sizes[i] : b.sizes[i] - a.sizes[i];
+        if (difference > m_settings.jitter)
+            return false;
+    }
+    return true;
+}
+
+void BarTracker::Commit(const BarLayout& layout)
+{
+    m_committed = layout;
+    m_candidate = {};
+    m_candidateCount = 0;
+}
+
+bool BarTracker::Observe(const BarLayout& observed, bool sceneCut)
+{
+    m_observations++;
+    if (m_hasLast && observed != m_last)
+        m_changes++;
+    m_hasLast = true;
+    m_last = observed;
+
+    if (!m_hasCommitted)
+    {
+        // nothing to hold on to yet, only the very first layout is not a change
+        if (m_observations > 1)
+            m_commits++;
+        m_hasCommitted = true;
+        Commit(observed);
+        return true;
+    }
+
+    if (IsSimilar(observed, m_committed))
+    {
+        // jitter around the committed layout, or back to it before a change was confirmed
+        m_candidate = {};
+        m_candidateCount = 0;
+        return false;
+    }
+
+    if (m_candidateCount > 0 && IsSimilar(observed, m_candidate))
+        m_candidateCount++;
+    else
+        m_candidateCount = 1;
+    // the latest of the similar layouts is the one committed
+    m_candidate = observed;
+
+    if (sceneCut || m_candidateCount >= m_settings.confirmations)
+    {
+        if (sceneCut && m_candidateCount < m_settings.confirmations)
+            m_fastTracked++;
+        m_commits++;
+        Commit(observed);
+        return true;
+    }
+    return false;
+}
+
+bool SceneCutLatch::Take(int64_t time)
+{
+    bool recent = m_cut && time - m_time <= m_window;
+    Reset();
+    return recent;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+// Hysteresis for the detected black bars.
+
+#include <stdint.h>
+
+// the bars of a detection pass, in the order Detection reports them
+struct BarLayout
+{
+    // 0 or 2
+    uint32_t count;
+    // BlackBarPosition of each bar
+    uint32_t positions[2];
+    // width of left and right bars, height of top and bottom ones
+    uint32_t sizes[2];
+};
+
+bool operator==(const BarLayout& a, const BarLayout& b);
+inline bool operator!=(const BarLayout& a, const BarLayout& b) { return !(a == b); }
+
+struct BarTrackerSettings
+{
+    // consecutive passes a new layout has to be seen on, 1 commits every change
+    uint32_t confirmations;
+    // size difference in pixels that still counts as the same layout
+    uint32_t jitter;
+};
+
+BarTrackerSettings DefaultBarTrackerSettings();
+
+class BarTracker
+{
+public:
+    BarTracker();
+
+    void Configure(const BarTrackerSettings& settings);
+    // forget the committed layout, the next observation is committed as is
+    void Reset();
+
+    // Feeds the result of a detection pass, sceneCut when the image changed completely
+    // since the last pass. Returns true when the committed layout changed.
+    bool Observe(const BarLayout& observed, bool sceneCut = false);
+    const BarLayout& GetCommitted() const { return m_committed; }
+
+    // passes observed, and passes whose layout differed from the pass before them,
+    // which is how often the bars were reconfigured without hysteresis
+    uint64_t GetObservations() const { return m_observations; }
+    uint64_t GetChanges() const { return m_changes; }
+    // layouts committed after the first, and the ones committed at a scene cut
+    uint64_t GetCommits() const { return m_commits; }
+    uint64_t GetFastTracked() const { return m_fastTracked; }
+    uint64_t GetAvoided() const { return m_changes > m_commits ? m_changes - m_commits : 0; }
+    void ResetStats();
+
+private:
+    bool IsSimilar(const BarLayout& a, const BarLayout& b) const;
+    void Commit(const BarLayout& layout);
+
+    BarTrackerSettings m_settings;
+    bool m_hasCommitted;
+    BarLayout m_committed;
+    // layout waiting for confirmation, seen m_candidateCount passes in a row
+    BarLayout m_candidate;
+    uint32_t m_candidateCount;
+
+    bool m_hasLast;
+    BarLayout m_last;
+    uint64_t m_observations;
+    uint64_t m_changes;
+    uint64_t m_commits;
+    uint64_t m_fastTracked;
+};
+
+// Scene cut for the next detection pass. The cut is found on the effect source
+// between passes, it only fast-tracks a pass that follows within the window, an
+// older one is stale and the pass needs its confirmations.
+class SceneCutLatch
+{
+public:
+    // nanoseconds, a few frames of motion readback and the detection itself
+    static constexpr int64_t DEFAULT_WINDOW = 500000000;
+
+    explicit SceneCutLatch(int64_t window = DEFAULT_WINDOW) : m_window(window) { Reset(); }
+
+    // a cut in the frame captured at time
+    void Mark(int64_t time) { m_cut = true; m_time = time; }
+    // whether a cut was marked at most the window before time, and clears it
+    bool Take(int64_t time);
+    void Reset() { m_cut = false; m_time = 0; }
+
+private:
+    int64_t m_window;
+    int64_t m_time;
+    bool m_cut;
+};
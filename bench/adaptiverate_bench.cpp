@@ -0,0 +1,198 @@
+#include "bench.h"
+
+#include "../adaptiverate.h"
+
+#include <cmath>
+#include <deque>
+#include <vector>
+
+static BenchCheck g_check("adaptive rate");
+
+#define BENCH_ADAPTIVE_FLOOR         30
+#define BENCH_ADAPTIVE_CEILING       120
+
+// A stretch of a scripted scene: the pattern of the blurred image moves at speed,
+// in radians per second, and a cut jumps it by half a period at the start.
+struct MotionSegment
+{
+    double seconds;
+    double speed;
+    bool cut;
+};
+
+struct MotionSequence
+{
+    const char* name;
+    std::vector<MotionSegment> segments;
+};
+
+// mean absolute change of the pattern is about 0.16 per radian: the thresholds of
+// 0.24 and 0.9 per second sit at about 1.5 and 5.7 radians per second
+static const MotionSequence g_motionSequences[] =
+{
+    { "static", { { 10.0, 0.0, false } } },
+    { "slow_drift", { { 10.0, 1.2, false } } },
+    { "pan", { { 10.0, 3.5, false } } },
+    { "action", { { 10.0, 10.0, false } } },
+    { "static_then_action", { { 10.0, 0.0, false }, { 2.0, 10.0, false } } },
+    { "static_then_cut", { { 10.0, 0.0, false }, { 2.0, 0.0, true } } },
+};
+
+static void FillGrid(float* luma, double phase)
+{
+    for (uint32_t y = 0; y < BENCH_MOTION_GRID_HEIGHT; y++)
+    {
+        for (uint32_t x = 0; x < BENCH_MOTION_GRID_WIDTH; x++)
+            luma[y * BENCH_MOTION_GRID_WIDTH + x] = 0.5f + 0.25f * (float)std::sin(x * 0.4 + y * 0.3 + phase);
+    }
+}
+
+struct SequenceResult
+{
+    uint64_t samples;
+    double averageRate;
+    uint32_t finalRate;
+    // rate before the last segment, and seconds into it until the ceiling,
+    // for sequences of more than one segment
+    uint32_t rateBeforeLast;
+    double reaction;
+};
+
+// Replays a sequence the way the app samples it: one grid per frame at the current
+// rate, read back BENCH_MOTION_READBACK frames later. Without normalize the
+// controller is given the ceiling's interval, which compares the raw change per
+// sample as it did before the thresholds were per second.
+static SequenceResult Replay(const MotionSequence& sequence, bool normalize)
+{
+    AdaptiveFrameRate rate;
+    rate.Configure(DefaultAdaptiveRateSettings(BENCH_ADAPTIVE_FLOOR, BENCH_ADAPTIVE_CEILING));
+    MotionEstimator estimator;
+
+    struct PendingGrid
+    {
+        float luma[MotionEstimator::GRID_SIZE];
+        int64_t time;
+    };
+    std::deque<PendingGrid> pending;
+
+    SequenceResult result = {};
+    result.reaction = -1.0;
+    double time = 0.0;
+    double phase = 0.0;
+    for (size_t i = 0; i < sequence.segments.size(); i++)
+    {
+        const MotionSegment& segment = sequence.segments[i];
+        bool last = i + 1 == sequence.segments.size();
+        if (last)
+            result.rateBeforeLast = rate.GetRate();
+        if (segment.cut)
+            phase += 3.14159265;
+
+        double start = time;
+        while (time < start + segment.seconds)
+        {
+            double interval = 1.0 / rate.GetRate();
+            time += interval;
+            phase += segment.speed * interval;
+
+            pending.emplace_back();
+            FillGrid(pending.back().luma, phase);
+            pending.back().time = (int64_t)(time * 1e9);
+            if (pending.size() > BENCH_MOTION_READBACK)
+            {
+                const PendingGrid& grid = pending.front();
+                float motion = estimator.Update(grid.luma, grid.time);
+                rate.Update(motion, normalize ? estimator.GetInterval() : 1.0 / BENCH_ADAPTIVE_CEILING);
+                pending.pop_front();
+            }
+            if (last && i > 0 && result.reaction < 0.0 && rate.GetRate() == BENCH_ADAPTIVE_CEILING)
+                result.reaction = time - start;
+        }
+    }
+
+    result.samples = rate.GetFrames();
+    result.averageRate = rate.GetAverageRate();
+    result.finalRate = rate.GetRate();
+    return result;
+}
+
+static void CheckEstimator()
+{
+    float a[MotionEstimator::GRID_SIZE];
+    float b[MotionEstimator::GRID_SIZE];
+    for (uint32_t i = 0; i < MotionEstimator::GRID_SIZE; i++)
+    {
+        a[i] = 0.25f;
+        b[i] = 0.75f;
+    }
+
+    MotionEstimator estimator;
+    g_check.Expect(estimator.Update(a, 1000) == 0.0f && estimator.GetInterval() == 0.0, "first grid has no motion");
+    g_check.Expect(estimator.Update(b, 1000 + 1000000000 / 60) == 0.5f, "mean absolute change");
+    g_check.Expect(std::fabs(estimator.GetInterval() - 1.0 / 60) < 1e-9, "interval between the grids");
+    g_check.Expect(estimator.Update(b, 1000 + 1000000000 / 30) == 0.0f, "no change, no motion");
+    estimator.Reset();
+    g_check.Expect(estimator.Update(a, 5000) == 0.0f && estimator.GetInterval() == 0.0, "reset starts over");
+}
+
+static void CheckNormalization()
+{
+    AdaptiveRateSettings settings = DefaultAdaptiveRateSettings(BENCH_ADAPTIVE_FLOOR, BENCH_ADAPTIVE_CEILING);
+    settings.settleFrames = 1;
+
+    // the same change per second reads the same at every rate
+    AdaptiveFrameRate rate;
+    rate.Configure(settings);
+    float speed = (settings.lowMotion + settings.highMotion) / 2;
+    g_check.Expect(rate.Update(speed / 120, 1.0 / 120) == 120, "between the thresholds holds the rate");
+    g_check.Expect(rate.Update(speed / 30, 1.0 / 30) == 120, "four times the step over four times the time");
+
+    // a static scene steps down at any rate, a moving one steps up
+    float calm = settings.lowMotion / 2;
+    g_check.Expect(rate.Update(calm / 120, 1.0 / 120) == 90, "static steps down");
+    g_check.Expect(rate.Update(calm / 90, 1.0 / 90) == 67, "static at a lower rate steps down");
+    float moving = settings.highMotion * 2;
+    g_check.Expect(rate.Update(moving / 67, 1.0 / 67) == 120, "motion steps up");
+
+    // without an interval the current rate's is taken
+    rate.Reset();
+    g_check.Expect(rate.Update(calm / 120, 0.0) == 90, "no interval uses the current rate");
+
+    // a cut is a single jump, whatever the interval
+    g_check.Expect(rate.Update(settings.cutMotion, 1.0) == 120, "cut jumps to the ceiling");
+    g_check.Expect(rate.IsSceneCut(settings.cutMotion) && !rate.IsSceneCut(settings.cutMotion / 2), "cut threshold");
+}
+
+int RunAdaptive(const BenchOptions&)
+{
+    CheckEstimator();
+    CheckNormalization();
+
+    printf("sequence,samples,average_fps,final_fps,final_fps_unnormalized,reaction_ms\n");
+    for (const MotionSequence& sequence : g_motionSequences)
+    {
+        SequenceResult result = Replay(sequence, true);
+        SequenceResult raw = Replay(sequence, false);
+        printf("%s,%llu,%.1f,%u,%u,%.1f\n", sequence.name, (unsigned long long)result.samples, result.averageRate,
+            result.finalRate, raw.finalRate, result.reaction >= 0.0 ? result.reaction * 1000.0 : -1.0);
+
+        std::string name = sequence.name;
+        if (name == "static" || name == "slow_drift")
+            g_check.Expect(result.finalRate == BENCH_ADAPTIVE_FLOOR, "calm scene reaches the floor");
+        if (name == "pan" || name == "action")
+            g_check.Expect(result.finalRate == BENCH_ADAPTIVE_CEILING, "moving scene keeps the ceiling");
+        if (name == "static_then_action" || name == "static_then_cut")
+        {
+            // back to the ceiling within a few samples of the floor rate
+            g_check.Expect(result.rateBeforeLast == BENCH_ADAPTIVE_FLOOR, "floor before the change");
+            g_check.Expect(result.reaction >= 0.0 && result.reaction <= 8.0 / BENCH_ADAPTIVE_FLOOR, "ceiling right after the change");
+        }
+    }
+
+    // the feedback the per second thresholds remove: each step down makes the slow
+    // drift's change per sample larger until it no longer reads as static
+    const MotionSequence& drift = g_motionSequences[1];
+    g_check.Expect(Replay(drift, false).finalRate > BENCH_ADAPTIVE_FLOOR, "per sample thresholds stall above the floor");
+
+    return g_check.Result();
+}
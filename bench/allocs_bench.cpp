@@ -0,0 +1,190 @@
+#include "bench.h"
+
+#include "../histogram.h"
+#include "../perfstats.h"
+
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <vector>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// Heap allocations of the whole process, for --allocs. Every replaceable form of
+// operator new is counted, and every operator delete frees the way its new allocated.
+static std::atomic<uint64_t> g_allocations(0);
+
+static void* CountedAlloc(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+static void* CountedAlignedAlloc(size_t size, std::align_val_t alignment)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    size_t align = (size_t)alignment;
+#ifdef _WIN32
+    return _aligned_malloc(size ? size : 1, align);
+#else
+    // aligned_alloc takes whole multiples of the alignment
+    return aligned_alloc(align, std::max(align, (size + align - 1) / align * align));
+#endif
+}
+
+static void CountedFree(void* p)
+{
+    free(p);
+}
+
+static void CountedAlignedFree(void* p)
+{
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+static void* ThrowIfNull(void* p)
+{
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size) { return ThrowIfNull(CountedAlloc(size)); }
+void* operator new[](size_t size) { return ThrowIfNull(CountedAlloc(size)); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return CountedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return CountedAlloc(size); }
+void* operator new(size_t size, std::align_val_t alignment) { return ThrowIfNull(CountedAlignedAlloc(size, alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return ThrowIfNull(CountedAlignedAlloc(size, alignment)); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return CountedAlignedAlloc(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return CountedAlignedAlloc(size, alignment); }
+
+void operator delete(void* p) noexcept { CountedFree(p); }
+void operator delete[](void* p) noexcept { CountedFree(p); }
+void operator delete(void* p, size_t) noexcept { CountedFree(p); }
+void operator delete[](void* p, size_t) noexcept { CountedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { CountedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { CountedFree(p); }
+void operator delete(void* p, std::align_val_t) noexcept { CountedAlignedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { CountedAlignedFree(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { CountedAlignedFree(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { CountedAlignedFree(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { CountedAlignedFree(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { CountedAlignedFree(p); }
+
+static BenchCheck g_check("allocs");
+
+#define BENCH_ALLOCS_WARMUP      3
+#define BENCH_ALLOCS_FRAMES      10
+
+// The frame loop of the app on the reference pipeline: the stages, the bar tracker,
+// the render plan built when the committed bars change, the constant upload, the
+// stage timer and the published snapshot. Everything is sized during warm-up, after
+// it a frame must not touch the heap. The portable code of the frame is covered; the
+// D3D calls RefreshEffectSource, RenderEffects and RenderBackBuffer make around it
+// are not, they only run on a device.
+static bool CountReferenceFrameAllocations(const Scenario& s, const BenchOptions& options,
+    uint64_t& warmupAllocations, uint64_t& allocations)
+{
+    uint64_t start = g_allocations.load(std::memory_order_relaxed);
+    Pipeline p;
+    if (!PreparePipeline(s, options, p))
+        return false;
+
+    BarTracker tracker;
+    RenderPlan plan = {};
+    CompositeSubmitter submitter;
+    BenchCompositeContext context;
+    LatencyHistogram frameTimes;
+    PerfSnapshot perf = {};
+    PerfSnapshotBuffer snapshots;
+
+    uint64_t steady = 0;
+    for (uint32_t frame = 0; frame < BENCH_ALLOCS_WARMUP + BENCH_ALLOCS_FRAMES; frame++)
+    {
+        if (frame == BENCH_ALLOCS_WARMUP)
+            steady = g_allocations.load(std::memory_order_relaxed);
+
+        BenchClock::time_point frameStart = BenchClock::now();
+        double times[StageCount] = {};
+        DetectedBars detected;
+        uint32_t width, height;
+        CompositeBar bars[2] = {};
+        if (RunFrame(s, p, detected, width, height, bars, times) == 0)
+        {
+            fprintf(stderr, "%s: no bars detected\n", GetScenarioName(s).c_str());
+            return false;
+        }
+
+        BarLayout layout = ToBarLayout(detected);
+        if (tracker.Observe(layout))
+        {
+            RenderPlanInputs inputs = {};
+            inputs.windowWidth = s.displayWidth;
+            inputs.windowHeight = s.displayHeight;
+            inputs.gameWidth = width;
+            inputs.gameHeight = height;
+            inputs.bars = layout;
+            inputs.mipLevel = BENCH_MIPMAP_LEVELS;
+            inputs.zoom = BENCH_ZOOM;
+            inputs.stretchFactor = BENCH_STRETCH_FACTOR;
+            inputs.mirrored = BENCH_MIRRORED;
+            plan = BuildRenderPlan(inputs);
+        }
+
+        CompositeDraw draws[COMPOSITE_MAX_SLOTS];
+        uint32_t drawCount = GetCompositeDraws(plan, nullptr, 0, draws);
+        CompositeInputs compositeInputs = { nullptr, 0, s.displayWidth, s.displayHeight, true, true, false, 1.0f };
+        for (uint32_t i = 0; i < drawCount; i++)
+            submitter.Submit(context, draws[i].slot, draws[i].bars, draws[i].barCount, compositeInputs);
+
+        double frameMs = ElapsedMs(frameStart);
+        frameTimes.Record((uint64_t)(frameMs * 1e6));
+        perf.frame = frame;
+        perf.stageMs[PerfStageFrame] = frameMs;
+        perf.stageMs[PerfStageDetect] = times[StageDetect];
+        perf.stageMs[PerfStageCopy] = times[StageCopy];
+        perf.stageMs[PerfStageMips] = times[StageMips];
+        perf.stageMs[PerfStageBlur] = times[StageBlur];
+        perf.stageMs[PerfStageComposite] = times[StageComposite];
+        perf.detections++;
+        perf.detectionHits++;
+        snapshots.Publish(perf);
+    }
+
+    uint64_t end = g_allocations.load(std::memory_order_relaxed);
+    warmupAllocations = steady - start;
+    allocations = end - steady;
+    return true;
+}
+
+int RunAllocs(const BenchOptions& options)
+{
+    // the hooks have to see the allocations for a count of 0 to mean anything
+    uint64_t before = g_allocations.load(std::memory_order_relaxed);
+    std::vector<uint32_t>* probe = new std::vector<uint32_t>(16);
+    delete probe;
+    g_check.Expect(g_allocations.load(std::memory_order_relaxed) - before == 2, "allocation hooks installed");
+
+    printf("scenario,warmup_frames,frames,warmup_allocations,allocations\n");
+    for (const Scenario* scenario : SelectScenarios(options))
+    {
+        const Scenario& s = *scenario;
+        uint64_t warmupAllocations, allocations;
+        if (!CountReferenceFrameAllocations(s, options, warmupAllocations, allocations))
+            return 1;
+
+        printf("%s,%u,%u,%llu,%llu\n", GetScenarioName(s).c_str(), BENCH_ALLOCS_WARMUP, BENCH_ALLOCS_FRAMES,
+            (unsigned long long)warmupAllocations, (unsigned long long)allocations);
+        g_check.Expect(allocations == 0, "no allocation after warm-up");
+    }
+
+    return g_check.Result();
+}
+
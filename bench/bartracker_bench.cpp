@@ -0,0 +1,342 @@
+#include "bench.h"
+
+#include "../adaptiverate.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+static BenchCheck g_check("bar tracker");
+
+BarLayout ToBarLayout(const DetectedBars& detected)
+{
+    BarLayout layout = {};
+    if (detected.left > 0 || detected.right > 0)
+        layout = { 2, { BENCH_BAR_LEFT, BENCH_BAR_RIGHT }, { detected.left, detected.right } };
+    else if (detected.top > 0 || detected.bottom > 0)
+        layout = { 2, { BENCH_BAR_TOP, BENCH_BAR_BOTTOM }, { detected.top, detected.bottom } };
+    return layout;
+}
+
+static BarLayout Pillars(uint32_t size)
+{
+    return ToBarLayout({ 0, 0, size, size });
+}
+
+static void CheckBarTracker()
+{
+    const BarLayout none = {};
+    const BarLayout pillars = Pillars(320);
+    const BarLayout wider = Pillars(440);
+
+    // the first pass is taken as it is, jitter around it is ignored
+    {
+        BarTracker tracker;
+        g_check.Expect(tracker.Observe(pillars), "first pass committed");
+        g_check.Expect(!tracker.Observe(Pillars(322)) && !tracker.Observe(Pillars(317)) && !tracker.Observe(Pillars(324)),
+            "jitter ignored");
+        g_check.Expect(tracker.GetCommitted() == pillars && tracker.GetCommits() == 0, "committed layout kept over jitter");
+        g_check.Expect(tracker.GetChanges() == 3 && tracker.GetAvoided() == 3, "jitter counted as avoided");
+    }
+
+    // a new layout needs the confirmations in a row, jitter between them still confirms
+    {
+        BarTracker tracker;
+        tracker.Observe(pillars);
+        g_check.Expect(!tracker.Observe(wider) && !tracker.Observe(Pillars(442)), "change held back");
+        g_check.Expect(tracker.Observe(Pillars(439)), "change committed on the third pass");
+        g_check.Expect(tracker.GetCommitted() == Pillars(439) && tracker.GetCommits() == 1, "latest pass committed");
+        g_check.Expect(!tracker.Observe(Pillars(439)), "no change after the commit");
+    }
+
+    // flapping between two layouts, or falling back to the committed one, never commits
+    {
+        BarTracker tracker;
+        tracker.Observe(pillars);
+        for (int i = 0; i < 10; i++)
+            g_check.Expect(!tracker.Observe(i % 2 ? pillars : wider), "flapping held back");
+        g_check.Expect(!tracker.Observe(wider) && !tracker.Observe(wider) && !tracker.Observe(pillars) &&
+            !tracker.Observe(wider) && !tracker.Observe(wider), "confirmations start over");
+        g_check.Expect(tracker.GetCommitted() == pillars && tracker.GetCommits() == 0 && tracker.GetAvoided() == tracker.GetChanges(),
+            "flapping avoided");
+        g_check.Expect(!tracker.Observe(none) && !tracker.Observe(none) && tracker.Observe(none), "bars removed after confirmation");
+    }
+
+    // a scene cut confirms a change at once
+    {
+        BarTracker tracker;
+        tracker.Observe(pillars);
+        g_check.Expect(!tracker.Observe(pillars, true), "scene cut without a change");
+        g_check.Expect(tracker.Observe(wider, true), "change at a scene cut committed");
+        g_check.Expect(tracker.GetFastTracked() == 1 && tracker.GetCommits() == 1, "fast tracked change counted");
+    }
+
+    // a single confirmation commits every change, as without hysteresis
+    {
+        BarTracker tracker;
+        tracker.Configure({ 1, 0 });
+        tracker.Observe(pillars);
+        g_check.Expect(tracker.Observe(Pillars(321)) && tracker.Observe(wider) && tracker.Observe(pillars), "every change committed");
+        g_check.Expect(tracker.GetAvoided() == 0, "nothing avoided without hysteresis");
+    }
+
+    // after a reset the next pass is committed as it is
+    {
+        BarTracker tracker;
+        tracker.Observe(pillars);
+        tracker.Reset();
+        g_check.Expect(tracker.Observe(wider) && tracker.GetCommitted() == wider && tracker.GetCommits() == 1, "pass after a reset committed");
+    }
+}
+
+struct DetectionPass
+{
+    DetectedBars bars;
+    bool sceneCut;
+};
+
+// Luma of a frame showing content of the given aspect ratio, scaled by gain. The content
+// darkens towards its edges, so a fade moves the detected bars inwards pass by pass.
+static DetectedBars DetectContent(std::vector<float>& luma, uint32_t width, uint32_t height,
+    uint32_t aspectX, uint32_t aspectY, float gain, uint32_t pass)
+{
+    Scenario s = { "", width, height, aspectX, aspectY };
+    uint32_t left, top, gameWidth, gameHeight;
+    GetGameBox(s, left, top, gameWidth, gameHeight);
+
+    luma.assign((size_t)width * height, 0.0f);
+    for (uint32_t y = top; y < top + gameHeight; y++)
+    {
+        for (uint32_t x = left; x < left + gameWidth; x++)
+        {
+            uint32_t edge = std::min(std::min(x - left, left + gameWidth - 1 - x), std::min(y - top, top + gameHeight - 1 - y));
+            float noise = 0.9f + 0.2f * (Hash(x * 7919 + y * 104729 + pass) & 0xffff) / 65535.0f;
+            luma[(size_t)y * width + x] = gain * 0.02f * std::min(1.0f, edge / 200.0f) * noise;
+        }
+    }
+
+    DetectedBars detected = ReferenceDetectBars(luma.data(), width, height,
+        BENCH_BRIGHTNESS_THRESHOLD * BENCH_LUMA_THRESHOLD, BENCH_BLACK_RATIO, BENCH_BLACK_VARIANCE);
+    // keep either only letterbox or pillarbox, as Detection::Detect does
+    uint32_t contentWidth = width - std::min(width - 1, detected.left + detected.right);
+    uint32_t contentHeight = height - std::min(height - 1, detected.top + detected.bottom);
+    if ((float)contentWidth / contentHeight <= (float)width / height)
+        detected.top = detected.bottom = 0;
+    else
+        detected.left = detected.right = 0;
+    return detected;
+}
+
+// Detection sessions of the content that makes the bars flap, 16:9 on a 21:9 display.
+// Each pass is the reference detection of a synthetic frame, two per second.
+static std::vector<DetectionPass> MakeSession(const std::string& name)
+{
+    const uint32_t width = 2560, height = 1080;
+    std::vector<float> luma;
+    std::vector<DetectionPass> passes;
+    if (name == "fade")
+    {
+        // bright, fade to black and back
+        for (uint32_t pass = 0; pass < 48; pass++)
+        {
+            float t = pass < 8 ? 0.0f : pass < 20 ? (pass - 8) / 12.0f : pass < 28 ? 1.0f : pass < 40 ? (40 - pass) / 12.0f : 0.0f;
+            float gain = std::pow(0.002f, t);
+            passes.push_back({ DetectContent(luma, width, height, 16, 9, gain, pass), false });
+        }
+    }
+    else if (name == "dark")
+    {
+        // a dark, flickering scene
+        for (uint32_t pass = 0; pass < 48; pass++)
+        {
+            float gain = 0.004f + 0.012f * (Hash(pass) & 0xff) / 255.0f;
+            passes.push_back({ DetectContent(luma, width, height, 16, 9, pass < 8 || pass >= 40 ? 1.0f : gain, pass), false });
+        }
+    }
+    else if (name == "cutscene")
+    {
+        // 16:9 gameplay cutting to a 21:9 cutscene and back, the content itself is steady
+        for (uint32_t pass = 0; pass < 32; pass++)
+        {
+            bool cutscene = pass >= 10 && pass < 22;
+            passes.push_back({ DetectContent(luma, width, height, cutscene ? 64 : 16, cutscene ? 27 : 9, 1.0f, pass),
+                pass == 10 || pass == 22 });
+        }
+    }
+    return passes;
+}
+
+// one pass per line: top bottom left right [cut], # starts a comment
+static bool ReadSession(const std::string& path, std::vector<DetectionPass>& passes)
+{
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        DetectionPass pass = {};
+        int cut = 0;
+        if (sscanf(line.c_str(), "%u %u %u %u %d", &pass.bars.top, &pass.bars.bottom, &pass.bars.left, &pass.bars.right, &cut) < 4)
+            return false;
+        pass.sceneCut = cut != 0;
+        passes.push_back(pass);
+    }
+    return true;
+}
+
+static void CheckSceneCutLatch()
+{
+    const int64_t ms = 1000000;
+    SceneCutLatch latch;
+    g_check.Expect(!latch.Take(1000 * ms), "no cut marked");
+    latch.Mark(1000 * ms);
+    g_check.Expect(latch.Take(1000 * ms + SceneCutLatch::DEFAULT_WINDOW), "cut within the window");
+    g_check.Expect(!latch.Take(1001 * ms), "a cut fast-tracks one pass");
+    latch.Mark(2000 * ms);
+    g_check.Expect(!latch.Take(2001 * ms + SceneCutLatch::DEFAULT_WINDOW), "stale cut ignored");
+    g_check.Expect(!latch.Take(2002 * ms + SceneCutLatch::DEFAULT_WINDOW), "stale cut cleared");
+    latch.Mark(3000 * ms);
+    latch.Reset();
+    g_check.Expect(!latch.Take(3000 * ms), "reset clears the cut");
+}
+
+struct CutSession
+{
+    const char* name;
+    // ms between detection passes and of the switch from 16:9 to a 21:9 cutscene,
+    // whether the content jumps there or fades in without a cut
+    int64_t detectionInterval;
+    int64_t cutTime;
+    bool cut;
+    // the first pass after the switch commits the cutscene at once
+    bool fastTracked;
+};
+
+static const CutSession g_cutSessions[] =
+{
+    { "cut", BENCH_DETECTION_INTERVAL, 3100, true, true },
+    { "cut_slow_detection", 2000, 3700, true, true },
+    { "cut_stale", 2000, 3100, true, false },
+    { "no_cut", BENCH_DETECTION_INTERVAL, 3100, false, false },
+};
+
+// Frames at 60 fps and detection passes at the interval, the way the app runs them:
+// the motion grid of each frame comes back BENCH_MOTION_READBACK frames later, a
+// cut marks the latch, and the next pass takes it. Returns ms from the switch to the commit.
+static int64_t ReplayCutSession(const CutSession& session, BarTracker& tracker)
+{
+    const int64_t ms = 1000000;
+    const float cutMotion = DefaultAdaptiveRateSettings(30, 60).cutMotion;
+    const BarLayout pillars = Pillars(320);
+    const BarLayout cutscene = Pillars(440);
+
+    MotionEstimator estimator;
+    SceneCutLatch latch;
+    std::deque<std::pair<std::vector<float>, int64_t>> pending;
+    int64_t commit = -1;
+    int64_t nextDetection = session.detectionInterval * ms;
+    for (int64_t frame = 0; frame < 60 * 10; frame++)
+    {
+        int64_t time = frame * 1000 * ms / 60;
+        bool after = time >= session.cutTime * ms;
+
+        // the content drifts slowly, a cut jumps it by half a period
+        std::vector<float> grid(MotionEstimator::GRID_SIZE);
+        double phase = time / 1e9 + (after && session.cut ? 3.14159265 : 0.0);
+        for (uint32_t i = 0; i < MotionEstimator::GRID_SIZE; i++)
+            grid[i] = 0.5f + 0.25f * (float)std::sin((i % BENCH_MOTION_GRID_WIDTH) * 0.4 + (i / BENCH_MOTION_GRID_WIDTH) * 0.3 + phase);
+        pending.push_back({ grid, time });
+        if (pending.size() > BENCH_MOTION_READBACK)
+        {
+            if (estimator.Update(pending.front().first.data(), pending.front().second) >= cutMotion)
+                latch.Mark(pending.front().second);
+            pending.pop_front();
+        }
+
+        if (time >= nextDetection)
+        {
+            nextDetection += session.detectionInterval * ms;
+            if (tracker.Observe(after ? cutscene : pillars, latch.Take(time)) && commit < 0)
+                commit = (time - session.cutTime * ms) / ms;
+        }
+    }
+    return commit;
+}
+
+static BarTracker ReplaySession(const std::vector<DetectionPass>& passes)
+{
+    BarTracker tracker;
+    for (const DetectionPass& pass : passes)
+        tracker.Observe(ToBarLayout(pass.bars), pass.sceneCut);
+    return tracker;
+}
+
+int RunBars(const BenchOptions& options)
+{
+    CheckBarTracker();
+    CheckSceneCutLatch();
+
+    std::vector<std::pair<std::string, std::vector<DetectionPass>>> sessions;
+    if (!options.session.empty())
+    {
+        std::vector<DetectionPass> passes;
+        if (!ReadSession(options.session, passes))
+        {
+            fprintf(stderr, "failed to read the detection session %s\n", options.session.c_str());
+            return 1;
+        }
+        sessions.push_back({ options.session, passes });
+    }
+    else
+    {
+        for (const char* name : { "fade", "dark", "cutscene" })
+            sessions.push_back({ name, MakeSession(name) });
+    }
+
+    printf("session,passes,changes,reconfigurations,fast_tracked,avoided\n");
+    for (const auto& session : sessions)
+    {
+        BarTracker tracker = ReplaySession(session.second);
+        BarTracker again = ReplaySession(session.second);
+        g_check.Expect(again.GetCommitted() == tracker.GetCommitted() && again.GetCommits() == tracker.GetCommits(),
+            "replay is deterministic");
+
+        printf("%s,%llu,%llu,%llu,%llu,%llu\n", session.first.c_str(),
+            (unsigned long long)tracker.GetObservations(), (unsigned long long)tracker.GetChanges(),
+            (unsigned long long)tracker.GetCommits(), (unsigned long long)tracker.GetFastTracked(),
+            (unsigned long long)tracker.GetAvoided());
+
+        if (session.first == "fade" || session.first == "dark")
+            g_check.Expect(tracker.GetChanges() > 0 && tracker.GetAvoided() > tracker.GetCommits(), "flapping bars held back");
+        else if (session.first == "cutscene")
+            g_check.Expect(tracker.GetCommits() == 2 && tracker.GetFastTracked() == 2 && tracker.GetAvoided() == 0,
+                "cutscene changes committed at the scene cuts");
+    }
+
+    // scene cuts found on the motion grid, fresh and stale
+    printf("cut_session,detection_interval_ms,fast_tracked,commit_after_switch_ms\n");
+    for (const CutSession& session : g_cutSessions)
+    {
+        BarTracker tracker;
+        int64_t commit = ReplayCutSession(session, tracker);
+        printf("%s,%lld,%llu,%lld\n", session.name, (long long)session.detectionInterval,
+            (unsigned long long)tracker.GetFastTracked(), (long long)commit);
+
+        // the cutscene is committed either way, at once only right after a cut
+        g_check.Expect(commit >= 0 && tracker.GetCommits() == 1, "cutscene committed");
+        g_check.Expect(tracker.GetFastTracked() == (session.fastTracked ? 1u : 0u),
+            session.fastTracked ? "fresh cut fast-tracked" : "no fast track without a fresh cut");
+        if (session.fastTracked)
+            g_check.Expect(commit <= session.detectionInterval, "committed on the first pass after the cut");
+    }
+
+    return g_check.Result();
+}
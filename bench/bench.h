@@ -0,0 +1,257 @@
+#pragma once
+
+// Shared pieces of ambientlight_bench, each mode lives in <module>_bench.cpp.
+
+#include "../bartracker.h"
+#include "../renderplan.h"
+#include "../resourceregistry.h"
+#include "../shaders/reference.h"
+#include "../texturepool.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// app defaults, see settings.h
+#define BENCH_MIPMAP_LEVELS          5
+#define BENCH_BLUR_SAMPLES           5
+#define BENCH_BLUR_PASSES            3
+#define BENCH_ZOOM                   1
+#define BENCH_STRETCH_FACTOR         2.0f
+#define BENCH_MIRRORED               true
+#define BENCH_VIGNETTE_INTENSITY     1.0f
+#define BENCH_VIGNETTE_RADIUS        0.99f
+#define BENCH_VIGNETTE_SMOOTHNESS    0.4f
+#define BENCH_BRIGHTNESS_THRESHOLD   0.03f
+#define BENCH_BLACK_RATIO            0.60f
+// detect.cpp, SDR
+#define BENCH_LUMA_THRESHOLD         0.01f
+#define BENCH_BLACK_VARIANCE         1e-6f
+
+#define BENCH_PIXEL_BYTES            sizeof(Pixel)
+
+// ambientlight.cpp and motion.h
+#define BENCH_SWAPCHAIN_BUFFERS      2
+#define BENCH_MOTION_READBACK        3
+// adaptiverate.h
+#define BENCH_MOTION_GRID_WIDTH      32
+#define BENCH_MOTION_GRID_HEIGHT     18
+// settings.h
+#define BENCH_TEXTURE_POOL_SIZE      128
+#define BENCH_DETECTION_INTERVAL     500
+// DXGI_FORMAT_B8G8R8A8_UNORM and R16G16B16A16_FLOAT, DXGI_COLOR_SPACE_RGB_FULL_G22_NONE_P709 and G10
+#define BENCH_FORMAT_SDR             87
+#define BENCH_FORMAT_HDR             10
+#define BENCH_COLOR_SPACE_SDR        0
+#define BENCH_COLOR_SPACE_HDR        1
+// BlackBarPosition, see common.h
+#define BENCH_BAR_TOP                0
+#define BENCH_BAR_BOTTOM             1
+#define BENCH_BAR_LEFT               2
+#define BENCH_BAR_RIGHT              3
+
+// measured runs when checking against the baselines, enough for a confidence interval
+#define BENCH_CHECK_RUNS             9
+#define BENCH_CHECK_THRESHOLD        0.15
+#define BENCH_CHECK_MIN_DELTA        0.1
+
+struct BenchOptions
+{
+    // 0 picks the default for the mode
+    uint32_t runs = 0;
+    uint32_t warmup = 1;
+    bool quick = false;
+    bool json = false;
+    bool help = false;
+    std::string filter;
+    std::string output;
+    std::string input;
+    // baseline directory to compare against, or to write to
+    std::string check;
+    std::string writeBaseline;
+    double threshold = BENCH_CHECK_THRESHOLD;
+    // mode to run, see main.cpp, empty times the pipeline
+    std::string mode;
+    // scrapes of the metrics endpoint for --scrape
+    uint32_t scrapes = 0;
+    // video memory budget for --memory in MiB, 0 for none
+    uint32_t budget = 0;
+    // detection session to replay with --bars, one pass per line
+    std::string session;
+    // texture pool size for --pool and --prewarm in MiB
+    uint32_t poolSize = BENCH_TEXTURE_POOL_SIZE;
+};
+
+// The checks of a mode. A check that fails prints "<name>: <what>" and fails the mode,
+// the ones after it still run so a run lists every failure.
+class BenchCheck
+{
+public:
+    explicit BenchCheck(const char* name) : m_name(name), m_passed(true) {}
+
+    void Expect(bool condition, const char* what)
+    {
+        if (!condition)
+        {
+            fprintf(stderr, "%s: %s\n", m_name, what);
+            m_passed = false;
+        }
+    }
+
+    bool Passed() const { return m_passed; }
+    // exit code of the mode
+    int Result() const { return m_passed ? 0 : 1; }
+
+private:
+    const char* m_name;
+    bool m_passed;
+};
+
+typedef std::chrono::steady_clock BenchClock;
+
+inline double ElapsedMs(BenchClock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+}
+
+enum BenchStage
+{
+    StageDetect = 0,
+    StageCopy,
+    StageMips,
+    StageBlur,
+    StageComposite,
+    StageTotal,
+    StageCount
+};
+
+struct Scenario
+{
+    const char* combo;
+    uint32_t displayWidth;
+    uint32_t displayHeight;
+    // content aspect ratio
+    uint32_t aspectX;
+    uint32_t aspectY;
+};
+
+// the three layouts from the README, up to 8K ultrawide
+#define BENCH_SCENARIO_COUNT         9
+extern const Scenario g_scenarios[BENCH_SCENARIO_COUNT];
+
+std::string GetScenarioName(const Scenario& s);
+// the scenarios --quick and --scenario leave, smallest display first within each combination
+std::vector<const Scenario*> SelectScenarios(const BenchOptions& options);
+// game area inside the display, centered, same as Detection::GetFixedBars
+void GetGameBox(const Scenario& s, uint32_t& left, uint32_t& top, uint32_t& width, uint32_t& height);
+uint32_t Hash(uint32_t x);
+
+// everything a frame reads or writes, allocated once per scenario like the app's textures
+struct Pipeline
+{
+    Image frame;
+    std::vector<float> luma;
+    Image game;
+    std::vector<Image> mips;
+    Image downsampled;
+    Image blurTemp;
+    Image canvas;
+    VignetteMap vignette;
+    BlurKernel kernel;
+
+    uint64_t Bytes() const;
+};
+
+// the frame of a scenario and the buffers it needs, sized once like the app's textures
+bool PreparePipeline(const Scenario& s, const BenchOptions& options, Pipeline& p);
+// One frame of the pipeline on p.frame, each stage timed into times. Returns the
+// number of bars composited, 0 when no bars were detected and the frame stopped there.
+uint32_t RunFrame(const Scenario& s, Pipeline& p, DetectedBars& detected, uint32_t& width, uint32_t& height,
+    CompositeBar* bars, double* times);
+// bars on both sides of the game, as BuildRenderPlan builds them for RenderEffects
+uint32_t BuildBars(const Scenario& s, const DetectedBars& detected, uint32_t gameWidth, uint32_t gameHeight,
+    const Image& downsampled, CompositeBar* bars);
+// the bars of a detection pass as the app hands them to the tracker, letterbox or pillarbox
+BarLayout ToBarLayout(const DetectedBars& detected);
+// empty directory of its own under the system temp directory
+std::filesystem::path MakeTempDirectory(const char* name);
+
+// Stands in for the D3D device in the registry checks: records what it was asked for,
+// and fails anything larger than failAbove bytes to play out running out of memory.
+class FakeAllocator : public ResourceAllocator
+{
+public:
+    uint64_t failAbove = 0;
+    uint32_t calls = 0;
+    ResourceDesc last = {};
+
+    bool Allocate(const ResourceDesc& desc, ResourceId id) override
+    {
+        calls++;
+        last = desc;
+        return id != RESOURCE_ID_NONE && (failAbove == 0 || GetResourceBytes(desc) <= failAbove);
+    }
+};
+
+// Stands in for the D3D device of the texture pool: keeps track of what is alive.
+class MockPoolDevice : public TexturePoolDevice
+{
+public:
+    uint64_t failAbove = 0;
+    // write the memory of every texture, which a texture creation costs at the least
+    bool commit = false;
+    uint32_t creates = 0;
+    uint32_t destroys = 0;
+    uint64_t createdBytes = 0;
+    uint64_t liveBytes = 0;
+    uint64_t peakBytes = 0;
+    std::vector<uint64_t> bytes;
+
+    uint64_t Create(const TexturePoolKey& key, PoolEntryId id) override;
+    void Destroy(PoolEntryId id) override;
+
+private:
+    std::vector<std::vector<uint8_t>> memory;
+};
+
+// counts the D3D calls Composite::Render makes through CompositeSubmitter
+class BenchCompositeContext : public CompositeContext
+{
+public:
+    uint64_t updates = 0;
+    uint64_t dispatches = 0;
+    // constants of the last update
+    CompositeParameters last = {};
+
+    void UpdateParameters(uint32_t, const CompositeParameters& params) override
+    {
+        updates++;
+        last = params;
+    }
+    void Dispatch(uint32_t, uint32_t, uint32_t, uint32_t) override { dispatches++; }
+};
+
+// the modes, see main.cpp
+int RunPipeline(const BenchOptions& options);
+int RunScrape(const BenchOptions& options);
+int RunMemory(const BenchOptions& options);
+int RunReconfigure(const BenchOptions& options);
+int RunBars(const BenchOptions& options);
+int RunPool(const BenchOptions& options);
+int RunPrewarm(const BenchOptions& options);
+int RunRenderPlan(const BenchOptions& options);
+int RunReference(const BenchOptions& options);
+int RunSurfaces(const BenchOptions& options);
+int RunPacer(const BenchOptions& options);
+int RunScheduler(const BenchOptions& options);
+int RunAdaptive(const BenchOptions& options);
+int RunInterpolation(const BenchOptions& options);
+int RunHistogram(const BenchOptions& options);
+int RunTrace(const BenchOptions& options);
+int RunLatency(const BenchOptions& options);
+int RunAllocs(const BenchOptions& options);
+int RunWatch(const BenchOptions& options);
+int RunPersist(const BenchOptions& options);
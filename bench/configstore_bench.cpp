@@ -0,0 +1,349 @@
+#include "bench.h"
+
+#include "../configstore.h"
+#include "../filewatcher.h"
+#include "../inipp.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+static BenchCheck g_watch("watch");
+
+static void WriteText(const std::filesystem::path& path, const std::string& text)
+{
+    std::ofstream os(path, std::ios::binary | std::ios::trunc);
+    os << text;
+}
+
+// notifications are delivered asynchronously on Windows
+#define BENCH_WATCH_TIMEOUT_MS   2000
+#define BENCH_WATCH_SETTLE_MS    100
+#define BENCH_WATCH_POLLS        100000
+
+static bool WaitForChange(FileWatcher& watcher)
+{
+    for (uint32_t waited = 0; waited < BENCH_WATCH_TIMEOUT_MS; waited++)
+    {
+        if (watcher.Poll())
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+static bool SettleWithoutChange(FileWatcher& watcher)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_WATCH_SETTLE_MS));
+    return !watcher.Poll();
+}
+
+static const char* g_watchConfig =
+    "[Game]\n"
+    "BlurStrength = 3\n"
+    "FrameRate = 30\n"
+    "Resolution = 21:9\n"
+    "\n"
+    "[21:9]\n"
+    "Width = 21\n"
+    "Height = 9\n";
+
+static bool HasChange(const std::vector<ConfigChange>& changes, const char* section, const char* key)
+{
+    for (const ConfigChange& change : changes)
+    {
+        if (change.section == section && change.key == key)
+            return true;
+    }
+    return false;
+}
+
+static void CheckConfigDiff()
+{
+    std::shared_ptr<const ConfigSnapshot> base = ConfigSnapshot::Parse(g_watchConfig);
+    g_watch.Expect(DiffConfig(*base, *ConfigSnapshot::Parse(g_watchConfig)).empty(), "same text, no change");
+
+    // layout, order and comments are not settings
+    std::shared_ptr<const ConfigSnapshot> reordered = ConfigSnapshot::Parse(
+        "; written by hand\n[21:9]\nHeight=9\nWidth=21 ; ultrawide\n\n[Game]\nResolution=21:9\nFrameRate=30\nBlurStrength=3\n");
+    g_watch.Expect(DiffConfig(*base, *reordered).empty(), "order, spacing and comments are no change");
+
+    std::shared_ptr<const ConfigSnapshot> changed = ConfigSnapshot::Parse(
+        "[Game]\nBlurStrength = 4\nFrameRate = 30\nResolution = 21:9\nZoom = 2\n[32:9]\nWidth = 32\nHeight = 9\n");
+    std::vector<ConfigChange> changes = DiffConfig(*base, *changed);
+    g_watch.Expect(changes.size() == 6, "changed, added and removed keys");
+    g_watch.Expect(HasChange(changes, "Game", "BlurStrength"), "changed value");
+    g_watch.Expect(HasChange(changes, "Game", "Zoom"), "added key");
+    g_watch.Expect(HasChange(changes, "21:9", "Width") && HasChange(changes, "21:9", "Height"), "removed section");
+    g_watch.Expect(HasChange(changes, "32:9", "Width") && HasChange(changes, "32:9", "Height"), "added section");
+    g_watch.Expect(!HasChange(changes, "Game", "FrameRate"), "unchanged key");
+
+    g_watch.Expect(base->GetSection("Missing").empty(), "missing section is empty");
+}
+
+static void CheckFileWatcher(const std::filesystem::path& directory)
+{
+    std::filesystem::path config = directory / "config.ini";
+    FileWatcher watcher;
+    g_watch.Expect(watcher.Start(config), "watch the directory");
+    g_watch.Expect(!watcher.Poll(), "no change before a write");
+
+    WriteText(config, g_watchConfig);
+    g_watch.Expect(WaitForChange(watcher), "created");
+    g_watch.Expect(SettleWithoutChange(watcher), "one write, one change");
+
+    WriteText(config, std::string(g_watchConfig) + "Zoom = 2\n");
+    g_watch.Expect(WaitForChange(watcher), "written in place");
+
+    // the UI and traces write next to the config
+    WriteText(directory / "imgui.ini", "[Window][Settings]\n");
+    g_watch.Expect(SettleWithoutChange(watcher), "other files are filtered out");
+
+    std::filesystem::path temp = directory / "config.ini.tmp";
+    WriteText(temp, g_watchConfig);
+    std::filesystem::rename(temp, config);
+    g_watch.Expect(WaitForChange(watcher), "replaced by a rename");
+
+    std::filesystem::remove(config);
+    g_watch.Expect(WaitForChange(watcher), "removed");
+    g_watch.Expect(watcher.GetChanges() == 4, "changes counted");
+}
+
+// reloads until the store read the file after a notification, true when keys changed
+static bool ReloadAfterWrite(ConfigStore& store)
+{
+    uint64_t reads = store.GetReads();
+    bool reloaded = false;
+    for (uint32_t waited = 0; waited < BENCH_WATCH_TIMEOUT_MS && store.GetReads() == reads; waited++)
+    {
+        reloaded = store.Reload();
+        if (store.GetReads() == reads)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return reloaded;
+}
+
+static void CheckConfigStore(const std::filesystem::path& directory)
+{
+    std::filesystem::path config = directory / "config.ini";
+    WriteFileAtomic(config, g_watchConfig);
+
+    ConfigStore store;
+    g_watch.Expect(store.Start(config), "store watches");
+    int blur = 0;
+    inipp::get_value(store.GetConfig()->GetSection("Game"), "BlurStrength", blur);
+    g_watch.Expect(blur == 3, "first read");
+
+    // the same contents are not even parsed, a new layout is parsed and dropped
+    WriteFileAtomic(config, g_watchConfig);
+    g_watch.Expect(!ReloadAfterWrite(store) && store.GetUnchanged() == 1 && store.GetParses() == 0,
+        "identical file is no parse");
+    WriteFileAtomic(config, std::string("; written by hand\n") + g_watchConfig);
+    g_watch.Expect(!ReloadAfterWrite(store) && store.GetParses() == 1 && store.GetReloads() == 0,
+        "new layout is no reload");
+
+    std::shared_ptr<const ConfigSnapshot> before = store.GetConfig();
+    WriteFileAtomic(config, "[Game]\nBlurStrength = 5\nFrameRate = 30\nResolution = 21:9\n[21:9]\nWidth = 21\nHeight = 9\n");
+    g_watch.Expect(ReloadAfterWrite(store), "changed file reloads");
+    g_watch.Expect(store.GetChanges().size() == 1 && HasChange(store.GetChanges(), "Game", "BlurStrength"),
+        "only the changed key");
+    blur = 0;
+    inipp::get_value(before->GetSection("Game"), "BlurStrength", blur);
+    g_watch.Expect(blur == 3, "a snapshot does not change after a reload");
+
+    uint64_t reads = store.GetReads();
+    for (uint32_t i = 0; i < 1000; i++)
+        store.Reload();
+    g_watch.Expect(store.GetReads() == reads, "no read without a notification");
+
+    uint64_t unchanged = store.GetUnchanged();
+    g_watch.Expect(!store.Reload(true) && store.GetReads() == reads + 1 && store.GetUnchanged() == unchanged + 1,
+        "forced reload of the same file");
+}
+
+int RunWatch(const BenchOptions& options)
+{
+    CheckConfigDiff();
+
+    std::filesystem::path directory = MakeTempDirectory("watch");
+    CheckFileWatcher(directory);
+    CheckConfigStore(directory);
+
+    // idle cost per frame: a poll of the watcher, against the write time the file
+    // was checked for every UPDATE_INTERVAL before
+    std::filesystem::path config = directory / "config.ini";
+    uint32_t polls = options.quick ? BENCH_WATCH_POLLS / 10 : BENCH_WATCH_POLLS;
+    FileWatcher watcher;
+    watcher.Start(config);
+    BenchClock::time_point start = BenchClock::now();
+    uint32_t changes = 0;
+    for (uint32_t i = 0; i < polls; i++)
+        changes += watcher.Poll() ? 1 : 0;
+    double watchNs = ElapsedMs(start) * 1e6 / polls;
+
+    std::error_code error;
+    std::filesystem::file_time_type writeTime;
+    start = BenchClock::now();
+    for (uint32_t i = 0; i < polls; i++)
+        writeTime = std::filesystem::last_write_time(config, error);
+    double writeTimeNs = ElapsedMs(start) * 1e6 / polls;
+    g_watch.Expect(changes == 0 && !error, "no change while nothing is written");
+
+    printf("method,polls,ns_per_poll\n");
+    printf("watcher,%u,%.1f\n", polls, watchNs);
+    printf("write_time,%u,%.1f\n", polls, writeTimeNs);
+
+    watcher.Stop();
+    std::filesystem::remove_all(directory, error);
+    return g_watch.Result();
+}
+
+static BenchCheck g_persist("persist");
+
+// a slider drag saves once per frame, the settings were read every UPDATE_INTERVAL
+#define BENCH_PERSIST_FRAMES     120
+#define BENCH_PERSIST_FRAME_MS   16
+#define BENCH_PERSIST_READ_MS    250
+
+// the config in use with the blur changed, as SaveSettings makes it
+static std::shared_ptr<const ConfigSnapshot> WithBlur(const ConfigSnapshot& config, int blur)
+{
+    ConfigSnapshot::Sections sections = config.GetSections();
+    sections["Game"]["BlurStrength"] = std::to_string(blur);
+    return ConfigSnapshot::Create(std::move(sections));
+}
+
+static int ReadBlur(const std::filesystem::path& file)
+{
+    std::ifstream is(file);
+    int blur = 0;
+    inipp::get_value(ConfigSnapshot::Parse(is)->GetSection("Game"), "BlurStrength", blur);
+    return blur;
+}
+
+struct PersistRun
+{
+    uint64_t saves;
+    uint64_t writes;
+    uint64_t reloads;
+    // without the store every save wrote the file and every read that found it
+    // written since the last one parsed it and applied it
+    uint64_t oldWrites;
+    uint64_t oldReloads;
+    // time of the last save and of the write
+    uint64_t lastSave;
+    uint64_t written;
+};
+
+// Drags the blur through values, one save per frame, then keeps running frames until
+// nothing is pending. Every frame reloads and flushes as ReadSettings does.
+static PersistRun Drag(ConfigStore& store, uint64_t& now, const std::vector<int>& values)
+{
+    PersistRun run = {};
+    uint64_t saves = store.GetSaves();
+    uint64_t writes = store.GetWrites();
+    uint64_t reloads = store.GetReloads();
+    uint64_t lastRead = now;
+    bool unread = false;
+
+    for (size_t frame = 0; frame < values.size() || store.IsPending(); frame++)
+    {
+        now += BENCH_PERSIST_FRAME_MS;
+        if (frame < values.size())
+        {
+            store.Save(WithBlur(*store.GetConfig(), values[frame]), now);
+            run.oldWrites++;
+            run.lastSave = now;
+            unread = true;
+        }
+        if (now >= lastRead + BENCH_PERSIST_READ_MS)
+        {
+            run.oldReloads += unread ? 1 : 0;
+            unread = false;
+            lastRead = now;
+        }
+
+        store.Reload();
+        if (store.Flush(now))
+            run.written = now;
+    }
+
+    run.saves = store.GetSaves() - saves;
+    run.writes = store.GetWrites() - writes;
+    run.reloads = store.GetReloads() - reloads;
+    return run;
+}
+
+static void PrintPersist(const char* scenario, const PersistRun& run)
+{
+    printf("%s,%llu,%llu,%llu,%llu,%llu\n", scenario, (unsigned long long)run.saves,
+        (unsigned long long)run.oldWrites, (unsigned long long)run.writes,
+        (unsigned long long)run.oldReloads, (unsigned long long)run.reloads);
+}
+
+int RunPersist(const BenchOptions& options)
+{
+    std::filesystem::path directory = MakeTempDirectory("persist");
+    std::filesystem::path config = directory / "config.ini";
+    std::filesystem::path temp = directory / "config.ini.tmp";
+    WriteFileAtomic(config, g_watchConfig);
+
+    ConfigStore store;
+    g_persist.Expect(store.Start(config), "store watches");
+    uint64_t now = 0;
+    uint32_t frames = options.quick ? BENCH_PERSIST_FRAMES / 2 : BENCH_PERSIST_FRAMES;
+
+    // drag from 3 up, the file is written once, a debounce window after the last save
+    std::vector<int> values;
+    for (uint32_t i = 0; i < frames; i++)
+        values.push_back(4 + (int)(i * 16 / frames));
+    PersistRun drag = Drag(store, now, values);
+    g_persist.Expect(drag.saves == frames && drag.writes == 1, "one write per drag");
+    g_persist.Expect(drag.written >= drag.lastSave + CONFIG_STORE_DEBOUNCE_MS &&
+        drag.written < drag.lastSave + CONFIG_STORE_DEBOUNCE_MS + BENCH_PERSIST_FRAME_MS, "written once the window passed");
+    g_persist.Expect(ReadBlur(config) == values.back(), "the last value is written");
+    g_persist.Expect(!std::filesystem::exists(temp), "no temp file left");
+
+    // the notification for our own write reads the file but reloads nothing
+    g_persist.Expect(!ReloadAfterWrite(store) && store.GetUnchanged() == 1 && store.GetParses() == 0,
+        "own write is no reload");
+    g_persist.Expect(drag.reloads == 0 && store.GetReloads() == 0, "no reload while dragging");
+
+    // up and back to where it started, the file holds that already
+    std::vector<int> back;
+    for (uint32_t i = 0; i < frames; i++)
+        back.push_back(values.back() + (int)(i < frames / 2 ? i : frames - 1 - i) * 8 / (int)frames);
+    PersistRun dragBack = Drag(store, now, back);
+    g_persist.Expect(dragBack.writes == 0 && store.GetSkippedWrites() == 1, "drag back is no write");
+    uint64_t reads = store.GetReads();
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_WATCH_SETTLE_MS));
+    store.Reload();
+    g_persist.Expect(store.GetReads() == reads, "no notification without a write");
+
+    // an edit outside the app while a save waits is the newer one
+    store.Save(WithBlur(*store.GetConfig(), 7), now);
+    WriteFileAtomic(config, WithBlur(*store.GetConfig(), 9)->Generate());
+    g_persist.Expect(ReloadAfterWrite(store) && !store.IsPending(), "edit drops the pending save");
+    uint64_t writes = store.GetWrites();
+    g_persist.Expect(!store.Flush(now + CONFIG_STORE_DEBOUNCE_MS) && store.GetWrites() == writes &&
+        ReadBlur(config) == 9, "edit is kept");
+
+    // on exit the window is not waited for
+    store.Save(WithBlur(*store.GetConfig(), 11), now);
+    g_persist.Expect(!store.Flush(now) && store.IsPending(), "held back in the window");
+    g_persist.Expect(store.Flush(now, true) && ReadBlur(config) == 11, "forced flush writes");
+
+    printf("scenario,saves,writes_before,writes_after,reloads_before,reloads_after\n");
+    PrintPersist("drag", drag);
+    PrintPersist("drag_back", dragBack);
+
+    store.Stop();
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    return g_persist.Result();
+}
+
@@ -0,0 +1,161 @@
+#include "bench.h"
+
+#include "../framepacer.h"
+
+static BenchCheck g_check("frame pacer");
+
+#define BENCH_MS                     1000000LL
+
+// the frame rates the report covers
+static const uint32_t g_pacerRates[] = { 30, 60, 120, 240 };
+
+// deadlines stay on the grid of the first frame
+static void CheckGrid()
+{
+    MockFrameClock clock;
+    FramePacer pacer(clock);
+    pacer.SetFrameRate(60);
+    int64_t period = 1000000000LL / 60;
+
+    pacer.Wait();
+    int64_t start = clock.Now();
+    for (uint32_t i = 1; i <= 100; i++)
+    {
+        clock.Advance(5 * BENCH_MS);
+        pacer.Wait();
+        g_check.Expect(clock.Now() == start + period * i, "woken on the deadline");
+    }
+    FramePacerStats stats = pacer.GetStats();
+    g_check.Expect(stats.frames == 100 && stats.wakeups == 100 && stats.missed == 0, "every frame waited");
+    g_check.Expect(clock.GetWakeups() == 100, "one wakeup per frame");
+    g_check.Expect(stats.meanError == 0.0 && stats.jitter == 0.0 && stats.maxError == 0, "no wakeup error");
+}
+
+// a late frame does not push the following ones back
+static void CheckLateFrames()
+{
+    MockFrameClock clock;
+    FramePacer pacer(clock);
+    pacer.SetFrameRate(60);
+    int64_t period = 1000000000LL / 60;
+
+    pacer.Wait();
+    int64_t start = clock.Now();
+    clock.Advance(period + 3 * BENCH_MS);
+    pacer.Wait();
+    g_check.Expect(pacer.GetStats().missed == 1 && clock.Now() == start + period + 3 * BENCH_MS, "late frame runs at once");
+    pacer.Wait();
+    g_check.Expect(clock.Now() == start + period * 2, "back on the grid after a late frame");
+
+    // more than a whole period lost starts a new grid from the late frame
+    int64_t late = clock.Now() + period * 3;
+    clock.Advance(period * 3);
+    pacer.Wait();
+    pacer.Wait();
+    g_check.Expect(pacer.GetStats().missed == 2 && clock.Now() == late + period, "new grid after a lost period");
+}
+
+static void CheckWakeupLatency()
+{
+    MockFrameClock clock;
+    clock.SetWakeupLatency(BENCH_MS / 5);
+    FramePacer pacer(clock);
+    pacer.SetFrameRate(120);
+
+    pacer.Wait();
+    for (uint32_t i = 0; i < 50; i++)
+        pacer.Wait();
+    FramePacerStats stats = pacer.GetStats();
+    g_check.Expect(stats.missed == 0 && stats.wakeups == 50, "latency below the period misses nothing");
+    g_check.Expect(stats.meanError == BENCH_MS / 5 && stats.maxError == BENCH_MS / 5 && stats.jitter == 0.0,
+        "a fixed latency is error, not jitter");
+
+    pacer.ResetStats();
+    stats = pacer.GetStats();
+    g_check.Expect(stats.frames == 0 && stats.wakeups == 0 && stats.maxError == 0, "stats reset");
+}
+
+static void CheckFrameRateChange()
+{
+    MockFrameClock clock;
+    FramePacer pacer(clock);
+    pacer.SetFrameRate(60);
+    g_check.Expect(pacer.GetFrameRate() == 60, "frame rate");
+
+    // the pending deadline moves with the period, counted from the last frame
+    pacer.Wait();
+    int64_t start = clock.Now();
+    pacer.SetFrameRate(30);
+    pacer.Wait();
+    g_check.Expect(clock.Now() == start + 1000000000LL / 30, "slower rate waits the longer period");
+    int64_t last = clock.Now();
+    pacer.SetFrameRate(240);
+    pacer.Wait();
+    g_check.Expect(clock.Now() == last + 1000000000LL / 240, "faster rate waits the shorter period");
+
+    pacer.SetFrameRate(0);
+    g_check.Expect(pacer.GetFrameRate() == 1, "at least one frame per second");
+}
+
+// the first frame after the loop was idle is neither a missed frame nor late
+static void CheckIdleGap()
+{
+    MockFrameClock clock;
+    FramePacer pacer(clock);
+    pacer.SetFrameRate(60);
+    int64_t period = 1000000000LL / 60;
+
+    pacer.Wait();
+    pacer.Wait();
+    pacer.Reset();
+    clock.Advance(2000 * BENCH_MS);
+    pacer.Wait();
+    int64_t resumed = clock.Now();
+    pacer.Wait();
+    FramePacerStats stats = pacer.GetStats();
+    g_check.Expect(stats.missed == 0, "idle gap is not a missed frame");
+    g_check.Expect(clock.Now() == resumed + period, "new grid after the idle gap");
+
+    // without the reset the gap is a long frame
+    FramePacer stalled(clock);
+    stalled.Wait();
+    clock.Advance(2000 * BENCH_MS);
+    stalled.Wait();
+    g_check.Expect(stalled.GetStats().missed == 1, "a long frame is a missed frame");
+}
+
+// wakeup error of the system clock at each rate, the waits only
+static void ReportJitter(const BenchOptions& options)
+{
+    SystemFrameClock clock;
+    // seconds per rate
+    double seconds = options.quick ? 0.25 : 2.0;
+
+    printf("fps,frames,missed,mean_error_ms,jitter_ms,max_error_ms,wait_cpu_us\n");
+    for (uint32_t rate : g_pacerRates)
+    {
+        FramePacer pacer(clock);
+        pacer.SetFrameRate(rate);
+        pacer.Wait();
+        uint32_t frames = (uint32_t)(rate * seconds);
+        for (uint32_t i = 0; i < frames; i++)
+            pacer.Wait();
+
+        FramePacerStats stats = pacer.GetStats();
+        printf("%u,%llu,%llu,%.3f,%.3f,%.3f,%.1f\n", rate, (unsigned long long)stats.frames,
+            (unsigned long long)stats.missed, stats.meanError / 1e6, stats.jitter / 1e6,
+            stats.maxError / 1e6, stats.waitCpuTime / 1e3);
+        g_check.Expect(stats.frames == frames, "every frame paced");
+    }
+}
+
+int RunPacer(const BenchOptions& options)
+{
+    CheckGrid();
+    CheckLateFrames();
+    CheckWakeupLatency();
+    CheckFrameRateChange();
+    CheckIdleGap();
+    ReportJitter(options);
+    return g_check.Result();
+}
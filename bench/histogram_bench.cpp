@@ -0,0 +1,165 @@
+#include "bench.h"
+
+#include "../histogram.h"
+
+#include <memory>
+#include <thread>
+
+static BenchCheck g_check("histogram");
+
+// relative width of a bucket, the resolution of the percentiles
+#define BENCH_HISTOGRAM_RESOLUTION   (1.0 / LatencyHistogram::SUB_BUCKETS)
+
+static void CheckBuckets()
+{
+    // small values map one to one
+    for (uint64_t value = 0; value < LatencyHistogram::SUB_BUCKETS; value++)
+    {
+        g_check.Expect(LatencyHistogram::BucketIndex(value) == value && LatencyHistogram::BucketWidth((uint32_t)value) == 1,
+            "small values map one to one");
+    }
+
+    // every bucket starts where the previous one ends, and its bounds map to it
+    for (uint32_t i = 0; i < LatencyHistogram::BUCKETS; i++)
+    {
+        uint64_t lower = LatencyHistogram::BucketLowerBound(i);
+        uint64_t width = LatencyHistogram::BucketWidth(i);
+        g_check.Expect(LatencyHistogram::BucketIndex(lower) == i, "lower bound in its bucket");
+        g_check.Expect(LatencyHistogram::BucketIndex(lower + width - 1) == i, "upper bound in its bucket");
+        if (i + 1 < LatencyHistogram::BUCKETS)
+            g_check.Expect(LatencyHistogram::BucketLowerBound(i + 1) == lower + width, "buckets are contiguous");
+        if (i >= LatencyHistogram::SUB_BUCKETS)
+            g_check.Expect((double)width / lower <= BENCH_HISTOGRAM_RESOLUTION, "bucket within the resolution");
+    }
+
+    // the powers of two start a new row of buckets
+    for (uint32_t bit = LatencyHistogram::SUB_BUCKET_BITS; bit < LatencyHistogram::MAX_VALUE_BITS; bit++)
+    {
+        uint32_t index = LatencyHistogram::BucketIndex(1ull << bit);
+        g_check.Expect(index % LatencyHistogram::SUB_BUCKETS == 0 && LatencyHistogram::BucketIndex((1ull << bit) - 1) == index - 1,
+            "power of two starts a row");
+    }
+
+    // values past the range land in the last bucket
+    g_check.Expect(LatencyHistogram::BucketIndex(1ull << LatencyHistogram::MAX_VALUE_BITS) == LatencyHistogram::BUCKETS - 1 &&
+        LatencyHistogram::BucketIndex(UINT64_MAX) == LatencyHistogram::BUCKETS - 1, "values clamped to the last bucket");
+}
+
+static bool Near(uint64_t value, uint64_t expected)
+{
+    double difference = value > expected ? (double)(value - expected) : (double)(expected - value);
+    return difference <= expected * BENCH_HISTOGRAM_RESOLUTION + 1;
+}
+
+static void CheckPercentiles()
+{
+    auto histogram = std::make_unique<LatencyHistogram>();
+    g_check.Expect(histogram->GetStats().count == 0, "nothing before the first window");
+
+    // 1 to 10000 us, uniform
+    for (uint64_t i = 1; i <= 10000; i++)
+        histogram->Record(i * 1000);
+    histogram->Rotate();
+    LatencyStats stats = histogram->GetStats();
+    g_check.Expect(stats.count == 10000 && stats.min == 1000 && stats.max == 10000000, "count and extremes exact");
+    g_check.Expect(stats.mean == 5000500, "mean exact");
+    g_check.Expect(Near(stats.p50, 5000000) && Near(stats.p95, 9500000) && Near(stats.p99, 9900000),
+        "percentiles within a bucket");
+
+    // a single value is every percentile, kept within the exact extremes
+    histogram->Record(16667000);
+    histogram->Rotate();
+    stats = histogram->GetStats();
+    g_check.Expect(stats.count == 1 && stats.p50 == 16667000 && stats.p99 == 16667000 && stats.mean == 16667000,
+        "single value");
+
+    // a slow tail only moves the high percentiles
+    for (uint32_t i = 0; i < 990; i++)
+        histogram->Record(2000000);
+    for (uint32_t i = 0; i < 10; i++)
+        histogram->Record(50000000);
+    histogram->Rotate();
+    stats = histogram->GetStats();
+    g_check.Expect(Near(stats.p50, 2000000) && Near(stats.p95, 2000000) && Near(stats.p99, 2000000), "tail under p99");
+    g_check.Expect(stats.max == 50000000, "tail in the max");
+    histogram->Record(50000000);
+    for (uint32_t i = 0; i < 979; i++)
+        histogram->Record(2000000);
+    for (uint32_t i = 0; i < 20; i++)
+        histogram->Record(50000000);
+    histogram->Rotate();
+    stats = histogram->GetStats();
+    g_check.Expect(Near(stats.p95, 2000000) && Near(stats.p99, 50000000), "tail over p99");
+}
+
+static void CheckRotate()
+{
+    auto histogram = std::make_unique<LatencyHistogram>();
+    histogram->Record(100);
+    histogram->Record(300);
+    g_check.Expect(histogram->GetStats().count == 0, "the current window is not read");
+    g_check.Expect(histogram->GetLast() == 300, "last sample in any window");
+
+    histogram->Rotate();
+    histogram->Record(5000);
+    LatencyStats stats = histogram->GetStats();
+    g_check.Expect(stats.count == 2 && stats.min == 100 && stats.max == 300 && stats.mean == 200,
+        "stats of the completed window");
+    g_check.Expect(histogram->GetLast() == 5000, "last sample after a rotate");
+
+    histogram->Rotate();
+    stats = histogram->GetStats();
+    g_check.Expect(stats.count == 1 && stats.min == 5000 && stats.max == 5000, "next window");
+
+    // an empty window clears the stats
+    histogram->Rotate();
+    stats = histogram->GetStats();
+    g_check.Expect(stats.count == 0 && stats.max == 0 && stats.p99 == 0, "empty window");
+}
+
+// wall ns per Record of each writer with threads recording at once, and per GetStats
+static void ReportOverhead(const BenchOptions& options)
+{
+    const uint32_t records = options.quick ? 1000000 : 10000000;
+    auto histogram = std::make_unique<LatencyHistogram>();
+
+    printf("threads,records,ns_per_record\n");
+    for (uint32_t threads : { 1u, 2u, 4u })
+    {
+        BenchClock::time_point start = BenchClock::now();
+        std::vector<std::thread> writers;
+        for (uint32_t t = 0; t < threads; t++)
+        {
+            writers.emplace_back([&histogram, records, t]()
+            {
+                // frame times around 16.7 ms with some spread
+                for (uint32_t i = 0; i < records; i++)
+                    histogram->Record(16000000 + (Hash(i + t * records) & 0xfffff));
+            });
+        }
+        for (std::thread& writer : writers)
+            writer.join();
+        double ms = ElapsedMs(start);
+        printf("%u,%u,%.2f\n", threads, records, ms * 1e6 / records);
+
+        histogram->Rotate();
+        g_check.Expect(histogram->GetStats().count == (uint64_t)records * threads, "every record counted");
+    }
+
+    const uint32_t reads = 1000;
+    BenchClock::time_point start = BenchClock::now();
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < reads; i++)
+        sum += histogram->GetStats().p99;
+    printf("get_stats_us,%.2f\n", ElapsedMs(start) * 1e3 / reads);
+    g_check.Expect(sum > 0, "stats read");
+}
+
+int RunHistogram(const BenchOptions& options)
+{
+    CheckBuckets();
+    CheckPercentiles();
+    CheckRotate();
+    ReportOverhead(options);
+    return g_check.Result();
+}
@@ -0,0 +1,144 @@
+#include "bench.h"
+
+static BenchCheck g_check("interpolation");
+
+#define BENCH_PRESENT_RATE           120
+
+// capture rate of each pair against BENCH_PRESENT_RATE, the last one without interpolation
+static const uint32_t g_captureRates[] = { 30, 60, 120 };
+
+struct InterpolationCost
+{
+    uint32_t captures;
+    // CPU time of the capture stages (history copy, copy, mips, blur) and of the composite
+    double captureMs;
+    double compositeMs;
+};
+
+// The frames of presentFrames at BENCH_PRESENT_RATE: capture, mips and blur run at
+// captureRate, the composite every frame, blending from the previous capture to the
+// latest over one capture period as RenderEffects does.
+static InterpolationCost RunPair(const Scenario& s, Pipeline& p, Image& previous, uint32_t captureRate,
+    uint32_t presentFrames)
+{
+    InterpolationCost cost = {};
+    bool interpolate = captureRate < BENCH_PRESENT_RATE;
+    uint32_t step = BENCH_PRESENT_RATE / captureRate;
+
+    DetectedBars detected;
+    uint32_t width, height;
+    CompositeBar bars[2] = {};
+    uint32_t barCount = 0;
+    for (uint32_t frame = 0; frame < presentFrames; frame++)
+    {
+        if (frame % step == 0)
+        {
+            BenchClock::time_point start = BenchClock::now();
+            if (interpolate && cost.captures > 0)
+            {
+                if (previous.Width() != p.downsampled.Width() || previous.Height() != p.downsampled.Height())
+                    previous.Resize(p.downsampled.Width(), p.downsampled.Height());
+                ReferenceCopyRegion(previous, p.downsampled, 0, 0);
+            }
+            double history = ElapsedMs(start);
+
+            // detection runs on its own interval in the app, only the capture stages count
+            double times[StageCount] = {};
+            barCount = RunFrame(s, p, detected, width, height, bars, times);
+            cost.captureMs += history + times[StageCopy] + times[StageMips] + times[StageBlur];
+            cost.captures++;
+        }
+
+        BenchClock::time_point start = BenchClock::now();
+        bool blend = interpolate && cost.captures >= 2;
+        ReferenceComposite(p.canvas, p.downsampled, bars, barCount, nullptr, 0, s.displayWidth, s.displayHeight,
+            &p.vignette, p.luma.data(), blend ? &previous : nullptr, blend ? (float)(frame % step) / step : 1.0f);
+        cost.compositeMs += ElapsedMs(start);
+    }
+    return cost;
+}
+
+// the blend weight picks the previous capture at 0 and the latest at 1
+static void CheckBlend(const Scenario& s, Pipeline& p)
+{
+    DetectedBars detected;
+    uint32_t width, height;
+    CompositeBar bars[2] = {};
+    double times[StageCount] = {};
+    uint32_t barCount = RunFrame(s, p, detected, width, height, bars, times);
+
+    Image previous;
+    previous.Resize(p.downsampled.Width(), p.downsampled.Height());
+    ReferenceCopyRegion(previous, p.downsampled, 0, 0);
+    for (uint32_t y = 0; y < previous.Height(); y++)
+    {
+        for (uint32_t x = 0; x < previous.Width(); x++)
+        {
+            Pixel& pixel = previous.At(x, y);
+            pixel.r = 1.0f - pixel.r;
+        }
+    }
+
+    Image latest, older, blended;
+    for (Image* image : { &latest, &older, &blended })
+        image->Resize(s.displayWidth, s.displayHeight);
+    ReferenceComposite(latest, p.downsampled, bars, barCount, nullptr, 0, s.displayWidth, s.displayHeight,
+        &p.vignette, p.luma.data());
+    ReferenceComposite(older, previous, bars, barCount, nullptr, 0, s.displayWidth, s.displayHeight,
+        &p.vignette, p.luma.data());
+
+    ReferenceComposite(blended, p.downsampled, bars, barCount, nullptr, 0, s.displayWidth, s.displayHeight,
+        &p.vignette, p.luma.data(), &previous, 1.0f);
+    g_check.Expect(ReferenceMaxDifference(blended, latest) < 1e-6f, "blend 1 is the latest capture");
+    ReferenceComposite(blended, p.downsampled, bars, barCount, nullptr, 0, s.displayWidth, s.displayHeight,
+        &p.vignette, p.luma.data(), &previous, 0.0f);
+    g_check.Expect(ReferenceMaxDifference(blended, older) < 1e-6f, "blend 0 is the previous capture");
+}
+
+int RunInterpolation(const BenchOptions& options)
+{
+    // two periods of the slowest capture rate, the first one blending
+    uint32_t presentFrames = options.quick ? 2 * BENCH_PRESENT_RATE / g_captureRates[0] : BENCH_PRESENT_RATE;
+    double perSecond = (double)BENCH_PRESENT_RATE / presentFrames;
+
+    printf("scenario,capture_fps,present_fps,captures_per_second,capture_ms_per_second,composite_ms_per_second,"
+        "total_ms_per_second,history_bytes,canvas_bytes\n");
+    bool checked = false;
+    for (const Scenario* scenario : SelectScenarios(options))
+    {
+        // the CPU composite is slow, a quick run only takes the smallest display
+        if (options.quick && checked)
+            break;
+        const Scenario& s = *scenario;
+        Pipeline p;
+        if (!PreparePipeline(s, options, p))
+            return 1;
+        if (!checked)
+        {
+            CheckBlend(s, p);
+            checked = true;
+        }
+
+        for (uint32_t captureRate : g_captureRates)
+        {
+            Image previous;
+            InterpolationCost cost = RunPair(s, p, previous, captureRate, presentFrames);
+            uint64_t historyBytes = (uint64_t)previous.Width() * previous.Height() * BENCH_PIXEL_BYTES;
+            uint64_t canvasBytes = (uint64_t)p.canvas.Width() * p.canvas.Height() * BENCH_PIXEL_BYTES;
+            printf("%s,%u,%u,%.0f,%.1f,%.1f,%.1f,%llu,%llu\n", GetScenarioName(s).c_str(), captureRate,
+                BENCH_PRESENT_RATE, cost.captures * perSecond, cost.captureMs * perSecond,
+                cost.compositeMs * perSecond, (cost.captureMs + cost.compositeMs) * perSecond,
+                (unsigned long long)historyBytes, (unsigned long long)canvasBytes);
+
+            g_check.Expect(cost.captures == (presentFrames + BENCH_PRESENT_RATE / captureRate - 1) / (BENCH_PRESENT_RATE / captureRate),
+                "captures at the capture rate");
+            // the only history is one blurred mip
+            if (captureRate < BENCH_PRESENT_RATE)
+                g_check.Expect(historyBytes > 0 && historyBytes * 100 < canvasBytes, "history tiny next to the canvas");
+            else
+                g_check.Expect(historyBytes == 0, "no history without interpolation");
+        }
+    }
+
+    return g_check.Result();
+}
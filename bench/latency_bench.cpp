@@ -0,0 +1,190 @@
+#include "bench.h"
+
+#include "../framepacer.h"
+#include "../latency.h"
+
+#include <algorithm>
+#include <memory>
+
+static BenchCheck g_check("latency");
+
+#define BENCH_MS                     1000000LL
+// GPU and CPU time of each stage of a simulated frame
+#define BENCH_LATENCY_COPY           (BENCH_MS / 2)
+#define BENCH_LATENCY_BLUR           (1 * BENCH_MS)
+#define BENCH_LATENCY_COMPOSITE      (BENCH_MS / 2)
+#define BENCH_LATENCY_PRESENT        (BENCH_MS / 5)
+// every this many frames the window is occluded and nothing is presented
+#define BENCH_LATENCY_DROP_EVERY     50
+
+static void CheckTracker()
+{
+    g_check.Expect(std::string(LatencyStageName(LatencyCopy)) == "copy" &&
+        std::string(LatencyStageName(LatencyCommit)) == "commit" &&
+        std::string(LatencyStageName(LatencyStageCount)) == "unknown", "stage names");
+
+    auto tracker = std::make_unique<LatencyTracker>();
+    // stamps outside a frame are ignored
+    tracker->Stamp(LatencyCopy, 5 * BENCH_MS);
+    tracker->EndFrame(true);
+    g_check.Expect(!tracker->InFrame() && tracker->GetFrames() == 0 && tracker->GetDropped() == 0, "no frame, nothing recorded");
+
+    // a frame records the age of its source at every stage it went through
+    tracker->BeginFrame(10 * BENCH_MS);
+    g_check.Expect(tracker->InFrame(), "in a frame");
+    tracker->Stamp(LatencyComposite, 12 * BENCH_MS);
+    tracker->Stamp(LatencyPresent, 13 * BENCH_MS);
+    tracker->Stamp(LatencyCommit, 18 * BENCH_MS);
+    tracker->EndFrame(true);
+    tracker->Rotate();
+    g_check.Expect(tracker->GetFrames() == 1, "frame counted");
+    g_check.Expect(tracker->GetStats(LatencyCopy).count == 0 && tracker->GetStats(LatencyBlur).count == 0,
+        "stages not gone through are left out");
+    LatencyStats composite = tracker->GetStats(LatencyComposite);
+    LatencyStats commit = tracker->GetStats(LatencyCommit);
+    g_check.Expect(composite.count == 1 && composite.min == 2 * BENCH_MS && composite.max == 2 * BENCH_MS, "composite age");
+    g_check.Expect(commit.count == 1 && commit.mean == 8 * BENCH_MS && commit.p99 == 8 * BENCH_MS, "commit age");
+
+    // a stamp older than the source is a clock mismatch
+    tracker->BeginFrame(20 * BENCH_MS);
+    tracker->Stamp(LatencyComposite, 19 * BENCH_MS);
+    tracker->Stamp(LatencyPresent, 21 * BENCH_MS);
+    tracker->EndFrame(true);
+    tracker->Rotate();
+    g_check.Expect(tracker->GetStats(LatencyComposite).count == 0 && tracker->GetStats(LatencyPresent).count == 1,
+        "stamp before the source left out");
+
+    // a frame that never reaches the screen is dropped, also when the next one begins
+    tracker->BeginFrame(30 * BENCH_MS);
+    tracker->Stamp(LatencyComposite, 31 * BENCH_MS);
+    tracker->EndFrame(false);
+    tracker->BeginFrame(40 * BENCH_MS);
+    tracker->Stamp(LatencyComposite, 41 * BENCH_MS);
+    tracker->BeginFrame(50 * BENCH_MS);
+    tracker->EndFrame(false);
+    tracker->Rotate();
+    g_check.Expect(tracker->GetDropped() == 3 && tracker->GetFrames() == 2, "dropped frames");
+    g_check.Expect(tracker->GetStats(LatencyComposite).count == 0, "dropped frames not recorded");
+}
+
+struct LatencyCase
+{
+    // rate the source presents new images at, and the effect and display rates
+    uint32_t sourceRate;
+    uint32_t frameRate;
+    uint32_t refreshRate;
+};
+
+static const LatencyCase g_latencyCases[] =
+{
+    { 60, 60, 60 },
+    { 60, 120, 120 },
+    { 120, 120, 120 },
+    { 144, 60, 144 },
+};
+
+struct SimulatedLatency
+{
+    uint64_t frames;
+    uint64_t presented;
+    uint64_t captures;
+    LatencyStats stats[LatencyStageCount];
+};
+
+// The app's frame loop on a mock clock against a source presenting at its own rate:
+// a new source image is copied and blurred, every frame is composited and presented,
+// and commits on the next vblank of the display.
+static SimulatedLatency Simulate(const LatencyCase& c, uint32_t frames)
+{
+    MockFrameClock clock;
+    // stamps of 0 mean not stamped, start the clock later
+    clock.Advance(1000 * BENCH_MS);
+    FramePacer pacer(clock);
+    pacer.SetFrameRate(c.frameRate);
+    auto tracker = std::make_unique<LatencyTracker>();
+
+    const int64_t sourcePeriod = 1000000000LL / c.sourceRate;
+    const int64_t refreshPeriod = 1000000000LL / c.refreshRate;
+    SimulatedLatency result = {};
+    int64_t captured = 0;
+    for (uint32_t frame = 0; frame < frames; frame++)
+    {
+        pacer.Wait();
+        result.frames++;
+
+        // the latest image the source presented is captured once, until the next one
+        // the frames show the same capture, aged
+        int64_t latest = clock.Now() / sourcePeriod * sourcePeriod;
+        bool capture = latest != captured;
+        captured = latest;
+        tracker->BeginFrame(captured);
+        if (capture)
+        {
+            result.captures++;
+            clock.Advance(BENCH_LATENCY_COPY);
+            tracker->Stamp(LatencyCopy, clock.Now());
+            clock.Advance(BENCH_LATENCY_BLUR);
+            tracker->Stamp(LatencyBlur, clock.Now());
+        }
+
+        clock.Advance(BENCH_LATENCY_COMPOSITE);
+        tracker->Stamp(LatencyComposite, clock.Now());
+        bool presented = (frame + 1) % BENCH_LATENCY_DROP_EVERY != 0;
+        if (presented)
+        {
+            clock.Advance(BENCH_LATENCY_PRESENT);
+            tracker->Stamp(LatencyPresent, clock.Now());
+            tracker->Stamp(LatencyCommit, (clock.Now() / refreshPeriod + 1) * refreshPeriod);
+            result.presented++;
+        }
+        tracker->EndFrame(presented);
+    }
+
+    tracker->Rotate();
+    for (int i = 0; i < LatencyStageCount; i++)
+        result.stats[i] = tracker->GetStats((LatencyStage)i);
+    g_check.Expect(tracker->GetFrames() == result.presented &&
+        tracker->GetDropped() == result.frames - result.presented, "presented and dropped frames");
+    return result;
+}
+
+int RunLatency(const BenchOptions& options)
+{
+    CheckTracker();
+
+    uint32_t seconds = options.quick ? 2 : 10;
+    printf("source_fps,frame_fps,refresh_fps,stage,count,p50_ms,p95_ms,p99_ms,max_ms\n");
+    for (const LatencyCase& c : g_latencyCases)
+    {
+        SimulatedLatency result = Simulate(c, c.frameRate * seconds);
+        for (int i = 0; i < LatencyStageCount; i++)
+        {
+            const LatencyStats& stats = result.stats[i];
+            printf("%u,%u,%u,%s,%llu,%.2f,%.2f,%.2f,%.2f\n", c.sourceRate, c.frameRate, c.refreshRate,
+                LatencyStageName((LatencyStage)i), (unsigned long long)stats.count, stats.p50 / 1e6,
+                stats.p95 / 1e6, stats.p99 / 1e6, stats.max / 1e6);
+        }
+
+        const LatencyStats* s = result.stats;
+        // copy and blur only for a new source image, the rest for every presented frame
+        g_check.Expect(s[LatencyComposite].count == result.presented && s[LatencyPresent].count == result.presented &&
+            s[LatencyCommit].count == result.presented, "every presented frame stamped");
+        g_check.Expect(s[LatencyCopy].count == s[LatencyBlur].count && s[LatencyCopy].count <= result.captures,
+            "copy and blur per capture");
+        g_check.Expect(result.captures <= result.frames && result.captures + 1 >= std::min(c.sourceRate, c.frameRate) * seconds,
+            "a capture per new source image");
+
+        // the source ages through the pipeline, stage by stage
+        g_check.Expect(s[LatencyCopy].min >= (uint64_t)BENCH_LATENCY_COPY, "copy after the source");
+        g_check.Expect(s[LatencyBlur].min >= s[LatencyCopy].min + BENCH_LATENCY_BLUR, "blur after the copy");
+        g_check.Expect(s[LatencyComposite].p50 <= s[LatencyPresent].p50 && s[LatencyPresent].p50 <= s[LatencyCommit].p50,
+            "stages in order");
+        // at most a source period waiting for the next frame, the frame itself and a refresh
+        uint64_t bound = 1000000000ull / c.sourceRate + 1000000000ull / c.frameRate + BENCH_LATENCY_COPY +
+            BENCH_LATENCY_BLUR + BENCH_LATENCY_COMPOSITE + BENCH_LATENCY_PRESENT + 1000000000ull / c.refreshRate;
+        g_check.Expect(s[LatencyCommit].max <= bound, "commit age bounded");
+        g_check.Expect(s[LatencyCommit].min >= (uint64_t)(BENCH_LATENCY_COMPOSITE + BENCH_LATENCY_PRESENT), "commit after present");
+    }
+
+    return g_check.Result();
+}
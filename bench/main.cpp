@@ -0,0 +1,207 @@
+// Headless benchmark of the effect pipeline and checks of the portable modules.
+// Without a mode it runs the portable CPU implementation of every stage the app runs
+// per frame (detect, copy, mips, blur, composite) on synthetic or recorded frames, for
+// the supported display/content combinations, and reports per stage and total time,
+// bytes touched and peak memory as CSV or JSON. Needs no GPU or desktop session.
+//
+// Modes, each in <module>_bench.cpp of the module it checks:
+//   --check DIR      pipeline          stage times against the stored baselines
+//   --reference      reference         direct mip sampling, the fused composite and the vignette map against the old passes
+//   --surfaces       surfaceplan       bar surface sizes, edge cases and memory per scenario
+//   --pacer          framepacer        deadlines on a mock clock, wakeup jitter at 30 to 240 fps
+//   --scheduler      scheduler         message loop wakeups and frames against simulated messages
+//   --adaptive       adaptiverate      frame rate over scripted motion sequences
+//   --interpolation  composite         capture and composite cost at 30/120, 60/120 and 120/120 fps
+//   --histogram      histogram         bucket bounds, percentiles, windows and the cost of a record
+//   --trace          trace             trace dump, cost of an event and of tracing a frame
+//   --latency        latency           source age at every stage against a simulated source and clock
+//   --scrape N       metrics           endpoint scraped next to a simulated render loop
+//   --memory         resourceregistry  resource registry, video memory per scenario
+//   --reconfigure    reconfigure       stages each settings or bar change rebuilds
+//   --bars           bartracker        detection hysteresis, replayed detection sessions
+//   --pool           texturepool       texture pool over aspect ratio changes
+//   --prewarm        prewarm           first switch to each resolution preset
+//   --render-plan    renderplan        composite uploads and dispatches per frame
+//   --allocs         allocs            heap allocations of the reference frame loop
+//   --watch          configstore       config file watcher and reload
+//   --persist        configstore       config file writes during a slider drag
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+
+struct BenchMode
+{
+    const char* name;
+    // what the option takes, empty for nothing
+    const char* value;
+    int (*run)(const BenchOptions& options);
+    const char* help;
+};
+
+// help lines after the first are indented under it
+static const BenchMode g_modes[] =
+{
+    { "reference", "", RunReference, "render the bars from the blurred mip directly and through the old upscale,\n"
+        "fail on a difference over 0.005 away from the mask edges; check the fused\n"
+        "composite against the passes it replaced and the baked vignette map against\n"
+        "its formula" },
+    { "surfaces", "", RunSurfaces, "check the bar surface sizes for odd bars, the downscale limits, no bars\n"
+        "and a full window bar, and list their memory against the window surface" },
+    { "pacer", "", RunPacer, "check the deadline pacer on a mock clock, report the wakeup jitter and\n"
+        "CPU time per frame at 30, 60, 120 and 240 fps" },
+    { "scheduler", "", RunScheduler, "run the message loop against simulated messages: idle sleeps until a\n"
+        "message or the next detection, messages never hold back a frame" },
+    { "adaptive", "", RunAdaptive, "check the motion estimate and the per second thresholds, replay scripted\n"
+        "motion and report the resulting fps" },
+    { "interpolation", "", RunInterpolation, "check the temporal blend and time capture and composite at 30, 60 and\n"
+        "120 captures per 120 frames" },
+    { "histogram", "", RunHistogram, "check the latency histogram buckets, percentiles and windows and time a record" },
+    { "trace", "", RunTrace, "check the trace dump and measure the cost of tracing a frame" },
+    { "latency", "", RunLatency, "check the latency stamps against a simulated source and clock and report\n"
+        "the source age per stage" },
+    { "scrape", " N", RunScrape, "scrape the metrics endpoint N times while a simulated render loop\n"
+        "publishes frames, report the cost of a publish and of a scrape" },
+    { "memory", "", RunMemory, "check the resource registry against a fake allocator and list the video\n"
+        "memory of every scenario, and what --budget MB downgrades" },
+    { "reconfigure", "", RunReconfigure, "check the stages each kind of settings or bar change rebuilds and\n"
+        "time them against a full rebuild" },
+    { "bars", "", RunBars, "check the detection hysteresis and the scene cut latch, replay\n"
+        "detection sessions (--session FILE) and count the reconfigurations avoided" },
+    { "pool", "", RunPool, "check the texture pool against a mock device and time it over aspect\n"
+        "ratio changes (--pool-size MB)" },
+    { "prewarm", "", RunPrewarm, "time the first switch to each resolution preset, cold and with its\n"
+        "textures created in the background" },
+    { "render-plan", "", RunRenderPlan, "check the render plan and the composite constants, and count the\n"
+        "uploads and dispatches the composite draws make over bar changes" },
+    { "allocs", "", RunAllocs, "count the heap allocations of the reference frame loop after warm-up,\n"
+        "fail on any; the D3D calls of the app's frame are not covered" },
+    { "watch", "", RunWatch, "check the config file watcher and the reload diff in a temp directory" },
+    { "persist", "", RunPersist, "count the config file writes and reloads of a simulated slider drag:\n"
+        "debounced, written atomically, skipped when unchanged" },
+};
+
+static const BenchMode* FindMode(const std::string& arg)
+{
+    for (const BenchMode& mode : g_modes)
+    {
+        if (arg == std::string("--") + mode.name)
+            return &mode;
+    }
+    return nullptr;
+}
+
+static void PrintUsage(FILE* out)
+{
+    fprintf(out,
+        "usage: ambientlight_bench [mode] [options]\n"
+        "Without a mode, times detection, copy, mipmaps, blur and composite on the CPU for\n"
+        "16:9 on 21:9, 21:9 on 32:9 and 32:9 on 16:9 up to 7680x2160, and reports the time,\n"
+        "bytes touched and peak memory of every stage.\n"
+        "  --runs N         measured runs per scenario (default 5, 9 with --check)\n"
+        "  --warmup N       runs before measuring (default 1)\n"
+        "  --scenario NAME  only scenarios whose name contains NAME\n"
+        "  --quick          only the smallest display of each combination\n"
+        "  --input FILE     binary PPM frame to use instead of the synthetic one\n"
+        "  --format FORMAT  csv (default) or json\n"
+        "  --output FILE    write the report to FILE instead of stdout\n"
+        "  --check DIR      compare against the baselines in DIR, fail on a regression\n"
+        "  --threshold PCT  allowed regression in percent for --check (default 15)\n"
+        "  --write-baseline DIR  store the results as the baselines in DIR\n"
+        "  --budget MB      video memory budget for --memory (default none)\n"
+        "  --session FILE   detection session for --bars, lines of top bottom left right [cut]\n"
+        "  --pool-size MB   texture pool size for --pool and --prewarm (default 128)\n"
+        "  --help           this text\n"
+        "modes:\n");
+    for (const BenchMode& mode : g_modes)
+    {
+        std::string option = std::string("--") + mode.name + mode.value;
+        std::string help = mode.help;
+        size_t start = 0;
+        for (size_t end = help.find('\n'); ; end = help.find('\n', start))
+        {
+            fprintf(out, "  %-16s %s\n", start == 0 ? option.c_str() : "", help.substr(start, end - start).c_str());
+            if (end == std::string::npos)
+                break;
+            start = end + 1;
+        }
+    }
+}
+
+static bool ParseOptions(int argc, char** argv, BenchOptions& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--runs" && hasValue)
+            options.runs = (uint32_t)std::max(1, atoi(argv[++i]));
+        else if (arg == "--warmup" && hasValue)
+            options.warmup = (uint32_t)std::max(0, atoi(argv[++i]));
+        else if (arg == "--scenario" && hasValue)
+            options.filter = argv[++i];
+        else if (arg == "--quick")
+            options.quick = true;
+        else if (arg == "--help")
+            options.help = true;
+        else if (arg == "--input" && hasValue)
+            options.input = argv[++i];
+        else if (arg == "--format" && hasValue)
+        {
+            std::string format = argv[++i];
+            if (format != "csv" && format != "json")
+                return false;
+            options.json = format == "json";
+        }
+        else if (arg == "--output" && hasValue)
+            options.output = argv[++i];
+        else if (arg == "--check" && hasValue)
+            options.check = argv[++i];
+        else if (arg == "--threshold" && hasValue)
+            options.threshold = std::max(0.0, atof(argv[++i])) / 100.0;
+        else if (arg == "--write-baseline" && hasValue)
+            options.writeBaseline = argv[++i];
+        else if (arg == "--scrape" && hasValue)
+        {
+            options.mode = "scrape";
+            options.scrapes = (uint32_t)std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--budget" && hasValue)
+            options.budget = (uint32_t)std::max(0, atoi(argv[++i]));
+        else if (arg == "--session" && hasValue)
+            options.session = argv[++i];
+        else if (arg == "--pool-size" && hasValue)
+            options.poolSize = (uint32_t)std::max(0, atoi(argv[++i]));
+        else if (const BenchMode* mode = FindMode(arg))
+        {
+            // modes that take a value are parsed above
+            if (mode->value[0] != '\0')
+                return false;
+            options.mode = mode->name;
+        }
+        else
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage(stderr);
+        return 2;
+    }
+    if (options.help)
+    {
+        PrintUsage(stdout);
+        return 0;
+    }
+    if (const BenchMode* mode = FindMode("--" + options.mode))
+        return mode->run(options);
+    return RunPipeline(options);
+}
@@ -0,0 +1,207 @@
+#include "bench.h"
+
+#include "../benchstats.h"
+#include "../metrics.h"
+#include "../perfstats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// one GET /metrics over a new connection, the whole response ends up in response
+static bool ScrapeMetrics(uint16_t port, std::string& response)
+{
+#ifdef _WIN32
+    SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCKET)
+        return false;
+#else
+    int s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s < 0)
+        return false;
+#endif
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    bool ok = false;
+    response.clear();
+    const char request[] = "GET /metrics HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    if (connect(s, (sockaddr*)&address, sizeof(address)) == 0 &&
+        send(s, request, (int)sizeof(request) - 1, 0) == (int)sizeof(request) - 1)
+    {
+        char buffer[4096];
+        int n;
+        while ((n = recv(s, buffer, (int)sizeof(buffer), 0)) > 0)
+            response.append(buffer, n);
+        ok = n == 0;
+    }
+
+#ifdef _WIN32
+    closesocket(s);
+#else
+    close(s);
+#endif
+    return ok;
+}
+
+// the stages are a summary: quantiles of the last window, sum and count since start
+static bool CheckStageSummary()
+{
+    PerfSnapshot snapshot = {};
+    snapshot.stageMs[PerfStageBlur] = 9.0;
+    snapshot.stageP50Ms[PerfStageBlur] = 1.0;
+    snapshot.stageP95Ms[PerfStageBlur] = 2.0;
+    snapshot.stageP99Ms[PerfStageBlur] = 4.0;
+    snapshot.stageSumMs[PerfStageBlur] = 1500.0;
+    snapshot.stageCount[PerfStageBlur] = 1200;
+
+    std::string out;
+    FormatMetrics(out, snapshot, 0, 0.0, 0.0);
+    const char* expected[] =
+    {
+        "# TYPE ambientlight_stage_seconds summary\n",
+        "ambientlight_stage_seconds{stage=\"blur\",quantile=\"0.5\"} 0.001\n",
+        "ambientlight_stage_seconds{stage=\"blur\",quantile=\"0.95\"} 0.002\n",
+        "ambientlight_stage_seconds{stage=\"blur\",quantile=\"0.99\"} 0.004\n",
+        "ambientlight_stage_seconds_sum{stage=\"blur\"} 1.5\n",
+        "ambientlight_stage_seconds_count{stage=\"blur\"} 1200\n",
+    };
+    for (const char* line : expected)
+    {
+        if (out.find(line) == std::string::npos)
+        {
+            fprintf(stderr, "stage summary is missing %s%s\n", line, out.c_str());
+            return false;
+        }
+    }
+    // the last frame alone is not exported
+    if (out.find(" 0.009\n") != std::string::npos)
+    {
+        fprintf(stderr, "stage summary exports the last frame\n%s\n", out.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Simulated render loop publishing a snapshot per frame while a local client scrapes
+// the endpoint. Reports what a publish costs the render thread and how long a scrape
+// takes, fails when a scrape is refused or does not carry the expected metrics.
+int RunScrape(const BenchOptions& options)
+{
+    if (!CheckStageSummary())
+        return 1;
+
+#ifdef _WIN32
+    WSADATA data;
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+        return 1;
+#endif
+
+    PerfSnapshotBuffer buffer;
+    MetricsServer server;
+    if (!server.Start(0, buffer))
+    {
+        fprintf(stderr, "metrics endpoint could not listen\n");
+        return 1;
+    }
+
+    std::atomic<bool> stop(false);
+    std::vector<double> publishNs;
+    publishNs.reserve(1 << 16);
+    std::thread render([&]()
+    {
+        PerfSnapshot snapshot = {};
+        snapshot.targetFps = 240;
+        while (!stop.load())
+        {
+            snapshot.frame++;
+            for (int i = 0; i < PerfStageCount; i++)
+                snapshot.stageMs[i] = 0.1 * (i + 1) + (snapshot.frame % 7) * 0.01;
+            // a statistics window a second
+            if (snapshot.frame % 240 == 0)
+            {
+                for (int i = 0; i < PerfStageCount; i++)
+                {
+                    snapshot.stageP50Ms[i] = 0.1 * (i + 1);
+                    snapshot.stageP95Ms[i] = 0.1 * (i + 1) + 0.05;
+                    snapshot.stageP99Ms[i] = 0.1 * (i + 1) + 0.06;
+                    snapshot.stageCount[i] += 240;
+                    snapshot.stageSumMs[i] += 240 * 0.1 * (i + 1);
+                }
+            }
+            snapshot.achievedFps = 239.5;
+            snapshot.capturesProcessed = snapshot.frame / 2;
+            snapshot.capturesSkipped = snapshot.frame - snapshot.capturesProcessed;
+
+            auto start = std::chrono::steady_clock::now();
+            buffer.Publish(snapshot);
+            auto end = std::chrono::steady_clock::now();
+            if (publishNs.size() < publishNs.capacity())
+                publishNs.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+            std::this_thread::sleep_for(std::chrono::microseconds(4167));
+        }
+    });
+
+    std::vector<double> scrapeMs;
+    std::string response;
+    bool passed = true;
+    for (uint32_t i = 0; i < options.scrapes && passed; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool ok = ScrapeMetrics(server.GetPort(), response);
+        auto end = std::chrono::steady_clock::now();
+        scrapeMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+
+        if (!ok || response.compare(0, 15, "HTTP/1.1 200 OK") != 0 ||
+            response.find("\nambientlight_frames_total ") == std::string::npos ||
+            response.find("ambientlight_stage_seconds{stage=\"blur\",quantile=\"0.99\"}") == std::string::npos ||
+            response.find("ambientlight_stage_seconds_count{stage=\"blur\"}") == std::string::npos)
+        {
+            fprintf(stderr, "scrape %u failed:\n%s\n", i, response.c_str());
+            passed = false;
+        }
+        // let the render loop publish between scrapes
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    stop.store(true);
+    render.join();
+    uint64_t served = server.GetScrapes();
+    server.Stop();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+
+    SampleStats publish = GetSampleStats(publishNs);
+    SampleStats scrape = GetSampleStats(scrapeMs);
+    std::sort(scrapeMs.begin(), scrapeMs.end());
+    double p99 = scrapeMs.empty() ? 0.0 : scrapeMs[std::min(scrapeMs.size() - 1, scrapeMs.size() * 99 / 100)];
+    fprintf(stderr, "publish: median %.0f ns, max %.0f ns over %zu frames\n", publish.median, publish.max, publishNs.size());
+    fprintf(stderr, "scrape: median %.3f ms, p99 %.3f ms, max %.3f ms, %llu served, %zu bytes\n",
+        scrape.median, p99, scrape.max, (unsigned long long)served, response.size());
+
+    if (passed && served != options.scrapes)
+    {
+        fprintf(stderr, "server counted %llu scrapes, expected %u\n", (unsigned long long)served, options.scrapes);
+        passed = false;
+    }
+    return passed ? 0 : 1;
+}
+
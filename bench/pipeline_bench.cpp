@@ -0,0 +1,638 @@
+#include "bench.h"
+
+#include "../benchstats.h"
+#include "../inipp.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+const Scenario g_scenarios[BENCH_SCENARIO_COUNT] =
+{
+    { "16x9_on_21x9", 2560, 1080, 16, 9 },
+    { "16x9_on_21x9", 3440, 1440, 16, 9 },
+    { "16x9_on_21x9", 5120, 2160, 16, 9 },
+    { "21x9_on_32x9", 3840, 1080, 21, 9 },
+    { "21x9_on_32x9", 5120, 1440, 21, 9 },
+    { "21x9_on_32x9", 7680, 2160, 21, 9 },
+    { "32x9_on_16x9", 1920, 1080, 32, 9 },
+    { "32x9_on_16x9", 2560, 1440, 32, 9 },
+    { "32x9_on_16x9", 3840, 2160, 32, 9 },
+};
+
+static const char* g_stageNames[StageCount] = { "detect", "copy", "mips", "blur", "composite", "total" };
+
+struct StageResult
+{
+    std::vector<double> samples;
+    uint64_t bytes = 0;
+};
+
+struct ScenarioResult
+{
+    std::string name;
+    const Scenario* scenario = nullptr;
+    uint32_t gameWidth = 0;
+    uint32_t gameHeight = 0;
+    bool detected = false;
+    StageResult stages[StageCount];
+    uint64_t peakBytes = 0;
+    uint64_t processPeakBytes = 0;
+    // fixed workload timed alongside the scenario, relates times across machines
+    double calibration = 0.0;
+};
+
+static uint64_t GetProcessPeakBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters = {};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage = {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    // kilobytes on Linux
+    return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+static uint64_t ImageBytes(const Image& image)
+{
+    return (uint64_t)image.Width() * image.Height() * BENCH_PIXEL_BYTES;
+}
+
+void GetGameBox(const Scenario& s, uint32_t& left, uint32_t& top, uint32_t& width, uint32_t& height)
+{
+    float aspect = (float)s.aspectX / (float)s.aspectY;
+    height = s.displayHeight;
+    width = (uint32_t)std::round(height * aspect);
+    if (width > s.displayWidth)
+    {
+        width = s.displayWidth;
+        height = (uint32_t)std::round(width / aspect);
+    }
+    left = (s.displayWidth - width) / 2;
+    top = (s.displayHeight - height) / 2;
+}
+
+uint32_t Hash(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+}
+
+// Deterministic game frame: smooth gradients with some noise, never black, so
+// detection finds exactly the bars around it.
+static void FillSynthetic(Image& frame, uint32_t left, uint32_t top, uint32_t width, uint32_t height)
+{
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            float u = (float)x / width;
+            float v = (float)y / height;
+            float noise = (Hash(y * 7919 + x) & 0xff) / 255.0f;
+            Pixel& p = frame.At(left + x, top + y);
+            p.r = 0.25f + 0.5f * (0.5f + 0.5f * std::sin(u * 12.0f + v * 3.0f));
+            p.g = 0.25f + 0.5f * v;
+            p.b = 0.25f + 0.25f * u + 0.25f * noise;
+            p.a = 1.0f;
+        }
+    }
+}
+
+// Recorded frame from a binary PPM (P6, 8 bit), scaled into the game area.
+static bool FillRecorded(Image& frame, const std::string& path, uint32_t left, uint32_t top, uint32_t width, uint32_t height)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    char magic[3] = {};
+    uint32_t imageWidth = 0, imageHeight = 0, maxValue = 0;
+    bool ok = fscanf(file, "%2s %u %u %u", magic, &imageWidth, &imageHeight, &maxValue) == 4 &&
+        strcmp(magic, "P6") == 0 && maxValue == 255 && imageWidth > 0 && imageHeight > 0;
+    std::vector<uint8_t> data;
+    if (ok)
+    {
+        fgetc(file);
+        data.resize((size_t)imageWidth * imageHeight * 3);
+        ok = fread(data.data(), 1, data.size(), file) == data.size();
+    }
+    fclose(file);
+    if (!ok)
+        return false;
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint32_t sy = (uint32_t)((uint64_t)y * imageHeight / height);
+        for (uint32_t x = 0; x < width; x++)
+        {
+            uint32_t sx = (uint32_t)((uint64_t)x * imageWidth / width);
+            const uint8_t* rgb = &data[((size_t)sy * imageWidth + sx) * 3];
+            frame.At(left + x, top + y) = { rgb[0] / 255.0f, rgb[1] / 255.0f, rgb[2] / 255.0f, 1.0f };
+        }
+    }
+    return true;
+}
+
+uint64_t Pipeline::Bytes() const
+{
+    uint64_t bytes = ImageBytes(frame) + ImageBytes(game) + ImageBytes(downsampled) +
+        ImageBytes(blurTemp) + ImageBytes(canvas) + luma.size() * sizeof(float) +
+        (uint64_t)vignette.Width() * vignette.Height() * sizeof(float);
+    for (const Image& mip : mips)
+        bytes += ImageBytes(mip);
+    return bytes;
+}
+
+uint32_t BuildBars(const Scenario& s, const DetectedBars& detected, uint32_t gameWidth, uint32_t gameHeight,
+    const Image& downsampled, CompositeBar* bars)
+{
+    bool pillarbox = detected.left > 0 || detected.right > 0;
+    uint32_t mipWidth = downsampled.Width();
+    uint32_t mipHeight = downsampled.Height();
+    float regionX = 0.0f;
+    float regionY = 0.0f;
+    float regionWidth = (float)mipWidth;
+    float regionHeight = (float)mipHeight;
+    if (mipWidth > BENCH_ZOOM * 2 && mipHeight > BENCH_ZOOM * 2)
+    {
+        regionX = (float)BENCH_ZOOM;
+        regionY = (float)BENCH_ZOOM;
+        regionWidth = (float)(mipWidth - BENCH_ZOOM * 2);
+        regionHeight = (float)(mipHeight - BENCH_ZOOM * 2);
+    }
+    float gameToMipX = regionWidth / (float)gameWidth;
+    float gameToMipY = regionHeight / (float)gameHeight;
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        // target in window coordinates, source is the game edge next to the bar
+        uint32_t dstX, dstY, dstWidth, dstHeight;
+        float srcX, srcY, srcWidth, srcHeight;
+        if (pillarbox)
+        {
+            dstWidth = i == 0 ? detected.left : detected.right;
+            dstHeight = s.displayHeight;
+            dstX = i == 0 ? 0 : s.displayWidth - dstWidth;
+            dstY = 0;
+            srcWidth = (float)(uint32_t)(dstWidth / BENCH_STRETCH_FACTOR);
+            srcHeight = (float)gameHeight;
+            srcX = i == 0 ? 0.0f : gameWidth - srcWidth;
+            srcY = 0.0f;
+        }
+        else
+        {
+            dstWidth = s.displayWidth;
+            dstHeight = i == 0 ? detected.top : detected.bottom;
+            dstX = 0;
+            dstY = i == 0 ? 0 : s.displayHeight - dstHeight;
+            srcWidth = (float)gameWidth;
+            srcHeight = (float)(uint32_t)(dstHeight / BENCH_STRETCH_FACTOR);
+            srcX = 0.0f;
+            srcY = i == 0 ? 0.0f : gameHeight - srcHeight;
+        }
+
+        CompositeBar& bar = bars[i];
+        bar.targetX = dstX;
+        bar.targetY = dstY;
+        bar.targetWidth = dstWidth;
+        bar.targetHeight = dstHeight;
+        bar.sourceX = regionX + srcX * gameToMipX;
+        bar.sourceY = regionY + srcY * gameToMipY;
+        bar.sourceWidth = srcWidth * gameToMipX;
+        bar.sourceHeight = srcHeight * gameToMipY;
+        bar.windowX = (float)dstX;
+        bar.windowY = (float)dstY;
+        bar.windowWidth = (float)dstWidth;
+        bar.windowHeight = (float)dstHeight;
+        bar.flip = BENCH_MIRRORED ? (pillarbox ? FlipHorizontal : FlipVertical) : FlipNone;
+    }
+    return 2;
+}
+
+std::string GetScenarioName(const Scenario& s)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "%s_%ux%u", s.combo, s.displayWidth, s.displayHeight);
+    return name;
+}
+
+std::vector<const Scenario*> SelectScenarios(const BenchOptions& options)
+{
+    std::vector<const Scenario*> selected;
+    const char* lastCombo = "";
+    for (const Scenario& s : g_scenarios)
+    {
+        if (options.quick && strcmp(s.combo, lastCombo) == 0)
+            continue;
+        lastCombo = s.combo;
+        if (!options.filter.empty() && GetScenarioName(s).find(options.filter) == std::string::npos)
+            continue;
+        selected.push_back(&s);
+    }
+    return selected;
+}
+
+// Fixed downsample and blur, the same kind of work as the pipeline. It runs after
+// every measured run so it sees the same machine load, and baseline times are scaled
+// by the ratio of the median calibrations before comparing.
+struct Calibration
+{
+    Image source;
+    Image half;
+    Image temp;
+    BlurKernel kernel;
+
+    Calibration()
+    {
+        source.Resize(512, 256);
+        FillSynthetic(source, 0, 0, source.Width(), source.Height());
+        kernel = ReferenceBlurKernel(BENCH_BLUR_SAMPLES);
+    }
+
+    double Run()
+    {
+        BenchClock::time_point start = BenchClock::now();
+        ReferenceDownsample(half, source);
+        ReferenceBlur(half, temp, kernel, 1);
+        return ElapsedMs(start);
+    }
+};
+
+bool PreparePipeline(const Scenario& s, const BenchOptions& options, Pipeline& p)
+{
+    uint32_t gameLeft, gameTop, gameWidth, gameHeight;
+    GetGameBox(s, gameLeft, gameTop, gameWidth, gameHeight);
+
+    p.frame.Resize(s.displayWidth, s.displayHeight);
+    if (!options.input.empty())
+    {
+        if (!FillRecorded(p.frame, options.input, gameLeft, gameTop, gameWidth, gameHeight))
+        {
+            fprintf(stderr, "failed to read %s, expected a binary 8 bit PPM\n", options.input.c_str());
+            return false;
+        }
+    }
+    else
+    {
+        FillSynthetic(p.frame, gameLeft, gameTop, gameWidth, gameHeight);
+    }
+
+    p.luma.resize((size_t)s.displayWidth * s.displayHeight);
+    p.mips.resize(BENCH_MIPMAP_LEVELS);
+    p.canvas.Resize(s.displayWidth, s.displayHeight);
+    p.kernel = ReferenceBlurKernel(BENCH_BLUR_SAMPLES);
+    VignetteSettings vignette = { BENCH_VIGNETTE_INTENSITY, BENCH_VIGNETTE_RADIUS, BENCH_VIGNETTE_SMOOTHNESS,
+        (float)s.displayWidth / s.displayHeight };
+    p.vignette.Bake(vignette);
+    return true;
+}
+
+uint32_t RunFrame(const Scenario& s, Pipeline& p, DetectedBars& detected, uint32_t& width, uint32_t& height,
+    CompositeBar* bars, double* times)
+{
+    BenchClock::time_point start = BenchClock::now();
+    ReferenceLuma(p.frame, p.luma.data());
+    detected = ReferenceDetectBars(p.luma.data(), s.displayWidth, s.displayHeight,
+        BENCH_BRIGHTNESS_THRESHOLD * BENCH_LUMA_THRESHOLD, BENCH_BLACK_RATIO, BENCH_BLACK_VARIANCE);
+    times[StageDetect] = ElapsedMs(start);
+
+    // keep either only letterbox or pillarbox, as Detection::Detect does
+    width = s.displayWidth - detected.left - detected.right;
+    height = s.displayHeight - detected.top - detected.bottom;
+    if ((float)width / height <= (float)s.displayWidth / s.displayHeight)
+    {
+        detected.top = detected.bottom = 0;
+        height = s.displayHeight;
+    }
+    else
+    {
+        detected.left = detected.right = 0;
+        width = s.displayWidth;
+    }
+    if (width == s.displayWidth && height == s.displayHeight)
+        return 0;
+
+    start = BenchClock::now();
+    if (p.game.Width() != width || p.game.Height() != height)
+        p.game.Resize(width, height);
+    ReferenceCopyRegion(p.game, p.frame, detected.left, detected.top);
+    times[StageCopy] = ElapsedMs(start);
+
+    // mip chain down to the level the blur runs on, then the copy out of it
+    start = BenchClock::now();
+    const Image* level = &p.game;
+    for (uint32_t i = 0; i < BENCH_MIPMAP_LEVELS; i++)
+    {
+        ReferenceDownsample(p.mips[i], *level);
+        level = &p.mips[i];
+    }
+    if (p.downsampled.Width() != level->Width() || p.downsampled.Height() != level->Height())
+        p.downsampled.Resize(level->Width(), level->Height());
+    ReferenceCopyRegion(p.downsampled, *level, 0, 0);
+    times[StageMips] = ElapsedMs(start);
+
+    start = BenchClock::now();
+    ReferenceBlur(p.downsampled, p.blurTemp, p.kernel, BENCH_BLUR_PASSES);
+    times[StageBlur] = ElapsedMs(start);
+
+    // copy, mirror, stretch, vignette and light peek mask in one pass, as on the GPU
+    start = BenchClock::now();
+    uint32_t barCount = BuildBars(s, detected, width, height, p.downsampled, bars);
+    ReferenceComposite(p.canvas, p.downsampled, bars, barCount, nullptr, 0,
+        s.displayWidth, s.displayHeight, &p.vignette, p.luma.data());
+    times[StageComposite] = ElapsedMs(start);
+    return barCount;
+}
+
+static bool RunScenario(const Scenario& s, const BenchOptions& options, ScenarioResult& result)
+{
+    result.name = GetScenarioName(s);
+    result.scenario = &s;
+    const char* name = result.name.c_str();
+
+    uint32_t gameLeft, gameTop, gameWidth, gameHeight;
+    GetGameBox(s, gameLeft, gameTop, gameWidth, gameHeight);
+
+    Pipeline p;
+    if (!PreparePipeline(s, options, p))
+        return false;
+
+    Calibration calibration;
+    std::vector<double> calibrationSamples;
+
+    for (uint32_t run = 0; run < options.warmup + options.runs; run++)
+    {
+        bool record = run >= options.warmup;
+        double times[StageCount] = {};
+
+        DetectedBars detected;
+        uint32_t width, height;
+        CompositeBar bars[2] = {};
+        uint32_t barCount = RunFrame(s, p, detected, width, height, bars, times);
+        if (barCount == 0)
+        {
+            fprintf(stderr, "%s: no bars detected\n", name);
+            return false;
+        }
+        result.detected = detected.left == gameLeft && detected.top == gameTop &&
+            width == gameWidth && height == gameHeight;
+        result.gameWidth = width;
+        result.gameHeight = height;
+
+        if (!record)
+            continue;
+        calibrationSamples.push_back(calibration.Run());
+
+        for (int i = 0; i < StageTotal; i++)
+        {
+            result.stages[i].samples.push_back(times[i]);
+            times[StageTotal] += times[i];
+        }
+        result.stages[StageTotal].samples.push_back(times[StageTotal]);
+
+        // bytes read plus written by each stage
+        uint64_t framePixels = (uint64_t)s.displayWidth * s.displayHeight;
+        uint64_t gamePixels = (uint64_t)width * height;
+        uint64_t mipPixels = (uint64_t)p.downsampled.Width() * p.downsampled.Height();
+        uint64_t barPixels = 0;
+        for (uint32_t i = 0; i < barCount; i++)
+            barPixels += (uint64_t)bars[i].targetWidth * bars[i].targetHeight;
+
+        // luma pass, then the row and column scans over the luma
+        result.stages[StageDetect].bytes = framePixels * (BENCH_PIXEL_BYTES + sizeof(float) * 3);
+        result.stages[StageCopy].bytes = gamePixels * BENCH_PIXEL_BYTES * 2;
+        uint64_t mipBytes = mipPixels * BENCH_PIXEL_BYTES * 2;
+        const Image* level = &p.game;
+        for (const Image& mip : p.mips)
+        {
+            mipBytes += ImageBytes(*level) + ImageBytes(mip);
+            level = &mip;
+        }
+        result.stages[StageMips].bytes = mipBytes;
+        result.stages[StageBlur].bytes = mipPixels * BENCH_PIXEL_BYTES * 4 * BENCH_BLUR_PASSES;
+        result.stages[StageComposite].bytes = barPixels * (BENCH_PIXEL_BYTES + sizeof(float)) +
+            mipPixels * BENCH_PIXEL_BYTES + (uint64_t)p.vignette.Width() * p.vignette.Height() * sizeof(float);
+        uint64_t total = 0;
+        for (int i = 0; i < StageTotal; i++)
+            total += result.stages[i].bytes;
+        result.stages[StageTotal].bytes = total;
+    }
+
+    result.peakBytes = p.Bytes();
+    result.processPeakBytes = GetProcessPeakBytes();
+    result.calibration = GetSampleStats(calibrationSamples).median;
+    return true;
+}
+
+static std::string GetBaselinePath(const std::string& directory, const std::string& name)
+{
+    return directory + "/" + name + ".ini";
+}
+
+static bool WriteBaseline(const std::string& directory, const ScenarioResult& r)
+{
+    std::ofstream os(GetBaselinePath(directory, r.name));
+    if (!os)
+        return false;
+
+    char value[64];
+    os << "; ambientlight_bench baseline, regenerate with --write-baseline\n";
+    os << "[scenario]\n";
+    snprintf(value, sizeof(value), "%.4f", r.calibration);
+    os << "calibration_ms = " << value << "\n";
+    os << "peak_bytes = " << r.peakBytes << "\n";
+    for (int i = 0; i < StageCount; i++)
+    {
+        SampleStats stats = GetSampleStats(r.stages[i].samples);
+        os << "\n[" << g_stageNames[i] << "]\n";
+        snprintf(value, sizeof(value), "%.4f", stats.median);
+        os << "median_ms = " << value << "\n";
+        snprintf(value, sizeof(value), "%.4f", stats.ciLow);
+        os << "ci_low_ms = " << value << "\n";
+        snprintf(value, sizeof(value), "%.4f", stats.ciHigh);
+        os << "ci_high_ms = " << value << "\n";
+        os << "bytes = " << r.stages[i].bytes << "\n";
+    }
+    return os.good();
+}
+
+// Compare a scenario against its baseline and print the per stage diff.
+// Returns false when a stage, the detection or the memory footprint regressed.
+static bool CheckBaseline(const std::string& directory, const ScenarioResult& r, double threshold)
+{
+    std::ifstream is(GetBaselinePath(directory, r.name));
+    if (!is)
+    {
+        fprintf(stderr, "%s: no baseline, skipped\n", r.name.c_str());
+        return true;
+    }
+
+    inipp::Ini<char> ini;
+    ini.parse(is);
+    ini.strip_trailing_comments();
+
+    double calibration = 0.0;
+    uint64_t peakBytes = 0;
+    inipp::get_value(ini.sections["scenario"], "calibration_ms", calibration);
+    inipp::get_value(ini.sections["scenario"], "peak_bytes", peakBytes);
+    double scale = calibration > 0.0 ? r.calibration / calibration : 1.0;
+
+    RegressionLimits limits = { threshold, BENCH_CHECK_MIN_DELTA };
+    bool passed = true;
+
+    fprintf(stderr, "%s: machine speed x%.2f of the baseline\n", r.name.c_str(), scale);
+    fprintf(stderr, "  %-10s %12s %12s %21s %8s\n", "stage", "baseline ms", "median ms", "95% interval", "change");
+    for (int i = 0; i < StageCount; i++)
+    {
+        auto& section = ini.sections[g_stageNames[i]];
+        StageBaseline baseline = {};
+        inipp::get_value(section, "median_ms", baseline.median);
+        inipp::get_value(section, "ci_low_ms", baseline.ciLow);
+        inipp::get_value(section, "ci_high_ms", baseline.ciHigh);
+        inipp::get_value(section, "bytes", baseline.bytes);
+
+        SampleStats stats = GetSampleStats(r.stages[i].samples);
+        StageVerdict verdict = CompareStage(stats, r.stages[i].bytes, baseline, scale, limits);
+        double expected = baseline.median * scale;
+        double change = expected > 0.0 ? (stats.median / expected - 1.0) * 100.0 : 0.0;
+        fprintf(stderr, "  %-10s %12.3f %12.3f %10.3f..%-9.3f %+7.1f%%  %s\n", g_stageNames[i],
+            expected, stats.median, stats.ciLow, stats.ciHigh, change, StageVerdictName(verdict));
+        if (verdict == StageLarger)
+        {
+            fprintf(stderr, "  %-10s bytes %llu, baseline %llu\n", "", (unsigned long long)r.stages[i].bytes,
+                (unsigned long long)baseline.bytes);
+        }
+
+        if (verdict == StageSlower || verdict == StageLarger)
+            passed = false;
+    }
+
+    if (!r.detected)
+    {
+        fprintf(stderr, "  detection did not find the game area\n");
+        passed = false;
+    }
+    if (peakBytes > 0 && (double)r.peakBytes > peakBytes * (1.0 + threshold))
+    {
+        fprintf(stderr, "  peak memory %llu bytes, baseline %llu\n", (unsigned long long)r.peakBytes,
+            (unsigned long long)peakBytes);
+        passed = false;
+    }
+    return passed;
+}
+
+static void WriteCsv(FILE* out, const std::vector<ScenarioResult>& results)
+{
+    fprintf(out, "scenario,display,game,detected,stage,runs,median_ms,mean_ms,min_ms,max_ms,bytes,peak_bytes,process_peak_bytes\n");
+    for (const ScenarioResult& r : results)
+    {
+        for (int i = 0; i < StageCount; i++)
+        {
+            SampleStats stats = GetSampleStats(r.stages[i].samples);
+            fprintf(out, "%s,%ux%u,%ux%u,%d,%s,%zu,%.4f,%.4f,%.4f,%.4f,%llu,%llu,%llu\n",
+                r.name.c_str(), r.scenario->displayWidth, r.scenario->displayHeight, r.gameWidth, r.gameHeight,
+                r.detected ? 1 : 0, g_stageNames[i], r.stages[i].samples.size(),
+                stats.median, stats.mean, stats.min, stats.max,
+                (unsigned long long)r.stages[i].bytes, (unsigned long long)r.peakBytes,
+                (unsigned long long)r.processPeakBytes);
+        }
+    }
+}
+
+static void WriteJson(FILE* out, const std::vector<ScenarioResult>& results)
+{
+    fprintf(out, "{\"scenarios\":[\n");
+    for (size_t s = 0; s < results.size(); s++)
+    {
+        const ScenarioResult& r = results[s];
+        fprintf(out, "{\"name\":\"%s\",\"display\":[%u,%u],\"game\":[%u,%u],\"detected\":%s,"
+            "\"peakBytes\":%llu,\"processPeakBytes\":%llu,\"stages\":[\n",
+            r.name.c_str(), r.scenario->displayWidth, r.scenario->displayHeight, r.gameWidth, r.gameHeight,
+            r.detected ? "true" : "false", (unsigned long long)r.peakBytes, (unsigned long long)r.processPeakBytes);
+        for (int i = 0; i < StageCount; i++)
+        {
+            SampleStats stats = GetSampleStats(r.stages[i].samples);
+            fprintf(out, "  {\"name\":\"%s\",\"runs\":%zu,\"medianMs\":%.4f,\"meanMs\":%.4f,\"minMs\":%.4f,\"maxMs\":%.4f,\"bytes\":%llu}%s\n",
+                g_stageNames[i], r.stages[i].samples.size(), stats.median, stats.mean, stats.min, stats.max,
+                (unsigned long long)r.stages[i].bytes, i + 1 < StageCount ? "," : "");
+        }
+        fprintf(out, "]}%s\n", s + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "]}\n");
+}
+
+int RunPipeline(const BenchOptions& options)
+{
+    BenchOptions measured = options;
+    if (measured.runs == 0)
+        measured.runs = (options.check.empty() && options.writeBaseline.empty()) ? 5 : BENCH_CHECK_RUNS;
+
+    std::vector<ScenarioResult> results;
+    for (const Scenario* s : SelectScenarios(options))
+    {
+        ScenarioResult result;
+        if (!RunScenario(*s, measured, result))
+            return 1;
+
+        fprintf(stderr, "%s: %.2f ms\n", result.name.c_str(), GetSampleStats(result.stages[StageTotal].samples).median);
+        results.push_back(std::move(result));
+    }
+
+    bool passed = true;
+    for (const ScenarioResult& result : results)
+    {
+        if (!options.writeBaseline.empty() && !WriteBaseline(options.writeBaseline, result))
+        {
+            fprintf(stderr, "failed to write the baseline of %s to %s\n", result.name.c_str(), options.writeBaseline.c_str());
+            return 1;
+        }
+        if (!options.check.empty() && !CheckBaseline(options.check, result, options.threshold))
+            passed = false;
+    }
+
+    FILE* out = stdout;
+    if (!options.output.empty())
+    {
+        out = fopen(options.output.c_str(), "w");
+        if (!out)
+        {
+            fprintf(stderr, "failed to open %s\n", options.output.c_str());
+            return 1;
+        }
+    }
+
+    if (options.json)
+        WriteJson(out, results);
+    else
+        WriteCsv(out, results);
+
+    if (out != stdout)
+        fclose(out);
+
+    if (!passed)
+    {
+        fprintf(stderr, "performance regression against the baselines in %s\n", options.check.c_str());
+        return 1;
+    }
+    return 0;
+}
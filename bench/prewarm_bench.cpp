@@ -0,0 +1,179 @@
+#include "bench.h"
+
+#include "../prewarm.h"
+
+#include <algorithm>
+#include <vector>
+
+// the presets of the shipped config.ini
+static const PrewarmPreset g_presets[] =
+{
+    { 1920, 1080 }, { 2560, 1440 }, { 2560, 1080 }, { 3440, 1440 },
+    { 16, 9 }, { 21, 9 }, { 4, 3 }, { 3360, 1440 },
+};
+static const uint32_t g_presetCount = sizeof(g_presets) / sizeof(g_presets[0]);
+
+static BenchCheck g_check("prewarm");
+
+static PrewarmInputs GetPrewarmInputs(const Scenario& s, uint64_t cap)
+{
+    uint32_t left, top;
+    PrewarmInputs inputs = {};
+    inputs.windowWidth = s.displayWidth;
+    inputs.windowHeight = s.displayHeight;
+    GetGameBox(s, left, top, inputs.gameWidth, inputs.gameHeight);
+    inputs.nativeFormat = BENCH_FORMAT_SDR;
+    inputs.format = ResourceFormatBGRA8;
+    inputs.mipmapLevels = BENCH_MIPMAP_LEVELS;
+    inputs.cap = cap;
+    return inputs;
+}
+
+static void CheckPrewarm()
+{
+    // the game size of a preset is the one the fixed bars leave
+    for (const Scenario& s : g_scenarios)
+    {
+        for (const PrewarmPreset& preset : g_presets)
+        {
+            Scenario content = s;
+            content.aspectX = preset.width;
+            content.aspectY = preset.height;
+            uint32_t left, top, width, height, gameWidth, gameHeight;
+            GetGameBox(content, left, top, width, height);
+            g_check.Expect(GetPresetGameSize(s.displayWidth, s.displayHeight, preset, gameWidth, gameHeight) &&
+                gameWidth == s.displayWidth - 2 * left && gameHeight == s.displayHeight - 2 * top, "preset game size");
+        }
+    }
+    uint32_t gameWidth, gameHeight;
+    g_check.Expect(!GetPresetGameSize(2560, 1080, { 0, 9 }, gameWidth, gameHeight), "empty preset skipped");
+
+    const Scenario& s = g_scenarios[0];
+    PrewarmInputs inputs = GetPrewarmInputs(s, (uint64_t)BENCH_TEXTURE_POOL_SIZE * 1024 * 1024);
+    TexturePoolKey keys[PREWARM_MAX_KEYS];
+    g_check.Expect(GetOffscreenKeys(inputs, inputs.gameWidth, inputs.gameHeight, keys) == 3, "game, downsampled and blur keys");
+    inputs.temporalInterpolation = true;
+    g_check.Expect(GetOffscreenKeys(inputs, inputs.gameWidth, inputs.gameHeight, keys) == 4, "previous key with temporal interpolation");
+    inputs.temporalInterpolation = false;
+
+    std::vector<TexturePoolKey> plan = PlanPrewarm(inputs, g_presets, g_presetCount);
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < plan.size(); i++)
+    {
+        bytes += GetResourceBytes(plan[i].desc);
+        g_check.Expect(plan[i].desc.width != inputs.gameWidth || plan[i].desc.height != inputs.gameHeight,
+            "current size not planned");
+        g_check.Expect(std::count(plan.begin(), plan.end(), plan[i]) == 1, "each key planned once");
+    }
+    // every key of every preset is either current or planned, the small mips are shared
+    TexturePoolKey current[PREWARM_MAX_KEYS];
+    uint32_t currentCount = GetOffscreenKeys(inputs, inputs.gameWidth, inputs.gameHeight, current);
+    for (const PrewarmPreset& preset : g_presets)
+    {
+        GetPresetGameSize(s.displayWidth, s.displayHeight, preset, gameWidth, gameHeight);
+        uint32_t count = GetOffscreenKeys(inputs, gameWidth, gameHeight, keys);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            g_check.Expect(std::count(current, current + currentCount, keys[i]) +
+                std::count(plan.begin(), plan.end(), keys[i]) == 1, "every other preset size planned");
+        }
+    }
+    g_check.Expect(bytes <= inputs.cap, "plan within the cap");
+
+    inputs.cap = 0;
+    g_check.Expect(PlanPrewarm(inputs, g_presets, g_presetCount).empty(), "nothing planned without a pool");
+    inputs.cap = bytes;
+    g_check.Expect(PlanPrewarm(inputs, g_presets, g_presetCount).size() < plan.size(),
+        "room kept for the current textures");
+}
+
+// Switches the leased textures to the preset's, the way RecreateTexture does: a key
+// that did not change keeps its texture, the old one goes back after the new one is leased.
+static void SwitchPreset(TexturePool& pool, MockPoolDevice& device, const PrewarmInputs& inputs,
+    uint32_t gameWidth, uint32_t gameHeight, TexturePoolKey* leasedKeys, PoolEntryId* leased)
+{
+    TexturePoolKey keys[PREWARM_MAX_KEYS];
+    uint32_t count = GetOffscreenKeys(inputs, gameWidth, gameHeight, keys);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (leased[i] != POOL_ENTRY_NONE && leasedKeys[i] == keys[i])
+            continue;
+        PoolEntryId previous = leased[i];
+        leased[i] = pool.Acquire(keys[i], device);
+        pool.Release(previous, device);
+        leasedKeys[i] = keys[i];
+        if (leased[i] == POOL_ENTRY_NONE)
+            g_check.Expect(false, "allocation of the preset textures");
+    }
+}
+
+int RunPrewarm(const BenchOptions& options)
+{
+    CheckPrewarm();
+
+    uint64_t cap = (uint64_t)options.poolSize * 1024 * 1024;
+    printf("scenario,pool_mb,presets,prewarmed,prewarm_mb,prewarm_ms,cold_creates,warm_creates,cold_us_per_switch,warm_us_per_switch\n");
+    for (const Scenario* scenario : SelectScenarios(options))
+    {
+        const Scenario& s = *scenario;
+        PrewarmInputs inputs = GetPrewarmInputs(s, cap);
+        std::vector<TexturePoolKey> plan = PlanPrewarm(inputs, g_presets, g_presetCount);
+        uint64_t planBytes = 0;
+        for (const TexturePoolKey& key : plan)
+            planBytes += GetResourceBytes(key.desc);
+
+        uint32_t creates[2] = {};
+        double us[2] = {};
+        double prewarmMs = 0.0;
+        for (uint32_t pass = 0; pass < 2; pass++)
+        {
+            TexturePool pool;
+            MockPoolDevice device;
+            device.commit = true;
+            pool.SetCap(cap);
+
+            TexturePoolKey leasedKeys[PREWARM_MAX_KEYS] = {};
+            PoolEntryId leased[PREWARM_MAX_KEYS] = {};
+            SwitchPreset(pool, device, inputs, inputs.gameWidth, inputs.gameHeight, leasedKeys, leased);
+
+            // the background thread, created and handed to the pool idle
+            if (pass == 1)
+            {
+                auto start = BenchClock::now();
+                for (const TexturePoolKey& key : plan)
+                    pool.Release(pool.Acquire(key, device), device);
+                prewarmMs = ElapsedMs(start);
+            }
+
+            uint32_t createsBefore = device.creates;
+            auto start = BenchClock::now();
+            for (const PrewarmPreset& preset : g_presets)
+            {
+                uint32_t gameWidth, gameHeight;
+                GetPresetGameSize(s.displayWidth, s.displayHeight, preset, gameWidth, gameHeight);
+                SwitchPreset(pool, device, inputs, gameWidth, gameHeight, leasedKeys, leased);
+            }
+            us[pass] = ElapsedMs(start) * 1000.0 / g_presetCount;
+            creates[pass] = device.creates - createsBefore;
+
+            g_check.Expect(pool.GetStats().idleBytes <= cap, "idle textures within the cap");
+            for (PoolEntryId id : leased)
+                pool.Release(id, device);
+            pool.SetCap(0);
+            pool.Trim(device);
+            g_check.Expect(device.liveBytes == 0, "everything released");
+        }
+
+        printf("%s,%llu,%u,%u,%.1f,%.2f,%u,%u,%.1f,%.1f\n", GetScenarioName(s).c_str(),
+            (unsigned long long)(cap / (1024 * 1024)), g_presetCount, (uint32_t)plan.size(),
+            planBytes / (1024.0 * 1024.0), prewarmMs, creates[0], creates[1], us[0], us[1]);
+
+        // a size the plan left out is still created on its first switch
+        g_check.Expect(creates[1] + plan.size() == creates[0], "prewarmed textures are not created again");
+        if (options.poolSize >= BENCH_TEXTURE_POOL_SIZE && options.quick)
+            g_check.Expect(creates[1] == 0, "every preset warmed with the default pool");
+    }
+
+    return g_check.Result();
+}
+
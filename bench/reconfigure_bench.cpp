@@ -0,0 +1,281 @@
+#include "bench.h"
+
+#include "../benchstats.h"
+#include "../reconfigure.h"
+#include "../surfaceplan.h"
+
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// What AmbientLight::GetReconfigureInputs returns for a scenario showing content of the
+// given aspect ratio with the default settings.
+static ReconfigureInputs GetBenchInputs(const Scenario& s, uint32_t aspectX, uint32_t aspectY)
+{
+    Scenario content = s;
+    content.aspectX = aspectX;
+    content.aspectY = aspectY;
+    uint32_t left, top, gameWidth, gameHeight;
+    GetGameBox(content, left, top, gameWidth, gameHeight);
+
+    ReconfigureInputs inputs = {};
+    inputs.windowWidth = s.displayWidth;
+    inputs.windowHeight = s.displayHeight;
+    inputs.gameWidth = gameWidth;
+    inputs.gameHeight = gameHeight;
+    if (left > 0)
+    {
+        inputs.barRectCount = 2;
+        uint32_t pillars[2][4] = { { 0, 0, left, s.displayHeight }, { left + gameWidth, 0, s.displayWidth, s.displayHeight } };
+        memcpy(inputs.barRects, pillars, sizeof(pillars));
+    }
+    else if (top > 0)
+    {
+        inputs.barRectCount = 2;
+        uint32_t letterbox[2][4] = { { 0, 0, s.displayWidth, top }, { 0, top + gameHeight, s.displayWidth, s.displayHeight } };
+        memcpy(inputs.barRects, letterbox, sizeof(letterbox));
+    }
+    inputs.format = BENCH_FORMAT_SDR;
+    inputs.colorSpace = BENCH_COLOR_SPACE_SDR;
+    inputs.mipmapLevels = BENCH_MIPMAP_LEVELS;
+    inputs.blurSamples = BENCH_BLUR_SAMPLES;
+    inputs.barSurfaceScale = 1;
+    inputs.vignetteIntensity = BENCH_VIGNETTE_INTENSITY;
+    inputs.vignetteRadius = BENCH_VIGNETTE_RADIUS;
+    inputs.vignetteSmoothness = BENCH_VIGNETTE_SMOOTHNESS;
+    inputs.brightnessThreshold = BENCH_BRIGHTNESS_THRESHOLD;
+    inputs.blackRatio = BENCH_BLACK_RATIO;
+    inputs.uiScale = 1.0f;
+    inputs.showInTaskbar = true;
+    return inputs;
+}
+
+// The resources and CPU side state the app rebuilds per stage, with the portable
+// stand-ins of the D3D work. The ImGui context and window styles have none.
+struct BenchReconfigure
+{
+    ResourceRegistry registry;
+    FakeAllocator allocator;
+    std::vector<ResourceId> ids[ReconfigureStageCount];
+    VignetteMap vignette;
+    BlurKernel kernel = {};
+    SurfacePlan plan = {};
+
+    void Release(uint32_t stage)
+    {
+        for (ResourceId id : ids[stage])
+            registry.Release(id);
+        ids[stage].clear();
+    }
+
+    void Allocate(uint32_t stage, const ResourceDesc& desc)
+    {
+        ids[stage].push_back(registry.Allocate(desc, allocator));
+    }
+
+    void Rebuild(uint32_t stages, const ReconfigureInputs& in)
+    {
+        ResourceFormat format = in.format == BENCH_FORMAT_HDR ? ResourceFormatRGBA16Float : ResourceFormatBGRA8;
+        registry.SetBudget(in.memoryBudget);
+
+        for (uint32_t i = 0; i < ReconfigureStageCount; i++)
+        {
+            if (!(stages & (1u << i)))
+                continue;
+            Release(i);
+
+            switch (1u << i)
+            {
+            case ReconfigureVignette:
+            {
+                VignetteSettings settings = { in.vignetteIntensity, in.vignetteRadius, in.vignetteSmoothness,
+                    (float)in.windowWidth / (float)in.windowHeight };
+                vignette.Bake(settings);
+                Allocate(i, { ResourceOwnerEffect, "vignette mask", VignetteMap::SIZE, VignetteMap::SIZE, ResourceFormatR16Unorm, 1, 1, ResourceDowngradeNone });
+                break;
+            }
+            case ReconfigureOffscreen:
+                Allocate(i, { ResourceOwnerEffect, "game", in.gameWidth, in.gameHeight, format, 0, 1, ResourceDowngradeNone });
+                Allocate(i, { ResourceOwnerEffect, "downsampled", std::max(1u, in.gameWidth >> in.mipmapLevels),
+                    std::max(1u, in.gameHeight >> in.mipmapLevels), format, 1, 1, ResourceDowngradeMip });
+                if (in.temporalInterpolation)
+                    Allocate(i, { ResourceOwnerEffect, "previous", std::max(1u, in.gameWidth >> in.mipmapLevels),
+                        std::max(1u, in.gameHeight >> in.mipmapLevels), format, 1, 1, ResourceDowngradeNone });
+                if (!in.barSurfaces)
+                    Allocate(i, { ResourceOwnerEffect, "canvas", in.windowWidth, in.windowHeight, format, 1, 1, ResourceDowngradeNone });
+                break;
+            case ReconfigureBarSurfaces:
+                if (in.barSurfaces)
+                {
+                    SurfaceRect rects[2] = {};
+                    for (uint32_t b = 0; b < in.barRectCount; b++)
+                        rects[b] = { in.barRects[b][0], in.barRects[b][1], in.barRects[b][2], in.barRects[b][3] };
+                    plan = PlanBarSurfaces(rects, in.barRectCount, in.barSurfaceScale, ResourceFormatBytes(format), BENCH_SWAPCHAIN_BUFFERS);
+                    for (uint32_t b = 0; b < plan.count; b++)
+                    {
+                        Allocate(i, { ResourceOwnerPresent, "bar swapchain", plan.surfaces[b].width, plan.surfaces[b].height,
+                            format, 1, BENCH_SWAPCHAIN_BUFFERS, ResourceDowngradeNone });
+                        Allocate(i, { ResourceOwnerEffect, "bar canvas", plan.surfaces[b].width, plan.surfaces[b].height,
+                            format, 1, 1, ResourceDowngradeNone });
+                    }
+                }
+                break;
+            case ReconfigureBlur:
+                kernel = ReferenceBlurKernel(in.blurSamples);
+                Allocate(i, { ResourceOwnerBlur, "blur temp", std::max(1u, in.gameWidth >> in.mipmapLevels),
+                    std::max(1u, in.gameHeight >> in.mipmapLevels), format, 1, 1, ResourceDowngradeFormat });
+                break;
+            case ReconfigureDetection:
+                Allocate(i, { ResourceOwnerDetect, "luma", in.windowWidth, in.windowHeight, ResourceFormatR32Float, 1, 1, ResourceDowngradeNone });
+                Allocate(i, { ResourceOwnerDetect, "luma staging", in.windowWidth, in.windowHeight, ResourceFormatR32Float, 1, 1, ResourceDowngradeNone });
+                break;
+            case ReconfigureDetectionInner:
+                Allocate(i, { ResourceOwnerDetect, "luma", in.gameWidth, in.gameHeight, ResourceFormatR32Float, 1, 1, ResourceDowngradeNone });
+                Allocate(i, { ResourceOwnerDetect, "luma staging", in.gameWidth, in.gameHeight, ResourceFormatR32Float, 1, 1, ResourceDowngradeNone });
+                break;
+            default:
+                break;
+            }
+        }
+    }
+};
+
+struct ReconfigureChange
+{
+    const char* name;
+    // stages the change has to rebuild with the default settings
+    uint32_t expected;
+};
+
+// every kind of change the app reconfigures for, applied to the default inputs
+static const ReconfigureChange g_reconfigureChanges[] =
+{
+    { "none", 0 },
+    // new content aspect ratio, the detected bars move
+    { "bars", ReconfigureOffscreen | ReconfigureBarSurfaces | ReconfigureBlur | ReconfigureDetectionInner },
+    { "display", ReconfigureAll & ~(ReconfigureUI | ReconfigureWindow) },
+    { "hdr", ReconfigureOffscreen | ReconfigureBarSurfaces | ReconfigureBlur | ReconfigureDetection | ReconfigureDetectionInner },
+    { "mipmap_levels", ReconfigureOffscreen | ReconfigureBlur },
+    { "memory_budget", ReconfigureOffscreen | ReconfigureBlur },
+    { "temporal", ReconfigureOffscreen | ReconfigureBlur },
+    { "bar_surfaces", ReconfigureOffscreen | ReconfigureBarSurfaces | ReconfigureBlur },
+    { "bar_surface_scale", ReconfigureBarSurfaces },
+    { "blur_samples", ReconfigureBlur },
+    { "vignette", ReconfigureVignette },
+    { "threshold", ReconfigureDetection | ReconfigureDetectionInner },
+    { "symmetric", ReconfigureDetection },
+    { "ui_scale", ReconfigureUI },
+    { "taskbar", ReconfigureWindow },
+};
+
+static ReconfigureInputs ApplyChange(const Scenario& s, const ReconfigureInputs& base, const char* change)
+{
+    std::string name = change;
+    ReconfigureInputs in = base;
+    if (name == "bars")
+        in = GetBenchInputs(s, 4, 3);
+    else if (name == "display")
+    {
+        Scenario larger = s;
+        larger.displayWidth *= 2;
+        larger.displayHeight *= 2;
+        in = GetBenchInputs(larger, s.aspectX, s.aspectY);
+    }
+    else if (name == "hdr")
+    {
+        in.format = BENCH_FORMAT_HDR;
+        in.colorSpace = BENCH_COLOR_SPACE_HDR;
+    }
+    else if (name == "mipmap_levels")
+        in.mipmapLevels++;
+    else if (name == "memory_budget")
+        in.memoryBudget = 64ull * 1024 * 1024;
+    else if (name == "temporal")
+        in.temporalInterpolation = !in.temporalInterpolation;
+    else if (name == "bar_surfaces")
+        in.barSurfaces = !in.barSurfaces;
+    else if (name == "bar_surface_scale")
+        in.barSurfaceScale *= 2;
+    else if (name == "blur_samples")
+        in.blurSamples += 2;
+    else if (name == "vignette")
+        in.vignetteRadius *= 0.5f;
+    else if (name == "threshold")
+        in.brightnessThreshold *= 2.0f;
+    else if (name == "symmetric")
+        in.symmetricBars = !in.symmetricBars;
+    else if (name == "ui_scale")
+        in.uiScale *= 1.5f;
+    else if (name == "taskbar")
+        in.showInTaskbar = !in.showInTaskbar;
+    return in;
+}
+
+int RunReconfigure(const BenchOptions& options)
+{
+    bool passed = true;
+    uint32_t runs = options.runs == 0 ? 5 : options.runs;
+
+    printf("scenario,change,stages,incremental_ms,full_ms\n");
+    for (const Scenario* scenario : SelectScenarios(options))
+    {
+        const Scenario& s = *scenario;
+        ReconfigureInputs base = GetBenchInputs(s, s.aspectX, s.aspectY);
+        for (const ReconfigureChange& change : g_reconfigureChanges)
+        {
+            ReconfigureInputs wanted = ApplyChange(s, base, change.name);
+            uint32_t stages = GetReconfigureStages(base, wanted);
+
+            char names[128];
+            FormatReconfigureStages(stages, names, sizeof(names));
+            if (stages != change.expected)
+            {
+                char expected[128];
+                FormatReconfigureStages(change.expected, expected, sizeof(expected));
+                fprintf(stderr, "%s %s: rebuilds %s, expected %s\n", GetScenarioName(s).c_str(), change.name, names, expected);
+                passed = false;
+            }
+            if (GetReconfigureStages(wanted, wanted) != 0)
+            {
+                fprintf(stderr, "%s %s: rebuilds again without a change\n", GetScenarioName(s).c_str(), change.name);
+                passed = false;
+            }
+
+            // the same change applied incrementally and the way every change used to be applied
+            std::vector<double> incrementalMs, fullMs;
+            for (uint32_t run = 0; run < runs + options.warmup; run++)
+            {
+                BenchReconfigure incremental, full;
+                incremental.Rebuild(ReconfigureAll, base);
+                full.Rebuild(ReconfigureAll, base);
+
+                auto start = BenchClock::now();
+                incremental.Rebuild(stages, wanted);
+                double incrementalTime = ElapsedMs(start);
+                start = BenchClock::now();
+                full.Rebuild(ReconfigureAll, wanted);
+                double fullTime = ElapsedMs(start);
+
+                if (run == 0 && incremental.registry.GetTotalBytes() != full.registry.GetTotalBytes())
+                {
+                    fprintf(stderr, "%s %s: %llu bytes after the incremental rebuild, %llu after the full one\n",
+                        GetScenarioName(s).c_str(), change.name,
+                        (unsigned long long)incremental.registry.GetTotalBytes(), (unsigned long long)full.registry.GetTotalBytes());
+                    passed = false;
+                }
+                if (run >= options.warmup)
+                {
+                    incrementalMs.push_back(incrementalTime);
+                    fullMs.push_back(fullTime);
+                }
+            }
+
+            printf("%s,%s,%s,%.4f,%.4f\n", GetScenarioName(s).c_str(), change.name, names,
+                GetSampleStats(incrementalMs).median, GetSampleStats(fullMs).median);
+        }
+    }
+
+    return passed ? 0 : 1;
+}
+
@@ -0,0 +1,442 @@
+#include "bench.h"
+
+#include "../benchstats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+static BenchCheck g_check("reference");
+
+// Largest difference between sampling the bars straight from the blurred mip and
+// sampling them from the mip scaled up to the game size. Both filter bilinearly, the
+// upscaled path twice, so they differ by a little on the low frequency blur.
+#define BENCH_DIRECT_TOLERANCE       0.005f
+// The fused composite reads the vignette from the baked map, the passes it replaced
+// computed it per pixel. The map is filtered between its texels.
+#define BENCH_FUSED_TOLERANCE        0.01f
+// The baked vignette against the formula, over the whole window. Bilinear between 256
+// texels follows the smoothstep closely, only the clamped half texel at the edges and
+// the corners of steep settings stray further.
+#define BENCH_VIGNETTE_TOLERANCE     0.015f
+// UV grid the map is walked over, its edges included
+#define BENCH_VIGNETTE_GRID          1024
+// the app default vignette ends before the bars of most layouts, this one reaches into them
+#define BENCH_FUSED_VIGNETTE_RADIUS  0.6f
+
+// a geometry of the effect pass, the inner box is masked out of the game when set
+struct ReferenceCase
+{
+    const char* name;
+    uint32_t windowWidth;
+    uint32_t windowHeight;
+    uint32_t gameWidth;
+    uint32_t gameHeight;
+    uint32_t zoom;
+    float stretchFactor;
+    bool mirrored;
+    // inner bars in game pixels, letterbox in a pillarboxed game or the other way round
+    uint32_t innerSize;
+};
+
+static const ReferenceCase g_referenceCases[] =
+{
+    // 16:9 on 21:9, pillarbox, and a 2.39:1 film letterboxed in it
+    { "pillarbox", 2560, 1080, 1920, 1080, BENCH_ZOOM, BENCH_STRETCH_FACTOR, BENCH_MIRRORED, 0 },
+    { "pillarbox_zoom_0", 2560, 1080, 1920, 1080, 0, BENCH_STRETCH_FACTOR, BENCH_MIRRORED, 0 },
+    { "pillarbox_zoom_2", 2560, 1080, 1920, 1080, 2, BENCH_STRETCH_FACTOR, BENCH_MIRRORED, 0 },
+    { "pillarbox_stretch_1", 2560, 1080, 1920, 1080, BENCH_ZOOM, 1.0f, BENCH_MIRRORED, 0 },
+    { "pillarbox_stretch_3.5", 2560, 1080, 1920, 1080, BENCH_ZOOM, 3.5f, BENCH_MIRRORED, 0 },
+    { "pillarbox_unmirrored", 2560, 1080, 1920, 1080, BENCH_ZOOM, BENCH_STRETCH_FACTOR, false, 0 },
+    { "pillarbox_inner", 2560, 1080, 1920, 1080, BENCH_ZOOM, BENCH_STRETCH_FACTOR, BENCH_MIRRORED, 138 },
+    { "pillarbox_inner_unmirrored", 2560, 1080, 1920, 1080, BENCH_ZOOM, BENCH_STRETCH_FACTOR, false, 138 },
+    // 21:9 on 16:9, letterbox, and 4:3 pillarboxed in it
+    { "letterbox", 1920, 1080, 1920, 810, BENCH_ZOOM, BENCH_STRETCH_FACTOR, BENCH_MIRRORED, 0 },
+    { "letterbox_zoom_0", 1920, 1080, 1920, 810, 0, BENCH_STRETCH_FACTOR, BENCH_MIRRORED, 0 },
+    { "letterbox_zoom_2", 1920, 1080, 1920, 810, 2, BENCH_STRETCH_FACTOR, BENCH_MIRRORED, 0 },
+    { "letterbox_stretch_1", 1920, 1080, 1920, 810, BENCH_ZOOM, 1.0f, BENCH_MIRRORED, 0 },
+    { "letterbox_stretch_3.5", 1920, 1080, 1920, 810, BENCH_ZOOM, 3.5f, BENCH_MIRRORED, 0 },
+    { "letterbox_unmirrored", 1920, 1080, 1920, 810, BENCH_ZOOM, BENCH_STRETCH_FACTOR, false, 0 },
+    { "letterbox_inner", 1920, 1080, 1920, 810, BENCH_ZOOM, BENCH_STRETCH_FACTOR, BENCH_MIRRORED, 420 },
+    { "letterbox_inner_unmirrored", 1920, 1080, 1920, 810, BENCH_ZOOM, BENCH_STRETCH_FACTOR, false, 420 },
+};
+
+static bool IsPillarbox(const ReferenceCase& c)
+{
+    return c.gameHeight == c.windowHeight;
+}
+
+static RenderPlanInputs GetReferenceInputs(const ReferenceCase& c)
+{
+    RenderPlanInputs inputs = {};
+    inputs.windowWidth = c.windowWidth;
+    inputs.windowHeight = c.windowHeight;
+    inputs.gameWidth = c.gameWidth;
+    inputs.gameHeight = c.gameHeight;
+    bool pillarbox = IsPillarbox(c);
+    inputs.bars.count = 2;
+    inputs.bars.positions[0] = pillarbox ? BENCH_BAR_LEFT : BENCH_BAR_TOP;
+    inputs.bars.positions[1] = pillarbox ? BENCH_BAR_RIGHT : BENCH_BAR_BOTTOM;
+    inputs.bars.sizes[0] = pillarbox ? (c.windowWidth - c.gameWidth) / 2 : (c.windowHeight - c.gameHeight) / 2;
+    inputs.bars.sizes[1] = inputs.bars.sizes[0];
+    inputs.mipLevel = BENCH_MIPMAP_LEVELS;
+    inputs.zoom = c.zoom;
+    inputs.stretchFactor = c.stretchFactor;
+    inputs.mirrored = c.mirrored;
+    return inputs;
+}
+
+// the inner bars in game pixels, as innerBars[i].toRect() gives them to the app
+static uint32_t GetInnerRects(const ReferenceCase& c, SurfaceRect* rects)
+{
+    if (c.innerSize == 0)
+        return 0;
+    if (IsPillarbox(c))
+    {
+        rects[0] = { 0, 0, c.gameWidth, c.innerSize };
+        rects[1] = { 0, c.gameHeight - c.innerSize, c.gameWidth, c.gameHeight };
+    }
+    else
+    {
+        rects[0] = { 0, 0, c.innerSize, c.gameHeight };
+        rects[1] = { c.gameWidth - c.innerSize, 0, c.gameWidth, c.gameHeight };
+    }
+    return 2;
+}
+
+// the blurred mip of a game frame: noise put through the app's blur
+static void FillBlurredMip(Image& mip)
+{
+    for (uint32_t y = 0; y < mip.Height(); y++)
+    {
+        for (uint32_t x = 0; x < mip.Width(); x++)
+        {
+            uint32_t h = Hash(y * mip.Width() + x);
+            mip.At(x, y) = { (h & 0xff) / 255.0f, ((h >> 8) & 0xff) / 255.0f, ((h >> 16) & 0xff) / 255.0f, 1.0f };
+        }
+    }
+    Image temp;
+    ReferenceBlur(mip, temp, ReferenceBlurKernel(BENCH_BLUR_SAMPLES), BENCH_BLUR_PASSES);
+}
+
+// RenderEffects before the bars sampled the mip: the region of the mip scaled up to
+// the game size, the inner box cleared in it, then each bar copied out of the game
+// edge next to it
+static void RenderUpscaled(Image& canvas, const Image& mip, const RenderPlan& plan,
+    const RenderPlanInputs& inputs, const SurfaceRect* inner, uint32_t innerCount)
+{
+    Image processed(inputs.gameWidth, inputs.gameHeight);
+    CompositeBar upscale = {};
+    upscale.targetWidth = inputs.gameWidth;
+    upscale.targetHeight = inputs.gameHeight;
+    upscale.sourceX = plan.regionX;
+    upscale.sourceY = plan.regionY;
+    upscale.sourceWidth = plan.mipWidth - plan.regionX * 2;
+    upscale.sourceHeight = plan.mipHeight - plan.regionY * 2;
+    upscale.flip = FlipNone;
+    ReferenceCopy(processed, upscale, mip);
+
+    for (uint32_t i = 0; i < innerCount; i++)
+        ReferenceClear(processed, inner[i].left, inner[i].top, inner[i].right, inner[i].bottom);
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        CompositeBar bar = plan.bars[i];
+        bool vertical = inputs.bars.positions[i] == BENCH_BAR_LEFT || inputs.bars.positions[i] == BENCH_BAR_RIGHT;
+        bool far = inputs.bars.positions[i] == BENCH_BAR_RIGHT || inputs.bars.positions[i] == BENCH_BAR_BOTTOM;
+        uint32_t size = (uint32_t)((float)inputs.bars.sizes[i] / inputs.stretchFactor);
+        bar.sourceX = vertical && far ? (float)(inputs.gameWidth - size) : 0.0f;
+        bar.sourceY = !vertical && far ? (float)(inputs.gameHeight - size) : 0.0f;
+        bar.sourceWidth = vertical ? (float)size : (float)inputs.gameWidth;
+        bar.sourceHeight = vertical ? (float)inputs.gameHeight : (float)size;
+        ReferenceCopy(canvas, bar, processed);
+    }
+}
+
+// The mask is a hard edge in source UV, the cleared game pixels of the upscaled path
+// are filtered into their neighbours. The target pixels next to each edge are left
+// out of the comparison by clearing them in both images.
+static void ClearMaskEdges(Image& a, Image& b, const ReferenceCase& c, const RenderPlan& plan,
+    const SurfaceRect* inner, uint32_t innerCount)
+{
+    bool pillarbox = IsPillarbox(c);
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        const CompositeBar& bar = plan.bars[i];
+        // the bars span the game along the edge, flipping is across it
+        uint32_t targetSize = pillarbox ? bar.targetHeight : bar.targetWidth;
+        uint32_t gameSize = pillarbox ? c.gameHeight : c.gameWidth;
+        uint32_t band = (targetSize + gameSize - 1) / gameSize + 1;
+        for (uint32_t r = 0; r < innerCount; r++)
+        {
+            uint32_t edges[2] = { pillarbox ? inner[r].top : inner[r].left, pillarbox ? inner[r].bottom : inner[r].right };
+            for (uint32_t edge : edges)
+            {
+                if (edge == 0 || edge >= gameSize)
+                    continue;
+                uint32_t center = (uint32_t)((uint64_t)edge * targetSize / gameSize);
+                uint32_t from = center > band ? center - band : 0;
+                uint32_t to = std::min(center + band, targetSize);
+                for (Image* image : { &a, &b })
+                {
+                    if (pillarbox)
+                        ReferenceClear(*image, bar.targetX, bar.targetY + from, bar.targetX + bar.targetWidth, bar.targetY + to);
+                    else
+                        ReferenceClear(*image, bar.targetX + from, bar.targetY, bar.targetX + to, bar.targetY + bar.targetHeight);
+                }
+            }
+        }
+    }
+}
+
+// the bars sampled straight from the blurred mip against the upscaled path
+static void CheckDirectSampling()
+{
+    printf("case,mip,max_difference,direct_ms,upscaled_ms\n");
+    for (const ReferenceCase& c : g_referenceCases)
+    {
+        RenderPlanInputs inputs = GetReferenceInputs(c);
+        RenderPlan plan = BuildRenderPlan(inputs);
+        g_check.Expect(plan.valid, "plan of the reference case");
+        if (!plan.valid)
+            continue;
+
+        Image mip(plan.mipWidth, plan.mipHeight);
+        FillBlurredMip(mip);
+
+        SurfaceRect inner[2];
+        uint32_t innerCount = GetInnerRects(c, inner);
+        UVRect masks[2];
+        for (uint32_t i = 0; i < innerCount; i++)
+            masks[i] = GetSourceUV(plan, inner[i]);
+
+        Image direct(c.windowWidth, c.windowHeight);
+        BenchClock::time_point start = BenchClock::now();
+        for (uint32_t i = 0; i < 2; i++)
+            ReferenceCopy(direct, plan.bars[i], mip, masks, innerCount);
+        double directMs = ElapsedMs(start);
+
+        Image upscaled(c.windowWidth, c.windowHeight);
+        start = BenchClock::now();
+        RenderUpscaled(upscaled, mip, plan, inputs, inner, innerCount);
+        double upscaledMs = ElapsedMs(start);
+
+        if (innerCount > 0)
+        {
+            // the middle of an inner bar is masked in every bar, flipped or not
+            for (uint32_t i = 0; i < 2; i++)
+            {
+                const CompositeBar& bar = plan.bars[i];
+                uint32_t x = bar.targetX + (IsPillarbox(c) ? bar.targetWidth / 2 : c.innerSize / 2 * bar.targetWidth / c.gameWidth);
+                uint32_t y = bar.targetY + (IsPillarbox(c) ? c.innerSize / 2 * bar.targetHeight / c.gameHeight : bar.targetHeight / 2);
+                const Pixel& p = direct.At(x, y);
+                g_check.Expect(p.r == 0.0f && p.g == 0.0f && p.b == 0.0f && p.a == 0.0f, "inner box masked out");
+            }
+            ClearMaskEdges(direct, upscaled, c, plan, inner, innerCount);
+        }
+
+        float difference = ReferenceMaxDifference(direct, upscaled);
+        printf("%s,%ux%u,%.5f,%.3f,%.3f\n", c.name, plan.mipWidth, plan.mipHeight, difference, directMs, upscaledMs);
+        g_check.Expect(difference <= BENCH_DIRECT_TOLERANCE, "direct sampling matches the upscaled path");
+    }
+}
+
+// 16:9 on 32:9, where the window passes cost the most against the bars
+static const ReferenceCase g_fusedTimingCase =
+    { "5120x1440_16:9", 5120, 1440, 2560, 1440, BENCH_ZOOM, BENCH_STRETCH_FACTOR, BENCH_MIRRORED, 0 };
+
+// the light peek of a desktop: mostly dark, with bright pixels that fade the effect out
+static void FillLuma(std::vector<float>& luma, uint32_t width, uint32_t height)
+{
+    luma.resize((size_t)width * height);
+    for (size_t i = 0; i < luma.size(); i++)
+    {
+        uint32_t h = Hash((uint32_t)i);
+        luma[i] = h % 4 == 0 ? (float)(h >> 8 & 0xff) / 255.0f : 0.0f;
+    }
+}
+
+// RenderEffects and RenderBackBuffer before the composite: the canvas cleared, a copy
+// per bar, then the vignette and the light peek mask each over the whole window
+static void RenderMultiPass(Image& canvas, const Image& mip, const RenderPlan& plan,
+    const UVRect* masks, uint32_t maskCount, const VignetteSettings& vignette, const float* luma)
+{
+    ReferenceClear(canvas, 0, 0, canvas.Width(), canvas.Height());
+    for (uint32_t i = 0; i < 2; i++)
+        ReferenceCopy(canvas, plan.bars[i], mip, masks, maskCount);
+    ReferenceVignette(canvas, vignette);
+    ReferenceLumaMask(canvas, luma, canvas.Width(), canvas.Height());
+}
+
+// One case through the passes and through the composite. The composite only writes the
+// bars, its canvas keeps the transparent black it was cleared to once.
+static float CompareFused(const ReferenceCase& c, uint32_t runs, double& multiPassMs, double& fusedMs,
+    uint64_t& multiPassBytes, uint64_t& fusedBytes)
+{
+    RenderPlan plan = BuildRenderPlan(GetReferenceInputs(c));
+    g_check.Expect(plan.valid, "plan of the reference case");
+    if (!plan.valid)
+        return 0.0f;
+
+    Image mip(plan.mipWidth, plan.mipHeight);
+    FillBlurredMip(mip);
+    std::vector<float> luma;
+    FillLuma(luma, c.windowWidth, c.windowHeight);
+
+    SurfaceRect inner[2];
+    uint32_t innerCount = GetInnerRects(c, inner);
+    UVRect masks[2];
+    for (uint32_t i = 0; i < innerCount; i++)
+        masks[i] = GetSourceUV(plan, inner[i]);
+
+    VignetteSettings vignette = { BENCH_VIGNETTE_INTENSITY, BENCH_FUSED_VIGNETTE_RADIUS, BENCH_VIGNETTE_SMOOTHNESS,
+        (float)c.windowWidth / c.windowHeight };
+    VignetteMap map;
+    map.Bake(vignette);
+
+    Image multiPass(c.windowWidth, c.windowHeight);
+    Image fused(c.windowWidth, c.windowHeight);
+
+    // bytes written and read: the clear, the copies, the vignette and the mask with its
+    // luma over the window, against the bars and their luma
+    uint64_t windowPixels = (uint64_t)c.windowWidth * c.windowHeight;
+    multiPassBytes = windowPixels * BENCH_PIXEL_BYTES + plan.barPixels * BENCH_PIXEL_BYTES +
+        windowPixels * BENCH_PIXEL_BYTES * 2 + windowPixels * (BENCH_PIXEL_BYTES * 2 + sizeof(float));
+    fusedBytes = plan.barPixels * (BENCH_PIXEL_BYTES + sizeof(float));
+    std::vector<double> multiPassSamples, fusedSamples;
+    for (uint32_t run = 0; run < runs; run++)
+    {
+        BenchClock::time_point start = BenchClock::now();
+        RenderMultiPass(multiPass, mip, plan, masks, innerCount, vignette, luma.data());
+        multiPassSamples.push_back(ElapsedMs(start));
+
+        start = BenchClock::now();
+        ReferenceComposite(fused, mip, plan.bars, 2, masks, innerCount, c.windowWidth, c.windowHeight,
+            &map, luma.data());
+        fusedSamples.push_back(ElapsedMs(start));
+    }
+    multiPassMs = GetSampleStats(multiPassSamples).median;
+    fusedMs = GetSampleStats(fusedSamples).median;
+    float difference = ReferenceMaxDifference(multiPass, fused);
+
+    // nothing between the bars is written
+    Image untouched(c.windowWidth, c.windowHeight);
+    for (uint32_t y = 0; y < c.windowHeight; y++)
+        for (uint32_t x = 0; x < c.windowWidth; x++)
+            untouched.At(x, y) = { 1.0f, 1.0f, 1.0f, 1.0f };
+    ReferenceComposite(untouched, mip, plan.bars, 2, masks, innerCount, c.windowWidth, c.windowHeight,
+        &map, luma.data());
+    const Pixel& center = untouched.At(c.windowWidth / 2, c.windowHeight / 2);
+    g_check.Expect(center.r == 1.0f && center.a == 1.0f, "composite only writes the bars");
+    return difference;
+}
+
+// the fused composite against the passes it replaced, and its time on 32:9
+static void CheckFusedComposite(const BenchOptions& options)
+{
+    // The CPU spends most of either path on the bilinear samples of the bars, which the
+    // GPU filters for free, so the bytes each path moves are checked and the times only reported.
+    printf("case,max_difference,multi_pass_ms,fused_ms,multi_pass_bytes,fused_bytes\n");
+    uint32_t runs = options.runs > 0 ? options.runs : (options.quick ? 3 : 9);
+    std::vector<const ReferenceCase*> cases;
+    for (const ReferenceCase& c : g_referenceCases)
+        cases.push_back(&c);
+    cases.push_back(&g_fusedTimingCase);
+    for (const ReferenceCase* c : cases)
+    {
+        double multiPassMs, fusedMs;
+        uint64_t multiPassBytes, fusedBytes;
+        float difference = CompareFused(*c, c == &g_fusedTimingCase ? runs : 1, multiPassMs, fusedMs,
+            multiPassBytes, fusedBytes);
+        printf("%s,%.5f,%.3f,%.3f,%llu,%llu\n", c->name, difference, multiPassMs, fusedMs,
+            (unsigned long long)multiPassBytes, (unsigned long long)fusedBytes);
+        g_check.Expect(difference <= BENCH_FUSED_TOLERANCE, "fused composite matches the passes");
+        g_check.Expect(fusedBytes < multiPassBytes, "fused composite moves less memory than the passes");
+    }
+}
+
+struct VignetteCase
+{
+    const char* name;
+    VignetteSettings settings;
+    // window the vignette is applied to, the aspect follows from it
+    uint32_t windowWidth;
+    uint32_t windowHeight;
+};
+
+static const VignetteCase g_vignetteCases[] =
+{
+    { "default_16:9", { BENCH_VIGNETTE_INTENSITY, BENCH_VIGNETTE_RADIUS, BENCH_VIGNETTE_SMOOTHNESS, 0.0f }, 1920, 1080 },
+    { "default_21:9", { BENCH_VIGNETTE_INTENSITY, BENCH_VIGNETTE_RADIUS, BENCH_VIGNETTE_SMOOTHNESS, 0.0f }, 2560, 1080 },
+    { "default_32:9", { BENCH_VIGNETTE_INTENSITY, BENCH_VIGNETTE_RADIUS, BENCH_VIGNETTE_SMOOTHNESS, 0.0f }, 5120, 1440 },
+    { "portrait", { BENCH_VIGNETTE_INTENSITY, BENCH_VIGNETTE_RADIUS, BENCH_VIGNETTE_SMOOTHNESS, 0.0f }, 1080, 1920 },
+    { "narrow", { BENCH_VIGNETTE_INTENSITY, BENCH_FUSED_VIGNETTE_RADIUS, BENCH_VIGNETTE_SMOOTHNESS, 0.0f }, 5120, 1440 },
+    { "zero_radius", { BENCH_VIGNETTE_INTENSITY, 0.0f, BENCH_VIGNETTE_SMOOTHNESS, 0.0f }, 5120, 1440 },
+    { "full_strength", { 1.0f, 0.5f, 0.5f, 0.0f }, 2560, 1080 },
+    { "half_strength", { 0.5f, BENCH_FUSED_VIGNETTE_RADIUS, BENCH_VIGNETTE_SMOOTHNESS, 0.0f }, 2560, 1080 },
+    { "off", { 0.0f, BENCH_VIGNETTE_RADIUS, BENCH_VIGNETTE_SMOOTHNESS, 0.0f }, 2560, 1080 },
+};
+
+// the baked map against ReferenceVignetteFactor over a UV grid, and against
+// ReferenceVignette over the window
+static void CheckVignetteMap()
+{
+    printf("vignette,map,grid_difference,window_difference\n");
+    for (const VignetteCase& c : g_vignetteCases)
+    {
+        VignetteSettings settings = c.settings;
+        settings.aspect = (float)c.windowWidth / c.windowHeight;
+        VignetteMap map;
+        map.Bake(settings);
+        // the size of the map does not follow the window
+        g_check.Expect(map.Width() == VignetteMap::SIZE && map.Height() == VignetteMap::SIZE, "vignette map size");
+
+        float gridDifference = 0.0f;
+        for (uint32_t y = 0; y <= BENCH_VIGNETTE_GRID; y++)
+        {
+            for (uint32_t x = 0; x <= BENCH_VIGNETTE_GRID; x++)
+            {
+                float u = (float)x / BENCH_VIGNETTE_GRID;
+                float v = (float)y / BENCH_VIGNETTE_GRID;
+                gridDifference = std::max(gridDifference,
+                    std::fabs(map.Sample(u, v) - ReferenceVignetteFactor(u, v, settings)));
+            }
+        }
+
+        // the composite scales by the map at the window pixel centers
+        Image analytic(c.windowWidth, c.windowHeight);
+        Image baked(c.windowWidth, c.windowHeight);
+        for (uint32_t y = 0; y < c.windowHeight; y++)
+        {
+            for (uint32_t x = 0; x < c.windowWidth; x++)
+            {
+                float factor = map.Sample(((float)x + 0.5f) / c.windowWidth, ((float)y + 0.5f) / c.windowHeight);
+                analytic.At(x, y) = { 1.0f, 1.0f, 1.0f, 1.0f };
+                baked.At(x, y) = { factor, factor, factor, factor };
+            }
+        }
+        ReferenceVignette(analytic, settings);
+        float windowDifference = ReferenceMaxDifference(analytic, baked);
+
+        printf("%s,%ux%u,%.5f,%.5f\n", c.name, map.Width(), map.Height(), gridDifference, windowDifference);
+        g_check.Expect(gridDifference <= BENCH_VIGNETTE_TOLERANCE, "vignette map matches the formula");
+        g_check.Expect(windowDifference <= BENCH_VIGNETTE_TOLERANCE, "vignette map matches the vignette pass");
+    }
+
+    // settings that leave nothing to interpolate are exact
+    VignetteSettings zero = { 1.0f, 0.0f, BENCH_VIGNETTE_SMOOTHNESS, 1.0f };
+    VignetteMap map;
+    map.Bake(zero);
+    g_check.Expect(map.Sample(0.5f, 0.5f) == 0.0f && map.Sample(0.0f, 1.0f) == 0.0f, "zero radius at full strength is black");
+    VignetteSettings off = { 0.0f, BENCH_VIGNETTE_RADIUS, BENCH_VIGNETTE_SMOOTHNESS, 1.0f };
+    map.Bake(off);
+    g_check.Expect(map.Sample(0.5f, 0.5f) == 1.0f && map.Sample(1.0f, 0.0f) == 1.0f, "no intensity leaves the effect alone");
+}
+
+int RunReference(const BenchOptions& options)
+{
+    CheckDirectSampling();
+    CheckFusedComposite(options);
+    CheckVignetteMap();
+    return g_check.Result();
+}
@@ -0,0 +1,251 @@
+#include "bench.h"
+
+#include <string.h>
+#include <cmath>
+
+static BenchCheck g_check("render plan");
+
+// the fixed bars of the scenario's content, as ValidateSettings sets them
+static RenderPlanInputs GetRenderPlanInputs(const Scenario& s, DetectedBars& detected)
+{
+    uint32_t left, top, width, height;
+    GetGameBox(s, left, top, width, height);
+    detected = { top, top, left, left };
+
+    RenderPlanInputs inputs = {};
+    inputs.windowWidth = s.displayWidth;
+    inputs.windowHeight = s.displayHeight;
+    inputs.gameWidth = s.displayWidth - 2 * left;
+    inputs.gameHeight = s.displayHeight - 2 * top;
+    bool pillarbox = inputs.gameHeight == inputs.windowHeight;
+    inputs.bars.count = 2;
+    inputs.bars.positions[0] = pillarbox ? BENCH_BAR_LEFT : BENCH_BAR_TOP;
+    inputs.bars.positions[1] = pillarbox ? BENCH_BAR_RIGHT : BENCH_BAR_BOTTOM;
+    inputs.bars.sizes[0] = pillarbox ? left : top;
+    inputs.bars.sizes[1] = inputs.bars.sizes[0];
+    inputs.mipLevel = BENCH_MIPMAP_LEVELS;
+    inputs.zoom = BENCH_ZOOM;
+    inputs.stretchFactor = BENCH_STRETCH_FACTOR;
+    inputs.mirrored = BENCH_MIRRORED;
+    return inputs;
+}
+
+static void CheckRenderPlan()
+{
+    // the same bars as the pipeline benchmark builds every frame
+    for (const Scenario& s : g_scenarios)
+    {
+        DetectedBars detected;
+        RenderPlanInputs inputs = GetRenderPlanInputs(s, detected);
+        RenderPlan plan = BuildRenderPlan(inputs);
+        g_check.Expect(plan.valid, "plan of the fixed bars");
+
+        Image downsampled(plan.mipWidth, plan.mipHeight);
+        CompositeBar bars[2] = {};
+        BuildBars(s, detected, inputs.gameWidth, inputs.gameHeight, downsampled, bars);
+        g_check.Expect(memcmp(bars, plan.bars, sizeof(bars)) == 0, "bars match the per-frame construction");
+
+        uint32_t left, top, width, height;
+        GetGameBox(s, left, top, width, height);
+        g_check.Expect(plan.gameBox.left == left && plan.gameBox.top == top &&
+            plan.gameBox.right - plan.gameBox.left == inputs.gameWidth &&
+            plan.gameBox.bottom - plan.gameBox.top == inputs.gameHeight, "game box");
+        g_check.Expect(plan.barPixels == (uint64_t)s.displayWidth * s.displayHeight -
+            (uint64_t)inputs.gameWidth * inputs.gameHeight, "bars cover the window outside the game");
+
+        UVRect uv = GetSourceUV(plan, { 1, 1, inputs.gameWidth - 1, inputs.gameHeight - 1 });
+        g_check.Expect(std::fabs(uv.left - (plan.regionX + plan.gameToMipX) / plan.mipWidth) < 1e-6f &&
+            std::fabs(uv.right - (1.0f - (plan.regionX + plan.gameToMipX) / plan.mipWidth)) < 1e-4f, "game area in source UV");
+        UVRect edges = GetSourceUV(plan, { 0, 0, inputs.gameWidth, inputs.gameHeight });
+        g_check.Expect(edges.left < 0.0f && edges.top < 0.0f && edges.right > 1.0f && edges.bottom > 1.0f,
+            "sides on the game edge reach past the texture");
+    }
+
+    DetectedBars detected;
+    RenderPlanInputs inputs = GetRenderPlanInputs(g_scenarios[0], detected);
+    RenderPlanInputs none = inputs;
+    none.bars.count = 0;
+    g_check.Expect(!BuildRenderPlan(none).valid, "nothing drawn without bars");
+    RenderPlanInputs cross = inputs;
+    cross.bars.positions[0] = BENCH_BAR_TOP;
+    cross.bars.positions[1] = BENCH_BAR_BOTTOM;
+    g_check.Expect(!BuildRenderPlan(cross).valid, "nothing drawn when the bars do not frame the game");
+    RenderPlanInputs unmirrored = inputs;
+    unmirrored.mirrored = false;
+    g_check.Expect(BuildRenderPlan(unmirrored).bars[0].flip == FlipNone, "mirroring from the settings");
+
+    ConstantCache cache;
+    float a[4] = { 1.0f, 2.0f, 3.0f, 4.0f };
+    float b[4] = { 1.0f, 2.0f, 3.0f, 5.0f };
+    g_check.Expect(cache.Update(a, sizeof(a)), "first upload");
+    g_check.Expect(!cache.Update(a, sizeof(a)), "same contents skipped");
+    g_check.Expect(cache.Update(b, sizeof(b)), "changed contents uploaded");
+    cache.Invalidate();
+    g_check.Expect(cache.Update(b, sizeof(b)), "upload after the buffer was recreated");
+    g_check.Expect(cache.GetUploads() == 3 && cache.GetSkipped() == 1, "upload counts");
+}
+
+struct RenderPlanVariant
+{
+    const char* name;
+    bool interpolate;
+    bool barSurfaces;
+};
+
+static const RenderPlanVariant g_renderPlanVariants[] =
+{
+    { "window", false, false },
+    { "interpolated", true, false },
+    { "bar_surfaces", false, true },
+};
+
+#define BENCH_PLAN_FRAMES        600
+#define BENCH_PLAN_CHANGES       2
+#define BENCH_PLAN_SURFACE_SCALE 2
+
+struct RenderPlanCounts
+{
+    uint64_t draws;
+    uint64_t updates;
+    uint64_t dispatches;
+    uint64_t skipped;
+};
+
+// The composite calls of one variant over bar changes, made the way AmbientLight::RenderEffects
+// makes them: GetCompositeDraws for the plan of the current bars, CompositeSubmitter for
+// each draw. The context counts the UpdateSubresource and Dispatch calls that reach D3D.
+static RenderPlanCounts CountRenderPlanCalls(const Scenario& s, const RenderPlanVariant& variant)
+{
+    const uint32_t aspects[BENCH_PLAN_CHANGES + 1][2] = { { s.aspectX, s.aspectY }, { 5, 4 }, { 4, 3 } };
+    CompositeSubmitter submitter;
+    BenchCompositeContext context;
+    RenderPlan plan = {};
+    SurfacePlan surfaces = {};
+    RenderPlanCounts counts = {};
+
+    for (uint32_t frame = 0; frame < BENCH_PLAN_FRAMES; frame++)
+    {
+        // UpdateSettings builds the plan and the bar surfaces when the bars change
+        uint32_t phase = frame * (BENCH_PLAN_CHANGES + 1) / BENCH_PLAN_FRAMES;
+        if (frame == 0 || phase != (frame - 1) * (BENCH_PLAN_CHANGES + 1) / BENCH_PLAN_FRAMES)
+        {
+            Scenario content = s;
+            content.aspectX = aspects[phase][0];
+            content.aspectY = aspects[phase][1];
+            DetectedBars detected;
+            plan = BuildRenderPlan(GetRenderPlanInputs(content, detected));
+            if (variant.barSurfaces)
+            {
+                SurfaceRect rects[2];
+                for (uint32_t i = 0; i < 2; i++)
+                {
+                    const CompositeBar& bar = plan.bars[i];
+                    rects[i] = { bar.targetX, bar.targetY, bar.targetX + bar.targetWidth, bar.targetY + bar.targetHeight };
+                }
+                surfaces = PlanBarSurfaces(rects, 2, BENCH_PLAN_SURFACE_SCALE, 4, 2);
+            }
+        }
+
+        // the blend moves every frame between the captures, at half the frame rate
+        CompositeInputs inputs = { nullptr, 0, s.displayWidth, s.displayHeight, true, true, variant.interpolate,
+            variant.interpolate ? (float)(frame % 2 + 1) / 2.0f : 1.0f };
+        CompositeDraw draws[COMPOSITE_MAX_SLOTS];
+        uint32_t drawCount = GetCompositeDraws(plan, surfaces.surfaces, variant.barSurfaces ? surfaces.count : 0, draws);
+        for (uint32_t i = 0; i < drawCount; i++)
+        {
+            submitter.Submit(context, draws[i].slot, draws[i].bars, draws[i].barCount, inputs);
+            counts.draws++;
+        }
+    }
+
+    counts.updates = context.updates;
+    counts.dispatches = context.dispatches;
+    counts.skipped = submitter.GetSkippedUploads();
+    return counts;
+}
+
+static void CheckCompositeDraws()
+{
+    DetectedBars detected;
+    RenderPlanInputs inputs = GetRenderPlanInputs(g_scenarios[0], detected);
+    RenderPlan plan = BuildRenderPlan(inputs);
+
+    CompositeDraw draws[COMPOSITE_MAX_SLOTS];
+    g_check.Expect(GetCompositeDraws(plan, nullptr, 0, draws) == 1 && draws[0].surface == COMPOSITE_WINDOW &&
+        draws[0].barCount == 2 && memcmp(draws[0].bars, plan.bars, sizeof(plan.bars)) == 0, "both bars into the window");
+
+    SurfaceRect rects[2];
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        const CompositeBar& bar = plan.bars[i];
+        rects[i] = { bar.targetX, bar.targetY, bar.targetX + bar.targetWidth, bar.targetY + bar.targetHeight };
+    }
+    SurfacePlan surfaces = PlanBarSurfaces(rects, 2, BENCH_PLAN_SURFACE_SCALE, 4, 2);
+    uint32_t drawCount = GetCompositeDraws(plan, surfaces.surfaces, surfaces.count, draws);
+    g_check.Expect(drawCount == 2, "a draw per bar surface");
+    for (uint32_t i = 0; i < drawCount; i++)
+    {
+        const PlannedSurface& surface = surfaces.surfaces[draws[i].surface];
+        g_check.Expect(draws[i].barCount == 1 && draws[i].slot == i && draws[i].bars[0].targetX == 0 &&
+            draws[i].bars[0].targetWidth == surface.width && draws[i].bars[0].targetHeight == surface.height,
+            "bar at the surface resolution");
+    }
+    RenderPlan none = {};
+    g_check.Expect(GetCompositeDraws(none, nullptr, 0, draws) == 0, "no draws without a plan");
+
+    // the constants as composite.hlsl reads them
+    CompositeSubmitter submitter;
+    BenchCompositeContext context;
+    UVRect mask = { 0.25f, 0.25f, 0.75f, 0.75f };
+    CompositeInputs compositeInputs = { &mask, 1, inputs.windowWidth, inputs.windowHeight, true, false, true, 0.5f };
+    submitter.Submit(context, 0, plan.bars, 2, compositeInputs);
+    const CompositeParameters& params = context.last;
+    const CompositeBar& bar = plan.bars[1];
+    g_check.Expect(params.barTarget[1][0] == (float)bar.targetX && params.barTarget[1][3] == (float)bar.targetHeight &&
+        params.barSource[1][2] == bar.sourceWidth && params.barWindow[1][1] == bar.windowY &&
+        params.barFlip[1][0] == (bar.flip == FlipHorizontal ? 1u : 0u) &&
+        params.barFlip[1][1] == (bar.flip == FlipVertical ? 1u : 0u), "bars packed");
+    g_check.Expect(params.maskCount == 1 && params.maskRects[0][2] == 0.75f && params.vignetteEnabled == 1 &&
+        params.lumaMaskEnabled == 0 && params.blendEnabled == 1 && params.blend == 0.5f &&
+        params.windowSize[0] == (float)inputs.windowWidth, "effects packed");
+    g_check.Expect(context.updates == 1 && context.dispatches == 1, "first draw uploads");
+    submitter.Submit(context, 0, plan.bars, 2, compositeInputs);
+    g_check.Expect(context.updates == 1 && context.dispatches == 2, "same constants not uploaded again");
+    submitter.Submit(context, 1, plan.bars, 2, compositeInputs);
+    g_check.Expect(context.updates == 2, "each slot has a buffer of its own");
+    submitter.Invalidate();
+    submitter.Submit(context, 0, plan.bars, 2, compositeInputs);
+    g_check.Expect(context.updates == 3, "upload after the buffers were recreated");
+    g_check.Expect(!submitter.Submit(context, COMPOSITE_MAX_SLOTS, plan.bars, 2, compositeInputs) &&
+        context.dispatches == 4, "slot out of range");
+}
+
+int RunRenderPlan(const BenchOptions& options)
+{
+    CheckRenderPlan();
+    CheckCompositeDraws();
+
+    // draws and dispatches match; without the constant cache every draw was an upload
+    printf("scenario,variant,frames,draws,dispatches,uploads,skipped_uploads\n");
+    for (const Scenario* scenario : SelectScenarios(options))
+    {
+        const Scenario& s = *scenario;
+        for (const RenderPlanVariant& variant : g_renderPlanVariants)
+        {
+            RenderPlanCounts counts = CountRenderPlanCalls(s, variant);
+            printf("%s,%s,%u,%llu,%llu,%llu,%llu\n", GetScenarioName(s).c_str(), variant.name,
+                BENCH_PLAN_FRAMES, (unsigned long long)counts.draws, (unsigned long long)counts.dispatches,
+                (unsigned long long)counts.updates, (unsigned long long)counts.skipped);
+
+            uint64_t drawsPerFrame = variant.barSurfaces ? 2 : 1;
+            g_check.Expect(counts.draws == BENCH_PLAN_FRAMES * drawsPerFrame && counts.dispatches == counts.draws,
+                "a dispatch per draw");
+            // with steady parameters only a change uploads, the blend of interpolation moves every frame
+            uint64_t uploads = variant.interpolate ? counts.draws : (uint64_t)(BENCH_PLAN_CHANGES + 1) * drawsPerFrame;
+            g_check.Expect(counts.updates == uploads, "uploads only for new constants");
+            g_check.Expect(counts.updates + counts.skipped == counts.draws, "every draw uploaded or skipped");
+        }
+    }
+
+    return g_check.Result();
+}
@@ -0,0 +1,194 @@
+#include "bench.h"
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+static BenchCheck g_check("resource registry");
+
+static void CheckResourceRegistry()
+{
+    const ResourceDesc canvas = { ResourceOwnerEffect, "canvas", 1920, 1080, ResourceFormatRGBA16Float, 1, 1, ResourceDowngradeNone };
+    const ResourceDesc mips = { ResourceOwnerEffect, "game", 1920, 1080, ResourceFormatBGRA8, 0, 1, ResourceDowngradeNone };
+    const ResourceDesc swapchain = { ResourceOwnerPresent, "swapchain", 1920, 1080, ResourceFormatBGRA8, 1, 2, ResourceDowngradeNone };
+    const ResourceDesc blur = { ResourceOwnerBlur, "blur temp", 64, 32, ResourceFormatRGBA16Float, 1, 1,
+        ResourceDowngradeMip | ResourceDowngradeFormat };
+
+    g_check.Expect(GetResourceBytes(canvas) == 1920ull * 1080 * 8, "bytes of a single mip");
+    g_check.Expect(GetMipChainLength(1920, 1080) == 11, "length of a full mip chain");
+    g_check.Expect(GetResourceBytes(mips) > 1920ull * 1080 * 4 && GetResourceBytes(mips) < 1920ull * 1080 * 4 * 4 / 3 + 64,
+        "bytes of a full mip chain");
+    g_check.Expect(GetResourceBytes(swapchain) == 1920ull * 1080 * 4 * 2, "bytes of every swapchain buffer");
+
+    // no budget, everything at the wanted quality
+    {
+        ResourceRegistry registry;
+        FakeAllocator allocator;
+        ResourceGrant grant = {};
+        ResourceId a = registry.Allocate(canvas, allocator, &grant);
+        ResourceId b = registry.Allocate(swapchain, allocator);
+        ResourceId c = registry.Allocate(blur, allocator);
+        g_check.Expect(a && b && c && a != b && b != c, "ids of allocated resources");
+        g_check.Expect(grant.desc == canvas && grant.mipShift == 0 && !grant.reducedFormat, "grant without a budget");
+        g_check.Expect(registry.GetTotalBytes() == GetResourceBytes(canvas) + GetResourceBytes(swapchain) + GetResourceBytes(blur),
+            "total of the allocated resources");
+        g_check.Expect(registry.GetOwnerBytes(ResourceOwnerEffect) == GetResourceBytes(canvas) &&
+            registry.GetOwnerBytes(ResourceOwnerPresent) == GetResourceBytes(swapchain) &&
+            registry.GetOwnerBytes(ResourceOwnerBlur) == GetResourceBytes(blur), "totals per owner");
+        g_check.Expect(registry.GetCount() == 3 && registry.GetDowngradedCount() == 0, "count without a budget");
+
+        registry.Release(b);
+        registry.Release(b);
+        g_check.Expect(!registry.Find(b) && registry.Find(a) && registry.GetCount() == 2, "release of a resource");
+        g_check.Expect(registry.GetOwnerBytes(ResourceOwnerPresent) == 0, "owner total after a release");
+        ResourceId d = registry.Allocate(swapchain, allocator);
+        g_check.Expect(d == b && registry.GetRecords().size() == 3, "reuse of a released id");
+
+        registry.Release(a);
+        registry.Release(c);
+        registry.Release(d);
+        g_check.Expect(registry.GetTotalBytes() == 0 && registry.GetCount() == 0, "total after releasing everything");
+    }
+
+    // over the budget the best quality that fits wins, lower precision before a smaller mip
+    {
+        ResourceRegistry registry;
+        FakeAllocator allocator;
+        registry.Allocate(canvas, allocator);
+        uint64_t blurBytes = GetResourceBytes(blur);
+
+        registry.SetBudget(GetResourceBytes(canvas) + blurBytes / 2);
+        ResourceGrant grant = {};
+        ResourceId reduced = registry.Allocate(blur, allocator, &grant);
+        g_check.Expect(reduced && grant.reducedFormat && grant.mipShift == 0 && grant.desc.format == ResourceFormatR11G11B10Float &&
+            grant.bytes == blurBytes / 2, "format downgrade first");
+        g_check.Expect(registry.GetDowngradedCount() == 1 && registry.GetSavedBytes() == blurBytes / 2, "downgraded count");
+        g_check.Expect(!registry.IsOverBudget(), "downgrade fits the budget");
+        registry.Release(reduced);
+        g_check.Expect(registry.GetDowngradedCount() == 0 && registry.GetSavedBytes() == 0, "downgraded count after a release");
+
+        registry.SetBudget(GetResourceBytes(canvas) + blurBytes / 4);
+        ResourceId shifted = registry.Allocate(blur, allocator, &grant);
+        g_check.Expect(shifted && grant.mipShift == 1 && !grant.reducedFormat && grant.desc.width == 32 && grant.desc.height == 16,
+            "mip downgrade next");
+        registry.Release(shifted);
+
+        // nothing fits, the smallest quality is allocated rather than failing
+        registry.SetBudget(GetResourceBytes(canvas));
+        ResourceId smallest = registry.Allocate(blur, allocator, &grant);
+        g_check.Expect(smallest && grant.mipShift == RESOURCE_MAX_MIP_SHIFT && grant.reducedFormat, "smallest quality over the budget");
+        g_check.Expect(registry.IsOverBudget(), "over budget reported");
+        registry.Release(smallest);
+
+        // resources that may not be downgraded keep their quality
+        ResourceId kept = registry.Allocate(canvas, allocator, &grant);
+        g_check.Expect(kept && grant.desc == canvas && registry.IsOverBudget(), "no downgrade without flags");
+    }
+
+    // allocator failures fall back to a lower quality, or fail without leaking a record
+    {
+        ResourceRegistry registry;
+        FakeAllocator allocator;
+        allocator.failAbove = GetResourceBytes(blur) / 4;
+        ResourceGrant grant = {};
+        ResourceId fallback = registry.Allocate(blur, allocator, &grant);
+        g_check.Expect(fallback && grant.mipShift == 1 && !grant.reducedFormat && allocator.calls == 3, "fallback after failures");
+
+        allocator.failAbove = 1;
+        g_check.Expect(registry.Allocate(canvas, allocator) == RESOURCE_ID_NONE, "failure without a downgrade");
+        g_check.Expect(registry.GetCount() == 1 && registry.GetTotalBytes() == grant.bytes, "no record of a failed allocation");
+    }
+}
+
+// The textures and swapchains the app allocates for a scenario, in the order it does,
+// see AmbientLight::Initialize and UpdateSettings. Returns the number that failed.
+static uint32_t AllocateAppResources(ResourceRegistry& registry, ResourceAllocator& allocator, const Scenario& s,
+    bool hdr, std::vector<ResourceId>& ids)
+{
+    uint32_t left, top, gameWidth, gameHeight;
+    GetGameBox(s, left, top, gameWidth, gameHeight);
+    ResourceFormat format = hdr ? ResourceFormatRGBA16Float : ResourceFormatBGRA8;
+    uint32_t mipWidth = std::max(1u, gameWidth >> BENCH_MIPMAP_LEVELS);
+    uint32_t mipHeight = std::max(1u, gameHeight >> BENCH_MIPMAP_LEVELS);
+    bool canDowngrade = BENCH_MIPMAP_LEVELS + RESOURCE_MAX_MIP_SHIFT < GetMipChainLength(gameWidth, gameHeight);
+
+    const ResourceDesc before[] =
+    {
+        { ResourceOwnerPresent, "swapchain", s.displayWidth, s.displayHeight, format, 1, BENCH_SWAPCHAIN_BUFFERS, ResourceDowngradeNone },
+        { ResourceOwnerMotion, "motion grid", BENCH_MOTION_GRID_WIDTH, BENCH_MOTION_GRID_HEIGHT, ResourceFormatR32Float, 1, 1, ResourceDowngradeNone },
+        { ResourceOwnerMotion, "motion staging", BENCH_MOTION_GRID_WIDTH, BENCH_MOTION_GRID_HEIGHT, ResourceFormatR32Float, 1, BENCH_MOTION_READBACK, ResourceDowngradeNone },
+        { ResourceOwnerEffect, "vignette mask", VignetteMap::SIZE, VignetteMap::SIZE, ResourceFormatR16Unorm, 1, 1, ResourceDowngradeNone },
+        { ResourceOwnerEffect, "game", gameWidth, gameHeight, format, 0, 1, ResourceDowngradeNone },
+        { ResourceOwnerEffect, "downsampled", mipWidth, mipHeight, format, 1, 1, canDowngrade ? ResourceDowngradeMip : ResourceDowngradeNone },
+    };
+
+    // the downsampled texture comes last, its grant sizes the blur temp
+    uint32_t failed = 0;
+    ResourceGrant downsampled = {};
+    for (const ResourceDesc& desc : before)
+    {
+        ResourceId id = registry.Allocate(desc, allocator, &downsampled);
+        failed += id == RESOURCE_ID_NONE;
+        ids.push_back(id);
+    }
+
+    const ResourceDesc after[] =
+    {
+        { ResourceOwnerEffect, "canvas", s.displayWidth, s.displayHeight, format, 1, 1, ResourceDowngradeNone },
+        { ResourceOwnerDetect, "luma", s.displayWidth, s.displayHeight, ResourceFormatR32Float, 1, 1, ResourceDowngradeNone },
+        { ResourceOwnerDetect, "luma staging", s.displayWidth, s.displayHeight, ResourceFormatR32Float, 1, 1, ResourceDowngradeNone },
+        { ResourceOwnerDetect, "luma", gameWidth, gameHeight, ResourceFormatR32Float, 1, 1, ResourceDowngradeNone },
+        { ResourceOwnerDetect, "luma staging", gameWidth, gameHeight, ResourceFormatR32Float, 1, 1, ResourceDowngradeNone },
+        // sized by the downsampled texture as it was granted
+        { ResourceOwnerBlur, "blur temp", downsampled.desc.width, downsampled.desc.height, format, 1, 1, ResourceDowngradeFormat },
+    };
+    for (const ResourceDesc& desc : after)
+    {
+        ResourceId id = registry.Allocate(desc, allocator);
+        failed += id == RESOURCE_ID_NONE;
+        ids.push_back(id);
+    }
+    return failed;
+}
+
+int RunMemory(const BenchOptions& options)
+{
+    CheckResourceRegistry();
+
+    printf("scenario,hdr,budget_mb,total_mb");
+    for (int i = 0; i < ResourceOwnerCount; i++)
+        printf(",%s_mb", ResourceOwnerName((ResourceOwner)i));
+    printf(",downgraded,saved_kb\n");
+
+    for (const Scenario* scenario : SelectScenarios(options))
+    {
+        const Scenario& s = *scenario;
+        for (int hdr = 0; hdr < 2; hdr++)
+        {
+            ResourceRegistry registry;
+            registry.SetBudget((uint64_t)options.budget * 1024 * 1024);
+            FakeAllocator allocator;
+            std::vector<ResourceId> ids;
+            g_check.Expect(AllocateAppResources(registry, allocator, s, hdr != 0, ids) == 0, "allocation of the app resources");
+
+            uint64_t ownerSum = 0;
+            for (int i = 0; i < ResourceOwnerCount; i++)
+                ownerSum += registry.GetOwnerBytes((ResourceOwner)i);
+            g_check.Expect(ownerSum == registry.GetTotalBytes(), "owner totals add up to the total");
+            if (options.budget == 0)
+                g_check.Expect(registry.GetDowngradedCount() == 0, "no downgrades without a budget");
+
+            printf("%s,%d,%u,%.1f", GetScenarioName(s).c_str(), hdr, options.budget, registry.GetTotalBytes() / (1024.0 * 1024.0));
+            for (int i = 0; i < ResourceOwnerCount; i++)
+                printf(",%.1f", registry.GetOwnerBytes((ResourceOwner)i) / (1024.0 * 1024.0));
+            printf(",%u,%.1f\n", registry.GetDowngradedCount(), registry.GetSavedBytes() / 1024.0);
+
+            for (ResourceId id : ids)
+                registry.Release(id);
+            g_check.Expect(registry.GetTotalBytes() == 0 && registry.GetCount() == 0, "total after releasing the app resources");
+        }
+    }
+
+    return g_check.Result();
+}
+
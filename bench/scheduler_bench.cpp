@@ -0,0 +1,246 @@
+#include "bench.h"
+
+#include "../framepacer.h"
+#include "../scheduler.h"
+
+#include <algorithm>
+#include <deque>
+
+static BenchCheck g_check("scheduler");
+
+#define BENCH_MS                     1000000LL
+#define BENCH_LOOP_FRAME_RATE        60
+// the app's idle interval without auto detection, see AmbientLight::UpdateSettings
+#define BENCH_LOOP_IDLE_INTERVAL     (1000 * BENCH_MS)
+// CPU time of an active frame, of a periodic detection pass and of a message
+#define BENCH_LOOP_FRAME_COST        (3 * BENCH_MS)
+#define BENCH_LOOP_POLL_COST         (2 * BENCH_MS)
+#define BENCH_LOOP_MESSAGE_COST      (BENCH_MS / 20)
+
+// One simulated run of the message loop: a script of messages, config file edits and of
+// the times there is something to draw, AmbientLight::Render and GetWaitTimeout on a mock clock.
+class SimulatedLoop : public MessageLoopHost
+{
+public:
+    SimulatedLoop(int64_t duration) :
+        m_duration(duration), m_pacer(m_clock), m_activeFrom(0), m_activeTo(0),
+        m_frames(0), m_polls(0), m_messages(0), m_waits(0), m_settingsReads(0), m_maxSettingsDelay(0)
+    {
+        m_scheduler.SetIdleInterval(BENCH_LOOP_IDLE_INTERVAL);
+        m_pacer.SetFrameRate(BENCH_LOOP_FRAME_RATE);
+    }
+
+    // a message every interval between from and to
+    void AddMessages(int64_t from, int64_t to, int64_t interval)
+    {
+        for (int64_t t = from; t < to; t += interval)
+            m_queue.push_back(t);
+    }
+
+    // the config file is edited every interval between from and to
+    void AddSettingsEdits(int64_t from, int64_t to, int64_t interval)
+    {
+        for (int64_t t = from; t < to; t += interval)
+            m_edits.push_back(t);
+    }
+
+    // there is something to draw between from and to
+    void SetActive(int64_t from, int64_t to)
+    {
+        m_activeFrom = from;
+        m_activeTo = to;
+    }
+
+    bool HandleMessage() override
+    {
+        if (m_queue.empty() || m_queue.front() > m_clock.Now())
+            return false;
+        m_queue.pop_front();
+        m_clock.Advance(BENCH_LOOP_MESSAGE_COST);
+        m_messages++;
+        return true;
+    }
+
+    bool IsQuitting() override { return m_clock.Now() >= m_duration; }
+
+    uint32_t GetWaitTimeout() override
+    {
+        int64_t now = m_clock.Now();
+        m_scheduler.SetActive(IsActive(now), now);
+        return (uint32_t)((m_scheduler.GetWaitTime(now) + BENCH_MS - 1) / BENCH_MS);
+    }
+
+    // the settings-changed event, signaled from the first edit until the settings are read
+    uint32_t GetWaitHandles(void** handles) override
+    {
+        handles[0] = &m_edits;
+        return 1;
+    }
+
+    uint32_t WaitForMessage(uint32_t timeout, void* const*, uint32_t handleCount) override
+    {
+        m_waits++;
+        int64_t until = m_clock.Now() + timeout * BENCH_MS;
+        bool edit = !m_edits.empty() && m_edits.front() <= until;
+        bool message = !m_queue.empty() && m_queue.front() <= until;
+        if (edit && (!message || m_edits.front() <= m_queue.front()))
+        {
+            m_clock.WaitUntil(m_edits.front());
+            return 0;
+        }
+        if (message)
+        {
+            m_clock.WaitUntil(m_queue.front());
+            return handleCount;
+        }
+        m_clock.WaitUntil(until);
+        return MESSAGE_LOOP_TIMEOUT;
+    }
+
+    void HandleSignal(uint32_t) override { ReadSettings(); }
+
+    void Render() override
+    {
+        int64_t now = m_clock.Now();
+        m_scheduler.SetActive(IsActive(now), now);
+        if (!m_scheduler.IsActive())
+        {
+            if (m_scheduler.Tick(now))
+            {
+                m_clock.Advance(BENCH_LOOP_POLL_COST);
+                m_polls++;
+                ReadSettings();
+            }
+            m_pacer.Reset();
+            return;
+        }
+        m_scheduler.Tick(now);
+        m_clock.Advance(BENCH_LOOP_FRAME_COST);
+        m_frames++;
+        ReadSettings();
+        m_pacer.Wait();
+    }
+
+    LoopSchedulerStats GetStats() { return m_scheduler.GetStats(m_clock.Now()); }
+    uint64_t GetFrames() const { return m_frames; }
+    uint64_t GetPolls() const { return m_polls; }
+    uint64_t GetMessages() const { return m_messages; }
+    uint64_t GetMissed() const { return m_pacer.GetStats().missed; }
+    // the thread woke from a wait for messages or from the frame pacer
+    uint64_t GetThreadWakeups() const { return m_waits + m_pacer.GetStats().wakeups; }
+    // edits applied, and the longest an edit waited for it
+    uint64_t GetSettingsReads() const { return m_settingsReads; }
+    int64_t GetMaxSettingsDelay() const { return m_maxSettingsDelay; }
+
+private:
+    bool IsActive(int64_t now) const { return now >= m_activeFrom && now < m_activeTo; }
+
+    // ReadSettings, takes the edits made so far and resets the event
+    void ReadSettings()
+    {
+        int64_t now = m_clock.Now();
+        while (!m_edits.empty() && m_edits.front() <= now)
+        {
+            m_maxSettingsDelay = std::max(m_maxSettingsDelay, now - m_edits.front());
+            m_edits.pop_front();
+            m_settingsReads++;
+        }
+    }
+
+    int64_t m_duration;
+    MockFrameClock m_clock;
+    LoopScheduler m_scheduler;
+    FramePacer m_pacer;
+    std::deque<int64_t> m_queue;
+    int64_t m_activeFrom;
+    int64_t m_activeTo;
+    uint64_t m_frames;
+    uint64_t m_polls;
+    uint64_t m_messages;
+    uint64_t m_waits;
+    std::deque<int64_t> m_edits;
+    uint64_t m_settingsReads;
+    int64_t m_maxSettingsDelay;
+};
+
+struct LoopCase
+{
+    const char* name;
+    // seconds of the run, then what is active and when messages arrive, in ms
+    int64_t duration;
+    int64_t activeFrom;
+    int64_t activeTo;
+    int64_t messagesFrom;
+    int64_t messagesTo;
+    int64_t messageInterval;
+    // config file edits from the start of the run, 0 for none
+    int64_t editInterval;
+};
+
+static const LoopCase g_loopCases[] =
+{
+    { "idle", 10, 0, 0, 0, 0, 0, 0 },
+    { "idle_mouse", 10, 0, 0, 0, 10000, 1, 0 },
+    { "idle_notifications", 10, 0, 0, 0, 10000, 250, 0 },
+    { "idle_settings", 10, 0, 0, 0, 0, 0, 1300 },
+    { "active", 10, 0, 10000, 0, 0, 0, 0 },
+    { "active_mouse", 10, 0, 10000, 0, 9900, 1, 0 },
+    { "active_settings", 10, 0, 10000, 0, 0, 0, 1300 },
+    { "active_then_idle", 10, 0, 5000, 0, 0, 0, 0 },
+    { "idle_then_active_mouse", 10, 5000, 10000, 2000, 8000, 1, 0 },
+};
+
+int RunScheduler(const BenchOptions&)
+{
+    // loop wakeups are the renders the scheduler counts, thread wakeups include every message
+    printf("case,seconds,frames,missed,polls,messages,loop_wakeups_per_second,thread_wakeups_per_second,"
+        "settings_edits,settings_max_delay_ms\n");
+    for (const LoopCase& c : g_loopCases)
+    {
+        SimulatedLoop loop(c.duration * 1000 * BENCH_MS);
+        loop.SetActive(c.activeFrom * BENCH_MS, c.activeTo * BENCH_MS);
+        if (c.messageInterval > 0)
+            loop.AddMessages(c.messagesFrom * BENCH_MS, c.messagesTo * BENCH_MS, c.messageInterval * BENCH_MS);
+        if (c.editInterval > 0)
+            loop.AddSettingsEdits(0, c.duration * 1000 * BENCH_MS, c.editInterval * BENCH_MS);
+        RunMessageLoop(loop);
+
+        LoopSchedulerStats stats = loop.GetStats();
+        printf("%s,%lld,%llu,%llu,%llu,%llu,%.1f,%.1f,%llu,%.3f\n", c.name, (long long)c.duration,
+            (unsigned long long)loop.GetFrames(), (unsigned long long)loop.GetMissed(),
+            (unsigned long long)loop.GetPolls(), (unsigned long long)loop.GetMessages(), stats.wakeupsPerSecond,
+            (double)loop.GetThreadWakeups() / c.duration, (unsigned long long)loop.GetSettingsReads(),
+            (double)loop.GetMaxSettingsDelay() / BENCH_MS);
+
+        // every active frame on the pacer's grid, messages or not
+        double activeSeconds = (double)(c.activeTo - c.activeFrom) / 1000.0;
+        uint64_t expectedFrames = (uint64_t)(activeSeconds * BENCH_LOOP_FRAME_RATE);
+        g_check.Expect(loop.GetFrames() + 1 >= expectedFrames && loop.GetFrames() <= expectedFrames + 1,
+            "frames rendered on schedule");
+        g_check.Expect(loop.GetMissed() == 0, "no missed frames");
+
+        // the periodic work runs once per idle interval, messages or not
+        double idleSeconds = (double)c.duration - activeSeconds;
+        uint64_t expectedPolls = (uint64_t)(idleSeconds * 1e9 / BENCH_LOOP_IDLE_INTERVAL);
+        g_check.Expect(loop.GetPolls() + 1 >= expectedPolls && loop.GetPolls() <= expectedPolls + 1,
+            "periodic work on schedule");
+
+        // idle and without messages the loop only wakes for the periodic work
+        if (c.activeTo == c.activeFrom && c.messageInterval == 0)
+            g_check.Expect(stats.wakeupsPerSecond <= 1e9 / BENCH_LOOP_IDLE_INTERVAL + 0.01, "idle wakeups");
+        // every message is handled
+        if (c.messageInterval > 0)
+            g_check.Expect(loop.GetMessages() == (uint64_t)((c.messagesTo - c.messagesFrom) / c.messageInterval),
+                "messages handled");
+        // an edit is applied when it is made, or by the next frame, not at the next idle wakeup
+        if (c.editInterval > 0)
+        {
+            g_check.Expect(loop.GetSettingsReads() == (uint64_t)((c.duration * 1000 + c.editInterval - 1) / c.editInterval),
+                "settings edits applied");
+            g_check.Expect(loop.GetMaxSettingsDelay() <= 1000 * BENCH_MS / BENCH_LOOP_FRAME_RATE + BENCH_LOOP_FRAME_COST,
+                "settings applied without waiting for the idle wakeup");
+        }
+    }
+
+    return g_check.Result();
+}
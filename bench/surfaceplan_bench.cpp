@@ -0,0 +1,125 @@
+#include "bench.h"
+
+#include "../surfaceplan.h"
+
+#include <cmath>
+
+static BenchCheck g_check("surface plan");
+
+// bytes per pixel of the SDR and HDR swapchains
+#define BENCH_SURFACE_BYTES_SDR      4
+#define BENCH_SURFACE_BYTES_HDR      8
+
+// the surface stretched back by the compositor covers its bar exactly
+static bool CoversWindow(const PlannedSurface& surface)
+{
+    float width = (float)(surface.window.right - surface.window.left);
+    float height = (float)(surface.window.bottom - surface.window.top);
+    return std::fabs(surface.width * surface.scaleX - width) < 1e-3f &&
+        std::fabs(surface.height * surface.scaleY - height) < 1e-3f;
+}
+
+static void CheckOddSizes()
+{
+    // pillarbox bars of 16:9 on 21:9 with an odd window, and a letterbox bar
+    SurfaceRect bars[2] = { { 0, 0, 321, 1081 }, { 2241, 0, 2562, 1081 } };
+    SurfacePlan plan = PlanBarSurfaces(bars, 2, 2, BENCH_SURFACE_BYTES_SDR, BENCH_SWAPCHAIN_BUFFERS);
+    g_check.Expect(plan.count == 2, "one surface per bar");
+    g_check.Expect(plan.surfaces[0].width == 161 && plan.surfaces[0].height == 541, "odd size rounded up");
+    g_check.Expect(plan.surfaces[1].window.left == 2241 && plan.surfaces[1].window.right == 2562, "surface keeps its bar");
+    g_check.Expect(CoversWindow(plan.surfaces[0]) && CoversWindow(plan.surfaces[1]), "odd surfaces cover their bars");
+    g_check.Expect(plan.pixelsPerFrame == 2ull * 161 * 541, "pixels per frame");
+    g_check.Expect(plan.bytes == plan.pixelsPerFrame * BENCH_SURFACE_BYTES_SDR * BENCH_SWAPCHAIN_BUFFERS, "bytes of every buffer");
+
+    SurfaceRect letterbox = { 0, 0, 1000, 7 };
+    plan = PlanBarSurfaces(&letterbox, 1, 3, BENCH_SURFACE_BYTES_HDR, BENCH_SWAPCHAIN_BUFFERS);
+    g_check.Expect(plan.surfaces[0].width == 334 && plan.surfaces[0].height == 3, "thin bar rounded up");
+    g_check.Expect(CoversWindow(plan.surfaces[0]), "thin surface covers its bar");
+    g_check.Expect(plan.bytes == 334ull * 3 * BENCH_SURFACE_BYTES_HDR * BENCH_SWAPCHAIN_BUFFERS, "HDR bytes");
+}
+
+static void CheckScaleClamping()
+{
+    SurfaceRect bar = { 0, 0, 640, 1440 };
+    SurfacePlan one = PlanBarSurfaces(&bar, 1, 1, BENCH_SURFACE_BYTES_SDR, BENCH_SWAPCHAIN_BUFFERS);
+    SurfacePlan zero = PlanBarSurfaces(&bar, 1, 0, BENCH_SURFACE_BYTES_SDR, BENCH_SWAPCHAIN_BUFFERS);
+    g_check.Expect(one.surfaces[0].width == 640 && one.surfaces[0].height == 1440 &&
+        one.surfaces[0].scaleX == 1.0f && one.surfaces[0].scaleY == 1.0f, "no downscale keeps the bar size");
+    g_check.Expect(zero.surfaces[0].width == 640 && zero.surfaces[0].height == 1440 && zero.bytes == one.bytes,
+        "a downscale of 0 is taken as 1");
+
+    // the largest downscale the settings allow, and one past the bar
+    SurfacePlan eight = PlanBarSurfaces(&bar, 1, 8, BENCH_SURFACE_BYTES_SDR, BENCH_SWAPCHAIN_BUFFERS);
+    g_check.Expect(eight.surfaces[0].width == 80 && eight.surfaces[0].height == 180 &&
+        eight.surfaces[0].scaleX == 8.0f, "downscale by 8");
+    g_check.Expect(eight.bytes * 64 == one.bytes, "memory falls with the square of the downscale");
+    SurfacePlan past = PlanBarSurfaces(&bar, 1, 100000, BENCH_SURFACE_BYTES_SDR, BENCH_SWAPCHAIN_BUFFERS);
+    g_check.Expect(past.surfaces[0].width == 1 && past.surfaces[0].height == 1, "at least one pixel");
+    g_check.Expect(CoversWindow(past.surfaces[0]), "one pixel stretched over the bar");
+}
+
+static void CheckEdgeCases()
+{
+    // no bars, or only empty ones: no surfaces and no memory
+    SurfacePlan none = PlanBarSurfaces(nullptr, 0, 1, BENCH_SURFACE_BYTES_SDR, BENCH_SWAPCHAIN_BUFFERS);
+    g_check.Expect(none.count == 0 && none.bytes == 0 && none.pixelsPerFrame == 0, "no bars, no surfaces");
+    SurfaceRect empty[2] = { { 0, 0, 0, 1440 }, { 5120, 0, 5120, 1440 } };
+    SurfacePlan zero = PlanBarSurfaces(empty, 2, 1, BENCH_SURFACE_BYTES_SDR, BENCH_SWAPCHAIN_BUFFERS);
+    g_check.Expect(zero.count == 0 && zero.bytes == 0, "zero width bars are skipped");
+    SurfaceRect one[2] = { { 0, 0, 5120, 0 }, { 0, 1300, 5120, 1440 } };
+    SurfacePlan single = PlanBarSurfaces(one, 2, 1, BENCH_SURFACE_BYTES_SDR, BENCH_SWAPCHAIN_BUFFERS);
+    g_check.Expect(single.count == 1 && single.surfaces[0].window.top == 1300, "only the non-empty bar");
+
+    // a bar over the whole window is the window surface
+    SurfaceRect full = { 0, 0, 5120, 1440 };
+    SurfacePlan bar = PlanBarSurfaces(&full, 1, 1, BENCH_SURFACE_BYTES_SDR, BENCH_SWAPCHAIN_BUFFERS);
+    SurfacePlan window = PlanWindowSurface(5120, 1440, BENCH_SURFACE_BYTES_SDR, BENCH_SWAPCHAIN_BUFFERS);
+    g_check.Expect(bar.count == 1 && window.count == 1 && bar.bytes == window.bytes &&
+        bar.pixelsPerFrame == window.pixelsPerFrame && bar.surfaces[0].width == window.surfaces[0].width &&
+        bar.surfaces[0].height == window.surfaces[0].height, "full screen bar matches the window surface");
+    g_check.Expect(PlanWindowSurface(0, 1440, BENCH_SURFACE_BYTES_SDR, BENCH_SWAPCHAIN_BUFFERS).count == 0,
+        "no window surface for an empty window");
+
+    // no more surfaces than the plan holds
+    SurfaceRect three[3] = { { 0, 0, 100, 100 }, { 100, 0, 200, 100 }, { 200, 0, 300, 100 } };
+    SurfacePlan capped = PlanBarSurfaces(three, 3, 1, BENCH_SURFACE_BYTES_SDR, BENCH_SWAPCHAIN_BUFFERS);
+    g_check.Expect(capped.count == SurfacePlan::MAX_SURFACES, "surfaces capped");
+}
+
+int RunSurfaces(const BenchOptions& options)
+{
+    CheckOddSizes();
+    CheckScaleClamping();
+    CheckEdgeCases();
+
+    // memory of the bar surfaces against the window surface for every scenario
+    printf("scenario,downscale,surfaces,bar_bytes,window_bytes\n");
+    for (const Scenario* scenario : SelectScenarios(options))
+    {
+        const Scenario& s = *scenario;
+        uint32_t left, top, width, height;
+        GetGameBox(s, left, top, width, height);
+        SurfaceRect bars[2];
+        if (left > 0)
+        {
+            bars[0] = { 0, 0, left, s.displayHeight };
+            bars[1] = { s.displayWidth - left, 0, s.displayWidth, s.displayHeight };
+        }
+        else
+        {
+            bars[0] = { 0, 0, s.displayWidth, top };
+            bars[1] = { 0, s.displayHeight - top, s.displayWidth, s.displayHeight };
+        }
+        SurfacePlan window = PlanWindowSurface(s.displayWidth, s.displayHeight, BENCH_SURFACE_BYTES_SDR, BENCH_SWAPCHAIN_BUFFERS);
+        for (uint32_t downscale = 1; downscale <= 4; downscale *= 2)
+        {
+            SurfacePlan plan = PlanBarSurfaces(bars, 2, downscale, BENCH_SURFACE_BYTES_SDR, BENCH_SWAPCHAIN_BUFFERS);
+            printf("%s,%u,%u,%llu,%llu\n", GetScenarioName(s).c_str(), downscale, plan.count,
+                (unsigned long long)plan.bytes, (unsigned long long)window.bytes);
+            g_check.Expect(plan.count == 2 && plan.bytes < window.bytes, "bar surfaces use less memory than the window");
+            g_check.Expect(CoversWindow(plan.surfaces[0]) && CoversWindow(plan.surfaces[1]), "surfaces cover the bars");
+        }
+    }
+
+    return g_check.Result();
+}
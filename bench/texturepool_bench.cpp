@@ -0,0 +1,222 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <vector>
+
+uint64_t MockPoolDevice::Create(const TexturePoolKey& key, PoolEntryId id)
+{
+    uint64_t size = GetResourceBytes(key.desc);
+    if (failAbove > 0 && size > failAbove)
+        return 0;
+    if (bytes.size() < id)
+        bytes.resize(id);
+    bytes[id - 1] = size;
+    if (commit)
+    {
+        if (memory.size() < id)
+            memory.resize(id);
+        memory[id - 1].assign(size, 0);
+    }
+    creates++;
+    createdBytes += size;
+    liveBytes += size;
+    peakBytes = std::max(peakBytes, liveBytes);
+    return size;
+}
+
+void MockPoolDevice::Destroy(PoolEntryId id)
+{
+    destroys++;
+    liveBytes -= bytes[id - 1];
+    bytes[id - 1] = 0;
+    if (id <= memory.size())
+        std::vector<uint8_t>().swap(memory[id - 1]);
+}
+
+static BenchCheck g_check("texture pool");
+
+static TexturePoolKey PoolKey(uint32_t width, uint32_t height, uint32_t mipLevels = 1,
+    uint32_t downgrades = ResourceDowngradeNone, uint64_t budget = 0)
+{
+    TexturePoolKey key = {};
+    key.desc = { ResourceOwnerEffect, "texture", width, height, ResourceFormatBGRA8, mipLevels, 1, downgrades };
+    key.nativeFormat = BENCH_FORMAT_SDR;
+    key.flags = mipLevels == 0 ? TexturePoolGenerateMips : TexturePoolNone;
+    key.budget = budget;
+    return key;
+}
+
+static void CheckTexturePool()
+{
+    const TexturePoolKey wide = PoolKey(2560, 1080);
+    const TexturePoolKey narrow = PoolKey(1920, 1080);
+    const uint64_t wideBytes = GetResourceBytes(wide.desc);
+    const uint64_t narrowBytes = GetResourceBytes(narrow.desc);
+
+    // a released texture is handed out again for the same key only
+    {
+        TexturePool pool;
+        MockPoolDevice device;
+        pool.SetCap(wideBytes + narrowBytes);
+        PoolEntryId a = pool.Acquire(wide, device);
+        pool.Release(a, device);
+        g_check.Expect(pool.GetStats().idle == 1 && pool.GetStats().idleBytes == wideBytes, "released texture kept");
+        PoolEntryId b = pool.Acquire(narrow, device);
+        g_check.Expect(b != a && device.creates == 2, "other size created");
+        PoolEntryId c = pool.Acquire(wide, device);
+        g_check.Expect(c == a && device.creates == 2 && pool.GetStats().hits == 1, "same size reused");
+        PoolEntryId d = pool.Acquire(wide, device);
+        g_check.Expect(d != a && device.creates == 3, "leased texture not handed out twice");
+        g_check.Expect(pool.Find(a) && *pool.Find(a) == wide, "key of a leased texture");
+
+        TexturePoolKey renamed = wide;
+        renamed.desc.name = "other";
+        renamed.desc.owner = ResourceOwnerBlur;
+        pool.Release(d, device);
+        g_check.Expect(pool.Acquire(renamed, device) != d, "owner is part of the key");
+        TexturePoolKey mips = PoolKey(2560, 1080, 0);
+        g_check.Expect(pool.FindIdle(mips) == POOL_ENTRY_NONE, "mip chain is part of the key");
+    }
+
+    // idle textures over the cap go, least recently used first
+    {
+        TexturePool pool;
+        MockPoolDevice device;
+        pool.SetCap(narrowBytes * 2);
+        PoolEntryId a = pool.Acquire(narrow, device);
+        PoolEntryId b = pool.Acquire(narrow, device);
+        PoolEntryId c = pool.Acquire(narrow, device);
+        pool.Release(b, device);
+        pool.Release(a, device);
+        pool.Release(c, device);
+        g_check.Expect(pool.GetStats().idle == 2 && pool.GetStats().evictions == 1 && !pool.Find(b), "oldest idle evicted");
+        g_check.Expect(pool.FindIdle(narrow) == c, "most recently used handed out first");
+        g_check.Expect(pool.EvictOldest(device) && !pool.Find(a) && pool.Find(c), "eviction order");
+
+        pool.SetCap(0);
+        pool.Trim(device);
+        g_check.Expect(pool.GetStats().idle == 0 && device.liveBytes == 0, "nothing kept without a cap");
+    }
+
+    // downgradable textures are only reused under the budget they were allocated for
+    {
+        TexturePool pool;
+        MockPoolDevice device;
+        pool.SetCap(wideBytes);
+        PoolEntryId a = pool.Acquire(PoolKey(640, 270, 1, ResourceDowngradeMip, 0), device);
+        pool.Release(a, device);
+        g_check.Expect(pool.FindIdle(PoolKey(640, 270, 1, ResourceDowngradeMip, 1 << 20)) == POOL_ENTRY_NONE, "budget of a downgradable texture");
+        g_check.Expect(pool.FindIdle(PoolKey(640, 270, 1, ResourceDowngradeMip, 0)) == a, "same budget reused");
+        PoolEntryId b = pool.Acquire(PoolKey(640, 270), device);
+        pool.Release(b, device);
+        g_check.Expect(pool.FindIdle(PoolKey(640, 270, 1, ResourceDowngradeNone, 1 << 20)) == b, "budget ignored without downgrades");
+    }
+
+    // a new device drops the idle textures, the leased ones go when they come back
+    {
+        TexturePool pool;
+        MockPoolDevice device;
+        pool.SetCap(wideBytes * 4);
+        PoolEntryId a = pool.Acquire(wide, device);
+        PoolEntryId b = pool.Acquire(wide, device);
+        pool.Release(a, device);
+        pool.Clear(device);
+        g_check.Expect(pool.GetStats().idle == 0 && pool.GetStats().leased == 1 && device.destroys == 1, "idle textures cleared");
+        pool.Release(b, device);
+        g_check.Expect(pool.GetStats().idle == 0 && device.liveBytes == 0, "orphaned texture destroyed on release");
+    }
+
+    // a failed creation leaves nothing behind
+    {
+        TexturePool pool;
+        MockPoolDevice device;
+        device.failAbove = narrowBytes;
+        g_check.Expect(pool.Acquire(wide, device) == POOL_ENTRY_NONE, "failed creation");
+        g_check.Expect(pool.GetStats().leased == 0 && pool.GetStats().misses == 1, "no entry for a failed creation");
+        g_check.Expect(pool.Acquire(narrow, device) == 1, "entry reused after a failure");
+    }
+}
+
+// The textures UpdateSettings recreates for the content on a display, see
+// AmbientLight::CreateOffscreen and Blur::Render.
+static void GetContentKeys(const Scenario& s, TexturePoolKey* keys)
+{
+    uint32_t left, top, gameWidth, gameHeight;
+    GetGameBox(s, left, top, gameWidth, gameHeight);
+    uint32_t mipWidth = std::max(1u, gameWidth >> BENCH_MIPMAP_LEVELS);
+    uint32_t mipHeight = std::max(1u, gameHeight >> BENCH_MIPMAP_LEVELS);
+    keys[0] = PoolKey(gameWidth, gameHeight, 0);
+    keys[1] = PoolKey(mipWidth, mipHeight, 1, ResourceDowngradeMip);
+    keys[2] = PoolKey(mipWidth, mipHeight, 1, ResourceDowngradeFormat);
+    keys[2].desc.owner = ResourceOwnerBlur;
+}
+
+#define BENCH_POOL_KEYS      3
+#define BENCH_POOL_CHANGES   30
+
+int RunPool(const BenchOptions& options)
+{
+    CheckTexturePool();
+
+    // content switching between the common aspect ratios, as a playlist of trailers does
+    const uint32_t aspects[][2] = { { 16, 9 }, { 64, 27 }, { 239, 100 } };
+
+    printf("scenario,pool_mb,changes,creates,created_mb,hits,evictions,peak_mb,us_per_change\n");
+    for (const Scenario* scenario : SelectScenarios(options))
+    {
+        const Scenario& s = *scenario;
+        uint32_t creates[2] = {};
+        for (uint32_t pass = 0; pass < 2; pass++)
+        {
+            // without a pool first, the way textures were recreated before
+            uint64_t cap = pass == 0 ? 0 : (uint64_t)options.poolSize * 1024 * 1024;
+            TexturePool pool;
+            MockPoolDevice device;
+            pool.SetCap(cap);
+
+            PoolEntryId leased[BENCH_POOL_KEYS] = {};
+            auto start = BenchClock::now();
+            for (uint32_t change = 0; change < BENCH_POOL_CHANGES; change++)
+            {
+                Scenario content = s;
+                content.aspectX = aspects[change % 3][0];
+                content.aspectY = aspects[change % 3][1];
+                TexturePoolKey keys[BENCH_POOL_KEYS];
+                GetContentKeys(content, keys);
+                for (uint32_t i = 0; i < BENCH_POOL_KEYS; i++)
+                {
+                    // the old texture goes back after the new one is leased, as in RecreateTexture
+                    PoolEntryId previous = leased[i];
+                    leased[i] = pool.Acquire(keys[i], device);
+                    pool.Release(previous, device);
+                    if (leased[i] == POOL_ENTRY_NONE)
+                        g_check.Expect(false, "allocation of the content textures");
+                }
+            }
+            double us = ElapsedMs(start) * 1000.0 / BENCH_POOL_CHANGES;
+
+            TexturePoolStats stats = pool.GetStats();
+            g_check.Expect(stats.idleBytes <= cap, "idle textures within the cap");
+            creates[pass] = device.creates;
+            printf("%s,%llu,%u,%u,%.1f,%llu,%llu,%.1f,%.2f\n", GetScenarioName(s).c_str(),
+                (unsigned long long)(cap / (1024 * 1024)), BENCH_POOL_CHANGES, device.creates,
+                device.createdBytes / (1024.0 * 1024.0), (unsigned long long)stats.hits, (unsigned long long)stats.evictions,
+                device.peakBytes / (1024.0 * 1024.0), us);
+
+            for (PoolEntryId id : leased)
+                pool.Release(id, device);
+            pool.SetCap(0);
+            pool.Trim(device);
+            g_check.Expect(device.liveBytes == 0 && stats.leased == BENCH_POOL_KEYS, "everything released");
+        }
+
+        // without a pool every change creates every texture, with the default size each
+        // aspect ratio is created once
+        g_check.Expect(creates[0] == BENCH_POOL_KEYS * BENCH_POOL_CHANGES, "every change creates without a pool");
+        if (options.poolSize >= BENCH_TEXTURE_POOL_SIZE)
+            g_check.Expect(creates[1] <= BENCH_POOL_KEYS * 3, "aspect ratio changes reuse the pooled textures");
+    }
+
+    return g_check.Result();
+}
+
@@ -0,0 +1,184 @@
+#include "bench.h"
+
+#include "../benchstats.h"
+#include "../trace.h"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+static BenchCheck g_check("trace");
+
+// events AmbientLight::Render records per frame: begin and end of the frame, capture,
+// render, detect, copy, mips, blur, composite, sleep and present timers, and the rate
+#define BENCH_TRACE_EVENTS_PER_FRAME 21
+// largest share of the frame time tracing may take, at the highest frame rate the
+// pacer runs, the GPU frames of the app are far shorter than the CPU reference ones
+#define BENCH_TRACE_MAX_OVERHEAD     0.01
+#define BENCH_TRACE_FRAME_RATE       240
+
+std::filesystem::path MakeTempDirectory(const char* name)
+{
+#ifdef _WIN32
+    unsigned long pid = GetCurrentProcessId();
+#else
+    unsigned long pid = (unsigned long)getpid();
+#endif
+    std::filesystem::path directory = std::filesystem::temp_directory_path() /
+        (std::string("ambientlight_") + name + "_" + std::to_string(pid));
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    std::filesystem::create_directories(directory, error);
+    return directory;
+}
+
+#ifdef AMBIENTLIGHT_TRACE
+
+static std::string ReadText(const std::filesystem::path& path)
+{
+    std::ifstream is(path, std::ios::binary);
+    std::stringstream text;
+    text << is.rdbuf();
+    return text.str();
+}
+
+static size_t Count(const std::string& text, const std::string& what)
+{
+    size_t count = 0;
+    for (size_t at = text.find(what); at != std::string::npos; at = text.find(what, at + what.size()))
+        count++;
+    return count;
+}
+
+// the dump holds the events of every thread, annotated, and only the last ring of each
+static void CheckDump()
+{
+    TRACE_SET_FRAME(7);
+    {
+        TRACE_SCOPE("bench_scope");
+        TRACE_COUNTER("bench_counter", 42);
+        TRACE_INSTANT("bench_bars", { "left", 320 }, { "right", 320 });
+    }
+    std::thread other([]()
+    {
+        // more than a ring from one thread
+        for (uint32_t i = 0; i < TRACE_BUFFER_EVENTS + 100; i++)
+            TRACE_COUNTER("bench_ring", i);
+    });
+    other.join();
+
+    std::filesystem::path directory = MakeTempDirectory("trace");
+    std::filesystem::path path = directory / "trace.json";
+    g_check.Expect(TRACE_DUMP(path.c_str()), "dump written");
+    std::string text = ReadText(path);
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+
+    g_check.Expect(text.rfind("{\"traceEvents\":[", 0) == 0 && text.find("\n]}\n") != std::string::npos, "trace event format");
+    g_check.Expect(Count(text, "\"name\":\"bench_scope\",\"ph\":\"B\"") == 1 &&
+        Count(text, "\"name\":\"bench_scope\",\"ph\":\"E\"") == 1, "scope begin and end");
+    g_check.Expect(text.find("\"args\":{\"bench_counter\":42}") != std::string::npos, "counter value");
+    g_check.Expect(text.find("\"frame\":7,\"left\":320,\"right\":320}") != std::string::npos, "instant with frame and arguments");
+    size_t ring = Count(text, "\"name\":\"bench_ring\"");
+    g_check.Expect(ring > 0 && ring <= TRACE_BUFFER_EVENTS, "oldest events overwritten");
+    g_check.Expect(text.find("\"bench_ring\":" + std::to_string(TRACE_BUFFER_EVENTS + 99) + "}") != std::string::npos,
+        "latest event kept");
+}
+
+// ns per recorded event, begin and end pairs on one thread
+static double MeasureEventCost(uint32_t pairs)
+{
+    BenchClock::time_point start = BenchClock::now();
+    for (uint32_t i = 0; i < pairs; i++)
+    {
+        TRACE_BEGIN("bench_event");
+        TRACE_END("bench_event");
+    }
+    return ElapsedMs(start) * 1e6 / (2.0 * pairs);
+}
+
+// what the app records around a frame
+static uint32_t RunTracedFrame(const Scenario& s, Pipeline& p, uint64_t frame)
+{
+    TRACE_SET_FRAME(frame);
+    TRACE_SCOPE("frame");
+    for (const char* name : { "capture", "render", "detect", "copy", "mips", "blur", "composite", "sleep", "present" })
+    {
+        TRACE_BEGIN(name);
+        TRACE_END(name);
+    }
+    TRACE_COUNTER("frameRate", 120);
+
+    DetectedBars detected;
+    uint32_t width, height;
+    CompositeBar bars[2] = {};
+    double times[StageCount] = {};
+    return RunFrame(s, p, detected, width, height, bars, times);
+}
+
+#endif
+
+int RunTrace(const BenchOptions& options)
+{
+#ifdef AMBIENTLIGHT_TRACE
+    CheckDump();
+
+    double eventNs = MeasureEventCost(options.quick ? 100000 : 1000000);
+    double frameShare = BENCH_TRACE_EVENTS_PER_FRAME * eventNs * BENCH_TRACE_FRAME_RATE / 1e9;
+    printf("ns_per_event,%.1f\n", eventNs);
+    printf("ns_per_frame,%.1f\n", BENCH_TRACE_EVENTS_PER_FRAME * eventNs);
+    printf("overhead_pct_at_%u_fps,%.4f\n", BENCH_TRACE_FRAME_RATE, frameShare * 100.0);
+    g_check.Expect(frameShare < BENCH_TRACE_MAX_OVERHEAD, "tracing under 1% of the frame time");
+
+    // frames with the app's events against the same frames without any, alternating
+    // so both see the same machine state; without events is what the build with
+    // AMBIENTLIGHT_TRACE off runs. The difference of the medians is mostly noise.
+    printf("scenario,frame_ms_off,frame_ms_on,measured_overhead_pct,event_overhead_pct\n");
+    for (const Scenario* scenario : SelectScenarios(options))
+    {
+        const Scenario& s = *scenario;
+        Pipeline p;
+        if (!PreparePipeline(s, options, p))
+            return 1;
+
+        uint32_t runs = options.runs > 0 ? options.runs : (options.quick ? 3 : 15);
+        std::vector<double> off, on;
+        uint64_t frame = 0;
+        for (uint32_t run = 0; run < options.warmup + runs; run++)
+        {
+            DetectedBars detected;
+            uint32_t width, height;
+            CompositeBar bars[2] = {};
+            double times[StageCount] = {};
+            BenchClock::time_point start = BenchClock::now();
+            RunFrame(s, p, detected, width, height, bars, times);
+            double plain = ElapsedMs(start);
+
+            start = BenchClock::now();
+            RunTracedFrame(s, p, ++frame);
+            double traced = ElapsedMs(start);
+            if (run >= options.warmup)
+            {
+                off.push_back(plain);
+                on.push_back(traced);
+            }
+        }
+
+        double offMs = GetSampleStats(off).median;
+        double onMs = GetSampleStats(on).median;
+        double eventShare = BENCH_TRACE_EVENTS_PER_FRAME * eventNs / (offMs * 1e6);
+        printf("%s,%.3f,%.3f,%.2f,%.5f\n", GetScenarioName(s).c_str(), offMs, onMs,
+            (onMs - offMs) / offMs * 100.0, eventShare * 100.0);
+    }
+#else
+    (void)options;
+    printf("tracing compiled out, configure with -DAMBIENTLIGHT_TRACE=ON\n");
+#endif
+    return g_check.Result();
+}
@@ -0,0 +1,78 @@
+#include "benchstats.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Rank of the lower bound of the confidence interval of the median: the largest k
+// with P(Binomial(n, 1/2) < k) <= alpha / 2, or 0 when n is too small.
+static size_t MedianConfidenceRank(size_t n, double alpha)
+{
+    double probability = std::pow(0.5, (double)n);
+    double cumulative = 0.0;
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        cumulative += probability;
+        if (cumulative > alpha / 2)
+            break;
+        k = i + 1;
+        probability *= (double)(n - i) / (double)(i + 1);
+    }
+    return k;
+}
+
+SampleStats GetSampleStats(std::vector<double> samples)
+{
+    SampleStats stats = {};
+    if (samples.empty())
+        return stats;
+
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    stats.count = n;
+    stats.median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    stats.min = samples.front();
+    stats.max = samples.back();
+    for (double sample : samples)
+        stats.mean += sample;
+    stats.mean /= n;
+
+    size_t k = MedianConfidenceRank(n, 0.05);
+    stats.ciLow = k > 0 ? samples[k - 1] : stats.min;
+    stats.ciHigh = k > 0 ? samples[n - k] : stats.max;
+    return stats;
+}
+
+StageVerdict CompareStage(const SampleStats& current, uint64_t bytes, const StageBaseline& baseline,
+    double scale, const RegressionLimits& limits)
+{
+    // bytes do not depend on the machine, any growth beyond the threshold counts
+    if (baseline.bytes > 0 && (double)bytes > baseline.bytes * (1.0 + limits.threshold))
+        return StageLarger;
+
+    double expected = baseline.median * scale;
+    double delta = current.median - expected;
+    if (std::fabs(delta) < limits.minDelta)
+        return StageUnchanged;
+
+    if (current.ciLow > expected * (1.0 + limits.threshold))
+        return StageSlower;
+    if (current.ciHigh < expected * (1.0 - limits.threshold))
+        return StageFaster;
+    return StageUnchanged;
+}
+
+const char* StageVerdictName(StageVerdict verdict)
+{
+    switch (verdict)
+    {
+    case StageFaster:
+        return "faster";
+    case StageSlower:
+        return "SLOWER";
+    case StageLarger:
+        return "LARGER";
+    default:
+        return "ok";
+    }
+}
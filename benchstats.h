@@ -0,0 +1,51 @@
+#pragma once
+
+// Noise aware comparison of benchmark runs against a stored baseline.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct SampleStats
+{
+    size_t count;
+    double median;
+    double mean;
+    double min;
+    double max;
+    // 95% confidence interval of the median, min and max for fewer than 6 samples
+    double ciLow;
+    double ciHigh;
+};
+
+SampleStats GetSampleStats(std::vector<double> samples);
+
+struct StageBaseline
+{
+    double median;
+    double ciLow;
+    double ciHigh;
+    uint64_t bytes;
+};
+
+struct RegressionLimits
+{
+    // allowed slowdown or growth, as a fraction of the baseline
+    double threshold;
+    // time differences below this many milliseconds are noise
+    double minDelta;
+};
+
+enum StageVerdict
+{
+    StageUnchanged = 0,
+    StageFaster,
+    StageSlower,
+    StageLarger
+};
+
+// scale converts baseline times to this machine, see the calibration in bench/pipeline_bench.cpp
+StageVerdict CompareStage(const SampleStats& current, uint64_t bytes, const StageBaseline& baseline,
+    double scale, const RegressionLimits& limits);
+
+const char* StageVerdictName(StageVerdict verdict);
@@ -100,6 +100,10 @@ HRESULT DesktopCapture::Capture()
             return hr;
         }
         hr = desktopResource.As(&m_desktopTexture);
+
+        // zero when only the pointer moved, the image is still the last presented one
+        if (frameInfo.LastPresentTime.QuadPart != 0)
+            m_lastPresentTime = frameInfo.LastPresentTime.QuadPart;
     }
 
     return hr;
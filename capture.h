@@ -15,6 +15,8 @@ public:
     HRESULT ReleaseFrame();
 
     ComPtr<ID3D11Texture2D> GetDesktopTexture() { return m_desktopTexture; }
+    // QueryPerformanceCounter time the captured desktop image was presented, 0 if unknown
+    INT64 GetLastPresentTime() { return m_lastPresentTime; }
     DXGI_OUTDUPL_DESC GetDesktopDesc()
     {
         DXGI_OUTDUPL_DESC desc = {};
@@ -34,4 +36,5 @@ private:
 
     ComPtr<ID3D11Texture2D> m_desktopTexture;
     DXGI_OUTPUT_DESC1 m_outputDesc1 = {};
+    INT64 m_lastPresentTime = 0;
 };
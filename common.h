@@ -7,12 +7,14 @@
 #include "dxgi1_3.h"
 #include "wrl/client.h"
 #include "SimpleMath.h"
+#include <memory>
 #include <string>
 #include <vector>
-#include <deque>
-#include <numeric>
 
 #include "settings.h"
+#include "histogram.h"
+#include "resourceregistry.h"
+#include "trace.h"
 
 using namespace Microsoft::WRL;
 
@@ -103,6 +105,165 @@ struct BlackBar
     }
 };
 
+// The bars of one detection, a letterbox or a pillarbox. Held by value with a fixed
+// capacity, so handing them around the frame loop does not allocate.
+struct BlackBars
+{
+    static constexpr UINT MAX_BARS = 2;
+
+    BlackBar bars[MAX_BARS];
+    UINT count;
+
+    BlackBars() : bars(), count(0) {}
+
+    // a bar beyond the capacity is dropped
+    void push_back(const BlackBar& bar)
+    {
+        if (count < MAX_BARS)
+            bars[count++] = bar;
+    }
+    void clear() { count = 0; }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    BlackBar& operator[](size_t i) { return bars[i]; }
+    const BlackBar& operator[](size_t i) const { return bars[i]; }
+
+    BlackBar* begin() { return bars; }
+    BlackBar* end() { return bars + count; }
+    const BlackBar* begin() const { return bars; }
+    const BlackBar* end() const { return bars + count; }
+};
+
+// Ties a registry record to the lifetime of a D3D or DXGI object. Attached as private
+// data, the object releases it when it is destroyed, whoever held the last reference.
+class ResourceReleaser : public IUnknown
+{
+public:
+    ResourceReleaser(ResourceId id) : m_refs(0), m_id(id) {}
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+    {
+        if (!object)
+            return E_POINTER;
+        if (riid != __uuidof(IUnknown))
+        {
+            *object = nullptr;
+            return E_NOINTERFACE;
+        }
+        *object = static_cast<IUnknown*>(this);
+        AddRef();
+        return S_OK;
+    }
+    ULONG STDMETHODCALLTYPE AddRef() override { return (ULONG)InterlockedIncrement(&m_refs); }
+    ULONG STDMETHODCALLTYPE Release() override
+    {
+        ULONG refs = (ULONG)InterlockedDecrement(&m_refs);
+        if (refs == 0)
+        {
+            GetResourceRegistry().Release(m_id);
+            delete this;
+        }
+        return refs;
+    }
+
+private:
+    LONG m_refs;
+    ResourceId m_id;
+};
+
+// {6E0C2F4B-8A5D-4C1E-9B7A-3F2D1C0B9E84}
+static const GUID RESOURCE_RELEASER_GUID = { 0x6e0c2f4b, 0x8a5d, 0x4c1e, { 0x9b, 0x7a, 0x3f, 0x2d, 0x1c, 0x0b, 0x9e, 0x84 } };
+
+template <class T>
+HRESULT TrackResource(T* resource, ResourceId id)
+{
+    ResourceReleaser* releaser = new ResourceReleaser(id);
+    HRESULT hr = resource->SetPrivateDataInterface(RESOURCE_RELEASER_GUID, releaser);
+    if (FAILED(hr))
+        delete releaser;
+    return hr;
+}
+
+inline ResourceFormat ToResourceFormat(DXGI_FORMAT format)
+{
+    switch (format)
+    {
+    case DXGI_FORMAT_R16_UNORM:
+        return ResourceFormatR16Unorm;
+    case DXGI_FORMAT_R32_FLOAT:
+        return ResourceFormatR32Float;
+    case DXGI_FORMAT_B8G8R8A8_UNORM:
+        return ResourceFormatBGRA8;
+    case DXGI_FORMAT_R10G10B10A2_UNORM:
+        return ResourceFormatRGB10A2;
+    case DXGI_FORMAT_R11G11B10_FLOAT:
+        return ResourceFormatR11G11B10Float;
+    case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        return ResourceFormatRGBA16Float;
+    default:
+        return ResourceFormatUnknown;
+    }
+}
+
+// format to create for a grant, wanted is the format that was asked for
+inline DXGI_FORMAT ToDxgiFormat(ResourceFormat granted, DXGI_FORMAT wanted)
+{
+    return granted == ResourceFormatR11G11B10Float ? DXGI_FORMAT_R11G11B10_FLOAT : wanted;
+}
+
+template <class Create>
+class ResourceAllocatorFn : public ResourceAllocator
+{
+public:
+    ResourceAllocatorFn(Create& create) : m_create(create), m_hr(E_FAIL) {}
+
+    bool Allocate(const ResourceDesc& desc, ResourceId id) override
+    {
+        m_hr = m_create(desc, id);
+        return SUCCEEDED(m_hr);
+    }
+
+    HRESULT GetResult() const { return m_hr; }
+
+private:
+    Create& m_create;
+    HRESULT m_hr;
+};
+
+// Allocates through the registry of the device. create(desc, id) makes the object
+// described by the granted desc, calls TrackResource on it and returns its HRESULT.
+template <class Create>
+HRESULT AllocateResource(const ResourceDesc& wanted, Create create, ResourceId* id = nullptr, ResourceGrant* grant = nullptr)
+{
+    ResourceAllocatorFn<Create> allocator(create);
+    ResourceId allocated = GetResourceRegistry().Allocate(wanted, allocator, grant);
+    if (id)
+        *id = allocated;
+    return allocated != RESOURCE_ID_NONE ? S_OK : allocator.GetResult();
+}
+
+// CreateTexture2D for resources the budget must not change, such as staging textures
+inline HRESULT CreateTrackedTexture2D(ID3D11Device* device, const D3D11_TEXTURE2D_DESC& desc,
+    const D3D11_SUBRESOURCE_DATA* data, ResourceOwner owner, const char* name, ID3D11Texture2D** texture)
+{
+    ResourceDesc wanted = { owner, name, desc.Width, desc.Height, ToResourceFormat(desc.Format),
+        desc.MipLevels, desc.ArraySize, ResourceDowngradeNone };
+    return AllocateResource(wanted, [&](const ResourceDesc&, ResourceId id)
+    {
+        ComPtr<ID3D11Texture2D> created;
+        HRESULT hr = device->CreateTexture2D(&desc, data, &created);
+        if (SUCCEEDED(hr))
+            hr = TrackResource(created.Get(), id);
+        if (SUCCEEDED(hr))
+            *texture = created.Detach();
+        return hr;
+    });
+}
+
+class TextureLease;
+
 class TextureView
 {
 public:
@@ -150,55 +311,17 @@ public:
         m_texture = nullptr;
         m_srv = nullptr;
         m_rtv = nullptr;
+        m_uav = nullptr;
+        m_resource = RESOURCE_ID_NONE;
+        m_lease = nullptr;
     }
 
-    HRESULT RecreateTexture(ID3D11Device* device, DXGI_FORMAT format, UINT width, UINT height, UINT mipLevels = 1, bool generateMips = false)
-    {
-        HRESULT hr = S_OK;
-
-        if (GetTexture())
-        {
-            ID3D11Texture2D* texture = GetTexture();
-            D3D11_TEXTURE2D_DESC desc;
-            texture->GetDesc(&desc);
-
-            bool existingHasGenerateMips = (desc.MiscFlags & D3D11_RESOURCE_MISC_GENERATE_MIPS) != 0;
-            if (desc.Format != format || desc.Width != width || desc.Height != height || 
-                (mipLevels != 0 && desc.MipLevels != mipLevels) || existingHasGenerateMips != generateMips)
-            {
-                Clear();
-            }
-        }
-        
-        if (width == 0 || height == 0)
-        {
-            return DXGI_ERROR_INVALID_CALL;
-        }
-
-        if (!GetTexture())
-        {
-            ID3D11Texture2D* texture = nullptr;
-            D3D11_TEXTURE2D_DESC desc = {};
-            desc.Width = width;
-            desc.Height = height;
-            desc.MipLevels = mipLevels;
-            desc.ArraySize = 1;
-            desc.Format = format;
-            desc.SampleDesc.Count = 1;
-            desc.SampleDesc.Quality = 0;
-            desc.Usage = D3D11_USAGE_DEFAULT;
-            desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET | D3D11_BIND_UNORDERED_ACCESS;
-            desc.CPUAccessFlags = 0;
-            desc.MiscFlags = generateMips ? D3D11_RESOURCE_MISC_GENERATE_MIPS : 0;
-            hr = device->CreateTexture2D(&desc, nullptr, &texture);
-            if (SUCCEEDED(hr))
-            {
-                CreateViews(device, texture);
-                texture->Release();
-            }
-        }
-        return hr;
-    }
+    // The texture is leased from the texture pool, see texturepool_d3d.h, which
+    // allocates through the resource registry; downgrades are the ResourceDowngradeFlags
+    // the budget may apply. Check GetTexture()->GetDesc for the size and format actually
+    // allocated.
+    HRESULT RecreateTexture(ID3D11Device* device, DXGI_FORMAT format, UINT width, UINT height, UINT mipLevels = 1, bool generateMips = false,
+        ResourceOwner owner = ResourceOwnerEffect, const char* name = "texture", UINT downgrades = ResourceDowngradeNone);
 
     ID3D11Texture2D* GetTexture() const
     {
@@ -216,65 +339,86 @@ public:
     {
         return m_uav.Get();
     }
+    // registry record of a texture made by RecreateTexture, nullptr otherwise
+    const ResourceRecord* GetResource() const
+    {
+        return GetResourceRegistry().Find(m_resource);
+    }
 
 private:
+    friend class D3DTexturePool;
+
     ComPtr<ID3D11Texture2D> m_texture;
     ComPtr<ID3D11ShaderResourceView> m_srv;
     ComPtr<ID3D11RenderTargetView> m_rtv;
     ComPtr<ID3D11UnorderedAccessView> m_uav;
+    // registry record of a texture made by RecreateTexture
+    ResourceId m_resource = RESOURCE_ID_NONE;
+    // pool entry of a texture made by RecreateTexture, shared by the copies of the view
+    std::shared_ptr<TextureLease> m_lease;
 };
 
+// Per-stage CPU timer backed by a lock-free latency histogram, see histogram.h.
+// Available in every build, recording does not allocate.
 __declspec(align(16))
 class PerfTimer {
 public:
-    PerfTimer() : m_name("Unnamed"), m_maxRecords(10) {
-        QueryPerformanceFrequency(&m_frequency);
-    }
+    PerfTimer() : PerfTimer("Unnamed") {}
 
-    PerfTimer(std::string name, size_t maxRecords = 10)
-        : m_name(name), m_maxRecords(maxRecords) {
+    PerfTimer(std::string name)
+        : m_name(name) {
         QueryPerformanceFrequency(&m_frequency);
+        m_startTime.QuadPart = 0;
     }
 
+    // Start/Stop for a timer used by a single thread, ScopedPerfTimer works from any thread
     void Start() { QueryPerformanceCounter(&m_startTime); }
 
-    void Stop() {
+    void Stop() { Record(m_startTime); }
+
+    void Record(LARGE_INTEGER startTime) {
         LARGE_INTEGER endTime;
         QueryPerformanceCounter(&endTime);
-        double duration = (double)(endTime.QuadPart - m_startTime.QuadPart) * 1000.0 / m_frequency.QuadPart;
-
-        m_records.push_back(duration);
-        if (m_records.size() > m_maxRecords) m_records.pop_front();
+        double ns = (double)(endTime.QuadPart - startTime.QuadPart) * 1e9 / m_frequency.QuadPart;
+        m_histogram.Record(ns > 0.0 ? (uint64_t)ns : 0);
     }
 
-    // New: Sends the average and last record to DebugView
+    // completes the window GetStats reports and starts a new one
+    void Rotate() { m_histogram.Rotate(); }
+
+    // Sends the percentiles of the last window to DebugView
     void PrintToDebug() const {
+        LatencyStats stats = m_histogram.GetStats();
+
         char buffer[256];
-        sprintf_s(buffer, "[%s] Avg: %.3fms | Last: %.3fms\n",
-            m_name.c_str(), GetAverage(), GetLast());
+        sprintf_s(buffer, "[%s] n %llu | min %.3f | p50 %.3f | p95 %.3f | p99 %.3f | max %.3f ms\n",
+            m_name.c_str(), stats.count, stats.min / 1e6, stats.p50 / 1e6,
+            stats.p95 / 1e6, stats.p99 / 1e6, stats.max / 1e6);
 
         OutputDebugStringA(buffer);
     }
 
-    double GetAverage() const {
-        if (m_records.empty()) return 0.0;
-        return std::accumulate(m_records.begin(), m_records.end(), 0.0) / m_records.size();
-    }
+    LatencyStats GetStats() const { return m_histogram.GetStats(); }
+
+    // mean of the last window, in milliseconds
+    double GetAverage() const { return m_histogram.GetStats().mean / 1e6; }
 
-    double GetLast() const { return m_records.empty() ? 0.0 : m_records.back(); }
+    double GetLast() const { return m_histogram.GetLast() / 1e6; }
+
+    const std::string& GetName() const { return m_name; }
 
 private:
     std::string m_name;
     LARGE_INTEGER m_frequency;
     LARGE_INTEGER m_startTime;
-    std::deque<double> m_records;
-    size_t m_maxRecords;
+    LatencyHistogram m_histogram;
 };
 
 struct ScopedPerfTimer {
     PerfTimer& timer;
-    ScopedPerfTimer(PerfTimer& t) : timer(t) { timer.Start(); }
-    ~ScopedPerfTimer() { timer.Stop(); }
+    LARGE_INTEGER start;
+    ScopedPerfTimer(PerfTimer& t) : timer(t) { TRACE_BEGIN(timer.GetName().c_str()); QueryPerformanceCounter(&start); }
+    ~ScopedPerfTimer() { timer.Record(start); TRACE_END(timer.GetName().c_str()); }
 };
 
 __declspec(align(16))
@@ -292,6 +436,8 @@ public:
         }
         return false;
     }
+
+    void Restart() { m_last = GetTickCount64(); }
 private:
     ULONGLONG m_last;
 };
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include "configstore.h"
+
+#include <fstream>
+#include <sstream>
+
+std::shared_ptr<const ConfigSnapshot> ConfigSnapshot::Parse(std::istream& is)
+{
+    inipp::Ini<char> ini;
+    ini.parse(is);
+    ini.strip_trailing_comments();
+
+    std::shared_ptr<ConfigSnapshot> snapshot(new ConfigSnapshot());
+    snapshot->m_sections = std::move(ini.sections);
+    return snapshot;
+}
+
+std::shared_ptr<const ConfigSnapshot> ConfigSnapshot::Parse(const std::string& text)
+{
+    std::istringstream is(text);
+    return Parse(is);
+}
+
+std::shared_ptr<const ConfigSnapshot> ConfigSnapshot::Create(Sections sections)
+{
+    std::shared_ptr<ConfigSnapshot> snapshot(new ConfigSnapshot());
+    snapshot->m_sections = std::move(sections);
+    return snapshot;
+}
+
+const ConfigSnapshot::Section& ConfigSnapshot::GetSection(const std::string& name) const
+{
+    static const Section empty;
+    auto it = m_sections.find(name);
+    return it != m_sections.end() ? it->second : empty;
+}
+
+std::string ConfigSnapshot::Generate() const
+{
+    inipp::Ini<char> ini;
+    ini.sections = m_sections;
+    std::ostringstream os;
+    ini.generate(os);
+    return os.str();
+}
+
+// keys of one section that differ, either section may be missing
+static void DiffSection(const std::string& name, const ConfigSnapshot::Section& before,
+    const ConfigSnapshot::Section& after, std::vector<ConfigChange>& changes)
+{
+    auto a = before.begin();
+    auto b = after.begin();
+    while (a != before.end() || b != after.end())
+    {
+        if (b == after.end() || (a != before.end() && a->first < b->first))
+        {
+            changes.push_back({ name, a->first });
+            ++a;
+        }
+        else if (a == before.end() || b->first < a->first)
+        {
+            changes.push_back({ name, b->first });
+            ++b;
+        }
+        else
+        {
+            if (a->second != b->second)
+                changes.push_back({ name, a->first });
+            ++a;
+            ++b;
+        }
+    }
+}
+
+std::vector<ConfigChange> DiffConfig(const ConfigSnapshot& before, const ConfigSnapshot& after)
+{
+    // both maps are sorted, walk them side by side
+    static const ConfigSnapshot::Section empty;
+    const ConfigSnapshot::Sections& a = before.GetSections();
+    const ConfigSnapshot::Sections& b = after.GetSections();
+    std::vector<ConfigChange> changes;
+
+    auto ia = a.begin();
+    auto ib = b.begin();
+    while (ia != a.end() || ib != b.end())
+    {
+        if (ib == b.end() || (ia != a.end() && ia->first < ib->first))
+        {
+            DiffSection(ia->first, ia->second, empty, changes);
+            ++ia;
+        }
+        else if (ia == a.end() || ib->first < ia->first)
+        {
+            DiffSection(ib->first, empty, ib->second, changes);
+            ++ib;
+        }
+        else
+        {
+            DiffSection(ia->first, ia->second, ib->second, changes);
+            ++ia;
+            ++ib;
+        }
+    }
+    return changes;
+}
+
+bool WriteFileAtomic(const std::filesystem::path& file, const std::string& text)
+{
+    std::filesystem::path temp = file;
+    temp += ".tmp";
+    std::error_code error;
+    {
+        // text mode, the file has the line endings of the platform as before
+        std::ofstream os(temp, std::ios::trunc);
+        os << text;
+        os.close();
+        if (!os)
+        {
+            std::filesystem::remove(temp, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temp, file, error);
+    if (error)
+    {
+        std::filesystem::remove(temp, error);
+        return false;
+    }
+    return true;
+}
+
+ConfigStore::ConfigStore() :
+    m_pending(false),
+    m_saved(0),
+    m_debounce(CONFIG_STORE_DEBOUNCE_MS),
+    m_reads(0),
+    m_unchanged(0),
+    m_parses(0),
+    m_reloads(0),
+    m_saves(0),
+    m_writes(0),
+    m_skippedWrites(0)
+{
+}
+
+bool ConfigStore::Start(const std::filesystem::path& file)
+{
+    m_file = file;
+    m_changes.clear();
+    m_pending = false;
+
+    // watch before the first read, a write in between is not missed
+    bool watching = m_watcher.Start(file);
+    m_text = Read();
+    m_config = ConfigSnapshot::Parse(m_text);
+    return watching;
+}
+
+void ConfigStore::Stop()
+{
+    m_watcher.Stop();
+}
+
+std::string ConfigStore::Read() const
+{
+    // a missing file reads as an empty one, every setting at its default
+    std::ifstream is(m_file);
+    std::ostringstream text;
+    text << is.rdbuf();
+    return text.str();
+}
+
+bool ConfigStore::Reload(bool force)
+{
+    bool notified = m_watcher.Poll();
+    if (!m_config || (!notified && !force))
+        return false;
+
+    m_reads++;
+    std::string text = Read();
+    if (text == m_text)
+    {
+        m_unchanged++;
+        return false;
+    }
+
+    m_parses++;
+    m_text = std::move(text);
+    std::shared_ptr<const ConfigSnapshot> config = ConfigSnapshot::Parse(m_text);
+    std::vector<ConfigChange> changes = DiffConfig(*m_config, *config);
+    if (changes.empty())
+        return false;
+
+    m_config = config;
+    m_changes = std::move(changes);
+    m_pending = false;
+    m_reloads++;
+    return true;
+}
+
+void ConfigStore::Save(std::shared_ptr<const ConfigSnapshot> config, uint64_t now)
+{
+    m_config = std::move(config);
+    m_pending = true;
+    m_saved = now;
+    m_saves++;
+}
+
+bool ConfigStore::Flush(uint64_t now, bool force)
+{
+    if (!m_pending || (!force && now < m_saved + m_debounce))
+        return false;
+
+    std::string text = m_config->Generate();
+    if (text == m_text)
+    {
+        // dragged back to where it started
+        m_pending = false;
+        m_skippedWrites++;
+        return false;
+    }
+
+    if (!WriteFileAtomic(m_file, text))
+    {
+        // tried again after another window
+        m_saved = now;
+        return false;
+    }
+
+    m_pending = false;
+    m_text = std::move(text);
+    m_writes++;
+    return true;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+// The parsed config file, its reload and its debounced, atomic save.
+
+#include <stdint.h>
+#include <filesystem>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "filewatcher.h"
+#include "inipp.h"
+
+// idle time after the last save before the file is written, a slider drag saves every frame
+#define CONFIG_STORE_DEBOUNCE_MS 500
+
+class ConfigSnapshot
+{
+public:
+    typedef inipp::Ini<char>::Section Section;
+    typedef inipp::Ini<char>::Sections Sections;
+
+    // contents of config.ini, trailing comments stripped
+    static std::shared_ptr<const ConfigSnapshot> Parse(std::istream& is);
+    static std::shared_ptr<const ConfigSnapshot> Parse(const std::string& text);
+    // sections as the app changed them, Generate writes them out
+    static std::shared_ptr<const ConfigSnapshot> Create(Sections sections);
+
+    const Sections& GetSections() const { return m_sections; }
+    // empty when the file has no such section
+    const Section& GetSection(const std::string& name) const;
+
+    std::string Generate() const;
+
+private:
+    ConfigSnapshot() {}
+
+    Sections m_sections;
+};
+
+// a key that was added, removed or given another value
+struct ConfigChange
+{
+    std::string section;
+    std::string key;
+};
+
+// changed keys in section and key order, empty when both hold the same values
+std::vector<ConfigChange> DiffConfig(const ConfigSnapshot& before, const ConfigSnapshot& after);
+
+// writes text to a temp file next to file and renames it over file, readers see the
+// old or the new contents but never a partial file
+bool WriteFileAtomic(const std::filesystem::path& file, const std::string& text);
+
+class ConfigStore
+{
+public:
+    ConfigStore();
+
+    // watches the file and reads it, false when it cannot be watched; the file is read
+    // either way and Reload(true) has to be called when it may have changed
+    bool Start(const std::filesystem::path& file);
+    void Stop();
+    bool IsWatching() const { return m_watcher.IsWatching(); }
+
+    // Reads the file again after a change notification, or always with force. Returns
+    // true when a key changed, the new snapshot is in use then and a save that was not
+    // written yet is dropped, the edit made outside the app is the newer one.
+    bool Reload(bool force = false);
+
+    const std::shared_ptr<const ConfigSnapshot>& GetConfig() const { return m_config; }
+    // keys the last reload that returned true changed
+    const std::vector<ConfigChange>& GetChanges() const { return m_changes; }
+
+    // Puts a config the app changed in use, now in milliseconds of any monotonic clock.
+    // Flush writes it once debounceMs passed without another save.
+    void Save(std::shared_ptr<const ConfigSnapshot> config, uint64_t now);
+    // Writes a pending save whose window passed, or any pending save with force (on
+    // exit). Returns true when the file was written.
+    bool Flush(uint64_t now, bool force = false);
+    bool IsPending() const { return m_pending; }
+    void SetDebounce(uint64_t debounceMs) { m_debounce = debounceMs; }
+
+    const FileWatcher& GetWatcher() const { return m_watcher; }
+    // event a change of the file signals, nullptr when there is none to wait on
+    void* GetChangeEvent() const { return m_watcher.GetEvent(); }
+    // reads after the first, the ones whose contents were the ones last read or written
+    // (our own writes), the parses and the parses that changed keys
+    uint64_t GetReads() const { return m_reads; }
+    uint64_t GetUnchanged() const { return m_unchanged; }
+    uint64_t GetParses() const { return m_parses; }
+    uint64_t GetReloads() const { return m_reloads; }
+    // saves, the files written, and the flushes skipped as the file held the contents already
+    uint64_t GetSaves() const { return m_saves; }
+    uint64_t GetWrites() const { return m_writes; }
+    uint64_t GetSkippedWrites() const { return m_skippedWrites; }
+
+private:
+    std::string Read() const;
+
+    std::filesystem::path m_file;
+    FileWatcher m_watcher;
+    std::shared_ptr<const ConfigSnapshot> m_config;
+    std::vector<ConfigChange> m_changes;
+    // contents the file holds as far as we know, the ones last read or written
+    std::string m_text;
+
+    bool m_pending;
+    uint64_t m_saved;
+    uint64_t m_debounce;
+
+    uint64_t m_reads;
+    uint64_t m_unchanged;
+    uint64_t m_parses;
+    uint64_t m_reloads;
+    uint64_t m_saves;
+    uint64_t m_writes;
+    uint64_t m_skippedWrites;
+};
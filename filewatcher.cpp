@@ -0,0 +1,219 @@
+#include "filewatcher.h"
+
+// change records read at once, a burst larger than this reports a change anyway
+#define FILE_WATCHER_BUFFER 4096
+
+FileWatcher::FileWatcher() :
+    m_watching(false),
+    m_directory(nullptr),
+    m_event(nullptr),
+    m_overlapped(nullptr),
+    m_descriptor(-1),
+    m_polls(0),
+    m_changes(0)
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+    Stop();
+}
+
+#ifdef _WIN32
+#include <wchar.h>
+#include <windows.h>
+
+bool FileWatcher::Start(const std::filesystem::path& file)
+{
+    Stop();
+    m_fileName = file.filename();
+
+    std::filesystem::path directory = file.has_parent_path() ? file.parent_path() : std::filesystem::path(L".");
+    HANDLE handle = CreateFileW(directory.c_str(), FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    m_directory = handle;
+    m_event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    m_overlapped = new OVERLAPPED();
+    m_buffer.resize(FILE_WATCHER_BUFFER);
+    m_watching = m_event != nullptr;
+    if (!m_watching || !Arm())
+    {
+        Stop();
+        return false;
+    }
+    return true;
+}
+
+void FileWatcher::Stop()
+{
+    if (m_directory)
+    {
+        // the system writes to the buffer until the read is cancelled
+        OVERLAPPED* overlapped = (OVERLAPPED*)m_overlapped;
+        if (m_watching && CancelIoEx(m_directory, overlapped))
+        {
+            DWORD bytes = 0;
+            GetOverlappedResult(m_directory, overlapped, &bytes, TRUE);
+        }
+        CloseHandle(m_directory);
+        m_directory = nullptr;
+    }
+    if (m_event)
+    {
+        CloseHandle(m_event);
+        m_event = nullptr;
+    }
+    delete (OVERLAPPED*)m_overlapped;
+    m_overlapped = nullptr;
+    m_watching = false;
+}
+
+bool FileWatcher::Arm()
+{
+    OVERLAPPED* overlapped = (OVERLAPPED*)m_overlapped;
+    ZeroMemory(overlapped, sizeof(OVERLAPPED));
+    overlapped->hEvent = m_event;
+    ResetEvent(m_event);
+
+    // a rename shows as a file name change, an in place write as a last write change
+    return ReadDirectoryChangesW(m_directory, m_buffer.data(), (DWORD)m_buffer.size(), FALSE,
+        FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE,
+        nullptr, overlapped, nullptr) != FALSE;
+}
+
+bool FileWatcher::Poll()
+{
+    if (!m_watching)
+        return false;
+    m_polls++;
+    if (WaitForSingleObject(m_event, 0) != WAIT_OBJECT_0)
+        return false;
+
+    bool changed = false;
+    DWORD bytes = 0;
+    if (!GetOverlappedResult(m_directory, (OVERLAPPED*)m_overlapped, &bytes, FALSE) || bytes == 0)
+    {
+        // the records did not fit the buffer
+        changed = true;
+    }
+    else
+    {
+        const std::wstring& name = m_fileName.native();
+        const uint8_t* record = m_buffer.data();
+        for (;;)
+        {
+            const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)record;
+            size_t length = info->FileNameLength / sizeof(WCHAR);
+            if (length == name.size() && _wcsnicmp(info->FileName, name.c_str(), length) == 0)
+                changed = true;
+            if (info->NextEntryOffset == 0)
+                break;
+            record += info->NextEntryOffset;
+        }
+    }
+
+    // without a queued read the caller falls back to checking the write time
+    if (!Arm())
+    {
+        Stop();
+        changed = true;
+    }
+    if (changed)
+        m_changes++;
+    return changed;
+}
+
+#else
+#include <errno.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+bool FileWatcher::Start(const std::filesystem::path& file)
+{
+    Stop();
+    m_fileName = file.filename();
+
+    std::filesystem::path directory = file.has_parent_path() ? file.parent_path() : std::filesystem::path(".");
+    int descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (descriptor < 0)
+        return false;
+
+    // in place writes are reported once the writer closes the file
+    uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+    if (inotify_add_watch(descriptor, directory.c_str(), mask) < 0)
+    {
+        close(descriptor);
+        return false;
+    }
+
+    m_descriptor = descriptor;
+    m_buffer.resize(FILE_WATCHER_BUFFER);
+    m_watching = true;
+    return true;
+}
+
+void FileWatcher::Stop()
+{
+    if (m_descriptor >= 0)
+    {
+        close(m_descriptor);
+        m_descriptor = -1;
+    }
+    m_watching = false;
+}
+
+bool FileWatcher::Arm()
+{
+    return m_watching;
+}
+
+bool FileWatcher::Poll()
+{
+    if (!m_watching)
+        return false;
+    m_polls++;
+
+    bool changed = false;
+    bool lost = false;
+    for (;;)
+    {
+        ssize_t bytes = read(m_descriptor, m_buffer.data(), m_buffer.size());
+        if (bytes <= 0)
+        {
+            if (bytes < 0 && errno == EINTR)
+                continue;
+            break;
+        }
+
+        const uint8_t* record = m_buffer.data();
+        const uint8_t* end = record + bytes;
+        while (record < end)
+        {
+            const inotify_event* event = (const inotify_event*)record;
+            if (event->mask & IN_Q_OVERFLOW)
+                changed = true;
+            else if (event->mask & IN_IGNORED)
+                lost = true;
+            else if (event->len > 0 && strcmp(event->name, m_fileName.c_str()) == 0)
+                changed = true;
+            record += sizeof(inotify_event) + event->len;
+        }
+    }
+
+    // the directory went away, the caller falls back to checking the write time
+    if (lost)
+    {
+        Stop();
+        changed = true;
+    }
+    if (changed)
+        m_changes++;
+    return changed;
+}
+
+#endif
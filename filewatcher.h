@@ -0,0 +1,51 @@
+#pragma once
+
+// Change notifications for a single file, the config file.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <filesystem>
+#include <vector>
+
+class FileWatcher
+{
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    // false when the directory of the file cannot be watched, the file need not exist
+    bool Start(const std::filesystem::path& file);
+    void Stop();
+    bool IsWatching() const { return m_watching; }
+
+    // true when the file was written, created, replaced or removed since the last call,
+    // also when notifications were lost and it may have been
+    bool Poll();
+
+    // signaled on a change until the next Poll, on Windows while watching, nullptr otherwise
+    void* GetEvent() const { return m_watching ? m_event : nullptr; }
+
+    // calls of Poll, and the ones that reported a change
+    uint64_t GetPolls() const { return m_polls; }
+    uint64_t GetChanges() const { return m_changes; }
+
+private:
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // queues the next ReadDirectoryChangesW on Windows
+    bool Arm();
+
+    std::filesystem::path m_fileName;
+    bool m_watching;
+    // directory handle, event and OVERLAPPED on Windows, inotify descriptor on Linux
+    void* m_directory;
+    void* m_event;
+    void* m_overlapped;
+    int m_descriptor;
+    // change records the system writes to
+    std::vector<uint8_t> m_buffer;
+
+    uint64_t m_polls;
+    uint64_t m_changes;
+};
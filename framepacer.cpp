@@ -0,0 +1,224 @@
+#include "framepacer.h"
+
+#include <math.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <mmsystem.h>
+
+#pragma comment(lib, "winmm.lib")
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+SystemFrameClock::SystemFrameClock() : m_timerPeriod(false)
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    m_frequency = frequency.QuadPart;
+
+    // high resolution timers need Windows 10 1803, fall back to a regular timer
+    // at the finest system timer resolution
+    m_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!m_timer)
+    {
+        m_timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+        m_timerPeriod = timeBeginPeriod(1) == TIMERR_NOERROR;
+    }
+}
+
+SystemFrameClock::~SystemFrameClock()
+{
+    if (m_timer)
+        CloseHandle(m_timer);
+    if (m_timerPeriod)
+        timeEndPeriod(1);
+}
+
+int64_t SystemFrameClock::Now()
+{
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return FromSystemTicks(counter.QuadPart);
+}
+
+void SystemFrameClock::WaitUntil(int64_t deadline)
+{
+    int64_t remaining = deadline - Now();
+    if (remaining <= 0)
+        return;
+
+    if (m_timer)
+    {
+        // negative due time is relative, in 100ns units
+        LARGE_INTEGER due;
+        due.QuadPart = -(remaining / 100);
+        if (SetWaitableTimer(m_timer, &due, 0, nullptr, nullptr, FALSE))
+        {
+            WaitForSingleObject(m_timer, INFINITE);
+            return;
+        }
+    }
+
+    Sleep((DWORD)(remaining / 1000000));
+}
+
+int64_t SystemFrameClock::ThreadCpuTime()
+{
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+        return 0;
+
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return (int64_t)(k.QuadPart + u.QuadPart) * 100;
+}
+
+#else
+#include <errno.h>
+#include <time.h>
+
+static int64_t ToNanoseconds(const timespec& ts)
+{
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+SystemFrameClock::SystemFrameClock() : m_timer(nullptr), m_frequency(1000000000LL), m_timerPeriod(false)
+{
+}
+
+SystemFrameClock::~SystemFrameClock()
+{
+}
+
+int64_t SystemFrameClock::Now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ToNanoseconds(ts);
+}
+
+void SystemFrameClock::WaitUntil(int64_t deadline)
+{
+    timespec ts;
+    ts.tv_sec = (time_t)(deadline / 1000000000LL);
+    ts.tv_nsec = (long)(deadline % 1000000000LL);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR)
+    {
+    }
+}
+
+int64_t SystemFrameClock::ThreadCpuTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ToNanoseconds(ts);
+}
+#endif
+
+int64_t SystemFrameClock::FromSystemTicks(int64_t ticks) const
+{
+    // split to avoid overflowing the multiplication
+    int64_t seconds = ticks / m_frequency;
+    int64_t remainder = ticks % m_frequency;
+    return seconds * 1000000000LL + remainder * 1000000000LL / m_frequency;
+}
+
+FramePacer::FramePacer(FrameClock& clock) :
+    m_clock(clock),
+    m_frameRate(60),
+    m_period(1000000000LL / 60),
+    m_deadline(0)
+{
+    ResetStats();
+}
+
+void FramePacer::SetFrameRate(uint32_t frameRate)
+{
+    if (frameRate == 0)
+        frameRate = 1;
+    if (frameRate == m_frameRate)
+        return;
+
+    int64_t period = 1000000000LL / frameRate;
+    // keep the pending deadline relative to the last frame
+    if (m_deadline != 0)
+        m_deadline += period - m_period;
+
+    m_frameRate = frameRate;
+    m_period = period;
+}
+
+void FramePacer::Wait()
+{
+    int64_t now = m_clock.Now();
+    if (m_deadline == 0)
+    {
+        // first frame, nothing to wait for
+        m_deadline = now + m_period;
+        return;
+    }
+
+    m_frames++;
+
+    if (now >= m_deadline)
+    {
+        // late, stay on the grid unless a whole period was lost
+        m_missed++;
+        m_deadline += m_period;
+        if (m_deadline <= now)
+            m_deadline = now + m_period;
+        return;
+    }
+
+    int64_t cpuStart = m_clock.ThreadCpuTime();
+    m_clock.WaitUntil(m_deadline);
+    m_waitCpuTime += m_clock.ThreadCpuTime() - cpuStart;
+    m_wakeups++;
+
+    int64_t woke = m_clock.Now();
+    int64_t error = woke - m_deadline;
+    m_errorSum += (double)error;
+    m_errorSquareSum += (double)error * (double)error;
+    if (error > m_maxError)
+        m_maxError = error;
+
+    m_deadline += m_period;
+    if (m_deadline <= woke)
+        m_deadline = woke + m_period;
+}
+
+FramePacerStats FramePacer::GetStats() const
+{
+    FramePacerStats stats = {};
+    stats.frames = m_frames;
+    stats.missed = m_missed;
+    stats.wakeups = m_wakeups;
+    stats.maxError = m_maxError;
+    if (m_wakeups > 0)
+    {
+        stats.meanError = m_errorSum / m_wakeups;
+        double variance = m_errorSquareSum / m_wakeups - stats.meanError * stats.meanError;
+        stats.jitter = variance > 0.0 ? sqrt(variance) : 0.0;
+    }
+    if (m_frames > 0)
+    {
+        stats.waitCpuTime = (double)m_waitCpuTime / m_frames;
+    }
+    return stats;
+}
+
+void FramePacer::ResetStats()
+{
+    m_frames = 0;
+    m_missed = 0;
+    m_wakeups = 0;
+    m_errorSum = 0.0;
+    m_errorSquareSum = 0.0;
+    m_maxError = 0;
+    m_waitCpuTime = 0;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+// Deadline based frame pacing.
+
+#include <stdint.h>
+
+class FrameClock
+{
+public:
+    virtual ~FrameClock() {}
+
+    // monotonic time in nanoseconds
+    virtual int64_t Now() = 0;
+    // block until the deadline (in Now() time) has passed
+    virtual void WaitUntil(int64_t deadline) = 0;
+    // CPU time consumed by the calling thread in nanoseconds
+    virtual int64_t ThreadCpuTime() = 0;
+};
+
+// High resolution waitable timer on Windows, clock_nanosleep on Linux. Without high
+// resolution timers (before Windows 10 1803) the system timer is raised to 1ms while
+// the clock exists, the default 15.6ms would miss every deadline above 60 fps.
+class SystemFrameClock : public FrameClock
+{
+public:
+    SystemFrameClock();
+    ~SystemFrameClock();
+
+    int64_t Now() override;
+    void WaitUntil(int64_t deadline) override;
+    int64_t ThreadCpuTime() override;
+
+    // convert a raw system timestamp (QueryPerformanceCounter ticks on Windows) to Now() time
+    int64_t FromSystemTicks(int64_t ticks) const;
+
+private:
+    SystemFrameClock(const SystemFrameClock&) = delete;
+    SystemFrameClock& operator=(const SystemFrameClock&) = delete;
+
+    // waitable timer handle and QueryPerformanceFrequency on Windows
+    void* m_timer;
+    int64_t m_frequency;
+    // timeBeginPeriod(1) is in effect for the fallback timer
+    bool m_timerPeriod;
+};
+
+// Deterministic clock: waits return immediately after advancing the time to the
+// deadline plus a fixed wakeup latency.
+class MockFrameClock : public FrameClock
+{
+public:
+    MockFrameClock() : m_now(0), m_wakeupLatency(0), m_wakeups(0) {}
+
+    int64_t Now() override { return m_now; }
+    void WaitUntil(int64_t deadline) override
+    {
+        if (deadline > m_now)
+            m_now = deadline;
+        m_now += m_wakeupLatency;
+        m_wakeups++;
+    }
+    int64_t ThreadCpuTime() override { return 0; }
+
+    // simulate work done between waits
+    void Advance(int64_t duration) { m_now += duration; }
+    void SetWakeupLatency(int64_t latency) { m_wakeupLatency = latency; }
+    uint64_t GetWakeups() const { return m_wakeups; }
+
+private:
+    int64_t m_now;
+    int64_t m_wakeupLatency;
+    uint64_t m_wakeups;
+};
+
+struct FramePacerStats
+{
+    uint64_t frames;
+    // frames where the deadline had already passed, no wait was needed
+    uint64_t missed;
+    uint64_t wakeups;
+    // wakeup error against the deadline, in nanoseconds
+    double meanError;
+    double jitter;
+    int64_t maxError;
+    // CPU time spent inside Wait() per frame, in nanoseconds
+    double waitCpuTime;
+};
+
+class FramePacer
+{
+public:
+    FramePacer(FrameClock& clock);
+
+    void SetFrameRate(uint32_t frameRate);
+    uint32_t GetFrameRate() const { return m_frameRate; }
+
+    // wait for the next frame deadline
+    void Wait();
+    // The loop stopped calling Wait, e.g. while idle. The next Wait starts a new grid
+    // instead of counting the gap as a missed frame.
+    void Reset() { m_deadline = 0; }
+
+    FramePacerStats GetStats() const;
+    void ResetStats();
+
+private:
+    FrameClock& m_clock;
+    uint32_t m_frameRate;
+    int64_t m_period;
+    int64_t m_deadline;
+
+    uint64_t m_frames;
+    uint64_t m_missed;
+    uint64_t m_wakeups;
+    double m_errorSum;
+    double m_errorSquareSum;
+    int64_t m_maxError;
+    int64_t m_waitCpuTime;
+};
@@ -0,0 +1,133 @@
+#include "histogram.h"
+
+#include <bit>
+
+LatencyHistogram::LatencyHistogram() :
+    m_current(0),
+    m_last(0)
+{
+    Clear(m_windows[0]);
+    Clear(m_windows[1]);
+}
+
+uint32_t LatencyHistogram::BucketIndex(uint64_t value)
+{
+    const uint64_t maxValue = (1ull << MAX_VALUE_BITS) - 1;
+    if (value > maxValue)
+        value = maxValue;
+
+    // small values map one to one
+    if (value < SUB_BUCKETS)
+        return (uint32_t)value;
+
+    // otherwise the top SUB_BUCKET_BITS + 1 bits of the value select the bucket
+    uint32_t shift = (uint32_t)std::bit_width(value) - 1 - SUB_BUCKET_BITS;
+    uint32_t mantissa = (uint32_t)(value >> shift);
+    return (shift + 1) * SUB_BUCKETS + (mantissa - SUB_BUCKETS);
+}
+
+uint64_t LatencyHistogram::BucketLowerBound(uint32_t index)
+{
+    if (index < SUB_BUCKETS)
+        return index;
+
+    uint32_t shift = index / SUB_BUCKETS - 1;
+    uint64_t mantissa = SUB_BUCKETS + index % SUB_BUCKETS;
+    return mantissa << shift;
+}
+
+uint64_t LatencyHistogram::BucketWidth(uint32_t index)
+{
+    if (index < SUB_BUCKETS)
+        return 1;
+    return 1ull << (index / SUB_BUCKETS - 1);
+}
+
+void LatencyHistogram::Record(uint64_t value)
+{
+    Window& window = m_windows[m_current.load(std::memory_order_relaxed)];
+
+    window.counts[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    window.count.fetch_add(1, std::memory_order_relaxed);
+    window.sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t current = window.min.load(std::memory_order_relaxed);
+    while (value < current && !window.min.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+    current = window.max.load(std::memory_order_relaxed);
+    while (value > current && !window.max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+
+    m_last.store(value, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Rotate()
+{
+    uint32_t next = m_current.load(std::memory_order_relaxed) ^ 1;
+    // A writer still holding the old index may land a sample in the window being
+    // cleared, which only loses that sample.
+    Clear(m_windows[next]);
+    m_current.store(next, std::memory_order_release);
+}
+
+LatencyStats LatencyHistogram::GetStats() const
+{
+    const Window& window = m_windows[m_current.load(std::memory_order_acquire) ^ 1];
+
+    LatencyStats stats = {};
+    stats.count = window.count.load(std::memory_order_relaxed);
+    if (stats.count == 0)
+        return stats;
+
+    stats.min = window.min.load(std::memory_order_relaxed);
+    stats.max = window.max.load(std::memory_order_relaxed);
+    stats.sum = window.sum.load(std::memory_order_relaxed);
+    stats.mean = stats.sum / stats.count;
+
+    // bucket counts can trail the total while a writer is mid-record
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < BUCKETS; i++)
+        total += window.counts[i].load(std::memory_order_relaxed);
+
+    uint64_t p50 = (total * 50 + 99) / 100;
+    uint64_t p95 = (total * 95 + 99) / 100;
+    uint64_t p99 = (total * 99 + 99) / 100;
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < BUCKETS && seen < p99; i++)
+    {
+        uint32_t count = window.counts[i].load(std::memory_order_relaxed);
+        if (count == 0)
+            continue;
+
+        uint64_t before = seen;
+        seen += count;
+        // report the middle of the bucket, kept within the exact extremes
+        uint64_t value = BucketLowerBound(i) + BucketWidth(i) / 2;
+        if (value < stats.min)
+            value = stats.min;
+        if (value > stats.max)
+            value = stats.max;
+
+        if (before < p50 && seen >= p50)
+            stats.p50 = value;
+        if (before < p95 && seen >= p95)
+            stats.p95 = value;
+        if (before < p99 && seen >= p99)
+            stats.p99 = value;
+    }
+
+    return stats;
+}
+
+void LatencyHistogram::Clear(Window& window)
+{
+    for (uint32_t i = 0; i < BUCKETS; i++)
+        window.counts[i].store(0, std::memory_order_relaxed);
+    window.count.store(0, std::memory_order_relaxed);
+    window.sum.store(0, std::memory_order_relaxed);
+    window.min.store(UINT64_MAX, std::memory_order_relaxed);
+    window.max.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+// Fixed memory, lock-free latency histogram with log-scaled buckets, values in nanoseconds.
+
+#include <atomic>
+#include <stdint.h>
+
+struct LatencyStats
+{
+    uint64_t count;
+    uint64_t min;
+    uint64_t p50;
+    uint64_t p95;
+    uint64_t p99;
+    uint64_t max;
+    uint64_t mean;
+    uint64_t sum;
+};
+
+class LatencyHistogram
+{
+public:
+    // 16 buckets per power of two, about 6% resolution
+    static constexpr uint32_t SUB_BUCKET_BITS = 4;
+    static constexpr uint32_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    // values are clamped to 2^40 ns, about 18 minutes
+    static constexpr uint32_t MAX_VALUE_BITS = 40;
+    static constexpr uint32_t BUCKETS = (MAX_VALUE_BITS - SUB_BUCKET_BITS) * SUB_BUCKETS + SUB_BUCKETS;
+
+    LatencyHistogram();
+
+    void Record(uint64_t value);
+
+    // start a new window, the stats then cover the window that just ended
+    void Rotate();
+
+    // stats of the last completed window
+    LatencyStats GetStats() const;
+    // most recent sample, in any window
+    uint64_t GetLast() const { return m_last.load(std::memory_order_relaxed); }
+
+    static uint32_t BucketIndex(uint64_t value);
+    // smallest value that falls into the bucket, and the width of the bucket
+    static uint64_t BucketLowerBound(uint32_t index);
+    static uint64_t BucketWidth(uint32_t index);
+
+private:
+    struct Window
+    {
+        std::atomic<uint32_t> counts[BUCKETS];
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum;
+        std::atomic<uint64_t> min;
+        std::atomic<uint64_t> max;
+    };
+
+    static void Clear(Window& window);
+
+    Window m_windows[2];
+    std::atomic<uint32_t> m_current;
+    std::atomic<uint64_t> m_last;
+};
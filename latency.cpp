@@ -0,0 +1,74 @@
+#include "latency.h"
+
+const char* LatencyStageName(LatencyStage stage)
+{
+    switch (stage)
+    {
+    case LatencyCopy:
+        return "copy";
+    case LatencyBlur:
+        return "blur";
+    case LatencyComposite:
+        return "composite";
+    case LatencyPresent:
+        return "present";
+    case LatencyCommit:
+        return "commit";
+    default:
+        return "unknown";
+    }
+}
+
+LatencyTracker::LatencyTracker() :
+    m_sourceTime(0),
+    m_inFrame(false),
+    m_frames(0),
+    m_dropped(0)
+{
+    for (int i = 0; i < LatencyStageCount; i++)
+        m_stamps[i] = 0;
+}
+
+void LatencyTracker::BeginFrame(int64_t sourceTime)
+{
+    if (m_inFrame)
+        EndFrame(false);
+
+    m_sourceTime = sourceTime;
+    for (int i = 0; i < LatencyStageCount; i++)
+        m_stamps[i] = 0;
+    m_inFrame = true;
+}
+
+void LatencyTracker::Stamp(LatencyStage stage, int64_t time)
+{
+    if (m_inFrame && stage < LatencyStageCount)
+        m_stamps[stage] = time;
+}
+
+void LatencyTracker::EndFrame(bool presented)
+{
+    if (!m_inFrame)
+        return;
+    m_inFrame = false;
+
+    if (!presented)
+    {
+        m_dropped++;
+        return;
+    }
+
+    m_frames++;
+    for (int i = 0; i < LatencyStageCount; i++)
+    {
+        // a stamp older than the source means a clock mismatch, leave it out
+        if (m_stamps[i] != 0 && m_stamps[i] >= m_sourceTime)
+            m_histograms[i].Record((uint64_t)(m_stamps[i] - m_sourceTime));
+    }
+}
+
+void LatencyTracker::Rotate()
+{
+    for (int i = 0; i < LatencyStageCount; i++)
+        m_histograms[i].Rotate();
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+// Capture-to-photon latency accounting, times in nanoseconds of one monotonic clock.
+
+#include <stdint.h>
+#include "histogram.h"
+
+enum LatencyStage
+{
+    LatencyCopy = 0,
+    LatencyBlur,
+    LatencyComposite,
+    LatencyPresent,
+    LatencyCommit,
+    LatencyStageCount
+};
+
+const char* LatencyStageName(LatencyStage stage);
+
+class LatencyTracker
+{
+public:
+    LatencyTracker();
+
+    // start a frame whose source image was presented at sourceTime
+    void BeginFrame(int64_t sourceTime);
+    // stages a frame does not go through (e.g. no new capture) are left out
+    void Stamp(LatencyStage stage, int64_t time);
+    // record the frame, or drop it if it never reached the screen
+    void EndFrame(bool presented);
+
+    bool InFrame() const { return m_inFrame; }
+
+    // source age at each stage over the last completed window, see LatencyHistogram
+    LatencyStats GetStats(LatencyStage stage) const { return m_histograms[stage].GetStats(); }
+    void Rotate();
+
+    uint64_t GetFrames() const { return m_frames; }
+    uint64_t GetDropped() const { return m_dropped; }
+
+private:
+    LatencyHistogram m_histograms[LatencyStageCount];
+    int64_t m_sourceTime;
+    int64_t m_stamps[LatencyStageCount];
+    bool m_inFrame;
+
+    uint64_t m_frames;
+    uint64_t m_dropped;
+};
@@ -0,0 +1,281 @@
+#include "metrics.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+
+typedef int socklen_t;
+#define CloseSocket closesocket
+#define SEND_FLAGS 0
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+typedef int SOCKET;
+#define INVALID_SOCKET (-1)
+#define CloseSocket close
+#define SEND_FLAGS MSG_NOSIGNAL
+#endif
+
+#define NO_SOCKET ((uintptr_t)INVALID_SOCKET)
+// how often the accept loop looks at the stop flag
+#define METRICS_POLL_MS 200
+// a scraper that does not send its request in time is dropped
+#define METRICS_RECEIVE_TIMEOUT_MS 1000
+#define METRICS_MAX_REQUEST 4096
+
+static void AppendMetric(std::string& out, const char* name, const char* type, const char* help, double value)
+{
+    char line[256];
+    snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n%s %.9g\n", name, help, name, type, name, value);
+    out += line;
+}
+
+void FormatMetrics(std::string& out, const PerfSnapshot& snapshot,
+    uint64_t scrapes, double scrapeSeconds, double scrapeMaxSeconds)
+{
+    out.clear();
+    AppendMetric(out, "ambientlight_frames_total", "counter", "Frames rendered.", (double)snapshot.frame);
+    AppendMetric(out, "ambientlight_frames_missed_total", "counter",
+        "Frames that started after their pacing deadline.", (double)snapshot.framesMissed);
+    AppendMetric(out, "ambientlight_target_fps", "gauge", "Frame rate the effect is paced to.", (double)snapshot.targetFps);
+    AppendMetric(out, "ambientlight_fps", "gauge", "Achieved frame rate.", snapshot.achievedFps);
+
+    // the quantiles are those of the last statistics window, about a second, the sum
+    // and count run since start
+    out += "# HELP ambientlight_stage_seconds Time spent in each stage.\n"
+        "# TYPE ambientlight_stage_seconds summary\n";
+    for (int i = 0; i < PerfStageCount; i++)
+    {
+        const char* stage = PerfStageName((PerfStage)i);
+        char line[512];
+        snprintf(line, sizeof(line),
+            "ambientlight_stage_seconds{stage=\"%s\",quantile=\"0.5\"} %.9g\n"
+            "ambientlight_stage_seconds{stage=\"%s\",quantile=\"0.95\"} %.9g\n"
+            "ambientlight_stage_seconds{stage=\"%s\",quantile=\"0.99\"} %.9g\n"
+            "ambientlight_stage_seconds_sum{stage=\"%s\"} %.9g\n"
+            "ambientlight_stage_seconds_count{stage=\"%s\"} %llu\n",
+            stage, snapshot.stageP50Ms[i] / 1e3, stage, snapshot.stageP95Ms[i] / 1e3, stage, snapshot.stageP99Ms[i] / 1e3,
+            stage, snapshot.stageSumMs[i] / 1e3, stage, (unsigned long long)snapshot.stageCount[i]);
+        out += line;
+    }
+
+    AppendMetric(out, "ambientlight_detections_total", "counter", "Black bar detection passes.", (double)snapshot.detections);
+    AppendMetric(out, "ambientlight_detection_hits_total", "counter", "Detection passes that found bars.", (double)snapshot.detectionHits);
+    AppendMetric(out, "ambientlight_detection_changes_total", "counter", "Detection passes that changed the bars.", (double)snapshot.detectionChanges);
+    AppendMetric(out, "ambientlight_detection_avoided_total", "counter", "Bar changes held back by the detection hysteresis.", (double)snapshot.detectionsAvoided);
+    AppendMetric(out, "ambientlight_texture_bytes", "gauge", "Video memory held by the effect pipeline.", (double)snapshot.textureBytes);
+    out += "# HELP ambientlight_resource_bytes Video memory held by each subsystem.\n"
+        "# TYPE ambientlight_resource_bytes gauge\n";
+    for (int i = 0; i < ResourceOwnerCount; i++)
+    {
+        char line[128];
+        snprintf(line, sizeof(line), "ambientlight_resource_bytes{owner=\"%s\"} %llu\n",
+            ResourceOwnerName((ResourceOwner)i), (unsigned long long)snapshot.resourceBytes[i]);
+        out += line;
+    }
+    AppendMetric(out, "ambientlight_resource_budget_bytes", "gauge", "Video memory budget, 0 for none.", (double)snapshot.resourceBudget);
+    AppendMetric(out, "ambientlight_resources_downgraded", "gauge",
+        "Resources allocated at a lower quality to fit the budget.", (double)snapshot.resourcesDowngraded);
+    AppendMetric(out, "ambientlight_texture_pool_hits_total", "counter",
+        "Texture requests served by a pooled texture.", (double)snapshot.poolHits);
+    AppendMetric(out, "ambientlight_texture_pool_misses_total", "counter",
+        "Texture requests that created a texture.", (double)snapshot.poolMisses);
+    AppendMetric(out, "ambientlight_texture_pool_idle_bytes", "gauge",
+        "Video memory of the unused textures kept for reuse.", (double)snapshot.poolIdleBytes);
+    AppendMetric(out, "ambientlight_texture_pool_prewarmed_total", "counter",
+        "Textures created ahead of time for the resolution presets.", (double)snapshot.poolPrewarmed);
+    AppendMetric(out, "ambientlight_captures_processed_total", "counter",
+        "Effect frames refreshed from a new capture.", (double)snapshot.capturesProcessed);
+    AppendMetric(out, "ambientlight_captures_skipped_total", "counter",
+        "Effect frames that reused the last capture.", (double)snapshot.capturesSkipped);
+
+    out += "# HELP ambientlight_scrape_seconds Time spent answering metrics requests.\n"
+        "# TYPE ambientlight_scrape_seconds summary\n";
+    char line[128];
+    snprintf(line, sizeof(line), "ambientlight_scrape_seconds_sum %.9g\nambientlight_scrape_seconds_count %llu\n",
+        scrapeSeconds, (unsigned long long)scrapes);
+    out += line;
+    AppendMetric(out, "ambientlight_scrape_max_seconds", "gauge", "Longest time spent answering a metrics request.", scrapeMaxSeconds);
+}
+
+MetricsServer::MetricsServer() :
+    m_source(nullptr),
+    m_stop(false),
+    m_socket(NO_SOCKET),
+    m_port(0),
+    m_scrapes(0),
+    m_scrapeTime(0),
+    m_scrapeMaxTime(0),
+    m_last()
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+    Stop();
+}
+
+bool MetricsServer::Start(uint16_t port, const PerfSnapshotBuffer& source)
+{
+    Stop();
+
+#ifdef _WIN32
+    WSADATA data;
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+        return false;
+#endif
+
+    SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCKET)
+    {
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return false;
+    }
+
+    // SO_REUSEADDR on Windows lets another process bind the same port and take the
+    // endpoint over, there the port is claimed exclusively; elsewhere it only allows
+    // a restart while old connections are in TIME_WAIT
+    int reuse = 1;
+#ifdef _WIN32
+    setsockopt(s, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, (const char*)&reuse, sizeof(reuse));
+#else
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+#endif
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (bind(s, (sockaddr*)&address, sizeof(address)) != 0 || listen(s, 4) != 0 ||
+        getsockname(s, (sockaddr*)&address, &length) != 0)
+    {
+        CloseSocket(s);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return false;
+    }
+
+    m_source = &source;
+    m_socket = (uintptr_t)s;
+    m_port = ntohs(address.sin_port);
+    m_stop.store(false);
+    m_thread = std::thread(&MetricsServer::Run, this);
+    return true;
+}
+
+void MetricsServer::Stop()
+{
+    if (!m_thread.joinable())
+        return;
+
+    m_stop.store(true);
+    m_thread.join();
+
+    CloseSocket((SOCKET)m_socket);
+    m_socket = NO_SOCKET;
+    m_port = 0;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+void MetricsServer::Run()
+{
+    SOCKET listener = (SOCKET)m_socket;
+    while (!m_stop.load())
+    {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(listener, &readable);
+        timeval timeout = { 0, METRICS_POLL_MS * 1000 };
+        if (select((int)listener + 1, &readable, nullptr, nullptr, &timeout) <= 0)
+            continue;
+
+        SOCKET client = accept(listener, nullptr, nullptr);
+        if (client == INVALID_SOCKET)
+            continue;
+
+#ifdef _WIN32
+        DWORD receiveTimeout = METRICS_RECEIVE_TIMEOUT_MS;
+#else
+        timeval receiveTimeout = { METRICS_RECEIVE_TIMEOUT_MS / 1000, (METRICS_RECEIVE_TIMEOUT_MS % 1000) * 1000 };
+#endif
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, (const char*)&receiveTimeout, sizeof(receiveTimeout));
+
+        Serve((uintptr_t)client);
+        CloseSocket(client);
+    }
+}
+
+void MetricsServer::Serve(uintptr_t client)
+{
+    SOCKET s = (SOCKET)client;
+
+    // the request line is all that matters, read up to the end of the headers
+    char request[METRICS_MAX_REQUEST];
+    int received = 0;
+    while (received < (int)sizeof(request) - 1)
+    {
+        int n = recv(s, request + received, (int)sizeof(request) - 1 - received, 0);
+        if (n <= 0)
+            break;
+        received += n;
+        request[received] = 0;
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n"))
+            break;
+    }
+    if (received == 0)
+        return;
+    request[received] = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    const char* status = "404 Not Found";
+    const char* contentType = "text/plain";
+    if (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET /metrics?", 13) == 0)
+    {
+        // keep the last snapshot if the render thread is publishing right now
+        m_source->Read(m_last);
+        uint64_t scrapes = m_scrapes.load(std::memory_order_relaxed);
+        FormatMetrics(m_response, m_last, scrapes, m_scrapeTime.load(std::memory_order_relaxed) / 1e9,
+            m_scrapeMaxTime.load(std::memory_order_relaxed) / 1e9);
+        status = "200 OK";
+        contentType = "text/plain; version=0.0.4";
+    }
+    else
+    {
+        m_response = "not found, try /metrics\n";
+    }
+
+    char header[256];
+    int headerLength = snprintf(header, sizeof(header),
+        "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+        status, contentType, m_response.size());
+    send(s, header, headerLength, SEND_FLAGS);
+    send(s, m_response.data(), (int)m_response.size(), SEND_FLAGS);
+
+    if (status[0] == '2')
+    {
+        uint64_t elapsed = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        m_scrapes.fetch_add(1, std::memory_order_relaxed);
+        m_scrapeTime.fetch_add(elapsed, std::memory_order_relaxed);
+        if (elapsed > m_scrapeMaxTime.load(std::memory_order_relaxed))
+            m_scrapeMaxTime.store(elapsed, std::memory_order_relaxed);
+    }
+}
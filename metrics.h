@@ -0,0 +1,54 @@
+#pragma once
+
+// Opt-in Prometheus metrics endpoint on http://127.0.0.1:<port>/metrics.
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "perfstats.h"
+
+// Prometheus text exposition of a snapshot, scrape statistics of the server included
+void FormatMetrics(std::string& out, const PerfSnapshot& snapshot,
+    uint64_t scrapes = 0, double scrapeSeconds = 0.0, double scrapeMaxSeconds = 0.0);
+
+class MetricsServer
+{
+public:
+    MetricsServer();
+    ~MetricsServer();
+
+    // Listen on the loopback interface only, port 0 picks a free one.
+    // Returns false if the socket could not be opened, the server is stopped then.
+    bool Start(uint16_t port, const PerfSnapshotBuffer& source);
+    void Stop();
+
+    bool IsRunning() const { return m_thread.joinable(); }
+    // the port listened on, 0 when stopped
+    uint16_t GetPort() const { return m_port; }
+
+    uint64_t GetScrapes() const { return m_scrapes.load(std::memory_order_relaxed); }
+
+private:
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    void Run();
+    void Serve(uintptr_t client);
+
+    const PerfSnapshotBuffer* m_source;
+    std::thread m_thread;
+    std::atomic<bool> m_stop;
+    uintptr_t m_socket;
+    uint16_t m_port;
+
+    // time spent answering /metrics, in nanoseconds
+    std::atomic<uint64_t> m_scrapes;
+    std::atomic<uint64_t> m_scrapeTime;
+    std::atomic<uint64_t> m_scrapeMaxTime;
+
+    // last snapshot read, used again when a read races with a publish
+    PerfSnapshot m_last;
+    std::string m_response;
+};
@@ -0,0 +1,74 @@
+#include "perfstats.h"
+
+#include <string.h>
+
+#define SNAPSHOT_READ_ATTEMPTS 16
+
+const char* PerfStageName(PerfStage stage)
+{
+    switch (stage)
+    {
+    case PerfStageFrame:
+        return "frame";
+    case PerfStageCapture:
+        return "capture";
+    case PerfStageCopy:
+        return "copy";
+    case PerfStageMips:
+        return "mips";
+    case PerfStageBlur:
+        return "blur";
+    case PerfStageComposite:
+        return "composite";
+    case PerfStagePresent:
+        return "present";
+    case PerfStageDetect:
+        return "detect";
+    default:
+        return "unknown";
+    }
+}
+
+PerfSnapshotBuffer::PerfSnapshotBuffer() : m_sequence(0)
+{
+    for (size_t i = 0; i < WORDS; i++)
+        m_words[i].store(0, std::memory_order_relaxed);
+}
+
+void PerfSnapshotBuffer::Publish(const PerfSnapshot& snapshot)
+{
+    uint64_t words[WORDS];
+    memcpy(words, &snapshot, sizeof(words));
+
+    // odd while writing
+    uint64_t sequence = m_sequence.load(std::memory_order_relaxed);
+    m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (size_t i = 0; i < WORDS; i++)
+        m_words[i].store(words[i], std::memory_order_relaxed);
+
+    m_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool PerfSnapshotBuffer::Read(PerfSnapshot& out) const
+{
+    uint64_t words[WORDS];
+    for (int attempt = 0; attempt < SNAPSHOT_READ_ATTEMPTS; attempt++)
+    {
+        uint64_t before = m_sequence.load(std::memory_order_acquire);
+        if (before & 1)
+            continue;
+
+        for (size_t i = 0; i < WORDS; i++)
+            words[i] = m_words[i].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_sequence.load(std::memory_order_relaxed) == before)
+        {
+            memcpy(&out, words, sizeof(words));
+            return true;
+        }
+    }
+    return false;
+}
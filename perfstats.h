@@ -0,0 +1,91 @@
+#pragma once
+
+// Lock-free snapshot of the frame statistics.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <type_traits>
+
+#include "resourceregistry.h"
+
+enum PerfStage
+{
+    PerfStageFrame = 0,
+    PerfStageCapture,
+    PerfStageCopy,
+    PerfStageMips,
+    PerfStageBlur,
+    PerfStageComposite,
+    PerfStagePresent,
+    PerfStageDetect,
+    PerfStageCount
+};
+
+const char* PerfStageName(PerfStage stage);
+
+// only 8 byte fields, the buffer copies it word by word
+struct PerfSnapshot
+{
+    // frames rendered since start, a new value means new stage times
+    uint64_t frame;
+    // time spent in each stage during that frame, 0 if the stage did not run, in milliseconds
+    double stageMs[PerfStageCount];
+    // percentiles of each stage over the last completed statistics window, about a
+    // second, and its runs and total time since start, in milliseconds
+    double stageP50Ms[PerfStageCount];
+    double stageP95Ms[PerfStageCount];
+    double stageP99Ms[PerfStageCount];
+    uint64_t stageCount[PerfStageCount];
+    double stageSumMs[PerfStageCount];
+
+    uint64_t targetFps;
+    double achievedFps;
+    // frames that started after their pacing deadline had passed
+    uint64_t framesMissed;
+
+    // detection passes, passes that found bars, passes that changed the bars
+    uint64_t detections;
+    uint64_t detectionHits;
+    uint64_t detectionChanges;
+    // bar changes the hysteresis held back, each one a reconfiguration saved
+    uint64_t detectionsAvoided;
+
+    // video memory held by the textures and swapchains of the resource registry
+    uint64_t textureBytes;
+    uint64_t resourceBytes[ResourceOwnerCount];
+    // budget, 0 for none, and the resources allocated at a lower quality to fit it
+    uint64_t resourceBudget;
+    uint64_t resourcesDowngraded;
+    // texture requests served from the pool and ones that created a texture, and the
+    // unused textures the pool holds on to
+    uint64_t poolHits;
+    uint64_t poolMisses;
+    uint64_t poolIdleBytes;
+    // textures created ahead of time for the resolution presets
+    uint64_t poolPrewarmed;
+
+    // effect frames that refreshed the source from a new capture, and that reused the last one
+    uint64_t capturesProcessed;
+    uint64_t capturesSkipped;
+};
+
+// Sequence lock with a single writer. Publish never waits, Read retries while a
+// publish is in progress and gives up after a few attempts.
+class PerfSnapshotBuffer
+{
+public:
+    PerfSnapshotBuffer();
+
+    void Publish(const PerfSnapshot& snapshot);
+    // false if no consistent copy could be taken, out is left unchanged
+    bool Read(PerfSnapshot& out) const;
+
+private:
+    static_assert(std::is_trivially_copyable<PerfSnapshot>::value, "snapshot is copied word by word");
+    static_assert(sizeof(PerfSnapshot) % sizeof(uint64_t) == 0, "snapshot is copied word by word");
+    static constexpr size_t WORDS = sizeof(PerfSnapshot) / sizeof(uint64_t);
+
+    std::atomic<uint64_t> m_sequence;
+    std::atomic<uint64_t> m_words[WORDS];
+};
@@ -4,7 +4,7 @@
 
 #define APP_WINDOW_CLASS_NAME L"ambientlightapp"
 
-PresentWindow::PresentWindow()
+PresentWindow::PresentWindow() : m_hwnd(nullptr), m_render(nullptr), m_quit(false)
 {
 }
 
@@ -95,17 +95,60 @@ void PresentWindow::Run()
     // Show the window
     ShowWindow(m_hwnd, SW_SHOWNORMAL);
 
+    m_quit = false;
+    RunMessageLoop(*this);
+}
+
+bool PresentWindow::HandleMessage()
+{
     MSG msg = {};
-    while (msg.message != WM_QUIT)
-    {
-        if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
-        {
-            TranslateMessage(&msg);
-            DispatchMessage(&msg);
-        }
-        if (m_render)
-            m_render->Render();
-    }
+    if (!PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+        return false;
+
+    if (msg.message == WM_QUIT)
+        m_quit = true;
+    TranslateMessage(&msg);
+    DispatchMessage(&msg);
+    return true;
+}
+
+uint32_t PresentWindow::GetWaitTimeout()
+{
+    // without a renderer there is nothing but messages to wait for
+    if (!m_render)
+        return INFINITE;
+    return m_render->GetWaitTimeout();
+}
+
+uint32_t PresentWindow::GetWaitHandles(void** handles)
+{
+    // a config.ini edit is applied right away, not at the next idle wakeup
+    HANDLE settingsChanged = GetSettingsChangeEvent();
+    if (!m_render || !settingsChanged)
+        return 0;
+    handles[0] = settingsChanged;
+    return 1;
+}
+
+uint32_t PresentWindow::WaitForMessage(uint32_t timeout, void* const* handles, uint32_t handleCount)
+{
+    DWORD result = MsgWaitForMultipleObjectsEx(handleCount, (const HANDLE*)handles, timeout, QS_ALLINPUT,
+        MWMO_INPUTAVAILABLE);
+    if (result > WAIT_OBJECT_0 + handleCount)
+        return MESSAGE_LOOP_TIMEOUT;
+    return result - WAIT_OBJECT_0;
+}
+
+void PresentWindow::HandleSignal(uint32_t)
+{
+    // reading the settings resets the event
+    m_render->ReloadSettings();
+}
+
+void PresentWindow::Render()
+{
+    if (m_render)
+        m_render->Render();
 }
 
 LRESULT CALLBACK PresentWindow::WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
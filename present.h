@@ -2,9 +2,10 @@
 
 #include "common.h"
 #include "ambientlight.h"
+#include "scheduler.h"
 
 
-class PresentWindow
+class PresentWindow : private MessageLoopHost
 {
 public:
     PresentWindow();
@@ -19,6 +20,15 @@ public:
 protected:
     static LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam);
 private:
+    bool HandleMessage() override;
+    bool IsQuitting() override { return m_quit; }
+    uint32_t GetWaitTimeout() override;
+    uint32_t GetWaitHandles(void** handles) override;
+    uint32_t WaitForMessage(uint32_t timeout, void* const* handles, uint32_t handleCount) override;
+    void HandleSignal(uint32_t index) override;
+    void Render() override;
+
     HWND m_hwnd;
     AmbientLight* m_render;
+    bool m_quit;
 };
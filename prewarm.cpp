@@ -0,0 +1,107 @@
+#include "prewarm.h"
+
+#include <algorithm>
+#include <cmath>
+
+bool GetPresetGameSize(uint32_t windowWidth, uint32_t windowHeight, const PrewarmPreset& preset,
+    uint32_t& gameWidth, uint32_t& gameHeight)
+{
+    if (windowWidth == 0 || windowHeight == 0 || preset.width == 0 || preset.height == 0)
+        return false;
+
+    // same float math as GetFixedBars, the bars are what the game size is taken from
+    float aspect = (float)preset.width / (float)preset.height;
+    float windowAspect = (float)windowWidth / (float)windowHeight;
+
+    uint32_t height = windowHeight;
+    uint32_t width = (uint32_t)std::round((float)height * aspect);
+    if (width > windowWidth)
+    {
+        width = windowWidth;
+        height = (uint32_t)std::round((float)width / aspect);
+    }
+
+    gameWidth = windowWidth;
+    gameHeight = windowHeight;
+    if (aspect > windowAspect)
+        gameHeight = windowHeight - (windowHeight - height) / 2 * 2;
+    else
+        gameWidth = windowWidth - (windowWidth - width) / 2 * 2;
+    return true;
+}
+
+static TexturePoolKey GetKey(const PrewarmInputs& inputs, ResourceOwner owner, const char* name,
+    uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t flags, uint32_t downgrades)
+{
+    TexturePoolKey key = {};
+    key.desc = { owner, name, width, height, inputs.format, mipLevels, 1, downgrades };
+    key.nativeFormat = inputs.nativeFormat;
+    key.flags = flags;
+    key.budget = inputs.budget;
+    return key;
+}
+
+uint32_t GetOffscreenKeys(const PrewarmInputs& inputs, uint32_t gameWidth, uint32_t gameHeight,
+    TexturePoolKey keys[PREWARM_MAX_KEYS])
+{
+    uint32_t count = 0;
+    keys[count++] = GetKey(inputs, ResourceOwnerEffect, "game", gameWidth, gameHeight, 0,
+        TexturePoolGenerateMips, ResourceDowngradeNone);
+
+    uint32_t mipWidth = std::max(1u, gameWidth >> inputs.mipmapLevels);
+    uint32_t mipHeight = std::max(1u, gameHeight >> inputs.mipmapLevels);
+    bool canDowngrade = inputs.mipmapLevels + RESOURCE_MAX_MIP_SHIFT < GetMipChainLength(gameWidth, gameHeight);
+    keys[count++] = GetKey(inputs, ResourceOwnerEffect, "downsampled", mipWidth, mipHeight, 1,
+        TexturePoolNone, canDowngrade ? ResourceDowngradeMip : ResourceDowngradeNone);
+
+    if (inputs.temporalInterpolation)
+    {
+        keys[count++] = GetKey(inputs, ResourceOwnerEffect, "previous", mipWidth, mipHeight, 1,
+            TexturePoolNone, ResourceDowngradeNone);
+    }
+
+    keys[count++] = GetKey(inputs, ResourceOwnerBlur, "blur temp", mipWidth, mipHeight, 1,
+        TexturePoolNone, ResourceDowngradeFormat);
+    return count;
+}
+
+std::vector<TexturePoolKey> PlanPrewarm(const PrewarmInputs& inputs, const PrewarmPreset* presets, size_t count)
+{
+    std::vector<TexturePoolKey> plan;
+    TexturePoolKey current[PREWARM_MAX_KEYS];
+    uint32_t currentCount = GetOffscreenKeys(inputs, inputs.gameWidth, inputs.gameHeight, current);
+
+    uint64_t bytes = 0;
+    for (uint32_t k = 0; k < currentCount; k++)
+        bytes += GetResourceBytes(current[k].desc);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t gameWidth, gameHeight;
+        if (!GetPresetGameSize(inputs.windowWidth, inputs.windowHeight, presets[i], gameWidth, gameHeight))
+            continue;
+
+        TexturePoolKey keys[PREWARM_MAX_KEYS];
+        uint32_t keyCount = GetOffscreenKeys(inputs, gameWidth, gameHeight, keys);
+
+        // keys the current size or an earlier preset asks for already
+        TexturePoolKey added[PREWARM_MAX_KEYS];
+        uint32_t addedCount = 0;
+        uint64_t addedBytes = 0;
+        for (uint32_t k = 0; k < keyCount; k++)
+        {
+            bool known = std::find(current, current + currentCount, keys[k]) != current + currentCount ||
+                std::find(plan.begin(), plan.end(), keys[k]) != plan.end();
+            if (known)
+                continue;
+            added[addedCount++] = keys[k];
+            addedBytes += GetResourceBytes(keys[k].desc);
+        }
+
+        if (addedCount == 0 || bytes + addedBytes > inputs.cap)
+            continue;
+        plan.insert(plan.end(), added, added + addedCount);
+        bytes += addedBytes;
+    }
+    return plan;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+// Textures of the resolution presets, created before the first switch to them.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "texturepool.h"
+
+// most keys one game size asks the pool for
+#define PREWARM_MAX_KEYS 4
+
+struct PrewarmPreset
+{
+    // as in config.ini, a resolution or an aspect ratio
+    uint32_t width;
+    uint32_t height;
+};
+
+struct PrewarmInputs
+{
+    uint32_t windowWidth;
+    uint32_t windowHeight;
+    // game area of the current preset, its textures exist already
+    uint32_t gameWidth;
+    uint32_t gameHeight;
+
+    // DXGI format of the desktop, and its registry format
+    uint32_t nativeFormat;
+    ResourceFormat format;
+    uint32_t mipmapLevels;
+    bool temporalInterpolation;
+    // registry budget, downgradable keys are allocated under it
+    uint64_t budget;
+    // bytes of idle textures the pool keeps, the plan stays within it
+    uint64_t cap;
+};
+
+// Game area of a preset centered in the window, the size Detection::GetFixedBars and
+// AmbientLight::ValidateSettings give it. false for an empty preset.
+bool GetPresetGameSize(uint32_t windowWidth, uint32_t windowHeight, const PrewarmPreset& preset,
+    uint32_t& gameWidth, uint32_t& gameHeight);
+
+// The keys AmbientLight::CreateOffscreen and Blur::Render ask the pool for at a game
+// size, at the quality the budget is not expected to take away. Returns the key count.
+uint32_t GetOffscreenKeys(const PrewarmInputs& inputs, uint32_t gameWidth, uint32_t gameHeight,
+    TexturePoolKey keys[PREWARM_MAX_KEYS]);
+
+// Keys of every preset size other than the current one, in preset order, each key once.
+// The current textures go back to the pool on the next switch, so the plan keeps to
+// the cap less their size. A size whose keys do not all fit is left out.
+std::vector<TexturePoolKey> PlanPrewarm(const PrewarmInputs& inputs, const PrewarmPreset* presets, size_t count);
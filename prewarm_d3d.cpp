@@ -0,0 +1,77 @@
+#include "prewarm_d3d.h"
+#include "texturepool_d3d.h"
+
+#include <chrono>
+
+void TexturePrewarmer::Start(ID3D11Device* device, std::vector<TexturePoolKey> plan, DWORD delayMs)
+{
+    Stop();
+    if (plan.empty())
+        return;
+    m_stop = false;
+    m_thread = std::thread([this, device = ComPtr<ID3D11Device>(device), plan = std::move(plan), delayMs]()
+    {
+        Run(device.Get(), plan, delayMs);
+    });
+}
+
+void TexturePrewarmer::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    if (m_thread.joinable())
+        m_thread.join();
+    m_ready.clear();
+}
+
+UINT TexturePrewarmer::Adopt(ID3D11Device* device)
+{
+    std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+    if (!lock.owns_lock() || m_ready.empty())
+        return 0;
+
+    UINT adopted = 0;
+    for (const Prewarmed& prewarmed : m_ready)
+    {
+        if (GetTexturePool().Adopt(device, prewarmed.key, prewarmed.view))
+            adopted++;
+    }
+    m_ready.clear();
+    m_adopted += adopted;
+    return adopted;
+}
+
+void TexturePrewarmer::Run(ID3D11Device* device, const std::vector<TexturePoolKey>& plan, DWORD delayMs)
+{
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_wake.wait_for(lock, std::chrono::milliseconds(delayMs), [this]() { return m_stop; }))
+            return;
+    }
+
+    for (const TexturePoolKey& key : plan)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stop)
+                return;
+        }
+
+        D3D11_TEXTURE2D_DESC desc = D3DTexturePool::GetTextureDesc(key.desc, (DXGI_FORMAT)key.nativeFormat,
+            (key.flags & TexturePoolGenerateMips) != 0);
+        ComPtr<ID3D11Texture2D> texture;
+        if (FAILED(device->CreateTexture2D(&desc, nullptr, &texture)))
+            continue;
+        Prewarmed prewarmed = { key };
+        prewarmed.view.CreateViews(device, texture.Get());
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stop)
+            return;
+        m_ready.push_back(prewarmed);
+    }
+}
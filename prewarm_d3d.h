@@ -0,0 +1,50 @@
+#pragma once
+
+// Creates the textures of a prewarm plan on a low priority thread of its own.
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+#include "texturepool.h"
+
+class TexturePrewarmer
+{
+public:
+    TexturePrewarmer() : m_stop(false), m_adopted(0) {}
+    ~TexturePrewarmer() { Stop(); }
+
+    // starts over with a new plan, after a delay that leaves the start of the pipeline alone
+    void Start(ID3D11Device* device, std::vector<TexturePoolKey> plan, DWORD delayMs);
+    // textures created but not adopted yet are dropped
+    void Stop();
+
+    // Hands the textures created so far to the texture pool, never waits for the thread.
+    // Returns the number the pool took.
+    UINT Adopt(ID3D11Device* device);
+
+    // textures handed to the pool since the app started
+    UINT64 GetAdopted() const { return m_adopted; }
+
+private:
+    TexturePrewarmer(const TexturePrewarmer&) = delete;
+    TexturePrewarmer& operator=(const TexturePrewarmer&) = delete;
+
+    struct Prewarmed
+    {
+        TexturePoolKey key;
+        TextureView view;
+    };
+
+    void Run(ID3D11Device* device, const std::vector<TexturePoolKey>& plan, DWORD delayMs);
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    // guarded by m_mutex
+    bool m_stop;
+    std::vector<Prewarmed> m_ready;
+    UINT64 m_adopted;
+};
@@ -0,0 +1,101 @@
+#include "reconfigure.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const char* ReconfigureStageName(ReconfigureStage stage)
+{
+    switch (stage)
+    {
+    case ReconfigureVignette:
+        return "vignette";
+    case ReconfigureOffscreen:
+        return "offscreen";
+    case ReconfigureBarSurfaces:
+        return "barsurfaces";
+    case ReconfigureBlur:
+        return "blur";
+    case ReconfigureDetection:
+        return "detection";
+    case ReconfigureDetectionInner:
+        return "detectinner";
+    case ReconfigureUI:
+        return "ui";
+    case ReconfigureWindow:
+        return "window";
+    default:
+        return "unknown";
+    }
+}
+
+void FormatReconfigureStages(uint32_t stages, char* buffer, size_t size)
+{
+    if (size == 0)
+        return;
+    buffer[0] = 0;
+    if (stages == 0)
+    {
+        snprintf(buffer, size, "none");
+        return;
+    }
+
+    size_t length = 0;
+    for (uint32_t i = 0; i < ReconfigureStageCount && length < size; i++)
+    {
+        if (stages & (1u << i))
+        {
+            int written = snprintf(buffer + length, size - length, "%s%s", length ? " " : "",
+                ReconfigureStageName((ReconfigureStage)(1u << i)));
+            if (written < 0)
+                break;
+            length += (size_t)written;
+        }
+    }
+}
+
+uint32_t GetReconfigureStages(const ReconfigureInputs& built, const ReconfigureInputs& wanted)
+{
+    const ReconfigureInputs& a = built;
+    const ReconfigureInputs& b = wanted;
+
+    bool window = a.windowWidth != b.windowWidth || a.windowHeight != b.windowHeight;
+    bool game = a.gameWidth != b.gameWidth || a.gameHeight != b.gameHeight;
+    bool bars = a.barRectCount != b.barRectCount || memcmp(a.barRects, b.barRects, sizeof(a.barRects)) != 0;
+    bool format = a.format != b.format;
+    bool detection = a.brightnessThreshold != b.brightnessThreshold || a.blackRatio != b.blackRatio ||
+        a.colorSpace != b.colorSpace;
+
+    uint32_t stages = 0;
+    if (window || a.vignetteIntensity != b.vignetteIntensity || a.vignetteRadius != b.vignetteRadius ||
+        a.vignetteSmoothness != b.vignetteSmoothness)
+        stages |= ReconfigureVignette;
+
+    if (window || game || format || a.mipmapLevels != b.mipmapLevels || a.memoryBudget != b.memoryBudget ||
+        a.temporalInterpolation != b.temporalInterpolation || a.barSurfaces != b.barSurfaces)
+        stages |= ReconfigureOffscreen;
+
+    if (window || bars || format || a.barSurfaces != b.barSurfaces || a.barSurfaceScale != b.barSurfaceScale)
+        stages |= ReconfigureBarSurfaces;
+
+    // the offscreen pass drops the canvas a failed bar surface falls back to
+    if ((stages & ReconfigureOffscreen) && b.barSurfaces)
+        stages |= ReconfigureBarSurfaces;
+
+    if ((stages & ReconfigureOffscreen) || a.blurSamples != b.blurSamples)
+        stages |= ReconfigureBlur;
+
+    if (window || detection || a.symmetricBars != b.symmetricBars ||
+        a.reservedWidth != b.reservedWidth || a.reservedHeight != b.reservedHeight)
+        stages |= ReconfigureDetection;
+
+    if (game || detection)
+        stages |= ReconfigureDetectionInner;
+
+    if (a.uiScale != b.uiScale)
+        stages |= ReconfigureUI;
+
+    if (a.showInTaskbar != b.showInTaskbar)
+        stages |= ReconfigureWindow;
+
+    return stages;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+// Which parts of the pipeline a settings or geometry change has to rebuild.
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum ReconfigureStage
+{
+    // vignette mask, depends on the window aspect
+    ReconfigureVignette = 1 << 0,
+    // game, downsampled and previous textures, and the full window canvas
+    ReconfigureOffscreen = 1 << 1,
+    ReconfigureBarSurfaces = 1 << 2,
+    // blur constants, sized by the downsampled texture
+    ReconfigureBlur = 1 << 3,
+    ReconfigureDetection = 1 << 4,
+    ReconfigureDetectionInner = 1 << 5,
+    // ImGui context and font atlas
+    ReconfigureUI = 1 << 6,
+    // taskbar and other window styles
+    ReconfigureWindow = 1 << 7,
+
+    ReconfigureStageCount = 8,
+    ReconfigureAll = (1 << ReconfigureStageCount) - 1
+};
+
+const char* ReconfigureStageName(ReconfigureStage stage);
+
+// space separated names of the stages, "none" for 0
+void FormatReconfigureStages(uint32_t stages, char* buffer, size_t size);
+
+// everything the stages are built from
+struct ReconfigureInputs
+{
+    uint32_t windowWidth;
+    uint32_t windowHeight;
+    uint32_t gameWidth;
+    uint32_t gameHeight;
+    // bar rectangles in window coordinates, left, top, right, bottom
+    uint32_t barRects[2][4];
+    uint32_t barRectCount;
+
+    // DXGI format and color space of the desktop
+    uint32_t format;
+    uint32_t colorSpace;
+
+    uint32_t mipmapLevels;
+    uint64_t memoryBudget;
+    bool temporalInterpolation;
+    bool barSurfaces;
+    uint32_t barSurfaceScale;
+    uint32_t blurSamples;
+
+    float vignetteIntensity;
+    float vignetteRadius;
+    float vignetteSmoothness;
+
+    float brightnessThreshold;
+    float blackRatio;
+    bool symmetricBars;
+    uint32_t reservedWidth;
+    uint32_t reservedHeight;
+
+    float uiScale;
+    bool showInTaskbar;
+};
+
+// ReconfigureStage bits of the stages whose inputs differ
+uint32_t GetReconfigureStages(const ReconfigureInputs& built, const ReconfigureInputs& wanted);
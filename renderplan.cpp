@@ -0,0 +1,277 @@
+#include "renderplan.h"
+
+#include <string.h>
+#include <algorithm>
+
+// BlackBarPosition
+enum PlanBarPosition
+{
+    PlanTop = 0,
+    PlanBottom,
+    PlanLeft,
+    PlanRight
+};
+
+static bool IsVertical(uint32_t position)
+{
+    return position == PlanLeft || position == PlanRight;
+}
+
+// BlackBar::toBox of a bar of size across its edge, the other side spans the parent
+static SurfaceRect GetBarBox(uint32_t position, uint32_t size, uint32_t parentWidth, uint32_t parentHeight)
+{
+    uint32_t clampH = std::min(size, parentHeight);
+    uint32_t clampW = std::min(size, parentWidth);
+    switch (position)
+    {
+    case PlanTop:
+        return { 0, 0, parentWidth, clampH };
+    case PlanBottom:
+        return { 0, parentHeight - clampH, parentWidth, parentHeight };
+    case PlanLeft:
+        return { 0, 0, clampW, parentHeight };
+    default:
+        return { parentWidth - clampW, 0, parentWidth, parentHeight };
+    }
+}
+
+RenderPlan BuildRenderPlan(const RenderPlanInputs& inputs)
+{
+    RenderPlan plan = {};
+    const BarLayout& bars = inputs.bars;
+    if (bars.count != 2 || inputs.gameWidth == 0 || inputs.gameHeight == 0)
+        return plan;
+
+    // a bar is as long as the window side it lies on
+    uint32_t barWidth[2], barHeight[2];
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        barWidth[i] = IsVertical(bars.positions[i]) ? bars.sizes[i] : inputs.windowWidth;
+        barHeight[i] = IsVertical(bars.positions[i]) ? inputs.windowHeight : bars.sizes[i];
+    }
+
+    SurfaceRect& box = plan.gameBox;
+    if (inputs.gameHeight == inputs.windowHeight)
+    {
+        // black bars on left/right
+        box = { barWidth[0], 0, inputs.windowWidth - barWidth[1], inputs.windowHeight };
+    }
+    else if (inputs.gameWidth == inputs.windowWidth)
+    {
+        // black bars on top/bottom
+        box = { 0, barHeight[0], inputs.windowWidth, inputs.windowHeight - barHeight[1] };
+    }
+    else
+    {
+        return plan;
+    }
+    if (box.left >= box.right || box.top >= box.bottom)
+        return plan;
+
+    // The blurred mip is sampled directly by the composite. The region of the mip that
+    // represents the game area (minus the zoom margin) is mapped onto game coordinates,
+    // so there is no need to upscale the blurred image back to the game resolution.
+    plan.mipWidth = std::max(1u, inputs.gameWidth >> inputs.mipLevel);
+    plan.mipHeight = std::max(1u, inputs.gameHeight >> inputs.mipLevel);
+    float regionWidth = (float)plan.mipWidth;
+    float regionHeight = (float)plan.mipHeight;
+    if (plan.mipWidth > inputs.zoom * 2 && plan.mipHeight > inputs.zoom * 2)
+    {
+        plan.regionX = (float)inputs.zoom;
+        plan.regionY = (float)inputs.zoom;
+        regionWidth = (float)(plan.mipWidth - inputs.zoom * 2);
+        regionHeight = (float)(plan.mipHeight - inputs.zoom * 2);
+    }
+    plan.gameToMipX = regionWidth / (float)inputs.gameWidth;
+    plan.gameToMipY = regionHeight / (float)inputs.gameHeight;
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        // the edge of the game next to the bar, narrower by the stretch factor
+        uint32_t position = bars.positions[i];
+        uint32_t sourceSize = IsVertical(position) ? barWidth[i] : barHeight[i];
+        sourceSize = (uint32_t)((float)sourceSize / inputs.stretchFactor);
+        SurfaceRect src = GetBarBox(position, sourceSize, inputs.gameWidth, inputs.gameHeight);
+        SurfaceRect dst = GetBarBox(position, IsVertical(position) ? barWidth[i] : barHeight[i],
+            inputs.windowWidth, inputs.windowHeight);
+
+        FlipMode flip = FlipNone;
+        if (inputs.mirrored)
+            flip = (inputs.gameWidth == inputs.windowWidth) ? FlipVertical : FlipHorizontal;
+
+        CompositeBar& bar = plan.bars[i];
+        bar.targetX = dst.left;
+        bar.targetY = dst.top;
+        bar.targetWidth = dst.right - dst.left;
+        bar.targetHeight = dst.bottom - dst.top;
+        bar.sourceX = plan.regionX + src.left * plan.gameToMipX;
+        bar.sourceY = plan.regionY + src.top * plan.gameToMipY;
+        bar.sourceWidth = (src.right - src.left) * plan.gameToMipX;
+        bar.sourceHeight = (src.bottom - src.top) * plan.gameToMipY;
+        bar.windowX = (float)dst.left;
+        bar.windowY = (float)dst.top;
+        bar.windowWidth = (float)bar.targetWidth;
+        bar.windowHeight = (float)bar.targetHeight;
+        bar.flip = flip;
+        plan.barPixels += (uint64_t)bar.targetWidth * bar.targetHeight;
+    }
+
+    plan.valid = true;
+    return plan;
+}
+
+UVRect GetSourceUV(const RenderPlan& plan, const SurfaceRect& gameRect)
+{
+    UVRect uv = {};
+    if (plan.mipWidth == 0 || plan.mipHeight == 0)
+        return uv;
+    uv.left = (plan.regionX + gameRect.left * plan.gameToMipX) / plan.mipWidth;
+    uv.top = (plan.regionY + gameRect.top * plan.gameToMipY) / plan.mipHeight;
+    uv.right = (plan.regionX + gameRect.right * plan.gameToMipX) / plan.mipWidth;
+    uv.bottom = (plan.regionY + gameRect.bottom * plan.gameToMipY) / plan.mipHeight;
+
+    uint32_t gameWidth = plan.gameBox.right - plan.gameBox.left;
+    uint32_t gameHeight = plan.gameBox.bottom - plan.gameBox.top;
+    if (gameRect.left == 0)
+        uv.left = -1.0f;
+    if (gameRect.top == 0)
+        uv.top = -1.0f;
+    if (gameRect.right >= gameWidth)
+        uv.right = 2.0f;
+    if (gameRect.bottom >= gameHeight)
+        uv.bottom = 2.0f;
+    return uv;
+}
+
+uint32_t GetCompositeDraws(const RenderPlan& plan, const PlannedSurface* surfaces, uint32_t surfaceCount,
+    CompositeDraw* draws)
+{
+    if (!plan.valid)
+        return 0;
+
+    if (surfaceCount == 0)
+    {
+        CompositeDraw& draw = draws[0];
+        memcpy(draw.bars, plan.bars, sizeof(draw.bars));
+        draw.barCount = 2;
+        draw.surface = COMPOSITE_WINDOW;
+        draw.slot = 0;
+        return 1;
+    }
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < surfaceCount && i < COMPOSITE_MAX_SLOTS; i++)
+    {
+        const PlannedSurface& surface = surfaces[i];
+        for (uint32_t j = 0; j < 2; j++)
+        {
+            const CompositeBar& bar = plan.bars[j];
+            if (bar.targetX != surface.window.left || bar.targetY != surface.window.top ||
+                bar.targetWidth == 0 || bar.targetHeight == 0)
+                continue;
+
+            CompositeDraw& draw = draws[count++];
+            memset(&draw, 0, sizeof(draw));
+            draw.bars[0] = bar;
+            draw.bars[0].targetX = 0;
+            draw.bars[0].targetY = 0;
+            draw.bars[0].targetWidth = surface.width;
+            draw.bars[0].targetHeight = surface.height;
+            draw.barCount = 1;
+            draw.surface = i;
+            draw.slot = i;
+            break;
+        }
+    }
+    return count;
+}
+
+bool CompositeSubmitter::Submit(CompositeContext& context, uint32_t slot, const CompositeBar* bars, uint32_t barCount,
+    const CompositeInputs& inputs)
+{
+    if (slot >= COMPOSITE_MAX_SLOTS)
+        return false;
+
+    barCount = std::min(barCount, (uint32_t)COMPOSITE_MAX_BARS);
+    if (barCount == 0)
+        return true;
+
+    // compared byte for byte with the last upload, padding included
+    CompositeParameters params;
+    memset(&params, 0, sizeof(params));
+    uint32_t maxWidth = 0;
+    uint32_t maxHeight = 0;
+    for (uint32_t i = 0; i < barCount; i++)
+    {
+        const CompositeBar& bar = bars[i];
+        float source[4] = { bar.sourceX, bar.sourceY, bar.sourceWidth, bar.sourceHeight };
+        float target[4] = { (float)bar.targetX, (float)bar.targetY, (float)bar.targetWidth, (float)bar.targetHeight };
+        float window[4] = { bar.windowX, bar.windowY, bar.windowWidth, bar.windowHeight };
+        memcpy(params.barSource[i], source, sizeof(source));
+        memcpy(params.barTarget[i], target, sizeof(target));
+        memcpy(params.barWindow[i], window, sizeof(window));
+        params.barFlip[i][0] = bar.flip == FlipHorizontal ? 1u : 0u;
+        params.barFlip[i][1] = bar.flip == FlipVertical ? 1u : 0u;
+
+        maxWidth = std::max(maxWidth, bar.targetWidth);
+        maxHeight = std::max(maxHeight, bar.targetHeight);
+    }
+
+    params.maskCount = inputs.masks ? std::min(inputs.maskCount, (uint32_t)COMPOSITE_MAX_MASK_RECTS) : 0;
+    for (uint32_t i = 0; i < params.maskCount; i++)
+    {
+        float rect[4] = { inputs.masks[i].left, inputs.masks[i].top, inputs.masks[i].right, inputs.masks[i].bottom };
+        memcpy(params.maskRects[i], rect, sizeof(rect));
+    }
+
+    params.vignetteEnabled = inputs.vignette ? 1 : 0;
+    params.lumaMaskEnabled = inputs.lumaMask ? 1 : 0;
+    params.windowSize[0] = (float)inputs.windowWidth;
+    params.windowSize[1] = (float)inputs.windowHeight;
+    params.blendEnabled = inputs.previous ? 1 : 0;
+    params.blend = inputs.blend;
+
+    // buffer contents persist across command lists, the last upload is still in place
+    if (m_caches[slot].Update(&params, sizeof(params)))
+        context.UpdateParameters(slot, params);
+
+    // only the bar rectangles are dispatched, one slice per bar
+    context.Dispatch(slot, (maxWidth + 15) / 16, (maxHeight + 15) / 16, barCount);
+    return true;
+}
+
+void CompositeSubmitter::Invalidate()
+{
+    for (ConstantCache& cache : m_caches)
+        cache.Invalidate();
+}
+
+uint64_t CompositeSubmitter::GetUploads() const
+{
+    uint64_t uploads = 0;
+    for (const ConstantCache& cache : m_caches)
+        uploads += cache.GetUploads();
+    return uploads;
+}
+
+uint64_t CompositeSubmitter::GetSkippedUploads() const
+{
+    uint64_t skipped = 0;
+    for (const ConstantCache& cache : m_caches)
+        skipped += cache.GetSkipped();
+    return skipped;
+}
+
+bool ConstantCache::Update(const void* data, size_t size)
+{
+    if (m_valid && m_data.size() == size && memcmp(m_data.data(), data, size) == 0)
+    {
+        m_skipped++;
+        return false;
+    }
+
+    m_data.assign((const uint8_t*)data, (const uint8_t*)data + size);
+    m_valid = true;
+    m_uploads++;
+    return true;
+}
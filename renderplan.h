@@ -0,0 +1,165 @@
+#pragma once
+
+// What the effect pass draws, built once per geometry or settings change.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "bartracker.h"
+#include "surfaceplan.h"
+#include "shaders/reference.h"
+
+struct RenderPlanInputs
+{
+    uint32_t windowWidth;
+    uint32_t windowHeight;
+    uint32_t gameWidth;
+    uint32_t gameHeight;
+    // the bars in window coordinates, as AmbientLight::ValidateSettings picked them
+    BarLayout bars;
+    // mip of the game texture the effect is made from, and the margin cut off its edges
+    uint32_t mipLevel;
+    uint32_t zoom;
+    float stretchFactor;
+    bool mirrored;
+};
+
+struct RenderPlan
+{
+    // false when the bars do not frame the game, nothing is drawn then
+    bool valid;
+    // game area of the desktop image
+    SurfaceRect gameBox;
+
+    // the region of the blurred mip that shows the game, in texels per game pixel
+    uint32_t mipWidth;
+    uint32_t mipHeight;
+    float regionX;
+    float regionY;
+    float gameToMipX;
+    float gameToMipY;
+
+    // both bars, mirrored and stretched from the game edge next to them
+    CompositeBar bars[2];
+    // pixels the bars cover
+    uint64_t barPixels;
+};
+
+RenderPlan BuildRenderPlan(const RenderPlanInputs& inputs);
+
+// A rectangle in game pixels as UV of the blurred mip, for the masks of the composite.
+// Sides on the edge of the game reach past the texture: a mirrored bar samples that
+// edge exactly, and the masks leave out their right and bottom side.
+UVRect GetSourceUV(const RenderPlan& plan, const SurfaceRect& gameRect);
+
+// Contents last uploaded to a constant buffer. The upload is skipped when a frame
+// asks for the same contents again, which it does unless the bars, the settings or
+// the interpolation blend changed.
+class ConstantCache
+{
+public:
+    ConstantCache() : m_valid(false), m_uploads(0), m_skipped(0) {}
+
+    // true when data has to be uploaded, it is kept as the buffer contents then
+    bool Update(const void* data, size_t size);
+    // the buffer was recreated, its contents are unknown
+    void Invalidate() { m_valid = false; }
+
+    uint64_t GetUploads() const { return m_uploads; }
+    uint64_t GetSkipped() const { return m_skipped; }
+
+private:
+    std::vector<uint8_t> m_data;
+    bool m_valid;
+    uint64_t m_uploads;
+    uint64_t m_skipped;
+};
+
+#define COMPOSITE_MAX_BARS       2
+#define COMPOSITE_MAX_MASK_RECTS 2
+// a constant buffer per target drawn in a frame
+#define COMPOSITE_MAX_SLOTS      COMPOSITE_MAX_BARS
+// CompositeDraw::surface of the window canvas
+#define COMPOSITE_WINDOW         0xFFFFFFFFu
+
+// One composite call of a frame, into the window canvas or bar surface `surface`.
+struct CompositeDraw
+{
+    CompositeBar bars[COMPOSITE_MAX_BARS];
+    uint32_t barCount;
+    uint32_t surface;
+    // constant buffer of the draw, the same for a target every frame
+    uint32_t slot;
+};
+
+// The composite calls of a frame: both bars into the window canvas, or with bar surfaces
+// each bar into its surface at the surface resolution. Returns their number.
+uint32_t GetCompositeDraws(const RenderPlan& plan, const PlannedSurface* surfaces, uint32_t surfaceCount,
+    CompositeDraw* draws);
+
+// The constants of composite.hlsl, laid out as its cbuffer.
+struct alignas(16) CompositeParameters
+{
+    // source region, target rectangle and window area per bar: offset.xy, size.zw
+    float barSource[COMPOSITE_MAX_BARS][4];
+    float barTarget[COMPOSITE_MAX_BARS][4];
+    float barWindow[COMPOSITE_MAX_BARS][4];
+    // flip per bar: horizontal, vertical
+    uint32_t barFlip[COMPOSITE_MAX_BARS][4];
+    // source UV rectangles [left, top, right, bottom]
+    float maskRects[COMPOSITE_MAX_MASK_RECTS][4];
+
+    uint32_t maskCount;
+    uint32_t vignetteEnabled;
+    uint32_t lumaMaskEnabled;
+    uint32_t blendEnabled;
+
+    float windowSize[2];
+    float blend;
+    float padding;
+};
+
+// what the composite calls of a frame share
+struct CompositeInputs
+{
+    const UVRect* masks;
+    uint32_t maskCount;
+    uint32_t windowWidth;
+    uint32_t windowHeight;
+    bool vignette;
+    bool lumaMask;
+    // lerp from the previous source by blend
+    bool previous;
+    float blend;
+};
+
+// The calls of a composite draw, made on the D3D context in the app.
+class CompositeContext
+{
+public:
+    virtual ~CompositeContext() {}
+
+    // UpdateSubresource of the constant buffer of slot
+    virtual void UpdateParameters(uint32_t slot, const CompositeParameters& params) = 0;
+    // binds the constant buffer of slot with the shader and views, and dispatches
+    virtual void Dispatch(uint32_t slot, uint32_t groupsX, uint32_t groupsY, uint32_t groupsZ) = 0;
+};
+
+// Packs the constants of a composite draw and dispatches the bar rectangles. The
+// constants are only uploaded when the slot does not hold them already.
+class CompositeSubmitter
+{
+public:
+    // false when slot is out of range, a draw without bars makes no calls
+    bool Submit(CompositeContext& context, uint32_t slot, const CompositeBar* bars, uint32_t barCount,
+        const CompositeInputs& inputs);
+    // the constant buffers were recreated
+    void Invalidate();
+
+    uint64_t GetUploads() const;
+    uint64_t GetSkippedUploads() const;
+
+private:
+    ConstantCache m_caches[COMPOSITE_MAX_SLOTS];
+};
@@ -0,0 +1,214 @@
+#include "resourceregistry.h"
+
+#include <algorithm>
+
+const char* ResourceOwnerName(ResourceOwner owner)
+{
+    switch (owner)
+    {
+    case ResourceOwnerEffect:
+        return "effect";
+    case ResourceOwnerBlur:
+        return "blur";
+    case ResourceOwnerDetect:
+        return "detect";
+    case ResourceOwnerMotion:
+        return "motion";
+    case ResourceOwnerPresent:
+        return "present";
+    default:
+        return "unknown";
+    }
+}
+
+const char* ResourceFormatName(ResourceFormat format)
+{
+    switch (format)
+    {
+    case ResourceFormatR16Unorm:
+        return "R16";
+    case ResourceFormatR32Float:
+        return "R32F";
+    case ResourceFormatBGRA8:
+        return "BGRA8";
+    case ResourceFormatRGB10A2:
+        return "RGB10A2";
+    case ResourceFormatR11G11B10Float:
+        return "R11G11B10F";
+    case ResourceFormatRGBA16Float:
+        return "RGBA16F";
+    default:
+        return "unknown";
+    }
+}
+
+uint32_t ResourceFormatBytes(ResourceFormat format)
+{
+    switch (format)
+    {
+    case ResourceFormatR16Unorm:
+        return 2;
+    case ResourceFormatRGBA16Float:
+        return 8;
+    default:
+        return 4;
+    }
+}
+
+ResourceFormat ResourceReducedFormat(ResourceFormat format)
+{
+    // keeps the HDR range, drops alpha and half the mantissa
+    if (format == ResourceFormatRGBA16Float)
+        return ResourceFormatR11G11B10Float;
+    return format;
+}
+
+bool operator==(const ResourceDesc& a, const ResourceDesc& b)
+{
+    return a.owner == b.owner && a.width == b.width && a.height == b.height && a.format == b.format &&
+        a.mipLevels == b.mipLevels && a.count == b.count && a.downgrades == b.downgrades;
+}
+
+uint32_t GetMipChainLength(uint32_t width, uint32_t height)
+{
+    uint32_t levels = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+        levels++;
+    return levels;
+}
+
+uint64_t GetResourceBytes(const ResourceDesc& desc)
+{
+    uint32_t levels = desc.mipLevels == 0 ? GetMipChainLength(desc.width, desc.height) : desc.mipLevels;
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < levels; i++)
+        bytes += (uint64_t)std::max(1u, desc.width >> i) * std::max(1u, desc.height >> i);
+    return bytes * ResourceFormatBytes(desc.format) * std::max(1u, desc.count);
+}
+
+static ResourceGrant GetGrant(const ResourceDesc& wanted, uint32_t mipShift, bool reducedFormat)
+{
+    ResourceGrant grant = {};
+    grant.desc = wanted;
+    grant.desc.width = std::max(1u, wanted.width >> mipShift);
+    grant.desc.height = std::max(1u, wanted.height >> mipShift);
+    if (grant.desc.mipLevels > 0)
+        grant.desc.mipLevels = std::min(grant.desc.mipLevels, GetMipChainLength(grant.desc.width, grant.desc.height));
+    if (reducedFormat)
+        grant.desc.format = ResourceReducedFormat(wanted.format);
+    grant.bytes = GetResourceBytes(grant.desc);
+    grant.mipShift = mipShift;
+    grant.reducedFormat = reducedFormat;
+    return grant;
+}
+
+ResourceRegistry::ResourceRegistry() :
+    m_budget(0),
+    m_totalBytes(0),
+    m_ownerBytes(),
+    m_count(0),
+    m_downgraded(0),
+    m_savedBytes(0)
+{
+}
+
+ResourceId ResourceRegistry::Reserve()
+{
+    if (!m_free.empty())
+    {
+        ResourceId id = m_free.back();
+        m_free.pop_back();
+        return id;
+    }
+    m_records.push_back({});
+    return (ResourceId)m_records.size();
+}
+
+ResourceId ResourceRegistry::Allocate(const ResourceDesc& wanted, ResourceAllocator& allocator, ResourceGrant* grant)
+{
+    // qualities from best to worst, each one smaller than the one before
+    ResourceGrant candidates[(RESOURCE_MAX_MIP_SHIFT + 1) * 2];
+    uint32_t candidateCount = 0;
+    uint32_t maxShift = (wanted.downgrades & ResourceDowngradeMip) ? RESOURCE_MAX_MIP_SHIFT : 0;
+    bool canReduce = (wanted.downgrades & ResourceDowngradeFormat) && ResourceReducedFormat(wanted.format) != wanted.format;
+    for (uint32_t shift = 0; shift <= maxShift; shift++)
+    {
+        candidates[candidateCount++] = GetGrant(wanted, shift, false);
+        if (canReduce)
+            candidates[candidateCount++] = GetGrant(wanted, shift, true);
+    }
+
+    // the best that fits, the smallest if none does
+    uint32_t first = candidateCount - 1;
+    for (uint32_t i = 0; i < candidateCount; i++)
+    {
+        if (m_budget == 0 || m_totalBytes + candidates[i].bytes <= m_budget)
+        {
+            first = i;
+            break;
+        }
+    }
+
+    ResourceId id = Reserve();
+    for (uint32_t i = first; i < candidateCount; i++)
+    {
+        if (!allocator.Allocate(candidates[i].desc, id))
+            continue;
+
+        ResourceRecord& record = m_records[id - 1];
+        record.wanted = wanted;
+        record.grant = candidates[i];
+        record.budget = m_budget;
+        record.active = true;
+
+        m_totalBytes += record.grant.bytes;
+        m_ownerBytes[wanted.owner] += record.grant.bytes;
+        m_count++;
+        if (record.grant.bytes != candidates[0].bytes)
+        {
+            m_downgraded++;
+            m_savedBytes += candidates[0].bytes - record.grant.bytes;
+        }
+
+        if (grant)
+            *grant = record.grant;
+        return id;
+    }
+
+    m_free.push_back(id);
+    return RESOURCE_ID_NONE;
+}
+
+void ResourceRegistry::Release(ResourceId id)
+{
+    if (id == RESOURCE_ID_NONE || id > m_records.size() || !m_records[id - 1].active)
+        return;
+
+    ResourceRecord& record = m_records[id - 1];
+    record.active = false;
+
+    m_totalBytes -= record.grant.bytes;
+    m_ownerBytes[record.wanted.owner] -= record.grant.bytes;
+    m_count--;
+    uint64_t wantedBytes = GetResourceBytes(record.wanted);
+    if (wantedBytes != record.grant.bytes)
+    {
+        m_downgraded--;
+        m_savedBytes -= wantedBytes - record.grant.bytes;
+    }
+
+    m_free.push_back(id);
+}
+
+const ResourceRecord* ResourceRegistry::Find(ResourceId id) const
+{
+    if (id == RESOURCE_ID_NONE || id > m_records.size() || !m_records[id - 1].active)
+        return nullptr;
+    return &m_records[id - 1];
+}
+
+ResourceRegistry& GetResourceRegistry()
+{
+    static ResourceRegistry registry;
+    return registry;
+}
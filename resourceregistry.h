@@ -0,0 +1,148 @@
+#pragma once
+
+// Accounting and budget of the textures, staging textures and swapchains the app allocates.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+enum ResourceOwner
+{
+    ResourceOwnerEffect = 0,
+    ResourceOwnerBlur,
+    ResourceOwnerDetect,
+    ResourceOwnerMotion,
+    ResourceOwnerPresent,
+    ResourceOwnerCount
+};
+
+const char* ResourceOwnerName(ResourceOwner owner);
+
+enum ResourceFormat
+{
+    ResourceFormatUnknown = 0,
+    ResourceFormatR16Unorm,
+    ResourceFormatR32Float,
+    ResourceFormatBGRA8,
+    ResourceFormatRGB10A2,
+    ResourceFormatR11G11B10Float,
+    ResourceFormatRGBA16Float
+};
+
+const char* ResourceFormatName(ResourceFormat format);
+uint32_t ResourceFormatBytes(ResourceFormat format);
+// the lower precision format with the same range, or the format itself if there is none
+ResourceFormat ResourceReducedFormat(ResourceFormat format);
+
+// quality the budget may take away from a resource
+enum ResourceDowngradeFlags
+{
+    ResourceDowngradeNone = 0,
+    // halve width and height, up to RESOURCE_MAX_MIP_SHIFT times
+    ResourceDowngradeMip = 1,
+    // use ResourceReducedFormat
+    ResourceDowngradeFormat = 2
+};
+
+#define RESOURCE_MAX_MIP_SHIFT 3
+
+struct ResourceDesc
+{
+    ResourceOwner owner;
+    // string literal, shown in listings
+    const char* name;
+    uint32_t width;
+    uint32_t height;
+    ResourceFormat format;
+    // 0 for the full mip chain
+    uint32_t mipLevels;
+    // array slices, or swapchain buffers
+    uint32_t count;
+    // ResourceDowngradeFlags
+    uint32_t downgrades;
+};
+
+bool operator==(const ResourceDesc& a, const ResourceDesc& b);
+inline bool operator!=(const ResourceDesc& a, const ResourceDesc& b) { return !(a == b); }
+
+uint64_t GetResourceBytes(const ResourceDesc& desc);
+// levels of a full mip chain
+uint32_t GetMipChainLength(uint32_t width, uint32_t height);
+
+typedef uint32_t ResourceId;
+#define RESOURCE_ID_NONE 0
+
+struct ResourceGrant
+{
+    // what was allocated, wanted downgraded by mipShift and reducedFormat
+    ResourceDesc desc;
+    uint64_t bytes;
+    uint32_t mipShift;
+    bool reducedFormat;
+};
+
+struct ResourceRecord
+{
+    ResourceDesc wanted;
+    ResourceGrant grant;
+    // budget the quality was picked for
+    uint64_t budget;
+    bool active;
+};
+
+// Creates the resource described by desc. id is the record the resource belongs to,
+// the resource must call ResourceRegistry::Release with it when it is destroyed.
+class ResourceAllocator
+{
+public:
+    virtual bool Allocate(const ResourceDesc& desc, ResourceId id) = 0;
+
+protected:
+    ~ResourceAllocator() = default;
+};
+
+// not thread safe, allocations and releases happen on the render thread
+class ResourceRegistry
+{
+public:
+    ResourceRegistry();
+
+    // 0 for no budget, in bytes
+    void SetBudget(uint64_t bytes) { m_budget = bytes; }
+    uint64_t GetBudget() const { return m_budget; }
+
+    // Allocates the best quality of wanted that still fits the budget, or the lowest
+    // quality allowed if none does. Lower qualities are tried when the allocator fails.
+    // Returns RESOURCE_ID_NONE if every quality failed.
+    ResourceId Allocate(const ResourceDesc& wanted, ResourceAllocator& allocator, ResourceGrant* grant = nullptr);
+    void Release(ResourceId id);
+
+    // nullptr if the id is not allocated
+    const ResourceRecord* Find(ResourceId id) const;
+
+    uint64_t GetTotalBytes() const { return m_totalBytes; }
+    uint64_t GetOwnerBytes(ResourceOwner owner) const { return m_ownerBytes[owner]; }
+    uint32_t GetCount() const { return m_count; }
+    // resources allocated below the wanted quality, and the bytes that saved
+    uint32_t GetDowngradedCount() const { return m_downgraded; }
+    uint64_t GetSavedBytes() const { return m_savedBytes; }
+    bool IsOverBudget() const { return m_budget > 0 && m_totalBytes > m_budget; }
+
+    // all records, released ones included, for listings
+    const std::vector<ResourceRecord>& GetRecords() const { return m_records; }
+
+private:
+    ResourceId Reserve();
+
+    std::vector<ResourceRecord> m_records;
+    std::vector<ResourceId> m_free;
+    uint64_t m_budget;
+    uint64_t m_totalBytes;
+    uint64_t m_ownerBytes[ResourceOwnerCount];
+    uint32_t m_count;
+    uint32_t m_downgraded;
+    uint64_t m_savedBytes;
+};
+
+// the registry of the app's device
+ResourceRegistry& GetResourceRegistry();
@@ -0,0 +1,106 @@
+#include "scheduler.h"
+
+LoopScheduler::LoopScheduler() :
+    m_active(true),
+    m_idleInterval(1000000000LL),
+    m_nextWakeup(0)
+{
+    ResetStats(0);
+}
+
+void LoopScheduler::SetActive(bool active, int64_t now)
+{
+    if (active == m_active)
+        return;
+
+    m_active = active;
+    if (!active)
+    {
+        // the work just ran as part of the last active frame
+        m_nextWakeup = now + m_idleInterval;
+    }
+}
+
+void LoopScheduler::SetIdleInterval(int64_t interval)
+{
+    if (interval <= 0)
+        interval = 1;
+
+    // pull a pending wakeup in if the interval got shorter
+    if (interval < m_idleInterval)
+        m_nextWakeup -= m_idleInterval - interval;
+
+    m_idleInterval = interval;
+}
+
+int64_t LoopScheduler::GetWaitTime(int64_t now) const
+{
+    if (m_active || now >= m_nextWakeup)
+        return 0;
+    return m_nextWakeup - now;
+}
+
+bool LoopScheduler::Tick(int64_t now)
+{
+    m_wakeups++;
+    if (m_active)
+    {
+        m_activeWakeups++;
+        return false;
+    }
+
+    if (now < m_nextWakeup)
+        return false;
+
+    m_periodicWakeups++;
+    // no catching up on missed wakeups, the work is a poll
+    m_nextWakeup += m_idleInterval;
+    if (m_nextWakeup <= now)
+        m_nextWakeup = now + m_idleInterval;
+    return true;
+}
+
+LoopSchedulerStats LoopScheduler::GetStats(int64_t now) const
+{
+    LoopSchedulerStats stats = {};
+    stats.wakeups = m_wakeups;
+    stats.activeWakeups = m_activeWakeups;
+    stats.periodicWakeups = m_periodicWakeups;
+    if (now > m_statsStart)
+        stats.wakeupsPerSecond = (double)m_wakeups * 1e9 / (double)(now - m_statsStart);
+    return stats;
+}
+
+void LoopScheduler::ResetStats(int64_t now)
+{
+    m_statsStart = now;
+    m_wakeups = 0;
+    m_activeWakeups = 0;
+    m_periodicWakeups = 0;
+}
+
+void RunMessageLoop(MessageLoopHost& host)
+{
+    while (!host.IsQuitting())
+    {
+        while (host.HandleMessage())
+        {
+            if (host.IsQuitting())
+                return;
+        }
+
+        // block until a message arrives, a handle is signaled or the idle work is due
+        uint32_t timeout = host.GetWaitTimeout();
+        if (timeout > 0)
+        {
+            void* handles[MESSAGE_LOOP_MAX_HANDLES];
+            uint32_t handleCount = host.GetWaitHandles(handles);
+            uint32_t woken = host.WaitForMessage(timeout, handles, handleCount);
+            if (woken < handleCount)
+                host.HandleSignal(woken);
+            if (woken != MESSAGE_LOOP_TIMEOUT)
+                continue;
+        }
+        host.Render();
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+// Decides when the render loop may block.
+
+#include <stdint.h>
+
+struct LoopSchedulerStats
+{
+    // loop iterations, active frames and idle wakeups
+    uint64_t wakeups;
+    uint64_t activeWakeups;
+    // idle wakeups where the periodic work was due, the rest were woken by messages
+    uint64_t periodicWakeups;
+    double wakeupsPerSecond;
+};
+
+class LoopScheduler
+{
+public:
+    LoopScheduler();
+
+    void SetActive(bool active, int64_t now);
+    bool IsActive() const { return m_active; }
+
+    // period of the idle wakeups
+    void SetIdleInterval(int64_t interval);
+
+    // how long the loop may block at now, 0 if it should run right away
+    int64_t GetWaitTime(int64_t now) const;
+
+    // Called on every loop iteration. Returns true when idle and the periodic work is due,
+    // in which case the next periodic wakeup is scheduled.
+    bool Tick(int64_t now);
+
+    LoopSchedulerStats GetStats(int64_t now) const;
+    void ResetStats(int64_t now);
+
+private:
+    bool m_active;
+    int64_t m_idleInterval;
+    int64_t m_nextWakeup;
+
+    int64_t m_statsStart;
+    uint64_t m_wakeups;
+    uint64_t m_activeWakeups;
+    uint64_t m_periodicWakeups;
+};
+
+// most handles a wait ends on besides the message queue
+#define MESSAGE_LOOP_MAX_HANDLES 4
+// WaitForMessage result when the timeout passed
+#define MESSAGE_LOOP_TIMEOUT     0xFFFFFFFFu
+
+// The window system and renderer the message loop runs on.
+class MessageLoopHost
+{
+public:
+    virtual ~MessageLoopHost() {}
+
+    // handle one queued message, false when the queue is empty
+    virtual bool HandleMessage() = 0;
+    // true once the quit message was handled
+    virtual bool IsQuitting() = 0;
+    // how long the loop may block in milliseconds, 0 to render right away
+    virtual uint32_t GetWaitTimeout() = 0;
+    // handles besides the message queue a wait ends on (the settings-changed event), fills
+    // handles and returns their number
+    virtual uint32_t GetWaitHandles(void** handles) = 0;
+    // Blocks until a message arrives, one of handles is signaled or the timeout passed.
+    // Returns the index of the signaled handle, handleCount for a message, or
+    // MESSAGE_LOOP_TIMEOUT.
+    virtual uint32_t WaitForMessage(uint32_t timeout, void* const* handles, uint32_t handleCount) = 0;
+    // handles[index] of the last wait was signaled, the host has to reset it
+    virtual void HandleSignal(uint32_t index) = 0;
+    virtual void Render() = 0;
+};
+
+// PresentWindow::Run: the queued messages are handled before every frame, a steady
+// stream of them (the mouse moving over the UI) does not hold the frames back.
+void RunMessageLoop(MessageLoopHost& host);
@@ -1,4 +1,5 @@
 #include "common.h"
+#include "configstore.h"
 #include "inipp.h"
 #include <fstream>
 #include <shlobj.h>
@@ -12,6 +13,14 @@ FILETIME lastWriteTime = {};
 
 std::wstring configFilePath = L"";
 
+// the config in use, reloaded on change notifications for the file and written
+// once the UI stops saving it
+ConfigStore configStore;
+bool configLoaded = false;
+// SettingsChange flags of the UI saves that ReadSettings has not returned yet
+UINT savedChanges = SettingsChangeNone;
+ULONGLONG lastSaveApplyTime = 0;
+
 #define UPDATE_INTERVAL 250
 
 namespace fs = std::filesystem;
@@ -126,7 +135,9 @@ BOOL CompareFileTime(FILETIME first, FILETIME second) {
     return (first.dwLowDateTime == second.dwLowDateTime && first.dwHighDateTime == second.dwHighDateTime);
 }
 
-bool ReadSettings(AppSettings& settings)
+// true when the write time of the config file changed since the last check, only
+// used when its directory cannot be watched
+bool HasConfigWriteTimeChanged()
 {
     ULONGLONG now = GetTickCount64();
 
@@ -144,103 +155,152 @@ bool ReadSettings(AppSettings& settings)
     }
 
     lastWriteTime = currentWriteTime;
+    return true;
+}
 
-    // read config file
-    inipp::Ini<char> ini;
-    std::ifstream is(GetCurrentConfigFilePath());
-    ini.parse(is);
-    ini.strip_trailing_comments();
+void ApplyConfig(const ConfigSnapshot& config, AppSettings& settings)
+{
+    const ConfigSnapshot::Section& game = config.GetSection("Game");
+    const ConfigSnapshot::Section& ui = config.GetSection("UI");
 
     int blur = DEFAULT_BLUR_PASSES;
-    inipp::get_value(ini.sections["Game"], "BlurStrength", blur);
+    inipp::get_value(game, "BlurStrength", blur);
 
     int blurSamples = DEFAULT_BLUR_SAMPLES;
-    inipp::get_value(ini.sections["Game"], "BlurSamples", blurSamples);
+    inipp::get_value(game, "BlurSamples", blurSamples);
 
     int mipmapLevels = 5; // Default to level 5 (~1/32 size)
-    inipp::get_value(ini.sections["Game"], "MipmapLevels", mipmapLevels);
+    inipp::get_value(game, "MipmapLevels", mipmapLevels);
 
     int frameRate = DEFAULT_FRAMERATE;
-    inipp::get_value(ini.sections["Game"], "FrameRate", frameRate);
+    inipp::get_value(game, "FrameRate", frameRate);
+
+    bool adaptiveFrameRate = DEFAULT_ADAPTIVE_FRAMERATE;
+    inipp::get_value(game, "AdaptiveFrameRate", adaptiveFrameRate);
+
+    int minFrameRate = DEFAULT_MIN_FRAMERATE;
+    inipp::get_value(game, "MinFrameRate", minFrameRate);
+
+    bool temporalInterpolation = DEFAULT_TEMPORAL_INTERPOLATION;
+    inipp::get_value(game, "TemporalInterpolation", temporalInterpolation);
+
+    int captureRate = DEFAULT_CAPTURE_RATE;
+    inipp::get_value(game, "CaptureRate", captureRate);
+
+    UINT memoryBudget = DEFAULT_MEMORY_BUDGET;
+    inipp::get_value(game, "MemoryBudget", memoryBudget);
+
+    UINT texturePoolSize = DEFAULT_TEXTURE_POOL_SIZE;
+    inipp::get_value(game, "TexturePoolSize", texturePoolSize);
+
+    bool prewarm = DEFAULT_PREWARM;
+    inipp::get_value(game, "Prewarm", prewarm);
 
     bool mirrored = DEFAULT_MIRRORED;
-    inipp::get_value(ini.sections["Game"], "Mirrored", mirrored);
+    inipp::get_value(game, "Mirrored", mirrored);
 
     bool stretched = DEFAULT_STRETCHED;
-    inipp::get_value(ini.sections["Game"], "Stretched", stretched);
+    inipp::get_value(game, "Stretched", stretched);
 
     float stretchFactor = DEFAULT_STRETCHED;
-    if (!inipp::get_value(ini.sections["Game"], "StretchFactor", stretchFactor))
+    if (!inipp::get_value(game, "StretchFactor", stretchFactor))
     {
         // for backward compatibility, if StretchFactor is missing, set it to 2.0f when Stretched is true, otherwise 1.0f
         stretchFactor = stretched ? 2.0f : 1.0f;
     }
 
     int zoom = DEFAULT_ZOOM;
-    inipp::get_value(ini.sections["Game"], "Zoom", zoom);
+    inipp::get_value(game, "Zoom", zoom);
 
     bool vignetteEnabled = DEFAULT_VIGNETTE_ENABLED;
-    inipp::get_value(ini.sections["Game"], "VignetteEnabled", vignetteEnabled);
+    inipp::get_value(game, "VignetteEnabled", vignetteEnabled);
 
     float vignetteIntensity = DEFAULT_VIGNETTE_INTENSITY;
-    inipp::get_value(ini.sections["Game"], "VignetteIntensity", vignetteIntensity);
+    inipp::get_value(game, "VignetteIntensity", vignetteIntensity);
 
     float vignetteRadius = DEFAULT_VIGNETTE_RADIUS;
-    inipp::get_value(ini.sections["Game"], "VignetteRadius", vignetteRadius);
+    inipp::get_value(game, "VignetteRadius", vignetteRadius);
 
     float vignetteSmoothness = DEFAULT_VIGNETTE_SMOOTHNESS;
-    inipp::get_value(ini.sections["Game"], "VignetteSmoothness", vignetteSmoothness);
+    inipp::get_value(game, "VignetteSmoothness", vignetteSmoothness);
 
     bool useAuto = DEFAULT_AUTO_DETECTION;
-    inipp::get_value(ini.sections["Game"], "AutoDetection", useAuto);
+    inipp::get_value(game, "AutoDetection", useAuto);
 
     int autoDetectionTime = DEFAULT_AUTO_DETECTION_TIME;
-    inipp::get_value(ini.sections["Game"], "AutoDetectionTime", autoDetectionTime);
+    inipp::get_value(game, "AutoDetectionTime", autoDetectionTime);
 
     float autoDetectionBrightnessThreshold = DEFAULT_AUTO_DETECTION_BRIGHTNESS_THRESHOLD;
-    inipp::get_value(ini.sections["Game"], "AutoDetectionBrightnessThreshold", autoDetectionBrightnessThreshold);
+    inipp::get_value(game, "AutoDetectionBrightnessThreshold", autoDetectionBrightnessThreshold);
 
     float autoDetectionBlackRatio = DEFAULT_AUTO_DETECTION_BLACK_RATIO;
-    inipp::get_value(ini.sections["Game"], "AutoDetectionBlackRatio", autoDetectionBlackRatio);
+    inipp::get_value(game, "AutoDetectionBlackRatio", autoDetectionBlackRatio);
 
     bool autoDetectionLightMask = DEFAULT_AUTO_DETECTION_LIGHT_MASK;
-    inipp::get_value(ini.sections["Game"], "AutoDetectionLightMask", autoDetectionLightMask);
+    inipp::get_value(game, "AutoDetectionLightMask", autoDetectionLightMask);
 
     bool autoDetectionSymmetricBars = DEFAULT_AUTO_DETECTION_SYMMETRIC_BARS;
-    inipp::get_value(ini.sections["Game"], "AutoDetectionSymmetricBars", autoDetectionSymmetricBars);
+    inipp::get_value(game, "AutoDetectionSymmetricBars", autoDetectionSymmetricBars);
 
     bool autoDetectionReservedArea = DEFAULT_AUTO_DETECTION_RESERVED_AREA;
-    inipp::get_value(ini.sections["Game"], "AutoDetectionReservedArea", autoDetectionReservedArea);
+    inipp::get_value(game, "AutoDetectionReservedArea", autoDetectionReservedArea);
 
     UINT autoDetectionReservedWidth = DEFAULT_AUTO_DETECTION_RESERVED_WIDTH;
-    inipp::get_value(ini.sections["Game"], "AutoDetectionReservedWidth", autoDetectionReservedWidth);
+    inipp::get_value(game, "AutoDetectionReservedWidth", autoDetectionReservedWidth);
 
     UINT autoDetectionReservedHeight = DEFAULT_AUTO_DETECTION_RESERVED_HEIGHT;
-    inipp::get_value(ini.sections["Game"], "AutoDetectionReservedHeight", autoDetectionReservedHeight);
+    inipp::get_value(game, "AutoDetectionReservedHeight", autoDetectionReservedHeight);
 
     bool autoDetectionInner = DEFAULT_AUTO_DETECTION_INNER;
-    inipp::get_value(ini.sections["Game"], "AutoDetectionInner", autoDetectionInner);
+    inipp::get_value(game, "AutoDetectionInner", autoDetectionInner);
+
+    UINT autoDetectionConfirmations = DEFAULT_AUTO_DETECTION_CONFIRMATIONS;
+    inipp::get_value(game, "AutoDetectionConfirmations", autoDetectionConfirmations);
+
+    UINT autoDetectionJitter = DEFAULT_AUTO_DETECTION_JITTER;
+    inipp::get_value(game, "AutoDetectionJitter", autoDetectionJitter);
+
+    bool barSurfaces = DEFAULT_BAR_SURFACES;
+    inipp::get_value(game, "BarSurfaces", barSurfaces);
+
+    UINT barSurfaceScale = DEFAULT_BAR_SURFACE_SCALE;
+    inipp::get_value(game, "BarSurfaceScale", barSurfaceScale);
 
     bool showInTaskbar = DEFAULT_SHOW_IN_TASKBAR;
-    inipp::get_value(ini.sections["UI"], "ShowInTaskbar", showInTaskbar);
+    inipp::get_value(ui, "ShowInTaskbar", showInTaskbar);
 
     bool popupConfigOnFocus = DEFAULT_POPUP_CONFIG_ON_FOCUS;
-    inipp::get_value(ini.sections["UI"], "PopupConfigOnFocus", popupConfigOnFocus);
+    inipp::get_value(ui, "PopupConfigOnFocus", popupConfigOnFocus);
 
     float uiScale = DEFAULT_UI_SCALE;
-    inipp::get_value(ini.sections["UI"], "UIScale", uiScale);
+    inipp::get_value(ui, "UIScale", uiScale);
+
+    bool metricsEnabled = DEFAULT_METRICS_ENABLED;
+    inipp::get_value(ui, "MetricsEnabled", metricsEnabled);
+
+    UINT metricsPort = DEFAULT_METRICS_PORT;
+    inipp::get_value(ui, "MetricsPort", metricsPort);
+    if (metricsPort == 0 || metricsPort > 65535)
+        metricsPort = DEFAULT_METRICS_PORT;
 
     int display = DEFAULT_DISPLAY;
-    inipp::get_value(ini.sections["Game"], "Display", display);
+    inipp::get_value(game, "Display", display);
 
     bool hdrSupport = DEFAULT_HDR_SUPPORT;
-    inipp::get_value(ini.sections["Game"], "HDRSupport", hdrSupport);
+    inipp::get_value(game, "HDRSupport", hdrSupport);
 
     settings.loaded = true;
     settings.blurPasses = blur;
     settings.blurSamples = blurSamples;
     settings.mipmapLevels = mipmapLevels;
     settings.frameRate = frameRate;
+    settings.adaptiveFrameRate = adaptiveFrameRate;
+    settings.minFrameRate = minFrameRate;
+    settings.temporalInterpolation = temporalInterpolation;
+    settings.captureRate = captureRate;
+    settings.memoryBudget = memoryBudget;
+    settings.texturePoolSize = texturePoolSize;
+    settings.prewarm = prewarm;
     settings.mirrored = mirrored;
     settings.stretched = stretched;
     settings.stretchFactor = stretchFactor;
@@ -261,16 +321,22 @@ bool ReadSettings(AppSettings& settings)
     settings.autoDetectionReservedWidth = autoDetectionReservedWidth;
     settings.autoDetectionReservedHeight = autoDetectionReservedHeight;
     settings.autoDetectionInner = autoDetectionInner;
+    settings.autoDetectionConfirmations = autoDetectionConfirmations;
+    settings.autoDetectionJitter = autoDetectionJitter;
     settings.uiScale = uiScale;
+    settings.metricsEnabled = metricsEnabled;
+    settings.metricsPort = metricsPort;
     settings.hdrSupport = hdrSupport;
+    settings.barSurfaces = barSurfaces;
+    settings.barSurfaceScale = barSurfaceScale;
 
     std::string currentRes = "";
-    inipp::get_value(ini.sections["Game"], "Resolution", currentRes);
+    inipp::get_value(game, "Resolution", currentRes);
 
     settings.resolutions.current = currentRes;
     settings.resolutions.available.clear();
 
-    for (auto const& sec : ini.sections)
+    for (auto const& sec : config.GetSections())
     {
         std::string name = sec.first;
 
@@ -281,8 +347,8 @@ bool ReadSettings(AppSettings& settings)
         int res_height = 0;
 
 
-        inipp::get_value(ini.sections[name.c_str()], "Width", res_width);
-        inipp::get_value(ini.sections[name.c_str()], "Height", res_height);
+        inipp::get_value(sec.second, "Width", res_width);
+        inipp::get_value(sec.second, "Height", res_height);
 
         if (res_width == 0 || res_height == 0)
             continue;
@@ -324,22 +390,100 @@ bool ReadSettings(AppSettings& settings)
     }
 
     settings.display = display;
-    auto displays = GetAvailableDisplays();
+    const auto& displays = GetAvailableDisplays();
     if (settings.display < 0 || settings.display >= displays.size())
     {
         settings.display = 0;
     }
+}
 
-    return true;
+// Keys the pipeline is not built from, and what they update instead. Any other key,
+// including the resolution sections, rebuilds through UpdateSettings.
+struct SettingsKeyChange
+{
+    const char* section;
+    const char* key;
+    UINT change;
+};
+
+const SettingsKeyChange NON_RENDER_KEYS[] =
+{
+    { "Game", "TexturePoolSize", SettingsChangeTexturePool },
+    { "UI", "MetricsEnabled", SettingsChangeMetrics },
+    { "UI", "MetricsPort", SettingsChangeMetrics },
+    // read when the window is activated
+    { "UI", "PopupConfigOnFocus", SettingsChangeNone },
+};
+
+UINT GetSettingsChanges(const std::vector<ConfigChange>& changes)
+{
+    UINT flags = SettingsChangeNone;
+    for (const ConfigChange& change : changes)
+    {
+        UINT flag = SettingsChangeRender;
+        for (const SettingsKeyChange& key : NON_RENDER_KEYS)
+        {
+            if (change.section == key.section && change.key == key.key)
+            {
+                flag = key.change;
+                break;
+            }
+        }
+        flags |= flag;
+    }
+    return flags;
+}
+
+UINT ReadSettings(AppSettings& settings)
+{
+    ULONGLONG now = GetTickCount64();
+    bool apply = !settings.loaded;
+    UINT changes = apply ? SettingsChangeAll : SettingsChangeNone;
+
+    if (!configLoaded)
+    {
+        // without notifications the write time is compared every UPDATE_INTERVAL instead
+        if (!configStore.Start(GetCurrentConfigFilePath()))
+            HasConfigWriteTimeChanged();
+        configLoaded = true;
+        apply = true;
+        changes = SettingsChangeAll;
+    }
+    else if (configStore.Reload(!configStore.IsWatching() && HasConfigWriteTimeChanged()))
+    {
+        // only the keys that changed are logged and updated
+        std::string names;
+        for (const ConfigChange& change : configStore.GetChanges())
+            names += " " + change.section + "." + change.key;
+        OutputDebugStringA(("=== Settings reloaded:" + names + "\n").c_str());
+
+        // the edit replaces the settings, UI saves that were not returned yet included
+        apply = true;
+        changes |= GetSettingsChanges(configStore.GetChanges()) | savedChanges;
+        savedChanges = SettingsChangeNone;
+    }
+    else if (savedChanges != SettingsChangeNone && now >= lastSaveApplyTime + UPDATE_INTERVAL)
+    {
+        // the UI changed the settings in place, they are not read back from the config;
+        // what depends on them is updated as often as the file used to be checked
+        changes |= savedChanges;
+        savedChanges = SettingsChangeNone;
+        lastSaveApplyTime = now;
+    }
+
+    configStore.Flush(now);
+
+    if (apply)
+        ApplyConfig(*configStore.GetConfig(), settings);
+    return changes;
 }
 
 void SaveSettings(AppSettings& settings)
 {
-    // config file
+    // on top of the config in use, keys the app does not know are kept
     inipp::Ini<char> ini;
-    std::ifstream is(GetCurrentConfigFilePath());
-    ini.parse(is);
-    ini.strip_trailing_comments();
+    if (configStore.GetConfig())
+        ini.sections = configStore.GetConfig()->GetSections();
 
     ini.sections["Game"]["Display"] = std::to_string(settings.display);
     ini.sections["Game"]["Resolution"] = settings.resolutions.current;
@@ -347,6 +491,13 @@ void SaveSettings(AppSettings& settings)
     ini.sections["Game"]["BlurSamples"] = std::to_string(settings.blurSamples);
     ini.sections["Game"]["MipmapLevels"] = std::to_string(settings.mipmapLevels);
     ini.sections["Game"]["FrameRate"] = std::to_string(settings.frameRate);
+    ini.sections["Game"]["AdaptiveFrameRate"] = settings.adaptiveFrameRate ? "true" : "false";
+    ini.sections["Game"]["MinFrameRate"] = std::to_string(settings.minFrameRate);
+    ini.sections["Game"]["TemporalInterpolation"] = settings.temporalInterpolation ? "true" : "false";
+    ini.sections["Game"]["CaptureRate"] = std::to_string(settings.captureRate);
+    ini.sections["Game"]["MemoryBudget"] = std::to_string(settings.memoryBudget);
+    ini.sections["Game"]["TexturePoolSize"] = std::to_string(settings.texturePoolSize);
+    ini.sections["Game"]["Prewarm"] = settings.prewarm ? "true" : "false";
     ini.sections["Game"]["Mirrored"] = settings.mirrored ? "true" : "false";
     //ini.sections["Game"]["Stretched"] = settings.stretched ? "true" : "false";
     ini.sections["Game"]["StretchFactor"] = std::to_string(settings.stretchFactor);
@@ -365,10 +516,16 @@ void SaveSettings(AppSettings& settings)
     ini.sections["Game"]["AutoDetectionReservedWidth"] = std::to_string(settings.autoDetectionReservedWidth);
     ini.sections["Game"]["AutoDetectionReservedHeight"] = std::to_string(settings.autoDetectionReservedHeight);
     ini.sections["Game"]["AutoDetectionInner"] = settings.autoDetectionInner ? "true" : "false";
+    ini.sections["Game"]["AutoDetectionConfirmations"] = std::to_string(settings.autoDetectionConfirmations);
+    ini.sections["Game"]["AutoDetectionJitter"] = std::to_string(settings.autoDetectionJitter);
     ini.sections["Game"]["HDRSupport"] = settings.hdrSupport ? "true" : "false";
+    ini.sections["Game"]["BarSurfaces"] = settings.barSurfaces ? "true" : "false";
+    ini.sections["Game"]["BarSurfaceScale"] = std::to_string(settings.barSurfaceScale);
     ini.sections["UI"]["ShowInTaskbar"] = settings.showInTaskbar ? "true" : "false";
     ini.sections["UI"]["PopupConfigOnFocus"] = settings.popupConfigOnFocus ? "true" : "false";
     ini.sections["UI"]["UIScale"] = std::to_string(settings.uiScale);
+    ini.sections["UI"]["MetricsEnabled"] = settings.metricsEnabled ? "true" : "false";
+    ini.sections["UI"]["MetricsPort"] = std::to_string(settings.metricsPort);
     
 
 
@@ -378,11 +535,25 @@ void SaveSettings(AppSettings& settings)
         ini.sections[res.name]["Height"] = std::to_string(res.height);
     }
 
-    is.close();
+    // the keys this save changed decide what ReadSettings has the app update
+    std::shared_ptr<const ConfigSnapshot> config = ConfigSnapshot::Create(std::move(ini.sections));
+    if (configStore.GetConfig())
+        savedChanges |= GetSettingsChanges(DiffConfig(*configStore.GetConfig(), *config));
+    else
+        savedChanges = SettingsChangeAll;
 
-    std::ofstream os(GetCurrentConfigFilePath());
-    ini.generate(os);
-    os.close();
+    // a slider drag saves every frame, the file is written once it stops
+    configStore.Save(std::move(config), GetTickCount64());
+}
+
+void FlushSettings()
+{
+    configStore.Flush(GetTickCount64(), true);
+}
+
+HANDLE GetSettingsChangeEvent()
+{
+    return configStore.GetChangeEvent();
 }
 
 BOOL CALLBACK BuildMonitorListCallback(HMONITOR hMonitor, HDC hdcMonitor, LPRECT lprcMonitor, LPARAM dwData) {
@@ -427,7 +598,7 @@ void RefreshDisplays()
     EnumDisplayMonitors(NULL, NULL, BuildMonitorListCallback, reinterpret_cast<LPARAM>(&monitorList));
 }
 
-std::vector<AvailableMonitor> GetAvailableDisplays()
+const std::vector<AvailableMonitor>& GetAvailableDisplays()
 {
     return monitorList;
 }
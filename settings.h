@@ -27,6 +27,8 @@
 #define DEFAULT_AUTO_DETECTION_RESERVED_AREA false
 #define DEFAULT_AUTO_DETECTION_RESERVED_WIDTH 16
 #define DEFAULT_AUTO_DETECTION_RESERVED_HEIGHT 9
+#define DEFAULT_AUTO_DETECTION_CONFIRMATIONS 3
+#define DEFAULT_AUTO_DETECTION_JITTER 4
 #define DEFAULT_SHOW_IN_TASKBAR     true
 #define DEFAULT_POPUP_CONFIG_ON_FOCUS     true
 #define DEFAULT_UI_SCALE               1.0f
@@ -34,6 +36,17 @@
 #define DEFAULT_DISPLAY                0
 #define DEFAULT_AUTO_DETECTION_INNER false
 #define DEFAULT_HDR_SUPPORT          true
+#define DEFAULT_BAR_SURFACES         false
+#define DEFAULT_BAR_SURFACE_SCALE    1
+#define DEFAULT_ADAPTIVE_FRAMERATE   false
+#define DEFAULT_MIN_FRAMERATE        15
+#define DEFAULT_TEMPORAL_INTERPOLATION false
+#define DEFAULT_CAPTURE_RATE         30
+#define DEFAULT_METRICS_ENABLED      false
+#define DEFAULT_METRICS_PORT         9464
+#define DEFAULT_MEMORY_BUDGET        0
+#define DEFAULT_TEXTURE_POOL_SIZE    128
+#define DEFAULT_PREWARM              false
 
 
 struct ResolutionSettings
@@ -70,6 +83,16 @@ struct AppSettings
     UINT blurPasses = DEFAULT_BLUR_PASSES;
     UINT blurSamples = DEFAULT_BLUR_SAMPLES;
     UINT frameRate = DEFAULT_FRAMERATE;
+    bool adaptiveFrameRate = DEFAULT_ADAPTIVE_FRAMERATE;
+    UINT minFrameRate = DEFAULT_MIN_FRAMERATE;
+    bool temporalInterpolation = DEFAULT_TEMPORAL_INTERPOLATION;
+    UINT captureRate = DEFAULT_CAPTURE_RATE;
+    // video memory budget in MiB, 0 for none
+    UINT memoryBudget = DEFAULT_MEMORY_BUDGET;
+    // unused textures kept for reuse in MiB, 0 for none
+    UINT texturePoolSize = DEFAULT_TEXTURE_POOL_SIZE;
+    // create the textures of the other resolution presets in the background
+    bool prewarm = DEFAULT_PREWARM;
     bool mirrored = DEFAULT_MIRRORED;
     bool stretched = DEFAULT_STRETCHED;
     float stretchFactor = DEFAULT_STRETCH_FACTOR;
@@ -89,19 +112,45 @@ struct AppSettings
     UINT autoDetectionReservedWidth = DEFAULT_AUTO_DETECTION_RESERVED_WIDTH;
     UINT autoDetectionReservedHeight = DEFAULT_AUTO_DETECTION_RESERVED_HEIGHT;
     bool autoDetectionInner = DEFAULT_AUTO_DETECTION_INNER;
+    // passes a new bar size has to be detected on, and the size change in pixels ignored
+    UINT autoDetectionConfirmations = DEFAULT_AUTO_DETECTION_CONFIRMATIONS;
+    UINT autoDetectionJitter = DEFAULT_AUTO_DETECTION_JITTER;
     bool hdrSupport = DEFAULT_HDR_SUPPORT;
+    bool barSurfaces = DEFAULT_BAR_SURFACES;
+    UINT barSurfaceScale = DEFAULT_BAR_SURFACE_SCALE;
     bool showInTaskbar = DEFAULT_SHOW_IN_TASKBAR;
     bool popupConfigOnFocus = true;
     float uiScale = DEFAULT_UI_SCALE;
+    bool metricsEnabled = DEFAULT_METRICS_ENABLED;
+    UINT metricsPort = DEFAULT_METRICS_PORT;
 };
 
 
-bool ReadSettings(AppSettings& settings);
+// what a settings change has to update
+enum SettingsChange
+{
+    SettingsChangeNone = 0,
+    // anything the pipeline is built from, rebuilt by UpdateSettings
+    SettingsChangeRender = 1 << 0,
+    // metrics endpoint, on or off and its port
+    SettingsChangeMetrics = 1 << 1,
+    // idle textures the pool keeps
+    SettingsChangeTexturePool = 1 << 2,
+    SettingsChangeAll = SettingsChangeRender | SettingsChangeMetrics | SettingsChangeTexturePool
+};
+
+// Reads the config when it was edited, and takes the UI saves. Returns the
+// SettingsChange flags of the keys that changed since the last call, 0 for none.
+UINT ReadSettings(AppSettings& settings);
 void SaveSettings(AppSettings& settings);
+// writes a save the debounce is still holding back, before exit
+void FlushSettings();
+// signaled when the config file may have changed until ReadSettings, nullptr when it is not watched
+HANDLE GetSettingsChangeEvent();
 
 std::filesystem::path GetDataFile(std::wstring fileName);
 
 void RefreshDisplays();
-std::vector<AvailableMonitor> GetAvailableDisplays();
+const std::vector<AvailableMonitor>& GetAvailableDisplays();
 RECT GetDisplayRect(int display);
 HMONITOR GetDisplayMonitor(int display);
\ No newline at end of file
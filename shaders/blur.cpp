@@ -176,7 +176,9 @@ HRESULT Blur::Render(ID3D11DeviceContext* context, TextureView target, UINT pass
     D3D11_TEXTURE2D_DESC target_desc = {};
     target.GetTexture()->GetDesc(&target_desc);
 
-    m_tempTexture.RecreateTexture(m_device.Get(), target_desc.Format, target_desc.Width, target_desc.Height);
+    // only holds the result of the horizontal pass, a lower precision format is barely visible
+    m_tempTexture.RecreateTexture(m_device.Get(), target_desc.Format, target_desc.Width, target_desc.Height,
+        1, false, ResourceOwnerBlur, "blur temp", ResourceDowngradeFormat);
 
     for (UINT i = 0; i < passes; i++)
     {
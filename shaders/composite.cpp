@@ -0,0 +1,133 @@
+#include "composite.h"
+#include "d3dcompiler.h"
+#include "composite_main_bin.h"
+
+#pragma comment(lib, "d3d11.lib")
+#pragma comment(lib, "d3dcompiler.lib")
+#pragma comment(lib, "dxgi.lib")
+
+using namespace DirectX;
+
+// CompositeParameters is uploaded as is
+static_assert(sizeof(CompositeParameters) == 192, "composite constants do not match composite.hlsl");
+
+// The D3D calls of one Composite::Render.
+class D3DCompositeContext : public CompositeContext
+{
+public:
+    D3DCompositeContext(ID3D11DeviceContext* context, const ComPtr<ID3D11Buffer>* params,
+        ID3D11ComputeShader* shader, ID3D11SamplerState* sampler,
+        ID3D11ShaderResourceView* const* srvs, ID3D11UnorderedAccessView* uav) :
+        m_context(context), m_params(params), m_shader(shader), m_sampler(sampler), m_srvs(srvs), m_uav(uav)
+    {
+    }
+
+    void UpdateParameters(uint32_t slot, const CompositeParameters& params) override
+    {
+        m_context->UpdateSubresource(m_params[slot].Get(), 0, nullptr, &params, sizeof(CompositeParameters), 0);
+    }
+
+    void Dispatch(uint32_t slot, uint32_t groupsX, uint32_t groupsY, uint32_t groupsZ) override
+    {
+        m_context->CSSetConstantBuffers(0, 1, m_params[slot].GetAddressOf());
+
+        m_context->CSSetShader(m_shader, nullptr, 0);
+        m_context->CSSetSamplers(0, 1, &m_sampler);
+        m_context->CSSetShaderResources(0, 4, m_srvs);
+        m_context->CSSetUnorderedAccessViews(0, 1, &m_uav, nullptr);
+
+        m_context->Dispatch(groupsX, groupsY, groupsZ);
+
+        ID3D11UnorderedAccessView* uav = nullptr;
+        m_context->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
+        ID3D11ShaderResourceView* srvs[4] = {};
+        m_context->CSSetShaderResources(0, 4, srvs);
+    }
+
+private:
+    ID3D11DeviceContext* m_context;
+    const ComPtr<ID3D11Buffer>* m_params;
+    ID3D11ComputeShader* m_shader;
+    ID3D11SamplerState* m_sampler;
+    ID3D11ShaderResourceView* const* m_srvs;
+    ID3D11UnorderedAccessView* m_uav;
+};
+
+Composite::Composite()
+{
+}
+
+Composite::~Composite()
+{
+}
+
+HRESULT Composite::Initialize(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> context)
+{
+    HRESULT hr = S_OK;
+    if (m_device != device)
+    {
+        m_shader = nullptr;
+    }
+
+    m_device = device;
+    m_context = context;
+
+    if (!m_shader)
+    {
+        hr = device->CreateComputeShader(g_composite_main, sizeof(g_composite_main), nullptr, &m_shader);
+        RETURN_IF_FAILED(hr);
+
+        D3D11_SAMPLER_DESC samplerDesc = {};
+        samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+        samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+        samplerDesc.MinLOD = 0;
+        samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+        hr = device->CreateSamplerState(&samplerDesc, &m_samplerState);
+        RETURN_IF_FAILED(hr);
+
+        // Create constant buffers
+        D3D11_BUFFER_DESC bufferDesc = {};
+        bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+        bufferDesc.ByteWidth = sizeof(CompositeParameters);
+        bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+        for (UINT i = 0; i < MAX_SLOTS; i++)
+        {
+            hr = device->CreateBuffer(&bufferDesc, nullptr, &m_params[i]);
+            RETURN_IF_FAILED(hr);
+        }
+        m_submitter.Invalidate();
+    }
+
+    return hr;
+}
+
+HRESULT Composite::Render(ID3D11DeviceContext* context, TextureView target, TextureView source,
+    const CompositeBar* bars, UINT barCount, const UVRect* masks, UINT maskCount,
+    UINT windowWidth, UINT windowHeight,
+    ID3D11ShaderResourceView* vignette, ID3D11ShaderResourceView* lumaMask,
+    ID3D11ShaderResourceView* previous, float blend, UINT slot)
+{
+    if (!target.GetTexture() || !source.GetTexture() || slot >= MAX_SLOTS)
+        return E_FAIL;
+
+    CompositeInputs inputs = { masks, maskCount, windowWidth, windowHeight,
+        vignette != nullptr, lumaMask != nullptr, previous != nullptr, blend };
+    ID3D11ShaderResourceView* srvs[4] = { source.GetSRV(), lumaMask, vignette, previous };
+    D3DCompositeContext d3d(context, m_params, m_shader.Get(), m_samplerState.Get(), srvs, target.GetUAV());
+    m_submitter.Submit(d3d, slot, bars, barCount, inputs);
+
+    return S_OK;
+}
+
+UINT64 Composite::GetUploads() const
+{
+    return m_submitter.GetUploads();
+}
+
+UINT64 Composite::GetSkippedUploads() const
+{
+    return m_submitter.GetSkippedUploads();
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "../common.h"
+#include <stdint.h>
+#include "DirectXMath.h"
+#include "reference.h"
+#include "../renderplan.h"
+
+// Writes the bar effects into the canvas in a single pass: copy with zoom, stretch
+// and mirroring from the blurred source, then vignette and light peek mask in registers.
+class Composite
+{
+public:
+    static constexpr UINT MAX_BARS = COMPOSITE_MAX_BARS;
+    static constexpr UINT MAX_MASK_RECTS = COMPOSITE_MAX_MASK_RECTS;
+
+    Composite();
+    ~Composite();
+    HRESULT Initialize(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> context);
+
+    // vignette and lumaMask are optional, pass nullptr to skip that effect.
+    // Both are looked up in window coordinates, see CompositeBar::window*.
+    // With a previous source of the same size, the result is lerp(previous, source, blend).
+    // Each slot has a constant buffer of its own, a target drawn every frame with the
+    // same parameters uses the same slot and skips the upload.
+    HRESULT Render(ID3D11DeviceContext* context, TextureView target, TextureView source,
+        const CompositeBar* bars, UINT barCount, const UVRect* masks, UINT maskCount,
+        UINT windowWidth, UINT windowHeight,
+        ID3D11ShaderResourceView* vignette, ID3D11ShaderResourceView* lumaMask,
+        ID3D11ShaderResourceView* previous = nullptr, float blend = 1.0f, UINT slot = 0);
+
+    static constexpr UINT MAX_SLOTS = COMPOSITE_MAX_SLOTS;
+    // constant buffer uploads made and skipped
+    UINT64 GetUploads() const;
+    UINT64 GetSkippedUploads() const;
+private:
+    ComPtr<ID3D11Device> m_device;
+    ComPtr<ID3D11DeviceContext> m_context;
+
+    ComPtr<ID3D11ComputeShader> m_shader;
+    ComPtr<ID3D11Buffer>        m_params[MAX_SLOTS];
+    CompositeSubmitter          m_submitter;
+    ComPtr<ID3D11SamplerState> m_samplerState;
+};
@@ -0,0 +1,97 @@
+#define MAX_BARS 2
+#define MAX_MASK_RECTS 2
+
+cbuffer CompositeParams : register(b0)
+{
+    float4 barSource[MAX_BARS]; // Source region of each bar (in texels): offset.xy, size.zw
+    float4 barTarget[MAX_BARS]; // Target rectangle of each bar (in pixels): offset.xy, size.zw
+    float4 barWindow[MAX_BARS]; // Window area covered by each bar target (in pixels): offset.xy, size.zw
+    uint4 barFlip[MAX_BARS]; // x: flip horizontal, y: flip vertical
+    float4 maskRects[MAX_MASK_RECTS]; // Source UV rectangles [left, top, right, bottom] written as transparent
+    uint maskCount; // Number of valid mask rectangles
+    uint vignetteEnabled; // 1 to apply the vignette
+    uint lumaMaskEnabled; // 1 to apply the light peek mask
+    uint blendEnabled; // 1 to blend from the previous source frame
+    float2 windowSize; // Window size in pixels, vignette and luma are evaluated in window coordinates
+    float blend; // Weight of the current source frame against the previous one
+    float padding;
+};
+
+Texture2D<float4> gInput : register(t0);
+Texture2D<float> gLuma : register(t1);
+Texture2D<float> gVignette : register(t2); // Vignette attenuation over normalized target coordinates
+Texture2D<float4> gPrevious : register(t3); // Previous blurred source, same size as gInput
+RWTexture2D<float4> gOutput : register(u0);
+SamplerState samLinear : register(s0);
+
+// One thread per target pixel of a bar, the bar index is the z dimension of the dispatch.
+// Only the bar rectangles are written, everything in between stays untouched.
+[numthreads(16, 16, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    uint bar = DTid.z;
+    float2 dstOffset = barTarget[bar].xy;
+    float2 dstSize = barTarget[bar].zw;
+
+    if (DTid.x >= (uint) dstSize.x || DTid.y >= (uint) dstSize.y)
+        return;
+
+    uint2 outCoord = (uint2) (DTid.xy + dstOffset);
+
+    uint width, height;
+    gOutput.GetDimensions(width, height);
+
+    if (outCoord.x >= width || outCoord.y >= height)
+        return;
+
+    float2 uv = (float2) DTid.xy / dstSize;
+
+    if (barFlip[bar].x > 0)
+        uv.x = 1.0f - uv.x;
+    if (barFlip[bar].y > 0)
+        uv.y = 1.0f - uv.y;
+
+    uint srcWidth, srcHeight;
+    gInput.GetDimensions(srcWidth, srcHeight);
+    float2 texelSize = 1.0f / float2(srcWidth, srcHeight);
+
+    // Final UV within the source texture
+    float2 finalUV = (barSource[bar].xy + uv * barSource[bar].zw) * texelSize;
+
+    // Masked areas of the source (e.g. inner letterbox) are left transparent
+    for (uint i = 0; i < maskCount; i++)
+    {
+        float4 mask = maskRects[i];
+        if (all(finalUV >= mask.xy) && all(finalUV < mask.zw))
+        {
+            gOutput[outCoord] = float4(0.0f, 0.0f, 0.0f, 0.0f);
+            return;
+        }
+    }
+
+    float4 color = gInput.SampleLevel(samLinear, finalUV, 0);
+
+    // Temporal interpolation between the last two captured frames
+    if (blendEnabled > 0)
+    {
+        color = lerp(gPrevious.SampleLevel(samLinear, finalUV, 0), color, blend);
+    }
+
+    // Pixel center in window coordinates, the target may be a scaled down bar surface
+    float2 windowPos = barWindow[bar].xy + (float2(DTid.xy) + 0.5) / dstSize * barWindow[bar].zw;
+
+    if (vignetteEnabled > 0)
+    {
+        color *= gVignette.SampleLevel(samLinear, windowPos / windowSize, 0);
+    }
+
+    // Light peek: bright pixels of the desktop fade the effect out
+    if (lumaMaskEnabled > 0)
+    {
+        float luma = gLuma.Load(int3(windowPos, 0));
+        float alpha = luma < 0.01 ? 1.0 : (1.0 - luma) / 4;
+        color = color * alpha;
+    }
+
+    gOutput[outCoord] = color;
+}
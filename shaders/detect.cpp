@@ -3,8 +3,6 @@
 #include "luma_mainSDR_bin.h"
 #include "luma_mainSCRGB_bin.h"
 #include "luma_mainHDR10_bin.h"
-#include "mask_main_bin.h"
-#include "mask_mainUNorm_bin.h"
 
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "d3dcompiler.lib")
@@ -44,13 +42,13 @@ static void CreateLumaMaskAndStaging(
     textureDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
     textureDesc.CPUAccessFlags = 0;
     textureDesc.MiscFlags = 0;
-    dev->CreateTexture2D(&textureDesc, nullptr, gpuTexOut);
+    CreateTrackedTexture2D(dev, textureDesc, nullptr, ResourceOwnerDetect, "luma", gpuTexOut);
 
     // Staging texture
     textureDesc.Usage = D3D11_USAGE_STAGING;
     textureDesc.BindFlags = 0;
     textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
-    dev->CreateTexture2D(&textureDesc, nullptr, stagingOut);
+    CreateTrackedTexture2D(dev, textureDesc, nullptr, ResourceOwnerDetect, "luma staging", stagingOut);
 }
 
 HRESULT Detection::Initialize(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> context,
@@ -65,7 +63,6 @@ HRESULT Detection::Initialize(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceCo
         m_lumaShader = nullptr;
         m_lumaHDR10Shader = nullptr;
         m_lumaSCRGBShader = nullptr;
-        m_lumaMaskShader = nullptr;
         m_width = 0;
         m_height = 0;
     }
@@ -73,7 +70,7 @@ HRESULT Detection::Initialize(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceCo
     m_device = device;
     m_context = context;
 
-    if (!m_lumaShader || !m_lumaMaskShader || !m_lumaHDR10Shader || !m_lumaSCRGBShader || !m_lumaMaskShaderUNorm)
+    if (!m_lumaShader || !m_lumaHDR10Shader || !m_lumaSCRGBShader)
     {
         // create compute shader
         hr = device->CreateComputeShader(g_luma_mainSDR, sizeof(g_luma_mainSDR), nullptr, &m_lumaShader);
@@ -84,13 +81,6 @@ HRESULT Detection::Initialize(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceCo
 
         hr = device->CreateComputeShader(g_luma_mainSCRGB, sizeof(g_luma_mainSCRGB), nullptr, &m_lumaSCRGBShader);
         RETURN_IF_FAILED(hr);
-
-        hr = device->CreateComputeShader(g_mask_main, sizeof(g_mask_main), nullptr, &m_lumaMaskShader);
-        RETURN_IF_FAILED(hr);
-
-        hr = device->CreateComputeShader(g_mask_mainUNorm, sizeof(g_mask_mainUNorm), nullptr, &m_lumaMaskShaderUNorm);
-        RETURN_IF_FAILED(hr);
-        
     }
 
 
@@ -366,47 +356,9 @@ HRESULT Detection::Detect(ID3D11DeviceContext* context, TextureView target)
     return hr;
 }
 
-HRESULT Detection::RenderLumaMask(ID3D11DeviceContext* context, TextureView target)
-{
-    HRESULT hr = S_OK;
-
-    D3D11_TEXTURE2D_DESC target_desc = {};
-    target.GetTexture()->GetDesc(&target_desc);
-
-    // Set the shader
-    if (target_desc.Format == DXGI_FORMAT_R16G16B16A16_FLOAT)
-    {
-        context->CSSetShader(m_lumaMaskShader.Get(), nullptr, 0); 
-    }
-    else
-    {
-        context->CSSetShader(m_lumaMaskShaderUNorm.Get(), nullptr, 0);
-    }
-
-    // Set the input texture
-    ID3D11ShaderResourceView* srv = m_luma.GetSRV();
-    context->CSSetShaderResources(0, 1, &srv);
-
-    ID3D11UnorderedAccessView* uav = target.GetUAV();
-    context->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
-
-    context->Dispatch(
-        (target_desc.Width + 15) / 16,
-        (target_desc.Height + 15) / 16,
-        1);
-
-    uav = nullptr;
-    context->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
-    srv = nullptr;
-    context->CSSetShaderResources(0, 1, &srv);
-
-    return hr;
-}
-
-
-std::vector<BlackBar> Detection::GetFixedBars(UINT windowWidth, UINT windowHeight, UINT gameWidth, UINT gameHeight)
+BlackBars Detection::GetFixedBars(UINT windowWidth, UINT windowHeight, UINT gameWidth, UINT gameHeight)
 {
-    std::vector<BlackBar> ret;
+    BlackBars ret;
 
     float aspect = (float)gameWidth / (float)gameHeight;
     float windowAspect = (float)windowWidth / (float)windowHeight;
@@ -459,9 +411,9 @@ std::vector<BlackBar> Detection::GetFixedBars(UINT windowWidth, UINT windowHeigh
     return ret;
 }
 
-std::vector<BlackBar> Detection::GetDetectedBars()
+BlackBars Detection::GetDetectedBars()
 {
-    std::vector<BlackBar> ret;
+    BlackBars ret;
     if (m_detectWidth == m_width && m_detectHeight == m_height)
     {
         // no bars detected
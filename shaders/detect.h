@@ -18,10 +18,12 @@ public:
         float blackThreshold, float blackRatio, bool symmetricBars, UINT reservedWidth, UINT reservedHeight, DXGI_COLOR_SPACE_TYPE colorSpace);
 
     HRESULT Detect(ID3D11DeviceContext* context, TextureView target);
-    HRESULT RenderLumaMask(ID3D11DeviceContext* context, TextureView target);
 
-    std::vector<BlackBar> GetDetectedBars();
-    static std::vector<BlackBar> GetFixedBars(UINT windowWidth, UINT windowHeight, UINT gameWidth, UINT gameHeight);
+    // luma of the last detection, used as the light peek mask
+    ID3D11ShaderResourceView* GetLumaSRV() const { return m_luma.GetSRV(); }
+
+    BlackBars GetDetectedBars();
+    static BlackBars GetFixedBars(UINT windowWidth, UINT windowHeight, UINT gameWidth, UINT gameHeight);
 
 private:
     ComPtr<ID3D11Device> m_device;
@@ -31,9 +33,6 @@ private:
     ComPtr<ID3D11ComputeShader> m_lumaHDR10Shader;
     ComPtr<ID3D11ComputeShader> m_lumaSCRGBShader;
 
-    ComPtr<ID3D11ComputeShader> m_lumaMaskShader;
-    ComPtr<ID3D11ComputeShader> m_lumaMaskShaderUNorm;
-
     TextureView m_luma;
     ComPtr<ID3D11Texture2D> m_lumaStaging;
 
@@ -0,0 +1,138 @@
+#include "motion.h"
+#include "d3dcompiler.h"
+#include "motion_main_bin.h"
+
+#pragma comment(lib, "d3d11.lib")
+#pragma comment(lib, "d3dcompiler.lib")
+#pragma comment(lib, "dxgi.lib")
+
+Motion::Motion() :
+    m_writeIndex(0),
+    m_pending(0),
+    m_times()
+{
+}
+
+Motion::~Motion()
+{
+}
+
+HRESULT Motion::Initialize(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> context)
+{
+    HRESULT hr = S_OK;
+    if (m_device != device)
+    {
+        m_shader = nullptr;
+        m_grid.Clear();
+        for (UINT i = 0; i < READBACK_LATENCY; i++)
+            m_staging[i] = nullptr;
+    }
+
+    m_device = device;
+    m_context = context;
+    Reset();
+
+    if (!m_shader)
+    {
+        hr = device->CreateComputeShader(g_motion_main, sizeof(g_motion_main), nullptr, &m_shader);
+        RETURN_IF_FAILED(hr);
+
+        D3D11_SAMPLER_DESC samplerDesc = {};
+        samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+        samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+        samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+        samplerDesc.MinLOD = 0;
+        samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+        hr = device->CreateSamplerState(&samplerDesc, &m_samplerState);
+        RETURN_IF_FAILED(hr);
+
+        hr = m_grid.RecreateTexture(device.Get(), DXGI_FORMAT_R32_FLOAT, MOTION_GRID_WIDTH, MOTION_GRID_HEIGHT,
+            1, false, ResourceOwnerMotion, "motion grid");
+        RETURN_IF_FAILED(hr);
+
+        D3D11_TEXTURE2D_DESC desc = {};
+        desc.Width = MOTION_GRID_WIDTH;
+        desc.Height = MOTION_GRID_HEIGHT;
+        desc.MipLevels = 1;
+        desc.ArraySize = 1;
+        desc.Format = DXGI_FORMAT_R32_FLOAT;
+        desc.SampleDesc.Count = 1;
+        desc.Usage = D3D11_USAGE_STAGING;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        for (UINT i = 0; i < READBACK_LATENCY; i++)
+        {
+            hr = CreateTrackedTexture2D(device.Get(), desc, nullptr, ResourceOwnerMotion, "motion staging", &m_staging[i]);
+            RETURN_IF_FAILED(hr);
+        }
+    }
+
+    return hr;
+}
+
+HRESULT Motion::Render(ID3D11DeviceContext* context, TextureView source, INT64 time)
+{
+    if (!source.GetSRV() || !m_grid.GetTexture())
+        return E_FAIL;
+
+    // the reader fell behind, overwrite the oldest grid
+    if (m_pending == READBACK_LATENCY)
+        m_pending--;
+
+    context->CSSetShader(m_shader.Get(), nullptr, 0);
+    context->CSSetSamplers(0, 1, m_samplerState.GetAddressOf());
+
+    ID3D11ShaderResourceView* srv = source.GetSRV();
+    context->CSSetShaderResources(0, 1, &srv);
+
+    ID3D11UnorderedAccessView* uav = m_grid.GetUAV();
+    context->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
+
+    context->Dispatch(
+        (MOTION_GRID_WIDTH + 15) / 16,
+        (MOTION_GRID_HEIGHT + 15) / 16,
+        1);
+
+    uav = nullptr;
+    context->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
+    srv = nullptr;
+    context->CSSetShaderResources(0, 1, &srv);
+
+    context->CopyResource(m_staging[m_writeIndex].Get(), m_grid.GetTexture());
+    m_times[m_writeIndex] = time;
+    m_writeIndex = (m_writeIndex + 1) % READBACK_LATENCY;
+    m_pending++;
+
+    return S_OK;
+}
+
+bool Motion::ReadGrid(ID3D11DeviceContext* immediate, float* luma, INT64& time)
+{
+    if (m_pending == 0)
+        return false;
+
+    UINT readIndex = (m_writeIndex + READBACK_LATENCY - m_pending) % READBACK_LATENCY;
+    ID3D11Texture2D* staging = m_staging[readIndex].Get();
+
+    D3D11_MAPPED_SUBRESOURCE mapped = {};
+    HRESULT hr = immediate->Map(staging, 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+    if (FAILED(hr))
+        return false;
+
+    for (UINT y = 0; y < MOTION_GRID_HEIGHT; y++)
+    {
+        const float* row = reinterpret_cast<const float*>((const BYTE*)mapped.pData + y * mapped.RowPitch);
+        memcpy(luma + y * MOTION_GRID_WIDTH, row, MOTION_GRID_WIDTH * sizeof(float));
+    }
+
+    immediate->Unmap(staging, 0);
+    time = m_times[readIndex];
+    m_pending--;
+    return true;
+}
+
+void Motion::Reset()
+{
+    m_pending = 0;
+}
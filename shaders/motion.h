@@ -0,0 +1,39 @@
+#pragma once
+#include "../common.h"
+#include "../adaptiverate.h"
+
+// Reduces the blurred effect source to a small luma grid and reads it back a few
+// frames later without stalling, for the adaptive frame rate.
+class Motion
+{
+public:
+    // frames in flight between the sample and the read back
+    static constexpr UINT READBACK_LATENCY = 3;
+
+    Motion();
+    ~Motion();
+    HRESULT Initialize(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> context);
+
+    // record the grid sampling and the copy into the next staging texture,
+    // time is when source was captured and comes back with the grid
+    HRESULT Render(ID3D11DeviceContext* context, TextureView source, INT64 time);
+
+    // Copy the oldest pending grid into luma (MOTION_GRID_WIDTH x MOTION_GRID_HEIGHT).
+    // Returns false if there is none, or the GPU has not finished it yet.
+    bool ReadGrid(ID3D11DeviceContext* immediate, float* luma, INT64& time);
+
+    // drop pending grids, e.g. when the effect stops
+    void Reset();
+private:
+    ComPtr<ID3D11Device> m_device;
+    ComPtr<ID3D11DeviceContext> m_context;
+
+    ComPtr<ID3D11ComputeShader> m_shader;
+    ComPtr<ID3D11SamplerState> m_samplerState;
+
+    TextureView m_grid;
+    ComPtr<ID3D11Texture2D> m_staging[READBACK_LATENCY];
+    INT64 m_times[READBACK_LATENCY];
+    UINT m_writeIndex;
+    UINT m_pending;
+};
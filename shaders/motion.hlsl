@@ -0,0 +1,22 @@
+// Samples the blurred effect source on a small fixed grid.
+// The grid is read back on the CPU to estimate how much the image moves between frames.
+
+Texture2D<float4> gInput : register(t0);
+RWTexture2D<float> gGrid : register(u0);
+SamplerState samLinear : register(s0);
+
+static const float3 LumaWeights709 = float3(0.2126, 0.7152, 0.0722);
+
+[numthreads(16, 16, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    uint2 size;
+    gGrid.GetDimensions(size.x, size.y);
+    if (any(DTid.xy >= size))
+        return;
+
+    // the source is already blurred, one bilinear tap per cell is enough
+    float2 uv = (float2(DTid.xy) + 0.5) / float2(size);
+    float3 color = gInput.SampleLevel(samLinear, uv, 0).rgb;
+    gGrid[DTid.xy] = dot(color, LumaWeights709);
+}
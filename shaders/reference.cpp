@@ -0,0 +1,537 @@
+#include "reference.h"
+
+#include <algorithm>
+#include <cmath>
+
+static Pixel Lerp(const Pixel& a, const Pixel& b, float t)
+{
+    return {
+        a.r + (b.r - a.r) * t,
+        a.g + (b.g - a.g) * t,
+        a.b + (b.b - a.b) * t,
+        a.a + (b.a - a.a) * t
+    };
+}
+
+Pixel Image::Sample(float u, float v) const
+{
+    if (m_width == 0 || m_height == 0)
+        return { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    // texel centers are at (i + 0.5) / size
+    float x = u * m_width - 0.5f;
+    float y = v * m_height - 0.5f;
+    float x0f = std::floor(x);
+    float y0f = std::floor(y);
+    float fx = x - x0f;
+    float fy = y - y0f;
+
+    int maxX = (int)m_width - 1;
+    int maxY = (int)m_height - 1;
+    int x0 = std::clamp((int)x0f, 0, maxX);
+    int x1 = std::clamp((int)x0f + 1, 0, maxX);
+    int y0 = std::clamp((int)y0f, 0, maxY);
+    int y1 = std::clamp((int)y0f + 1, 0, maxY);
+
+    Pixel top = Lerp(At(x0, y0), At(x1, y0), fx);
+    Pixel bottom = Lerp(At(x0, y1), At(x1, y1), fx);
+    return Lerp(top, bottom, fy);
+}
+
+static int Mirror(int i, int size)
+{
+    // D3D11_TEXTURE_ADDRESS_MIRROR: ... 1 0 | 0 1 ... n-1 | n-1 n-2 ...
+    int period = size * 2;
+    i %= period;
+    if (i < 0)
+        i += period;
+    return i < size ? i : period - 1 - i;
+}
+
+Pixel Image::SampleMirror(float u, float v) const
+{
+    if (m_width == 0 || m_height == 0)
+        return { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    float x = u * m_width - 0.5f;
+    float y = v * m_height - 0.5f;
+    float x0f = std::floor(x);
+    float y0f = std::floor(y);
+    float fx = x - x0f;
+    float fy = y - y0f;
+
+    int x0 = Mirror((int)x0f, (int)m_width);
+    int x1 = Mirror((int)x0f + 1, (int)m_width);
+    int y0 = Mirror((int)y0f, (int)m_height);
+    int y1 = Mirror((int)y0f + 1, (int)m_height);
+
+    Pixel top = Lerp(At(x0, y0), At(x1, y0), fx);
+    Pixel bottom = Lerp(At(x0, y1), At(x1, y1), fx);
+    return Lerp(top, bottom, fy);
+}
+
+static float Saturate(float x)
+{
+    // HLSL saturate maps NaN to 0
+    if (!(x > 0.0f))
+        return 0.0f;
+    return x < 1.0f ? x : 1.0f;
+}
+
+static float SmoothStep(float edge0, float edge1, float x)
+{
+    float t = Saturate((x - edge0) / (edge1 - edge0));
+    return t * t * (3.0f - 2.0f * t);
+}
+
+static bool SampleBar(const CompositeBar& bar, const Image& source, uint32_t x, uint32_t y,
+    const UVRect* masks, uint32_t maskCount, Pixel& out)
+{
+    float texelX = 1.0f / source.Width();
+    float texelY = 1.0f / source.Height();
+
+    float u = (float)x / bar.targetWidth;
+    float v = (float)y / bar.targetHeight;
+    if (bar.flip == FlipHorizontal)
+        u = 1.0f - u;
+    if (bar.flip == FlipVertical)
+        v = 1.0f - v;
+
+    float finalU = bar.sourceX * texelX + u * bar.sourceWidth * texelX;
+    float finalV = bar.sourceY * texelY + v * bar.sourceHeight * texelY;
+
+    for (uint32_t i = 0; i < maskCount; i++)
+    {
+        const UVRect& m = masks[i];
+        if (finalU >= m.left && finalU < m.right && finalV >= m.top && finalV < m.bottom)
+        {
+            out = { 0.0f, 0.0f, 0.0f, 0.0f };
+            return false;
+        }
+    }
+
+    out = source.Sample(finalU, finalV);
+    return true;
+}
+
+void ReferenceCopy(Image& target, const CompositeBar& bar, const Image& source,
+    const UVRect* masks, uint32_t maskCount)
+{
+    if (source.Width() == 0 || source.Height() == 0)
+        return;
+
+    for (uint32_t y = 0; y < bar.targetHeight; y++)
+    {
+        uint32_t outY = bar.targetY + y;
+        if (outY >= target.Height())
+            break;
+
+        for (uint32_t x = 0; x < bar.targetWidth; x++)
+        {
+            uint32_t outX = bar.targetX + x;
+            if (outX >= target.Width())
+                break;
+
+            SampleBar(bar, source, x, y, masks, maskCount, target.At(outX, outY));
+        }
+    }
+}
+
+float ReferenceVignetteFactor(float u, float v, const VignetteSettings& settings)
+{
+    const float centerX = 0.5f;
+    const float centerY = 0.5f;
+
+    // adjust for aspect ratio
+    if (settings.aspect >= 1.0f)
+        v = (v - centerY) / settings.aspect + centerY;
+    else
+        u = (u - centerX) / settings.aspect + centerX;
+
+    float dx = u - centerX;
+    float dy = v - centerY;
+    float dist = std::sqrt(dx * dx + dy * dy);
+
+    float factor = SmoothStep(settings.radius, settings.radius - settings.smoothness, dist);
+    return 1.0f - ((1.0f - factor) * settings.intensity);
+}
+
+void VignetteMap::Bake(const VignetteSettings& settings, uint32_t width, uint32_t height)
+{
+    m_width = width;
+    m_height = height;
+    m_factors.resize((size_t)width * height);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            float u = ((float)x + 0.5f) / width;
+            float v = ((float)y + 0.5f) / height;
+            m_factors[(size_t)y * width + x] = ReferenceVignetteFactor(u, v, settings);
+        }
+    }
+}
+
+float VignetteMap::Sample(float u, float v) const
+{
+    if (m_width == 0 || m_height == 0)
+        return 1.0f;
+
+    float x = u * m_width - 0.5f;
+    float y = v * m_height - 0.5f;
+    float x0f = std::floor(x);
+    float y0f = std::floor(y);
+    float fx = x - x0f;
+    float fy = y - y0f;
+
+    int maxX = (int)m_width - 1;
+    int maxY = (int)m_height - 1;
+    int x0 = std::clamp((int)x0f, 0, maxX);
+    int x1 = std::clamp((int)x0f + 1, 0, maxX);
+    int y0 = std::clamp((int)y0f, 0, maxY);
+    int y1 = std::clamp((int)y0f + 1, 0, maxY);
+
+    auto at = [this](int px, int py) { return m_factors[(size_t)py * m_width + px]; };
+    float top = at(x0, y0) + (at(x1, y0) - at(x0, y0)) * fx;
+    float bottom = at(x0, y1) + (at(x1, y1) - at(x0, y1)) * fx;
+    return top + (bottom - top) * fy;
+}
+
+static Pixel Scale(const Pixel& p, float s)
+{
+    return { p.r * s, p.g * s, p.b * s, p.a * s };
+}
+
+void ReferenceVignette(Image& target, const VignetteSettings& settings)
+{
+    for (uint32_t y = 0; y < target.Height(); y++)
+    {
+        for (uint32_t x = 0; x < target.Width(); x++)
+        {
+            float u = ((float)x + 0.5f) / target.Width();
+            float v = ((float)y + 0.5f) / target.Height();
+            // the vignette color is transparent black, so the lerp is a scale
+            target.At(x, y) = Scale(target.At(x, y), ReferenceVignetteFactor(u, v, settings));
+        }
+    }
+}
+
+float ReferenceLumaAlpha(float luma)
+{
+    return luma < 0.01f ? 1.0f : (1.0f - luma) / 4;
+}
+
+static float LoadLuma(const float* luma, uint32_t lumaWidth, uint32_t lumaHeight, uint32_t x, uint32_t y)
+{
+    // out of bounds loads return 0
+    if (!luma || x >= lumaWidth || y >= lumaHeight)
+        return 0.0f;
+    return luma[(size_t)y * lumaWidth + x];
+}
+
+void ReferenceLumaMask(Image& target, const float* luma, uint32_t lumaWidth, uint32_t lumaHeight)
+{
+    for (uint32_t y = 0; y < target.Height(); y++)
+    {
+        for (uint32_t x = 0; x < target.Width(); x++)
+        {
+            float alpha = ReferenceLumaAlpha(LoadLuma(luma, lumaWidth, lumaHeight, x, y));
+            target.At(x, y) = Scale(target.At(x, y), alpha);
+        }
+    }
+}
+
+void ReferenceComposite(Image& target, const Image& source, const CompositeBar* bars, uint32_t barCount,
+    const UVRect* masks, uint32_t maskCount, uint32_t windowWidth, uint32_t windowHeight,
+    const VignetteMap* vignette, const float* luma,
+    const Image* previous, float blend)
+{
+    if (source.Width() == 0 || source.Height() == 0)
+        return;
+
+    for (uint32_t i = 0; i < barCount; i++)
+    {
+        const CompositeBar& bar = bars[i];
+        for (uint32_t y = 0; y < bar.targetHeight; y++)
+        {
+            uint32_t outY = bar.targetY + y;
+            if (outY >= target.Height())
+                break;
+
+            for (uint32_t x = 0; x < bar.targetWidth; x++)
+            {
+                uint32_t outX = bar.targetX + x;
+                if (outX >= target.Width())
+                    break;
+
+                Pixel color;
+                if (SampleBar(bar, source, x, y, masks, maskCount, color))
+                {
+                    if (previous)
+                    {
+                        Pixel last;
+                        SampleBar(bar, *previous, x, y, nullptr, 0, last);
+                        color = Lerp(last, color, blend);
+                    }
+
+                    // pixel center in window coordinates
+                    float windowPosX = bar.windowX + ((float)x + 0.5f) / bar.targetWidth * bar.windowWidth;
+                    float windowPosY = bar.windowY + ((float)y + 0.5f) / bar.targetHeight * bar.windowHeight;
+
+                    float scale = 1.0f;
+                    if (vignette)
+                    {
+                        scale *= vignette->Sample(windowPosX / windowWidth, windowPosY / windowHeight);
+                    }
+                    if (luma)
+                    {
+                        scale *= ReferenceLumaAlpha(LoadLuma(luma, windowWidth, windowHeight, (uint32_t)windowPosX, (uint32_t)windowPosY));
+                    }
+                    color = Scale(color, scale);
+                }
+                target.At(outX, outY) = color;
+            }
+        }
+    }
+}
+
+void ReferenceCopyRegion(Image& target, const Image& source, uint32_t left, uint32_t top)
+{
+    if (left >= source.Width() || top >= source.Height())
+        return;
+
+    uint32_t width = std::min(target.Width(), source.Width() - left);
+    uint32_t height = std::min(target.Height(), source.Height() - top);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        std::copy(&source.At(left, top + y), &source.At(left, top + y) + width, &target.At(0, y));
+    }
+}
+
+void ReferenceDownsample(Image& target, const Image& source)
+{
+    if (source.Width() == 0 || source.Height() == 0)
+        return;
+
+    uint32_t width = std::max(1u, source.Width() / 2);
+    uint32_t height = std::max(1u, source.Height() / 2);
+    if (target.Width() != width || target.Height() != height)
+        target.Resize(width, height);
+
+    uint32_t maxX = source.Width() - 1;
+    uint32_t maxY = source.Height() - 1;
+    for (uint32_t y = 0; y < height; y++)
+    {
+        uint32_t y0 = std::min(y * 2, maxY);
+        uint32_t y1 = std::min(y * 2 + 1, maxY);
+        for (uint32_t x = 0; x < width; x++)
+        {
+            uint32_t x0 = std::min(x * 2, maxX);
+            uint32_t x1 = std::min(x * 2 + 1, maxX);
+            Pixel top = Lerp(source.At(x0, y0), source.At(x1, y0), 0.5f);
+            Pixel bottom = Lerp(source.At(x0, y1), source.At(x1, y1), 0.5f);
+            target.At(x, y) = Lerp(top, bottom, 0.5f);
+        }
+    }
+}
+
+static float ComputeGaussian(float n, float theta)
+{
+    const float pi = 3.14159265358979f;
+    return (float)((1.0 / std::sqrt(2 * pi * theta)) * std::exp(-(n * n) / (2 * theta * theta)));
+}
+
+BlurKernel ReferenceBlurKernel(uint32_t samples, float amount)
+{
+    BlurKernel kernel = {};
+    kernel.count = std::clamp(samples, 1u, BlurKernel::MAX_SAMPLE_COUNT);
+
+    kernel.weights[0] = ComputeGaussian(0, amount);
+    kernel.offsets[0] = 0.0f;
+    float totalWeights = kernel.weights[0];
+
+    // pairs of taps halfway between two texels, as in VS_BLUR_PARAMETERS
+    for (uint32_t i = 0; i < kernel.count / 2; i++)
+    {
+        float weight = ComputeGaussian(float(i + 1), amount);
+        kernel.weights[i * 2 + 1] = weight;
+        kernel.weights[i * 2 + 2] = weight;
+        totalWeights += weight * 2;
+
+        float offset = float(i) * 2.0f + 1.5f;
+        kernel.offsets[i * 2 + 1] = offset;
+        kernel.offsets[i * 2 + 2] = -offset;
+    }
+
+    for (uint32_t i = 0; i < kernel.count; i++)
+        kernel.weights[i] /= totalWeights;
+
+    return kernel;
+}
+
+void ReferenceBlurPass(Image& target, const Image& source, const BlurKernel& kernel, bool vertical)
+{
+    uint32_t width = target.Width();
+    uint32_t height = target.Height();
+    float texelX = vertical ? 0.0f : 1.0f / width;
+    float texelY = vertical ? 1.0f / height : 0.0f;
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            float u = ((float)x + 0.5f) / width;
+            float v = ((float)y + 0.5f) / height;
+
+            Pixel c = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (uint32_t i = 0; i < kernel.count; i++)
+            {
+                Pixel s = source.SampleMirror(u + kernel.offsets[i] * texelX, v + kernel.offsets[i] * texelY);
+                float w = kernel.weights[i];
+                c.r += s.r * w;
+                c.g += s.g * w;
+                c.b += s.b * w;
+                c.a += s.a * w;
+            }
+            target.At(x, y) = c;
+        }
+    }
+}
+
+void ReferenceBlur(Image& target, Image& temp, const BlurKernel& kernel, uint32_t passes)
+{
+    if (temp.Width() != target.Width() || temp.Height() != target.Height())
+        temp.Resize(target.Width(), target.Height());
+
+    for (uint32_t i = 0; i < passes; i++)
+    {
+        ReferenceBlurPass(temp, target, kernel, false);
+        ReferenceBlurPass(target, temp, kernel, true);
+    }
+}
+
+void ReferenceLuma(const Image& source, float* luma)
+{
+    size_t count = (size_t)source.Width() * source.Height();
+    for (size_t i = 0; i < count; i++)
+    {
+        const Pixel& p = source.Data()[i];
+        float r = std::pow(std::max(p.r, 0.0f), 2.2f);
+        float g = std::pow(std::max(p.g, 0.0f), 2.2f);
+        float b = std::pow(std::max(p.b, 0.0f), 2.2f);
+        luma[i] = Saturate(r * 0.2126f + g * 0.7152f + b * 0.0722f);
+    }
+}
+
+static bool IsLineMostlyBlack(const float* data, uint32_t length, size_t stride,
+    float blackThreshold, float blackRatio, float blackVariance)
+{
+    uint32_t darkPixelCount = 0;
+    float sum = 0.0f;
+    float sumSq = 0.0f;
+
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        float pixel = data[i * stride];
+        if (pixel <= blackThreshold)
+        {
+            ++darkPixelCount;
+            sum += pixel;
+            sumSq += pixel * pixel;
+        }
+    }
+
+    if (darkPixelCount == 0)
+        return false;
+
+    float darkRatio = (float)darkPixelCount / (float)length;
+    if (darkRatio < blackRatio)
+        return false;
+
+    float n = (float)darkPixelCount;
+    float mean = sum / n;
+    float variance = (sumSq / n) - (mean * mean);
+    return variance <= blackVariance;
+}
+
+DetectedBars ReferenceDetectBars(const float* luma, uint32_t width, uint32_t height,
+    float blackThreshold, float blackRatio, float blackVariance, uint32_t minBarSize)
+{
+    DetectedBars bars = {};
+    if (width == 0 || height == 0)
+        return bars;
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        if (!IsLineMostlyBlack(luma + (size_t)y * width, width, 1, blackThreshold, blackRatio, blackVariance))
+        {
+            bars.top = y;
+            break;
+        }
+    }
+
+    for (uint32_t y = height; y-- > 0;)
+    {
+        if (!IsLineMostlyBlack(luma + (size_t)y * width, width, 1, blackThreshold, blackRatio, blackVariance))
+        {
+            bars.bottom = (height - 1) - y;
+            break;
+        }
+    }
+
+    for (uint32_t x = 0; x < width; ++x)
+    {
+        if (!IsLineMostlyBlack(luma + x, height, width, blackThreshold, blackRatio, blackVariance))
+        {
+            bars.left = x;
+            break;
+        }
+    }
+
+    for (uint32_t x = width; x-- > 0;)
+    {
+        if (!IsLineMostlyBlack(luma + x, height, width, blackThreshold, blackRatio, blackVariance))
+        {
+            bars.right = (width - 1) - x;
+            break;
+        }
+    }
+
+    bars.top = bars.top < minBarSize ? 0 : bars.top;
+    bars.bottom = bars.bottom < minBarSize ? 0 : bars.bottom;
+    bars.left = bars.left < minBarSize ? 0 : bars.left;
+    bars.right = bars.right < minBarSize ? 0 : bars.right;
+    return bars;
+}
+
+void ReferenceClear(Image& target, uint32_t left, uint32_t top, uint32_t right, uint32_t bottom)
+{
+    right = std::min(right, target.Width());
+    bottom = std::min(bottom, target.Height());
+    for (uint32_t y = top; y < bottom; y++)
+    {
+        for (uint32_t x = left; x < right; x++)
+        {
+            target.At(x, y) = { 0.0f, 0.0f, 0.0f, 0.0f };
+        }
+    }
+}
+
+float ReferenceMaxDifference(const Image& a, const Image& b)
+{
+    if (a.Width() != b.Width() || a.Height() != b.Height())
+        return INFINITY;
+
+    float maxDiff = 0.0f;
+    size_t count = (size_t)a.Width() * a.Height();
+    for (size_t i = 0; i < count; i++)
+    {
+        const Pixel& pa = a.Data()[i];
+        const Pixel& pb = b.Data()[i];
+        maxDiff = std::max(maxDiff, std::fabs(pa.r - pb.r));
+        maxDiff = std::max(maxDiff, std::fabs(pa.g - pb.g));
+        maxDiff = std::max(maxDiff, std::fabs(pa.b - pb.b));
+        maxDiff = std::max(maxDiff, std::fabs(pa.a - pb.a));
+    }
+    return maxDiff;
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+// Portable CPU implementations of the effect shaders, a reference for the GPU output.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct Pixel
+{
+    float r, g, b, a;
+};
+
+struct UVRect
+{
+    float left, top, right, bottom;
+};
+
+class Image
+{
+public:
+    Image() : m_width(0), m_height(0) {}
+    Image(uint32_t width, uint32_t height) { Resize(width, height); }
+
+    void Resize(uint32_t width, uint32_t height)
+    {
+        m_width = width;
+        m_height = height;
+        m_pixels.assign((size_t)width * height, Pixel{ 0.0f, 0.0f, 0.0f, 0.0f });
+    }
+
+    uint32_t Width() const { return m_width; }
+    uint32_t Height() const { return m_height; }
+
+    Pixel& At(uint32_t x, uint32_t y) { return m_pixels[(size_t)y * m_width + x]; }
+    const Pixel& At(uint32_t x, uint32_t y) const { return m_pixels[(size_t)y * m_width + x]; }
+
+    // bilinear sample with clamp addressing, matching SampleLevel(samLinear, uv, 0)
+    Pixel Sample(float u, float v) const;
+    // bilinear sample with mirror addressing, the blur sampler
+    Pixel SampleMirror(float u, float v) const;
+
+    Pixel* Data() { return m_pixels.data(); }
+    const Pixel* Data() const { return m_pixels.data(); }
+
+private:
+    uint32_t m_width;
+    uint32_t m_height;
+    std::vector<Pixel> m_pixels;
+};
+
+enum FlipMode
+{
+    FlipNone = 0,
+    FlipHorizontal = 1,
+    FlipVertical = 2
+};
+
+// one bar of the composite: a target rectangle filled from a source region
+struct CompositeBar
+{
+    // target rectangle in pixels
+    uint32_t targetX, targetY, targetWidth, targetHeight;
+    // source region in (sub)texels
+    float sourceX, sourceY, sourceWidth, sourceHeight;
+    // window area the target rectangle covers, the same as the target unless it is a scaled surface
+    float windowX, windowY, windowWidth, windowHeight;
+    FlipMode flip;
+};
+
+struct VignetteSettings
+{
+    float intensity;
+    float radius;
+    float smoothness;
+    float aspect;
+};
+
+// Scale a source region into a target region, optionally flipped.
+// Samples whose source UV falls inside one of the masks are written as transparent.
+void ReferenceCopy(Image& target, const CompositeBar& bar, const Image& source,
+    const UVRect* masks = nullptr, uint32_t maskCount = 0);
+
+// vignette.hlsl: attenuation at normalized target coordinates (pixel centers)
+float ReferenceVignetteFactor(float u, float v, const VignetteSettings& settings);
+void ReferenceVignette(Image& target, const VignetteSettings& settings);
+
+// Vignette attenuation baked over normalized target coordinates.
+// The size is fixed, so the memory used does not depend on the window size.
+class VignetteMap
+{
+public:
+    static constexpr uint32_t SIZE = 256;
+
+    VignetteMap() : m_width(0), m_height(0) {}
+
+    void Bake(const VignetteSettings& settings, uint32_t width = SIZE, uint32_t height = SIZE);
+
+    // bilinear sample with clamp addressing, same as the GPU lookup
+    float Sample(float u, float v) const;
+
+    uint32_t Width() const { return m_width; }
+    uint32_t Height() const { return m_height; }
+    const float* Data() const { return m_factors.data(); }
+
+private:
+    uint32_t m_width;
+    uint32_t m_height;
+    std::vector<float> m_factors;
+};
+
+// mask.hlsl: light peek alpha for a detection luma value
+float ReferenceLumaAlpha(float luma);
+void ReferenceLumaMask(Image& target, const float* luma, uint32_t lumaWidth, uint32_t lumaHeight);
+
+// composite.hlsl: the copy, vignette and luma mask of every bar in a single pass.
+// Only the bar rectangles are written, vignette and luma are optional and are
+// evaluated in window coordinates. With a previous source the samples are
+// lerp(previous, source, blend).
+void ReferenceComposite(Image& target, const Image& source, const CompositeBar* bars, uint32_t barCount,
+    const UVRect* masks, uint32_t maskCount, uint32_t windowWidth, uint32_t windowHeight,
+    const VignetteMap* vignette, const float* luma,
+    const Image* previous = nullptr, float blend = 1.0f);
+
+// CopySubresourceRegion: the target sized region of the source at (left, top)
+void ReferenceCopyRegion(Image& target, const Image& source, uint32_t left, uint32_t top);
+
+// GenerateMips: one 2x2 box filtered level, the target is half the source size (at least 1)
+void ReferenceDownsample(Image& target, const Image& source);
+
+// blur.cpp: gaussian taps along one axis, offsets in texels
+struct BlurKernel
+{
+    static constexpr uint32_t MAX_SAMPLE_COUNT = 63;
+
+    uint32_t count;
+    float offsets[MAX_SAMPLE_COUNT];
+    float weights[MAX_SAMPLE_COUNT];
+};
+BlurKernel ReferenceBlurKernel(uint32_t samples, float amount = 4.0f);
+// blur.hlsl: one direction, target and source have the same size
+void ReferenceBlurPass(Image& target, const Image& source, const BlurKernel& kernel, bool vertical);
+// Blur::Render: horizontal then vertical for every pass, temp is resized as needed
+void ReferenceBlur(Image& target, Image& temp, const BlurKernel& kernel, uint32_t passes);
+
+// luma.hlsl mainSDR: saturated linear BT.709 luma, one float per pixel
+void ReferenceLuma(const Image& source, float* luma);
+
+// black bars found by Detection::Detect, in pixels from each edge
+struct DetectedBars
+{
+    uint32_t top, bottom, left, right;
+};
+// The scan of Detection::Detect over a luma image: a line is black when enough of
+// it is below the threshold and the dark pixels barely vary. Bars shorter than
+// minBarSize are ignored, reserved area and symmetric bars are not applied.
+DetectedBars ReferenceDetectBars(const float* luma, uint32_t width, uint32_t height,
+    float blackThreshold, float blackRatio, float blackVariance, uint32_t minBarSize = 16);
+
+// clear a rectangle to transparent black, same as ClearView
+void ReferenceClear(Image& target, uint32_t left, uint32_t top, uint32_t right, uint32_t bottom);
+
+// largest per-channel absolute difference between two images of the same size
+float ReferenceMaxDifference(const Image& a, const Image& b);
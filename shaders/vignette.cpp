@@ -1,25 +1,10 @@
 #include "vignette.h"
-#include "d3dcompiler.h"
-#include "vignette_main_bin.h"
-#include "vignette_mainUNorm_bin.h"
+
+#include <algorithm>
 
 #pragma comment(lib, "d3d11.lib")
-#pragma comment(lib, "d3dcompiler.lib")
 #pragma comment(lib, "dxgi.lib")
 
-using namespace DirectX;
-
-__declspec(align(16))
-struct VIGNETTE_PARAMETERS
-{
-    XMFLOAT2 center;
-    float intensity;
-    float radius;
-    float smoothness;
-    float screenAspect;
-    XMFLOAT4 vignetteColor;
-};
-
 Vignette::Vignette()
 {
 }
@@ -33,74 +18,59 @@ HRESULT Vignette::Initialize(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceCon
     HRESULT hr = S_OK;
     if (m_device != device)
     {
-        m_shader = nullptr;
-        m_shaderUNorm = nullptr;
+        m_attenuation.Clear();
     }
 
     m_device = device;
     m_context = context;
 
-    if (!m_shader ||!m_shaderUNorm)
+    VignetteSettings settings = {};
+    settings.intensity = intensity;
+    settings.radius = radius;
+    settings.smoothness = smoothness;
+    settings.aspect = aspect;
+
+    if (m_attenuation.GetTexture() &&
+        settings.intensity == m_settings.intensity &&
+        settings.radius == m_settings.radius &&
+        settings.smoothness == m_settings.smoothness &&
+        settings.aspect == m_settings.aspect)
     {
-        hr = device->CreateComputeShader(g_vignette_main, sizeof(g_vignette_main), nullptr, &m_shader);
-        RETURN_IF_FAILED(hr);
-
-        hr = device->CreateComputeShader(g_vignette_mainUNorm, sizeof(g_vignette_mainUNorm), nullptr, &m_shaderUNorm);
-        RETURN_IF_FAILED(hr);
-
-        // Create constant buffer
-        D3D11_BUFFER_DESC bufferDesc = {};
-        bufferDesc.Usage = D3D11_USAGE_DEFAULT;
-        bufferDesc.ByteWidth = sizeof(VIGNETTE_PARAMETERS);
-        bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-        hr = device->CreateBuffer(&bufferDesc, nullptr, &m_params);
-        RETURN_IF_FAILED(hr);
+        // nothing changed, keep the baked map
+        return hr;
     }
 
-    VIGNETTE_PARAMETERS paramData = {};
-    paramData.center = { 0.5f, 0.5f };
-    paramData.intensity = intensity;
-    paramData.radius = radius;
-    paramData.smoothness = smoothness;
-    paramData.screenAspect = aspect;
-    paramData.vignetteColor = { 0.0f, 0.0f, 0.0f, 0.0f };
-    m_context->UpdateSubresource(m_params.Get(), 0, nullptr, &paramData, sizeof(VIGNETTE_PARAMETERS), 0);
+    m_settings = settings;
+    m_map.Bake(settings);
 
-    return hr;
-}
-
-HRESULT Vignette::Render(ID3D11DeviceContext* context, TextureView target)
-{
-    HRESULT hr = S_OK;
-
-    if (!target.GetTexture())
-        return E_FAIL;
-
-    D3D11_TEXTURE2D_DESC target_desc = {};
-    target.GetTexture()->GetDesc(&target_desc);
-
-    context->CSSetConstantBuffers(0, 1, m_params.GetAddressOf());
-
-    if (target_desc.Format == DXGI_FORMAT_R16G16B16A16_FLOAT)
+    std::vector<uint16_t> texels(m_map.Width() * m_map.Height());
+    for (size_t i = 0; i < texels.size(); i++)
     {
-        context->CSSetShader(m_shader.Get(), nullptr, 0);
+        float factor = std::clamp(m_map.Data()[i], 0.0f, 1.0f);
+        texels[i] = (uint16_t)(factor * 65535.0f + 0.5f);
     }
-    else
-    {
-        context->CSSetShader(m_shaderUNorm.Get(), nullptr, 0);
-    }
-    
 
-    ID3D11UnorderedAccessView* uav = target.GetUAV();
-    context->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
+    D3D11_TEXTURE2D_DESC desc = {};
+    desc.Width = m_map.Width();
+    desc.Height = m_map.Height();
+    desc.MipLevels = 1;
+    desc.ArraySize = 1;
+    desc.Format = DXGI_FORMAT_R16_UNORM;
+    desc.SampleDesc.Count = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.Usage = D3D11_USAGE_IMMUTABLE;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 
-    context->Dispatch(
-        (target_desc.Width + 15) / 16,
-        (target_desc.Height + 15) / 16,
-        1);
+    D3D11_SUBRESOURCE_DATA data = {};
+    data.pSysMem = texels.data();
+    data.SysMemPitch = m_map.Width() * sizeof(uint16_t);
 
-    uav = nullptr;
-    context->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
+    ComPtr<ID3D11Texture2D> texture;
+    hr = CreateTrackedTexture2D(device.Get(), desc, &data, ResourceOwnerEffect, "vignette mask", &texture);
+    RETURN_IF_FAILED(hr);
 
-    return S_OK;
+    m_attenuation.Clear();
+    m_attenuation.CreateViews(device.Get(), texture.Get(), false, true, false);
+
+    return hr;
 }
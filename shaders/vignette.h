@@ -2,21 +2,24 @@
 #include "../common.h"
 #include <stdint.h>
 #include "DirectXMath.h"
+#include "reference.h"
 
 
+// Vignette attenuation, baked into a small fixed size map whenever the settings change.
+// The composite pass applies it to the bars with a single sample and multiply.
 class Vignette
 {
 public:
     Vignette();
     ~Vignette();
     HRESULT Initialize(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> context, float intensity, float radius, float smoothness, float aspect);
-    HRESULT Render(ID3D11DeviceContext* context, TextureView target);
+
+    ID3D11ShaderResourceView* GetAttenuationSRV() const { return m_attenuation.GetSRV(); }
 private:
     ComPtr<ID3D11Device> m_device;
     ComPtr<ID3D11DeviceContext> m_context;
 
-    ComPtr<ID3D11ComputeShader> m_shader;
-    ComPtr<ID3D11ComputeShader> m_shaderUNorm;
-
-    ComPtr<ID3D11Buffer> m_params;
+    VignetteSettings m_settings = {};
+    VignetteMap m_map;
+    TextureView m_attenuation;
 };
@@ -0,0 +1,57 @@
+#include "surfaceplan.h"
+
+static PlannedSurface PlanSurface(const SurfaceRect& window, uint32_t downscale)
+{
+    uint32_t windowWidth = window.right - window.left;
+    uint32_t windowHeight = window.bottom - window.top;
+
+    PlannedSurface surface = {};
+    surface.window = window;
+    surface.width = (windowWidth + downscale - 1) / downscale;
+    surface.height = (windowHeight + downscale - 1) / downscale;
+    if (surface.width == 0)
+        surface.width = 1;
+    if (surface.height == 0)
+        surface.height = 1;
+    surface.scaleX = (float)windowWidth / (float)surface.width;
+    surface.scaleY = (float)windowHeight / (float)surface.height;
+    return surface;
+}
+
+static void AddSurface(SurfacePlan& plan, const PlannedSurface& surface, uint32_t bytesPerPixel, uint32_t bufferCount)
+{
+    uint64_t pixels = (uint64_t)surface.width * surface.height;
+    plan.surfaces[plan.count++] = surface;
+    plan.bytes += pixels * bytesPerPixel * bufferCount;
+    plan.pixelsPerFrame += pixels;
+}
+
+SurfacePlan PlanBarSurfaces(const SurfaceRect* bars, uint32_t barCount, uint32_t downscale,
+    uint32_t bytesPerPixel, uint32_t bufferCount)
+{
+    SurfacePlan plan = {};
+    if (downscale == 0)
+        downscale = 1;
+
+    for (uint32_t i = 0; i < barCount && plan.count < SurfacePlan::MAX_SURFACES; i++)
+    {
+        const SurfaceRect& bar = bars[i];
+        if (bar.left >= bar.right || bar.top >= bar.bottom)
+            continue;
+
+        AddSurface(plan, PlanSurface(bar, downscale), bytesPerPixel, bufferCount);
+    }
+    return plan;
+}
+
+SurfacePlan PlanWindowSurface(uint32_t windowWidth, uint32_t windowHeight,
+    uint32_t bytesPerPixel, uint32_t bufferCount)
+{
+    SurfacePlan plan = {};
+    if (windowWidth == 0 || windowHeight == 0)
+        return plan;
+
+    SurfaceRect window = { 0, 0, windowWidth, windowHeight };
+    AddSurface(plan, PlanSurface(window, 1), bytesPerPixel, bufferCount);
+    return plan;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+// Layout of the output surfaces for the bar effects.
+
+#include <stdint.h>
+
+struct SurfaceRect
+{
+    uint32_t left, top, right, bottom;
+};
+
+struct PlannedSurface
+{
+    // area of the window the surface covers
+    SurfaceRect window;
+    // surface size in pixels
+    uint32_t width, height;
+    // compositor scale from surface pixels to window pixels
+    float scaleX, scaleY;
+};
+
+struct SurfacePlan
+{
+    static constexpr uint32_t MAX_SURFACES = 2;
+
+    PlannedSurface surfaces[MAX_SURFACES];
+    uint32_t count;
+
+    // memory of all surfaces, including every swapchain buffer
+    uint64_t bytes;
+    // pixels written into the surfaces for one frame
+    uint64_t pixelsPerFrame;
+};
+
+// One surface per non-empty bar, each dimension divided by downscale (rounded up) and
+// stretched back by the compositor.
+SurfacePlan PlanBarSurfaces(const SurfaceRect* bars, uint32_t barCount, uint32_t downscale,
+    uint32_t bytesPerPixel, uint32_t bufferCount);
+
+// A single surface covering the whole window, the layout used without bar surfaces.
+SurfacePlan PlanWindowSurface(uint32_t windowWidth, uint32_t windowHeight,
+    uint32_t bytesPerPixel, uint32_t bufferCount);
@@ -0,0 +1,152 @@
+#include "texturepool.h"
+
+bool operator==(const TexturePoolKey& a, const TexturePoolKey& b)
+{
+    return a.desc == b.desc && a.nativeFormat == b.nativeFormat && a.flags == b.flags &&
+        (a.desc.downgrades == ResourceDowngradeNone || a.budget == b.budget);
+}
+
+TexturePool::TexturePool() :
+    m_cap(0),
+    m_clock(0),
+    m_stats()
+{
+}
+
+PoolEntryId TexturePool::FindIdle(const TexturePoolKey& key) const
+{
+    // the idle texture used last is the one most likely still in the caches
+    PoolEntryId best = POOL_ENTRY_NONE;
+    for (PoolEntryId i = 0; i < m_entries.size(); i++)
+    {
+        const Entry& entry = m_entries[i];
+        if (entry.used && !entry.leased && entry.key == key &&
+            (best == POOL_ENTRY_NONE || entry.lastUse > m_entries[best - 1].lastUse))
+            best = i + 1;
+    }
+    return best;
+}
+
+PoolEntryId TexturePool::Acquire(const TexturePoolKey& key, TexturePoolDevice& device)
+{
+    PoolEntryId best = FindIdle(key);
+    if (best != POOL_ENTRY_NONE)
+    {
+        Entry& entry = m_entries[best - 1];
+        entry.leased = true;
+        entry.lastUse = ++m_clock;
+        m_stats.hits++;
+        m_stats.idle--;
+        m_stats.idleBytes -= entry.bytes;
+        m_stats.leased++;
+        m_stats.leasedBytes += entry.bytes;
+        return best;
+    }
+
+    PoolEntryId id;
+    if (!m_free.empty())
+    {
+        id = m_free.back();
+        m_free.pop_back();
+    }
+    else
+    {
+        m_entries.push_back({});
+        id = (PoolEntryId)m_entries.size();
+    }
+
+    m_stats.misses++;
+    uint64_t bytes = device.Create(key, id);
+    if (bytes == 0)
+    {
+        m_free.push_back(id);
+        return POOL_ENTRY_NONE;
+    }
+
+    Entry& entry = m_entries[id - 1];
+    entry.key = key;
+    entry.bytes = bytes;
+    entry.lastUse = ++m_clock;
+    entry.used = true;
+    entry.leased = true;
+    entry.orphaned = false;
+    m_stats.leased++;
+    m_stats.leasedBytes += bytes;
+    return id;
+}
+
+void TexturePool::Release(PoolEntryId id, TexturePoolDevice& device)
+{
+    if (id == POOL_ENTRY_NONE || id > m_entries.size() || !m_entries[id - 1].leased)
+        return;
+
+    Entry& entry = m_entries[id - 1];
+    entry.leased = false;
+    entry.lastUse = ++m_clock;
+    m_stats.leased--;
+    m_stats.leasedBytes -= entry.bytes;
+    m_stats.idle++;
+    m_stats.idleBytes += entry.bytes;
+
+    if (entry.orphaned)
+    {
+        Destroy(id, device);
+        return;
+    }
+    Trim(device);
+}
+
+void TexturePool::Destroy(PoolEntryId id, TexturePoolDevice& device)
+{
+    Entry& entry = m_entries[id - 1];
+    device.Destroy(id);
+    m_stats.idle--;
+    m_stats.idleBytes -= entry.bytes;
+    entry = {};
+    m_free.push_back(id);
+}
+
+bool TexturePool::EvictOldest(TexturePoolDevice& device)
+{
+    PoolEntryId oldest = POOL_ENTRY_NONE;
+    for (PoolEntryId i = 0; i < m_entries.size(); i++)
+    {
+        const Entry& entry = m_entries[i];
+        if (entry.used && !entry.leased && (oldest == POOL_ENTRY_NONE || entry.lastUse < m_entries[oldest - 1].lastUse))
+            oldest = i + 1;
+    }
+    if (oldest == POOL_ENTRY_NONE)
+        return false;
+
+    Destroy(oldest, device);
+    m_stats.evictions++;
+    return true;
+}
+
+void TexturePool::Trim(TexturePoolDevice& device)
+{
+    while (m_stats.idleBytes > m_cap && EvictOldest(device))
+    {
+    }
+}
+
+void TexturePool::Clear(TexturePoolDevice& device)
+{
+    for (PoolEntryId i = 0; i < m_entries.size(); i++)
+    {
+        Entry& entry = m_entries[i];
+        if (!entry.used)
+            continue;
+        if (entry.leased)
+            entry.orphaned = true;
+        else
+            Destroy(i + 1, device);
+    }
+}
+
+const TexturePoolKey* TexturePool::Find(PoolEntryId id) const
+{
+    if (id == POOL_ENTRY_NONE || id > m_entries.size() || !m_entries[id - 1].used)
+        return nullptr;
+    return &m_entries[id - 1].key;
+}
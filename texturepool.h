@@ -0,0 +1,109 @@
+#pragma once
+
+// Pool of render textures kept across geometry changes.
+
+#include <stdint.h>
+#include <vector>
+
+#include "resourceregistry.h"
+
+enum TexturePoolFlags
+{
+    TexturePoolNone = 0,
+    TexturePoolGenerateMips = 1
+};
+
+// What a texture is created from. Pooled textures are only handed out for the exact
+// same description: the shaders sample them over their full size.
+struct TexturePoolKey
+{
+    // size, format and downgrades asked for, the name is not part of the key
+    ResourceDesc desc;
+    // format of the device, the registry format is coarser
+    uint32_t nativeFormat;
+    // TexturePoolFlags
+    uint32_t flags;
+    // budget a downgradable texture was allocated under, its quality depends on it
+    uint64_t budget;
+};
+
+bool operator==(const TexturePoolKey& a, const TexturePoolKey& b);
+
+typedef uint32_t PoolEntryId;
+#define POOL_ENTRY_NONE 0
+
+// Creates and destroys the textures of the pool entries, keyed by the entry id.
+class TexturePoolDevice
+{
+public:
+    // returns the bytes allocated, 0 if it failed
+    virtual uint64_t Create(const TexturePoolKey& key, PoolEntryId id) = 0;
+    virtual void Destroy(PoolEntryId id) = 0;
+
+protected:
+    ~TexturePoolDevice() = default;
+};
+
+struct TexturePoolStats
+{
+    // requests served by an idle texture, and ones that had to create a texture
+    uint64_t hits;
+    uint64_t misses;
+    // idle textures destroyed to stay under the cap, or to make room for the budget
+    uint64_t evictions;
+    uint32_t leased;
+    uint32_t idle;
+    uint64_t leasedBytes;
+    uint64_t idleBytes;
+};
+
+// not thread safe, used from the render thread
+class TexturePool
+{
+public:
+    TexturePool();
+
+    // bytes of idle textures kept, 0 keeps none
+    void SetCap(uint64_t bytes) { m_cap = bytes; }
+    uint64_t GetCap() const { return m_cap; }
+
+    // An idle texture with the same key, the most recently used one, or a new one.
+    // Returns POOL_ENTRY_NONE if the device failed to create it.
+    PoolEntryId Acquire(const TexturePoolKey& key, TexturePoolDevice& device);
+    // Back to the idle textures, the oldest idle ones are destroyed over the cap.
+    // Entries that were orphaned by Clear are destroyed right away.
+    void Release(PoolEntryId id, TexturePoolDevice& device);
+
+    // the most recently used idle entry with the key, POOL_ENTRY_NONE if there is none
+    PoolEntryId FindIdle(const TexturePoolKey& key) const;
+    // destroys the least recently used idle texture, false if there is none
+    bool EvictOldest(TexturePoolDevice& device);
+    // destroys the least recently used idle textures over the cap
+    void Trim(TexturePoolDevice& device);
+    // destroys every idle texture, the leased ones are destroyed when they are released
+    void Clear(TexturePoolDevice& device);
+
+    // key of a leased or idle entry, nullptr otherwise
+    const TexturePoolKey* Find(PoolEntryId id) const;
+    TexturePoolStats GetStats() const { return m_stats; }
+
+private:
+    struct Entry
+    {
+        TexturePoolKey key;
+        uint64_t bytes;
+        // Acquire or Release count of the last use, orders the idle entries
+        uint64_t lastUse;
+        bool used;
+        bool leased;
+        bool orphaned;
+    };
+
+    void Destroy(PoolEntryId id, TexturePoolDevice& device);
+
+    std::vector<Entry> m_entries;
+    std::vector<PoolEntryId> m_free;
+    uint64_t m_cap;
+    uint64_t m_clock;
+    TexturePoolStats m_stats;
+};
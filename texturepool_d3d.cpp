@@ -0,0 +1,159 @@
+#include "texturepool_d3d.h"
+
+#include <string.h>
+
+D3DTexturePool::D3DTexturePool() : m_hr(S_OK)
+{
+    // constructed first, so the registry outlives the pooled textures
+    GetResourceRegistry();
+}
+
+PoolEntryId D3DTexturePool::Acquire(ID3D11Device* device, const TexturePoolKey& key, DXGI_FORMAT format)
+{
+    if (device != m_device.Get())
+    {
+        m_pool.Clear(*this);
+        m_device = device;
+    }
+
+    // idle textures count against the budget, they go before a new texture is downgraded
+    ResourceRegistry& registry = GetResourceRegistry();
+    if (registry.GetBudget() > 0 && m_pool.FindIdle(key) == POOL_ENTRY_NONE)
+    {
+        while (registry.GetTotalBytes() + GetResourceBytes(key.desc) > registry.GetBudget() && m_pool.EvictOldest(*this))
+        {
+        }
+    }
+
+    m_format = format;
+    return m_pool.Acquire(key, *this);
+}
+
+bool D3DTexturePool::Adopt(ID3D11Device* device, const TexturePoolKey& key, const TextureView& view)
+{
+    if (device != m_device.Get() || !view.GetTexture() || m_pool.FindIdle(key) != POOL_ENTRY_NONE)
+        return false;
+
+    // warming never pushes a texture in use down to a lower quality
+    ResourceRegistry& registry = GetResourceRegistry();
+    if (registry.GetBudget() > 0 && registry.GetTotalBytes() + GetResourceBytes(key.desc) > registry.GetBudget())
+        return false;
+
+    m_format = (DXGI_FORMAT)key.nativeFormat;
+    m_adopted = &view;
+    PoolEntryId id = m_pool.Acquire(key, *this);
+    m_adopted = nullptr;
+    if (id == POOL_ENTRY_NONE)
+        return false;
+    m_pool.Release(id, *this);
+    return true;
+}
+
+UINT64 D3DTexturePool::Create(const TexturePoolKey& key, PoolEntryId id)
+{
+    if (m_views.size() < id)
+        m_views.resize(id);
+
+    ResourceId resource = RESOURCE_ID_NONE;
+    ResourceGrant grant = {};
+    bool generateMips = (key.flags & TexturePoolGenerateMips) != 0;
+    m_hr = AllocateResource(key.desc, [&](const ResourceDesc& granted, ResourceId resourceId)
+    {
+        D3D11_TEXTURE2D_DESC desc = GetTextureDesc(granted, m_format, generateMips);
+
+        // a prewarmed texture is only taken at the quality it was created at
+        D3D11_TEXTURE2D_DESC full = GetTextureDesc(key.desc, m_format, generateMips);
+        if (m_adopted && memcmp(&desc, &full, sizeof(desc)) == 0)
+        {
+            HRESULT result = TrackResource(m_adopted->GetTexture(), resourceId);
+            if (SUCCEEDED(result))
+                m_views[id - 1] = *m_adopted;
+            return result;
+        }
+
+        ComPtr<ID3D11Texture2D> texture;
+        HRESULT result = m_device->CreateTexture2D(&desc, nullptr, &texture);
+        if (SUCCEEDED(result))
+            result = TrackResource(texture.Get(), resourceId);
+        if (SUCCEEDED(result))
+            m_views[id - 1].CreateViews(m_device.Get(), texture.Get());
+        return result;
+    }, &resource, &grant);
+
+    if (FAILED(m_hr))
+    {
+        m_views[id - 1].Clear();
+        return 0;
+    }
+    m_views[id - 1].m_resource = resource;
+    return grant.bytes;
+}
+
+void D3DTexturePool::Destroy(PoolEntryId id)
+{
+    // the registry record goes with the last reference to the texture
+    m_views[id - 1].Clear();
+}
+
+D3D11_TEXTURE2D_DESC D3DTexturePool::GetTextureDesc(const ResourceDesc& granted, DXGI_FORMAT format, bool generateMips)
+{
+    D3D11_TEXTURE2D_DESC desc = {};
+    desc.Width = granted.width;
+    desc.Height = granted.height;
+    desc.MipLevels = granted.mipLevels;
+    desc.ArraySize = 1;
+    desc.Format = ToDxgiFormat(granted.format, format);
+    desc.SampleDesc.Count = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET | D3D11_BIND_UNORDERED_ACCESS;
+    desc.CPUAccessFlags = 0;
+    desc.MiscFlags = generateMips ? D3D11_RESOURCE_MISC_GENERATE_MIPS : 0;
+    return desc;
+}
+
+D3DTexturePool& GetTexturePool()
+{
+    static D3DTexturePool pool;
+    return pool;
+}
+
+HRESULT TextureView::RecreateTexture(ID3D11Device* device, DXGI_FORMAT format, UINT width, UINT height, UINT mipLevels,
+    bool generateMips, ResourceOwner owner, const char* name, UINT downgrades)
+{
+    D3DTexturePool& pool = GetTexturePool();
+    ResourceDesc wanted = { owner, name, width, height, ToResourceFormat(format), mipLevels, 1, downgrades };
+    TexturePoolKey key = { wanted, (uint32_t)format, generateMips ? TexturePoolGenerateMips : TexturePoolNone,
+        GetResourceRegistry().GetBudget() };
+
+    // The old texture goes back to the pool once the new one is leased, so the pool does
+    // not evict the texture asked for to make room for the one returned.
+    std::shared_ptr<TextureLease> previous = m_lease;
+
+    // a texture that may be downgraded picks its quality again when the budget changed,
+    // the one it had stays in the pool for when the budget goes back
+    if (GetTexture())
+    {
+        const TexturePoolKey* leased = m_lease ? pool.GetPool().Find(m_lease->GetId()) : nullptr;
+        if (!leased || !(*leased == key) || pool.GetDevice() != device)
+        {
+            Clear();
+        }
+    }
+
+    if (width == 0 || height == 0)
+    {
+        return DXGI_ERROR_INVALID_CALL;
+    }
+
+    if (!GetTexture())
+    {
+        PoolEntryId id = pool.Acquire(device, key, format);
+        if (id == POOL_ENTRY_NONE)
+            return pool.GetLastResult();
+
+        *this = pool.GetView(id);
+        m_lease = std::make_shared<TextureLease>(id);
+    }
+    return S_OK;
+}
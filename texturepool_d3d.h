@@ -0,0 +1,71 @@
+#pragma once
+
+// The D3D side of the texture pool.
+
+#include "common.h"
+#include "texturepool.h"
+
+class D3DTexturePool : public TexturePoolDevice
+{
+public:
+    D3DTexturePool();
+
+    // Leases a texture for key, created on device. Idle textures of another device are
+    // dropped first.
+    PoolEntryId Acquire(ID3D11Device* device, const TexturePoolKey& key, DXGI_FORMAT format);
+    void Release(PoolEntryId id) { m_pool.Release(id, *this); }
+
+    // Hands a texture created ahead of time for key, see TexturePrewarmer, to the pool as
+    // an idle texture. It has to be the one GetTextureDesc describes for the key. Returns
+    // false and drops it when the pool has the key already, or it is over the budget.
+    bool Adopt(ID3D11Device* device, const TexturePoolKey& key, const TextureView& view);
+
+    // bytes of idle textures kept
+    void SetCap(UINT64 bytes)
+    {
+        m_pool.SetCap(bytes);
+        m_pool.Trim(*this);
+    }
+
+    ID3D11Device* GetDevice() const { return m_device.Get(); }
+    // the texture and views of a leased entry
+    const TextureView& GetView(PoolEntryId id) const { return m_views[id - 1]; }
+    const TexturePool& GetPool() const { return m_pool; }
+    // result of the last texture the pool failed to create
+    HRESULT GetLastResult() const { return m_hr; }
+
+    UINT64 Create(const TexturePoolKey& key, PoolEntryId id) override;
+    void Destroy(PoolEntryId id) override;
+
+    // the texture made for a granted desc, format is the one asked for
+    static D3D11_TEXTURE2D_DESC GetTextureDesc(const ResourceDesc& granted, DXGI_FORMAT format, bool generateMips);
+
+private:
+    TexturePool m_pool;
+    ComPtr<ID3D11Device> m_device;
+    // format of the texture being created
+    DXGI_FORMAT m_format = DXGI_FORMAT_UNKNOWN;
+    // texture Create takes instead of making one, during Adopt
+    const TextureView* m_adopted = nullptr;
+    std::vector<TextureView> m_views;
+    HRESULT m_hr;
+};
+
+// the texture pool of the app's device
+D3DTexturePool& GetTexturePool();
+
+// Hands a pooled texture back when the last copy of the TextureView holding it goes.
+class TextureLease
+{
+public:
+    TextureLease(PoolEntryId id) : m_id(id) {}
+    ~TextureLease() { GetTexturePool().Release(m_id); }
+
+    PoolEntryId GetId() const { return m_id; }
+
+private:
+    TextureLease(const TextureLease&) = delete;
+    TextureLease& operator=(const TextureLease&) = delete;
+
+    PoolEntryId m_id;
+};
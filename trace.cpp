@@ -0,0 +1,167 @@
+#include "trace.h"
+
+#ifdef AMBIENTLIGHT_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+struct TraceEvent
+{
+    const char* name;
+    int64_t timestamp;
+    uint64_t frame;
+    int64_t value;
+    TraceArg args[TRACE_MAX_ARGS];
+    uint32_t argCount;
+    char phase;
+};
+
+struct TraceBuffer
+{
+    uint32_t threadId;
+    // events written so far, the ring holds the last TRACE_BUFFER_EVENTS of them
+    std::atomic<uint64_t> head;
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+};
+
+// only taken when a thread records its first event, and by the dump
+static std::mutex g_buffersLock;
+// never freed, a thread may exit before the dump
+static std::vector<TraceBuffer*> g_buffers;
+static std::atomic<uint64_t> g_frame(0);
+static const std::chrono::steady_clock::time_point g_start = std::chrono::steady_clock::now();
+
+static TraceBuffer* GetThreadBuffer()
+{
+    thread_local TraceBuffer* buffer = nullptr;
+    if (!buffer)
+    {
+        buffer = new TraceBuffer();
+        buffer->head.store(0, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(g_buffersLock);
+        buffer->threadId = (uint32_t)g_buffers.size() + 1;
+        g_buffers.push_back(buffer);
+    }
+    return buffer;
+}
+
+static void Record(char phase, const char* name, int64_t value, const TraceArg* args, uint32_t argCount)
+{
+    TraceBuffer* buffer = GetThreadBuffer();
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+
+    TraceEvent& event = buffer->events[head % TRACE_BUFFER_EVENTS];
+    event.phase = phase;
+    event.name = name;
+    event.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - g_start).count();
+    event.frame = g_frame.load(std::memory_order_relaxed);
+    event.value = value;
+    event.argCount = argCount < TRACE_MAX_ARGS ? argCount : TRACE_MAX_ARGS;
+    for (uint32_t i = 0; i < event.argCount; i++)
+        event.args[i] = args[i];
+
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void TraceBegin(const char* name)
+{
+    Record('B', name, 0, nullptr, 0);
+}
+
+void TraceEnd(const char* name)
+{
+    Record('E', name, 0, nullptr, 0);
+}
+
+void TraceCounter(const char* name, int64_t value)
+{
+    Record('C', name, value, nullptr, 0);
+}
+
+void TraceInstant(const char* name, const TraceArg* args, uint32_t argCount)
+{
+    Record('i', name, 0, args, argCount);
+}
+
+void TraceSetFrame(uint64_t frame)
+{
+    g_frame.store(frame, std::memory_order_relaxed);
+}
+
+static void WriteString(std::ofstream& out, const char* text)
+{
+    out << '"';
+    for (const char* c = text; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            out << '\\';
+        out << *c;
+    }
+    out << '"';
+}
+
+bool TraceDump(const TracePathChar* path)
+{
+    std::ofstream out(std::filesystem::path(path), std::ios::out | std::ios::trunc);
+    if (!out)
+        return false;
+
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+
+    std::lock_guard<std::mutex> lock(g_buffersLock);
+    for (TraceBuffer* buffer : g_buffers)
+    {
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t start = 0;
+        if (head > TRACE_BUFFER_EVENTS)
+        {
+            // the owning thread keeps writing, stay clear of the slots it is about to reuse
+            start = head - TRACE_BUFFER_EVENTS + 64;
+        }
+
+        for (uint64_t i = start; i < head; i++)
+        {
+            const TraceEvent& event = buffer->events[i % TRACE_BUFFER_EVENTS];
+
+            out << (first ? "" : ",\n");
+            first = false;
+
+            out << "{\"name\":";
+            WriteString(out, event.name);
+            out << ",\"ph\":\"" << event.phase << "\",\"ts\":" << event.timestamp / 1000.0
+                << ",\"pid\":1,\"tid\":" << buffer->threadId;
+            if (event.phase == 'i')
+                out << ",\"s\":\"t\"";
+
+            out << ",\"args\":{";
+            if (event.phase == 'C')
+            {
+                WriteString(out, event.name);
+                out << ":" << event.value;
+            }
+            else
+            {
+                out << "\"frame\":" << event.frame;
+                for (uint32_t a = 0; a < event.argCount; a++)
+                {
+                    out << ",";
+                    WriteString(out, event.args[a].name);
+                    out << ":" << event.args[a].value;
+                }
+            }
+            out << "}}";
+        }
+    }
+
+    out << "\n]}\n";
+    return out.good();
+}
+
+#endif
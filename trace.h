@@ -0,0 +1,67 @@
+#pragma once
+
+// Frame pipeline tracing in the Chrome trace event format, compiled out without AMBIENTLIGHT_TRACE.
+
+#include <stdint.h>
+
+struct TraceArg
+{
+    const char* name;
+    int64_t value;
+};
+
+#ifdef AMBIENTLIGHT_TRACE
+
+// events per thread
+#define TRACE_BUFFER_EVENTS 8192
+#define TRACE_MAX_ARGS 4
+
+// names must be string literals or otherwise outlive the trace
+void TraceBegin(const char* name);
+void TraceEnd(const char* name);
+void TraceCounter(const char* name, int64_t value);
+void TraceInstant(const char* name, const TraceArg* args, uint32_t argCount);
+
+// frame number attached to every event recorded from now on
+void TraceSetFrame(uint64_t frame);
+
+// the path in the native encoding, std::filesystem::path::c_str()
+#ifdef _WIN32
+typedef wchar_t TracePathChar;
+#else
+typedef char TracePathChar;
+#endif
+bool TraceDump(const TracePathChar* path);
+
+struct TraceScope
+{
+    const char* name;
+    TraceScope(const char* n) : name(n) { TraceBegin(name); }
+    ~TraceScope() { TraceEnd(name); }
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_BEGIN(name) TraceBegin(name)
+#define TRACE_END(name) TraceEnd(name)
+#define TRACE_COUNTER(name, value) TraceCounter(name, value)
+// TRACE_INSTANT("name", { "arg", value }, ...)
+#define TRACE_INSTANT(name, ...) \
+    do { const TraceArg traceArgs[] = { { "", 0 }, __VA_ARGS__ }; \
+        TraceInstant(name, traceArgs + 1, (uint32_t)(sizeof(traceArgs) / sizeof(traceArgs[0]) - 1)); } while (0)
+#define TRACE_SET_FRAME(frame) TraceSetFrame(frame)
+#define TRACE_DUMP(path) TraceDump(path)
+
+#else
+
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_COUNTER(name, value) ((void)0)
+#define TRACE_INSTANT(name, ...) ((void)0)
+#define TRACE_SET_FRAME(frame) ((void)0)
+#define TRACE_DUMP(path) (false)
+
+#endif
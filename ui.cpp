@@ -133,7 +133,89 @@ void InitUI(HWND hwnd, ID3D11Device* device, ID3D11DeviceContext* device_context
 }
 
 
-bool RenderUI(HWND hwnd, AppSettings& settings, UINT gameWidth, UINT gameHeight, bool resetPos)
+#define PERF_HISTORY_SIZE 240
+
+// stage times of the last frames, kept on the UI side so the snapshot stays small
+struct PerfHistory
+{
+    float stageMs[PerfStageCount][PERF_HISTORY_SIZE] = {};
+    int offset = 0;
+    int count = 0;
+    PerfSnapshot last = {};
+};
+
+static PerfHistory perfHistory;
+
+static void RenderPerfPanel(const PerfSnapshotBuffer* perf)
+{
+    if (!perf)
+        return;
+
+    // a failed read means the render thread is publishing, keep the last snapshot
+    PerfSnapshot snapshot = perfHistory.last;
+    perf->Read(snapshot);
+    if (snapshot.frame != perfHistory.last.frame)
+    {
+        for (int i = 0; i < PerfStageCount; i++)
+            perfHistory.stageMs[i][perfHistory.offset] = (float)snapshot.stageMs[i];
+        perfHistory.offset = (perfHistory.offset + 1) % PERF_HISTORY_SIZE;
+        perfHistory.count = min(perfHistory.count + 1, PERF_HISTORY_SIZE);
+    }
+    perfHistory.last = snapshot;
+
+    ImGui::Text("Frame rate %.1f / %llu fps", snapshot.achievedFps, snapshot.targetFps);
+    ImGui::SameLine(); HelpMarker("Achieved and target frame rate of the effect.\n"
+        "While this window is open the UI is drawn as well, and the frame rate is not lowered.");
+
+    ImGui::SeparatorText("Stages (ms)");
+    for (int i = 0; i < PerfStageCount; i++)
+    {
+        float average = 0.0f;
+        float peak = 0.0f;
+        for (int j = 0; j < perfHistory.count; j++)
+        {
+            average += perfHistory.stageMs[i][j];
+            peak = max(peak, perfHistory.stageMs[i][j]);
+        }
+        if (perfHistory.count > 0)
+            average /= perfHistory.count;
+
+        char overlay[64];
+        sprintf_s(overlay, "avg %.3f  max %.3f", average, peak);
+        ImGui::PlotLines(PerfStageName((PerfStage)i), perfHistory.stageMs[i], PERF_HISTORY_SIZE, perfHistory.offset,
+            overlay, 0.0f, peak > 0.0f ? peak * 1.2f : 1.0f, ImVec2(0, 40));
+    }
+
+    ImGui::SeparatorText("Detection");
+    double hitRate = snapshot.detections ? 100.0 * snapshot.detectionHits / snapshot.detections : 0.0;
+    ImGui::Text("%llu passes, %.0f%% found bars, %llu changes, %llu held back", snapshot.detections, hitRate,
+        snapshot.detectionChanges, snapshot.detectionsAvoided);
+
+    ImGui::SeparatorText("Capture");
+    UINT64 captures = snapshot.capturesProcessed + snapshot.capturesSkipped;
+    ImGui::Text("%llu processed, %llu skipped (%.0f%%)", snapshot.capturesProcessed, snapshot.capturesSkipped,
+        captures ? 100.0 * snapshot.capturesSkipped / captures : 0.0);
+    ImGui::SameLine(); HelpMarker("Skipped frames reuse the last capture, because of the capture rate\n"
+        "with interpolation, or because the desktop did not change.");
+
+    ImGui::SeparatorText("Memory");
+    ImGui::Text("Textures %.1f MB", snapshot.textureBytes / (1024.0 * 1024.0));
+    if (snapshot.resourceBudget > 0)
+    {
+        ImGui::SameLine();
+        ImGui::Text("of %.0f MB budget, %llu downgraded", snapshot.resourceBudget / (1024.0 * 1024.0), snapshot.resourcesDowngraded);
+    }
+    for (int i = 0; i < ResourceOwnerCount; i++)
+    {
+        ImGui::BulletText("%s %.1f MB", ResourceOwnerName((ResourceOwner)i), snapshot.resourceBytes[i] / (1024.0 * 1024.0));
+    }
+    UINT64 poolRequests = snapshot.poolHits + snapshot.poolMisses;
+    ImGui::Text("Pool %.1f MB kept, %.0f%% reused, %llu prewarmed", snapshot.poolIdleBytes / (1024.0 * 1024.0),
+        poolRequests ? 100.0 * snapshot.poolHits / poolRequests : 0.0, snapshot.poolPrewarmed);
+}
+
+bool RenderUI(HWND hwnd, AppSettings& settings, UINT gameWidth, UINT gameHeight, bool resetPos,
+    const PerfSnapshotBuffer* perf)
 {
     // Start the Dear ImGui frame
     ImGui_ImplDX11_NewFrame();
@@ -157,7 +239,7 @@ bool RenderUI(HWND hwnd, AppSettings& settings, UINT gameWidth, UINT gameHeight,
     {
         if (ImGui::BeginTabItem("Game/Content Resolution"))
         {
-            auto displays = GetAvailableDisplays();
+            const auto& displays = GetAvailableDisplays();
 
             if (1 < displays.size())
             {
@@ -246,6 +328,27 @@ bool RenderUI(HWND hwnd, AppSettings& settings, UINT gameWidth, UINT gameHeight,
                     {
                         SaveSettings(settings);
                     }
+                    if (ImGui::DragInt("Detection Confirmations", (int*)&settings.autoDetectionConfirmations, 0.1f, 1, 20))
+                    {
+                        SaveSettings(settings);
+                    }
+                    if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
+                    {
+                        ImGui::SetTooltip(
+                            "Detection passes in a row a new bar size has to be found on before it is applied.\n"
+                            "Keeps dark scenes and fades from resizing the effect back and forth.\n"
+                            "A size found right after a scene cut is applied at once.\n"
+                            "1 applies every change immediately.");
+                    }
+                    if (ImGui::DragInt("Detection Jitter", (int*)&settings.autoDetectionJitter, 0.1f, 0, 64, "%d px"))
+                    {
+                        SaveSettings(settings);
+                    }
+                    if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
+                    {
+                        ImGui::SetTooltip(
+                            "Bar size changes up to this many pixels are ignored.");
+                    }
 
                     if (ImGui::Checkbox("Symmetric", &settings.autoDetectionSymmetricBars))
                     {
@@ -383,6 +486,40 @@ bool RenderUI(HWND hwnd, AppSettings& settings, UINT gameWidth, UINT gameHeight,
                 SaveSettings(settings);
             }
 
+            if (ImGui::Checkbox("Adaptive frame rate", &settings.adaptiveFrameRate))
+                SaveSettings(settings);
+            if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
+            {
+                ImGui::SetTooltip(
+                    "Lower the frame rate while the picture is static or moving slowly,\n"
+                    "and go back up to the frame rate above on fast motion or scene cuts.");
+            }
+
+            if (settings.adaptiveFrameRate)
+            {
+                if (ImGui::DragInt("Min frame rate", (int*)&settings.minFrameRate, 0.1f, 10, (int)settings.frameRate))
+                {
+                    SaveSettings(settings);
+                }
+            }
+
+            if (ImGui::Checkbox("Interpolate", &settings.temporalInterpolation))
+                SaveSettings(settings);
+            if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
+            {
+                ImGui::SetTooltip(
+                    "Capture and blur at a lower rate, and blend between the last two\n"
+                    "captures at the frame rate. Adds up to one capture period of latency.");
+            }
+
+            if (settings.temporalInterpolation)
+            {
+                if (ImGui::DragInt("Capture rate", (int*)&settings.captureRate, 0.1f, 10, (int)settings.frameRate))
+                {
+                    SaveSettings(settings);
+                }
+            }
+
             if (ImGui::DragInt("Zoom", (int*)&settings.zoom, 1, 0, 16))
             {
                 settings.zoom = std::clamp(settings.zoom, 0u, 16u);
@@ -395,6 +532,82 @@ bool RenderUI(HWND hwnd, AppSettings& settings, UINT gameWidth, UINT gameHeight,
             if (ImGui::Checkbox("Mirrored", &settings.mirrored))
                 SaveSettings(settings);
 
+            if (ImGui::Checkbox("Bar Surfaces", &settings.barSurfaces))
+                SaveSettings(settings);
+            if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
+            {
+                ImGui::SetTooltip(
+                    "Present each bar through its own small surface instead of a full screen one.\n"
+                    "Reduces video memory and compositor work, mostly on very wide displays.");
+            }
+
+            if (settings.barSurfaces)
+            {
+                if (ImGui::DragInt("Surface Downscale", (int*)&settings.barSurfaceScale, 0.1f, 1, 8))
+                {
+                    SaveSettings(settings);
+                }
+                if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
+                {
+                    ImGui::SetTooltip("Render the bar surfaces at a fraction of the resolution and let the compositor upscale them.");
+                }
+            }
+
+            ImGui::EndTabItem();
+        }
+
+        if (perf && ImGui::BeginTabItem("Performance"))
+        {
+            RenderPerfPanel(perf);
+
+            int memoryBudget = settings.memoryBudget;
+            if (ImGui::InputInt("Memory budget (MB)", &memoryBudget, 64, 256, ImGuiInputTextFlags_EnterReturnsTrue))
+            {
+                settings.memoryBudget = max(0, memoryBudget);
+                SaveSettings(settings);
+            }
+            ImGui::SameLine(); HelpMarker("Video memory the effect may use, 0 for no limit.\n"
+                "Over the budget the blur works on a smaller mip and, in HDR, at lower precision.\n"
+                "The game texture, canvas and swapchains are never reduced.");
+
+            int poolSize = settings.texturePoolSize;
+            if (ImGui::InputInt("Texture pool (MB)", &poolSize, 64, 256, ImGuiInputTextFlags_EnterReturnsTrue))
+            {
+                settings.texturePoolSize = max(0, poolSize);
+                SaveSettings(settings);
+            }
+            ImGui::SameLine(); HelpMarker("Textures no longer used are kept up to this size, so switching\n"
+                "back to a recent aspect ratio reuses them instead of creating new ones.\n"
+                "Counts against the memory budget, 0 keeps none.");
+
+            if (ImGui::Checkbox("Prewarm presets", &settings.prewarm))
+            {
+                SaveSettings(settings);
+            }
+            ImGui::SameLine(); HelpMarker("Create the textures of the other resolution presets in the\n"
+                "background after startup, so the first switch to one does not wait for them.\n"
+                "They are kept in the texture pool and limited by its size.");
+
+            ImGui::SeparatorText("Monitoring");
+            if (ImGui::Checkbox("Metrics endpoint", &settings.metricsEnabled))
+            {
+                SaveSettings(settings);
+            }
+            ImGui::SameLine(); HelpMarker("Serve these statistics in the Prometheus text format\n"
+                "on http://127.0.0.1:<port>/metrics, reachable from this machine only.");
+            if (settings.metricsEnabled)
+            {
+                int port = settings.metricsPort;
+                if (ImGui::InputInt("Port", &port, 0, 0, ImGuiInputTextFlags_EnterReturnsTrue))
+                {
+                    settings.metricsPort = max(1, min(port, 65535));
+                    SaveSettings(settings);
+                }
+                if (ImGui::IsItemHovered())
+                {
+                    ImGui::SetTooltip("Press Enter to apply.");
+                }
+            }
             ImGui::EndTabItem();
         }
 
@@ -415,6 +628,16 @@ bool RenderUI(HWND hwnd, AppSettings& settings, UINT gameWidth, UINT gameHeight,
                 SaveSettings(settings);
             }
 
+#ifdef AMBIENTLIGHT_TRACE
+            if (ImGui::Button("Save trace"))
+            {
+                TRACE_DUMP(GetDataFile(L"trace.json").c_str());
+            }
+            ImGui::SameLine(); HelpMarker("Write the recent frame pipeline events to trace.json\n"
+                "next to the config file, open it in chrome://tracing or Perfetto.\n"
+                "A trace is also written on exit.");
+#endif
+
             ImGui::EndTabItem();
         }
 
@@ -1,10 +1,12 @@
 #pragma once
 #include "settings.h"
+#include "perfstats.h"
 #include "imgui/imgui.h"
 #include "imgui/backends/imgui_impl_win32.h"
 #include "imgui/backends/imgui_impl_dx11.h"
 
 LRESULT UiWndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam);
 void InitUI(HWND hwnd, ID3D11Device* device, ID3D11DeviceContext* device_context, AppSettings& settings);
-bool RenderUI(HWND hwnd, AppSettings& settings, UINT gameWidth, UINT gameHeight, bool resetPos);
+bool RenderUI(HWND hwnd, AppSettings& settings, UINT gameWidth, UINT gameHeight, bool resetPos,
+    const PerfSnapshotBuffer* perf = nullptr);
 void UpdateWindowFlags(HWND hwnd, AppSettings& settings);
\ No newline at end of file